@@ -0,0 +1,284 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/App/AttributesTools.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Model/Codon/TripletSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
+#include <Bpp/Phyl/Model/MixtureOfSubstitutionModels.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Protein/LG08.h>
+#include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Tree/PhyloTreeTools.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Simulation/SimpleSubstitutionProcessSequenceSimulator.h>
+#include <Bpp/Phyl/Likelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+#include <Bpp/Phyl/OptimizationTools.h>
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+/*
+ * Benchmark of the likelihood engine on simulated data sets.
+ *
+ * For each combination of alphabet, number of taxa, number of sites,
+ * rate distribution and model, a random tree and an alignment are
+ * simulated with a fixed seed, and the following steps are timed:
+ * - construction of the dataflow graph,
+ * - first evaluation of the likelihood,
+ * - re-evaluation after a change of a single branch length,
+ * - first order derivatives for all branch lengths (first call, with
+ *   the construction of the derivative graph, then after a change),
+ * - full optimization of the parameters (optional).
+ *
+ * Results are written as JSON, one object per data set. Options are
+ * given as key=value arguments:
+ *
+ *   alphabets=DNA,Protein,Codon   taxa=16,4096   sites=1000,1000000
+ *   rates=Constant,Gamma4         models=Single,Mixture,Word
+ *   seed=1  reevaluations=20  optimization=yes  optimization.max_evaluations=1000
+ *   output.file=bench_likelihood.json
+ *
+ * The Word model is a triplet model of independent nucleotide
+ * positions, for the Codon alphabet only, which is computed in
+ * Kronecker-factored form.
+ *
+ * Default values give a run of a few seconds.
+ */
+
+namespace
+{
+class Timer
+{
+private:
+  chrono::steady_clock::time_point start_;
+
+public:
+  Timer() : start_(chrono::steady_clock::now()) {}
+
+  /**
+   * @return The time since the last call, in seconds.
+   */
+  double lap()
+  {
+    auto now = chrono::steady_clock::now();
+    double t = chrono::duration<double>(now - start_).count();
+    start_ = now;
+    return t;
+  }
+};
+
+shared_ptr<SubstitutionModelInterface> buildModel(const string& alphabetName, const string& modelName)
+{
+  if (modelName == "Word")
+  {
+    if (alphabetName != "Codon")
+      throw Exception("bench_likelihood: the Word model is only available for the Codon alphabet.");
+    auto gc = make_shared<StandardGeneticCode>(AlphabetTools::DNA_ALPHABET);
+    auto alphabet = dynamic_pointer_cast<const CodonAlphabet>(gc->getSourceAlphabet());
+    return make_shared<TripletSubstitutionModel>(alphabet,
+        make_unique<T92>(AlphabetTools::DNA_ALPHABET, 3.),
+        make_unique<K80>(AlphabetTools::DNA_ALPHABET, 2.),
+        make_unique<T92>(AlphabetTools::DNA_ALPHABET, 5., 0.4));
+  }
+
+  unique_ptr<SubstitutionModelInterface> model;
+  if (alphabetName == "DNA")
+    model = make_unique<T92>(AlphabetTools::DNA_ALPHABET, 3., 0.6);
+  else if (alphabetName == "Protein")
+    model = make_unique<LG08>(AlphabetTools::PROTEIN_ALPHABET);
+  else if (alphabetName == "Codon")
+  {
+    auto gc = make_shared<StandardGeneticCode>(AlphabetTools::DNA_ALPHABET);
+    model = make_unique<YN98>(gc, CodonFrequencySetInterface::getFrequencySetForCodons(CodonFrequencySetInterface::F3X4, gc));
+  }
+  else
+    throw Exception("bench_likelihood: unknown alphabet " + alphabetName);
+
+  if (modelName == "Single")
+    return std::move(model);
+  if (modelName != "Mixture")
+    throw Exception("bench_likelihood: unknown model " + modelName);
+
+  auto alphabet = model->getAlphabet();
+  vector<unique_ptr<TransitionModelInterface>> models;
+  models.push_back(unique_ptr<TransitionModelInterface>(model->clone()));
+  models.push_back(std::move(model));
+  return make_shared<MixtureOfSubstitutionModels>(alphabet, models);
+}
+
+shared_ptr<DiscreteDistributionInterface> buildRates(const string& ratesName)
+{
+  if (ratesName == "Constant")
+    return make_shared<ConstantRateDistribution>();
+  if (ratesName == "Gamma4")
+    return make_shared<GammaDiscreteRateDistribution>(4, 0.5);
+  throw Exception("bench_likelihood: unknown rate distribution " + ratesName);
+}
+
+shared_ptr<PhyloTree> buildTree(size_t nbTaxa)
+{
+  vector<string> names;
+  for (size_t i = 0; i < nbTaxa; ++i)
+  {
+    names.push_back("T" + TextTools::toString(i + 1));
+  }
+  auto tree = TreeTemplateTools::getRandomTree(names, false);
+  for (auto* node : tree->getNodes())
+  {
+    if (node->hasFather())
+      node->setDistanceToFather(RandomTools::randExponential(0.05) + 0.001);
+  }
+  return PhyloTreeTools::buildFromTreeTemplate(*tree);
+}
+}
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    map<string, string> params = AttributesTools::parseOptions(argc, argv);
+
+    vector<string> alphabets = ApplicationTools::getVectorParameter<string>("alphabets", params, ',', "DNA");
+    vector<size_t> taxa = ApplicationTools::getVectorParameter<size_t>("taxa", params, ',', "16,64");
+    vector<size_t> sites = ApplicationTools::getVectorParameter<size_t>("sites", params, ',', "1000,10000");
+    vector<string> rates = ApplicationTools::getVectorParameter<string>("rates", params, ',', "Gamma4");
+    vector<string> models = ApplicationTools::getVectorParameter<string>("models", params, ',', "Single");
+    unsigned int seed = ApplicationTools::getParameter<unsigned int>("seed", params, 1);
+    unsigned int nbReeval = ApplicationTools::getParameter<unsigned int>("reevaluations", params, 20);
+    bool optimize = ApplicationTools::getBooleanParameter("optimization", params, true);
+    unsigned int nbEvalMax = ApplicationTools::getParameter<unsigned int>("optimization.max_evaluations", params, 1000);
+    string outputPath = ApplicationTools::getAFilePath("output.file", params, false, false, "", true, "bench_likelihood.json");
+
+    ofstream out(outputPath.c_str(), ios::out);
+    if (!out)
+      throw IOException("bench_likelihood: could not open file " + outputPath);
+    out << "{\n  \"benchmark\": \"bench_likelihood\",\n  \"seed\": " << seed << ",\n  \"results\": [";
+    out << setprecision(12);
+
+    bool first = true;
+    for (const auto& alphabetName : alphabets)
+    {
+      for (auto nbTaxa : taxa)
+      {
+        for (auto nbSites : sites)
+        {
+          for (const auto& ratesName : rates)
+          {
+            for (const auto& modelName : models)
+            {
+              string label = alphabetName + "/" + TextTools::toString(nbTaxa) + " taxa/" + TextTools::toString(nbSites) + " sites/" + ratesName + "/" + modelName;
+              ApplicationTools::displayMessage(label);
+
+              // Every data set is simulated from the same seed.
+              RandomTools::setSeed(seed);
+              auto model = buildModel(alphabetName, modelName);
+              auto rdist = buildRates(ratesName);
+              auto tree = make_shared<ParametrizablePhyloTree>(*buildTree(nbTaxa));
+              auto process = make_shared<RateAcrossSitesSubstitutionProcess>(model, rdist, tree);
+              SimpleSubstitutionProcessSequenceSimulator simulator(process);
+              shared_ptr<const AlignmentDataInterface> data = simulator.simulate(nbSites);
+
+              Timer timer;
+              Context context;
+              auto likCal = make_shared<LikelihoodCalculationSingleProcess>(context, data, process);
+              auto llh = make_shared<SingleProcessPhyloLikelihood>(context, likCal);
+              double construction = timer.lap();
+
+              double lnL = llh->getLogLikelihood();
+              double firstEvaluation = timer.lap();
+
+              auto brLenNames = llh->getBranchLengthParameters().getParameterNames();
+              string brLen = brLenNames[0];
+              double x = llh->getParameterValue(brLen);
+              timer.lap();
+              for (unsigned int i = 0; i < nbReeval; ++i)
+              {
+                llh->setParameterValue(brLen, (i % 2 == 0) ? x * 1.1 : x);
+                llh->getValue();
+              }
+              double reevaluation = nbReeval > 0 ? timer.lap() / nbReeval : 0;
+
+              for (const auto& name : brLenNames)
+              {
+                llh->getFirstOrderDerivative(name);
+              }
+              double firstGradient = timer.lap();
+              llh->setParameterValue(brLen, x * 1.1);
+              timer.lap();
+              for (const auto& name : brLenNames)
+              {
+                llh->getFirstOrderDerivative(name);
+              }
+              double gradient = timer.lap();
+              llh->setParameterValue(brLen, x);
+
+              double optimization = 0;
+              unsigned int nbEval = 0;
+              double lnLOpt = lnL;
+              if (optimize)
+              {
+                timer.lap();
+                nbEval = OptimizationTools::optimizeNumericalParameters2(
+                      llh, llh->getParameters(), nullptr,
+                      0.000001, nbEvalMax,
+                      nullptr, nullptr,
+                      false, false,
+                      0, OptimizationTools::OPTIMIZATION_NEWTON);
+                optimization = timer.lap();
+                lnLOpt = llh->getLogLikelihood();
+              }
+
+              ApplicationTools::displayResult("  Log-likelihood", lnL);
+              ApplicationTools::displayResult("  First evaluation (s)", firstEvaluation);
+              ApplicationTools::displayResult("  Re-evaluation (s)", reevaluation);
+
+              out << (first ? "\n" : ",\n");
+              first = false;
+              out << "    {\"alphabet\": \"" << alphabetName << "\""
+                  << ", \"taxa\": " << nbTaxa
+                  << ", \"sites\": " << nbSites
+                  << ", \"distinct_sites\": " << likCal->getNumberOfDistinctSites()
+                  << ", \"rates\": \"" << ratesName << "\""
+                  << ", \"model\": \"" << modelName << "\""
+                  << ", \"construction_s\": " << construction
+                  << ", \"first_evaluation_s\": " << firstEvaluation
+                  << ", \"reevaluation_s\": " << reevaluation
+                  << ", \"first_gradient_s\": " << firstGradient
+                  << ", \"gradient_s\": " << gradient
+                  << ", \"optimization_s\": " << optimization
+                  << ", \"optimization_evaluations\": " << nbEval
+                  << ", \"log_likelihood\": " << lnL
+                  << ", \"optimized_log_likelihood\": " << lnLOpt << "}";
+            }
+          }
+        }
+      }
+    }
+    out << "\n  ]\n}\n";
+    out.close();
+    ApplicationTools::displayResult("Results written to", outputPath);
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Numeric/Matrix/EigenValue.h>
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Model/Codon/CodonDistanceSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
+#include <Bpp/Phyl/Model/FrequencySet/ProteinFrequencySet.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Protein/LG08.h>
+
+#include <chrono>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+/*
+ * Benchmark of the updates of substitution models.
+ *
+ * For each model, the time of an update of its first parameter (with
+ * the eigen decomposition of the generator) is compared to the time of
+ * a general eigen decomposition and inversion of the same generator.
+ * The number of non-zero rates of the sparse generator is also given.
+ *
+ * Run without argument, results are printed on the standard output.
+ */
+
+namespace
+{
+void benchmarkUpdates(SubstitutionModelInterface& model, unsigned int nbUpdates)
+{
+  string name = model.getParameters()[0].getName();
+  double value = model.getParameterValue(model.getParameterNameWithoutNamespace(name));
+  auto start = chrono::steady_clock::now();
+  for (unsigned int i = 0; i < nbUpdates; ++i)
+  {
+    model.setParameterValue(model.getParameterNameWithoutNamespace(name), i % 2 == 0 ? value * 0.99 : value);
+  }
+  chrono::duration<double, milli> updateTime = chrono::steady_clock::now() - start;
+
+  RowMatrix<double> gen(model.generator());
+  RowMatrix<double> inv;
+  start = chrono::steady_clock::now();
+  for (unsigned int i = 0; i < nbUpdates; ++i)
+  {
+    EigenValue<double> ev(gen);
+    MatrixTools::inv(ev.getV(), inv);
+  }
+  chrono::duration<double, milli> generalTime = chrono::steady_clock::now() - start;
+
+  cout << model.getName() << ": " << updateTime.count() / nbUpdates << " ms per update, "
+       << generalTime.count() / nbUpdates << " ms per general decomposition, "
+       << model.sparseGenerator().nonZeros() << " non-zero rates for "
+       << model.getNumberOfStates() << " states." << endl;
+}
+}
+
+int main()
+{
+  GTR gtr(AlphabetTools::DNA_ALPHABET, 1.2, 0.4, 0.5, 0.9, 1.7, 0.1, 0.2, 0.3, 0.4);
+  benchmarkUpdates(gtr, 1000);
+
+  LG08 lg08(AlphabetTools::PROTEIN_ALPHABET, make_unique<FullProteinFrequencySet>(AlphabetTools::PROTEIN_ALPHABET), true);
+  benchmarkUpdates(lg08, 200);
+
+  auto gc = make_shared<StandardGeneticCode>(AlphabetTools::DNA_ALPHABET);
+  YN98 yn98(gc, CodonFrequencySetInterface::getFrequencySetForCodons(CodonFrequencySetInterface::F3X4, gc));
+  yn98.setParameterValue("kappa", 2.5);
+  yn98.setParameterValue("omega", 0.3);
+  benchmarkUpdates(yn98, 20);
+
+  CodonDistanceSubstitutionModel codon(gc, make_unique<K80>(AlphabetTools::DNA_ALPHABET, 2.), nullptr);
+  codon.setParameterValue("beta", 0.4);
+  benchmarkUpdates(codon, 20);
+
+  return 0;
+}
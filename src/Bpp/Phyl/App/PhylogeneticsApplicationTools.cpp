@@ -2562,47 +2562,14 @@ std::shared_ptr<PhyloLikelihoodInterface> PhylogeneticsApplicationTools::optimiz
     ApplicationTools::displayResult("Tolerance", TextTools::toString(tolerance));
 
   // Backing up or restoring?
-  shared_ptr<BackupListener> backupListener;
+  // The backup is restored, if found, by the optimization methods.
+  shared_ptr<PhyloBackupListener> backupListener;
   string backupFile = ApplicationTools::getAFilePath("optimization.backup.file", params, false, false, suffix, suffixIsOptional, "none", warn + 1);
   if (backupFile != "none")
   {
     ApplicationTools::displayResult("Parameters will be backup to", backupFile);
-    backupListener.reset(new BackupListener(backupFile));
-    if (FileTools::fileExists(backupFile))
-    {
-      ApplicationTools::displayMessage("A backup file was found! Try to restore parameters from previous run...");
-      ifstream bck(backupFile.c_str(), ios::in);
-      vector<string> lines = FileTools::putStreamIntoVectorOfStrings(bck);
-      double fval = TextTools::toDouble(lines[0].substr(5));
-      ParameterList pl = lik->getParameters();
-      for (size_t l = 1; l < lines.size(); ++l)
-      {
-        if (!TextTools::isEmpty(lines[l]))
-        {
-          StringTokenizer stp(lines[l], "=");
-          if (stp.numberOfRemainingTokens() != 2)
-          {
-            cerr << "Corrupted backup file!!!" << endl;
-            cerr << "at line " << l << ": " << lines[l] << endl;
-          }
-          string pname  = stp.nextToken();
-          string pvalue = stp.nextToken();
-          if (pl.hasParameter(pname))
-          {
-            size_t p = pl.whichParameterHasName(pname);
-            pl.setParameter(p, AutoParameter(pl[p]));
-            pl[p].setValue(TextTools::toDouble(pvalue));
-          }
-          else
-            ApplicationTools::displayWarning("Unknown parameter in backup file : " + pname);
-        }
-      }
-      bck.close();
-      lik->setParameters(pl);
-      if (convert(abs(lik->getValue() - fval)) > 0.000001)
-        ApplicationTools::displayMessage("Changed likelihood from backup file.");
-      ApplicationTools::displayResult("Restoring log-likelihood", -lik->getValue());
-    }
+    bool skipCompleted = ApplicationTools::getBooleanParameter("optimization.backup.skip_completed", params, false, suffix, suffixIsOptional, warn + 1);
+    backupListener = make_shared<PhyloBackupListener>(backupFile, skipCompleted);
   }
 
   // if (verbose)
@@ -2688,20 +2655,31 @@ std::shared_ptr<PhyloLikelihoodInterface> PhylogeneticsApplicationTools::optimiz
     parametersToEstimate.matchParametersValues(lik->getParameters());
     n = OptimizationTools::optimizeNumericalParameters(
           lik, parametersToEstimate,
-          backupListener, nstep, tolerance, nbEvalMax, messageHandler, profiler, reparam, optVerbose, optMethodDeriv, optMethodModel);
+          nullptr, nstep, tolerance, nbEvalMax, messageHandler, profiler, reparam, optVerbose, optMethodDeriv, optMethodModel, backupListener);
   }
   else if (optName == "FullD")
   {
     // Uses Newton-raphson algorithm with numerical derivatives when required.
     parametersToEstimate.matchParametersValues(lik->getParameters());
-    if (dynamic_pointer_cast<SingleProcessPhyloLikelihood>(lik))
+    // Partitions with unlinked parameters may be optimized separately:
+    bool byPartition = ApplicationTools::getBooleanParameter("optimization.by_partition", params, false, suffix, suffixIsOptional, warn + 1);
+    auto setLik = dynamic_pointer_cast<PhyloLikelihoodSetInterface>(lik);
+    if (verbose && setLik)
+      ApplicationTools::displayResult("Optimization by partition", (byPartition ? "yes" : "no"));
+    if (byPartition && setLik && backupListener)
+      throw Exception("PhylogeneticsApplicationTools::optimizeParameters. Backups ('optimization.backup.file') are not available with 'optimization.by_partition'.");
+    if (byPartition && setLik)
+      n = OptimizationTools::optimizeNumericalParametersByPartition(
+            setLik, parametersToEstimate,
+            tolerance, nbEvalMax, messageHandler, profiler, optVerbose, optMethodDeriv);
+    else if (dynamic_pointer_cast<SingleProcessPhyloLikelihood>(lik))
       n = OptimizationTools::optimizeNumericalParameters2(
             dynamic_pointer_cast<SingleProcessPhyloLikelihood>(lik), parametersToEstimate,
-            backupListener, tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv);
+            nullptr, tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv, backupListener);
     else
       n = OptimizationTools::optimizeNumericalParameters2(
             lik, parametersToEstimate,
-            backupListener, tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv);
+            nullptr, tolerance, nbEvalMax, messageHandler, profiler, reparam, useClock, optVerbose, optMethodDeriv, backupListener);
   }
   else
     throw Exception("Unknown optimization method: " + optName);
@@ -0,0 +1,427 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include "PairwiseDistanceEstimation.h"
+
+// From bpp-core:
+#include <Bpp/App/ApplicationTools.h>
+
+// From the STL:
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+/*
+ * First and second derivatives of the log-likelihood of a pair of
+ * sequences, given the counts of the pairs of codes.
+ */
+class PairLikelihoodDerivatives
+{
+public:
+  virtual ~PairLikelihoodDerivatives() {}
+
+  virtual void compute(
+      double distance,
+      const vector<size_t>& codePairs,
+      const vector<double>& counts,
+      double& d1,
+      double& d2) = 0;
+};
+
+/*
+ * Using the real diagonalization of the generator, the likelihood of a
+ * pair of codes (k, l) is
+ * L = sum_c p_c sum_i a_ki b_li exp(lambda_i r_c t),
+ * with a_k = (pi . w_k)^T V and b_l = V^-1 w_l.
+ */
+class EigenPairLikelihoodDerivatives :
+  public PairLikelihoodDerivatives
+{
+private:
+  size_t nbStates_;
+  vector<double> lambdas_;
+  vector<double> rates_;
+  vector<double> probas_;
+  vector<double> coefs_;
+  vector<double> g0_;
+  vector<double> g1_;
+  vector<double> g2_;
+
+public:
+  EigenPairLikelihoodDerivatives(
+      const SubstitutionModelInterface& model,
+      const DiscreteDistributionInterface& rateDist,
+      const vector< vector<double>>& weights) :
+    nbStates_(model.getNumberOfStates()),
+    lambdas_(model.getEigenValues()),
+    rates_(rateDist.getCategories()),
+    probas_(rateDist.getProbabilities()),
+    coefs_(),
+    g0_(nbStates_),
+    g1_(nbStates_),
+    g2_(nbStates_)
+  {
+    for (auto& lambda : lambdas_)
+    {
+      lambda *= model.getRate();
+    }
+    const Vdouble& freqs = model.getFrequencies();
+    const Matrix<double>& v = model.getColumnRightEigenVectors();
+    const Matrix<double>& vInv = model.getRowLeftEigenVectors();
+    size_t nbCodes = weights.size();
+    vector< vector<double>> a(nbCodes, vector<double>(nbStates_, 0));
+    vector< vector<double>> b(nbCodes, vector<double>(nbStates_, 0));
+    for (size_t k = 0; k < nbCodes; ++k)
+    {
+      for (size_t i = 0; i < nbStates_; ++i)
+      {
+        for (size_t s = 0; s < nbStates_; ++s)
+        {
+          a[k][i] += freqs[s] * weights[k][s] * v(s, i);
+          b[k][i] += vInv(i, s) * weights[k][s];
+        }
+      }
+    }
+    coefs_.resize(nbCodes * nbCodes * nbStates_);
+    for (size_t k = 0; k < nbCodes; ++k)
+    {
+      for (size_t l = 0; l < nbCodes; ++l)
+      {
+        for (size_t i = 0; i < nbStates_; ++i)
+        {
+          coefs_[(k * nbCodes + l) * nbStates_ + i] = a[k][i] * b[l][i];
+        }
+      }
+    }
+  }
+
+  void compute(
+      double distance,
+      const vector<size_t>& codePairs,
+      const vector<double>& counts,
+      double& d1,
+      double& d2) override
+  {
+    for (size_t i = 0; i < nbStates_; ++i)
+    {
+      g0_[i] = 0;
+      g1_[i] = 0;
+      g2_[i] = 0;
+      for (size_t c = 0; c < rates_.size(); ++c)
+      {
+        double lr = lambdas_[i] * rates_[c];
+        double e = probas_[c] * exp(lr * distance);
+        g0_[i] += e;
+        g1_[i] += lr * e;
+        g2_[i] += lr * lr * e;
+      }
+    }
+    d1 = 0;
+    d2 = 0;
+    for (size_t p = 0; p < codePairs.size(); ++p)
+    {
+      const double* coefs = &coefs_[codePairs[p] * nbStates_];
+      double l0 = 0, l1 = 0, l2 = 0;
+      for (size_t i = 0; i < nbStates_; ++i)
+      {
+        l0 += coefs[i] * g0_[i];
+        l1 += coefs[i] * g1_[i];
+        l2 += coefs[i] * g2_[i];
+      }
+      if (l0 <= 0)
+        continue;
+      double r1 = l1 / l0;
+      d1 += counts[p] * r1;
+      d2 += counts[p] * (l2 / l0 - r1 * r1);
+    }
+  }
+};
+
+/*
+ * Using the transition probabilities of a model (that must not be
+ * shared between threads).
+ */
+class MatrixPairLikelihoodDerivatives :
+  public PairLikelihoodDerivatives
+{
+private:
+  std::unique_ptr<TransitionModelInterface> model_;
+  size_t nbStates_;
+  size_t nbCodes_;
+  vector<double> rates_;
+  vector<double> probas_;
+  vector< vector<double>> u_;
+  vector< vector<double>> w_;
+  RowMatrix<double> p0_;
+  RowMatrix<double> p1_;
+  RowMatrix<double> p2_;
+
+public:
+  MatrixPairLikelihoodDerivatives(
+      const TransitionModelInterface& model,
+      const DiscreteDistributionInterface& rateDist,
+      const vector< vector<double>>& weights) :
+    model_(model.clone()),
+    nbStates_(model.getNumberOfStates()),
+    nbCodes_(weights.size()),
+    rates_(rateDist.getCategories()),
+    probas_(rateDist.getProbabilities()),
+    u_(weights),
+    w_(weights),
+    p0_(nbStates_, nbStates_),
+    p1_(nbStates_, nbStates_),
+    p2_(nbStates_, nbStates_)
+  {
+    const Vdouble& freqs = model.getFrequencies();
+    for (auto& u : u_)
+    {
+      for (size_t s = 0; s < nbStates_; ++s)
+      {
+        u[s] *= freqs[s];
+      }
+    }
+  }
+
+  void compute(
+      double distance,
+      const vector<size_t>& codePairs,
+      const vector<double>& counts,
+      double& d1,
+      double& d2) override
+  {
+    for (size_t s1 = 0; s1 < nbStates_; ++s1)
+    {
+      for (size_t s2 = 0; s2 < nbStates_; ++s2)
+      {
+        p0_(s1, s2) = 0;
+        p1_(s1, s2) = 0;
+        p2_(s1, s2) = 0;
+      }
+    }
+    for (size_t c = 0; c < rates_.size(); ++c)
+    {
+      double r = rates_[c];
+      const Matrix<double>& pij = model_->getPij_t(r * distance);
+      for (size_t s1 = 0; s1 < nbStates_; ++s1)
+      {
+        for (size_t s2 = 0; s2 < nbStates_; ++s2)
+        {
+          p0_(s1, s2) += probas_[c] * pij(s1, s2);
+        }
+      }
+      const Matrix<double>& dpij = model_->getdPij_dt(r * distance);
+      for (size_t s1 = 0; s1 < nbStates_; ++s1)
+      {
+        for (size_t s2 = 0; s2 < nbStates_; ++s2)
+        {
+          p1_(s1, s2) += probas_[c] * r * dpij(s1, s2);
+        }
+      }
+      const Matrix<double>& d2pij = model_->getd2Pij_dt2(r * distance);
+      for (size_t s1 = 0; s1 < nbStates_; ++s1)
+      {
+        for (size_t s2 = 0; s2 < nbStates_; ++s2)
+        {
+          p2_(s1, s2) += probas_[c] * r * r * d2pij(s1, s2);
+        }
+      }
+    }
+    d1 = 0;
+    d2 = 0;
+    for (size_t p = 0; p < codePairs.size(); ++p)
+    {
+      const vector<double>& u = u_[codePairs[p] / nbCodes_];
+      const vector<double>& w = w_[codePairs[p] % nbCodes_];
+      double l0 = 0, l1 = 0, l2 = 0;
+      for (size_t s1 = 0; s1 < nbStates_; ++s1)
+      {
+        if (u[s1] == 0)
+          continue;
+        double x0 = 0, x1 = 0, x2 = 0;
+        for (size_t s2 = 0; s2 < nbStates_; ++s2)
+        {
+          x0 += p0_(s1, s2) * w[s2];
+          x1 += p1_(s1, s2) * w[s2];
+          x2 += p2_(s1, s2) * w[s2];
+        }
+        l0 += u[s1] * x0;
+        l1 += u[s1] * x1;
+        l2 += u[s1] * x2;
+      }
+      if (l0 <= 0)
+        continue;
+      double r1 = l1 / l0;
+      d1 += counts[p] * r1;
+      d2 += counts[p] * (l2 / l0 - r1 * r1);
+    }
+  }
+};
+}
+
+/******************************************************************************/
+
+void PairwiseDistanceEstimation::computeMatrix()
+{
+  if (!model_)
+    throw NullPointerException("PairwiseDistanceEstimation::computeMatrix. No model.");
+  if (!rateDist_)
+    throw NullPointerException("PairwiseDistanceEstimation::computeMatrix. No rate distribution.");
+  if (!sites_)
+    throw NullPointerException("PairwiseDistanceEstimation::computeMatrix. No data.");
+
+  size_t n = sites_->getNumberOfSequences();
+  size_t nbSites = sites_->getNumberOfSites();
+  size_t nbStates = model_->getNumberOfStates();
+  vector<string> names = sites_->getSequenceNames();
+  dist_ = make_shared<DistanceMatrix>(names);
+
+  // Map characters to codes, with their likelihoods for each state:
+  map<int, size_t> codeIndex;
+  vector< vector<double>> weights;
+  vector< vector<size_t>> codes(n, vector<size_t>(nbSites));
+  for (size_t j = 0; j < n; ++j)
+  {
+    const Sequence& seq = sites_->sequence(j);
+    for (size_t i = 0; i < nbSites; ++i)
+    {
+      int c = seq.getValue(i);
+      auto it = codeIndex.find(c);
+      if (it == codeIndex.end())
+      {
+        it = codeIndex.insert(make_pair(c, weights.size())).first;
+        vector<double> w(nbStates);
+        for (size_t s = 0; s < nbStates; ++s)
+        {
+          w[s] = sites_->getStateValueAt(i, j, model_->getAlphabetStateAsInt(s));
+        }
+        weights.push_back(w);
+      }
+      codes[j][i] = it->second;
+    }
+  }
+  size_t nbCodes = weights.size();
+
+  // Use the eigen decomposition of the generator, if it is maintained
+  // and real:
+  auto subModel = dynamic_pointer_cast<const SubstitutionModelInterface>(model_);
+  bool useEigen = subModel && subModel->enableEigenDecomposition() && subModel->isDiagonalizable();
+  if (useEigen)
+  {
+    for (auto x : subModel->getIEigenValues())
+    {
+      if (x != 0)
+        useEigen = false;
+    }
+  }
+
+  string errorMessage = "";
+  size_t nbDone = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::unique_ptr<PairLikelihoodDerivatives> derivatives;
+    try
+    {
+      if (useEigen)
+        derivatives.reset(new EigenPairLikelihoodDerivatives(*subModel, *rateDist_, weights));
+      else
+        derivatives.reset(new MatrixPairLikelihoodDerivatives(*model_, *rateDist_, weights));
+    }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (PairwiseDistanceEstimation_computeMatrix_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = e.what();
+    }
+    vector<double> pairCounts(nbCodes * nbCodes, 0);
+    vector<size_t> codePairs;
+    vector<double> counts;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (size_t i = 0; i < n; ++i)
+    {
+      (*dist_)(i, i) = 0;
+      if (!derivatives)
+        continue;
+      try
+      {
+        for (size_t j = i + 1; j < n; ++j)
+        {
+          // Summarize the pair of sequences:
+          const vector<size_t>& codesI = codes[i];
+          const vector<size_t>& codesJ = codes[j];
+          for (size_t s = 0; s < nbSites; ++s)
+          {
+            pairCounts[codesI[s] * nbCodes + codesJ[s]]++;
+          }
+          codePairs.clear();
+          counts.clear();
+          for (size_t p = 0; p < pairCounts.size(); ++p)
+          {
+            if (pairCounts[p] > 0)
+            {
+              codePairs.push_back(p);
+              counts.push_back(pairCounts[p]);
+              pairCounts[p] = 0;
+            }
+          }
+
+          // Newton-Raphson iterations:
+          double t = max(minimumDistance_, min(0.1, maximumDistance_));
+          for (unsigned int it = 0; it < maximumNumberOfIterations_; ++it)
+          {
+            double d1, d2;
+            derivatives->compute(t, codePairs, counts, d1, d2);
+            double newT;
+            if (d2 < 0)
+              newT = t - d1 / d2;
+            else
+              newT = (d1 > 0 ? 2 * t : t / 2);
+            newT = max(minimumDistance_, min(newT, maximumDistance_));
+            bool stop = abs(newT - t) < tolerance_;
+            t = newT;
+            if (stop)
+              break;
+          }
+          (*dist_)(i, j) = (*dist_)(j, i) = t;
+        }
+      }
+      catch (exception& e)
+      {
+#ifdef _OPENMP
+#pragma omp critical (PairwiseDistanceEstimation_computeMatrix_error)
+#endif
+        if (errorMessage == "")
+          errorMessage = e.what();
+      }
+      if (verbose_ > 0)
+      {
+#ifdef _OPENMP
+#pragma omp critical (PairwiseDistanceEstimation_computeMatrix_display)
+#endif
+        ApplicationTools::displayGauge(nbDone++, n - 1, '=');
+      }
+    }
+  }
+  if (errorMessage != "")
+    throw Exception("PairwiseDistanceEstimation::computeMatrix. " + errorMessage);
+}
+
+/******************************************************************************/
@@ -0,0 +1,175 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_DISTANCE_PAIRWISEDISTANCEESTIMATION_H
+#define BPP_PHYL_DISTANCE_PAIRWISEDISTANCEESTIMATION_H
+
+#include <Bpp/Clonable.h>
+#include <Bpp/Numeric/Prob/DiscreteDistribution.h>
+
+#include "../Model/SubstitutionModel.h"
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Seq/DistanceMatrix.h>
+
+// From the STL:
+#include <memory>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Maximum likelihood distances between all pairs of sequences,
+ * without building a likelihood graph per pair.
+ *
+ * This computes the same distances as DistanceEstimation when no
+ * additional parameter is estimated, for reversible models: the
+ * likelihood of two sequences only depends on the sum of the two
+ * branch lengths, which is the estimated distance.
+ *
+ * The characters of the alignment are first mapped to codes, and each
+ * pair of sequences is summarized by the matrix of counts of pairs of
+ * codes. With the eigen decomposition of the generator, computed once,
+ * the likelihood of each pair of codes is a sum of exponentials in the
+ * distance, and the log-likelihood and its two derivatives are computed
+ * in closed form for Newton-Raphson iterations. Models without a real
+ * diagonalization use their transition probability matrices instead.
+ *
+ * Pairs are computed in parallel if the library is built with OpenMP.
+ */
+class PairwiseDistanceEstimation :
+  public virtual Clonable
+{
+private:
+  std::shared_ptr<const TransitionModelInterface> model_;
+  std::shared_ptr<const DiscreteDistributionInterface> rateDist_;
+  std::shared_ptr<const SiteContainerInterface> sites_;
+  std::shared_ptr<DistanceMatrix> dist_;
+  double minimumDistance_;
+  double maximumDistance_;
+  double tolerance_;
+  unsigned int maximumNumberOfIterations_;
+  size_t verbose_;
+
+public:
+  /**
+   * @param model    The substitution model to use.
+   * @param rateDist The discrete rate distribution to use.
+   * @param verbose  The verbose level: 0=Off, 1=one * by row computation.
+   */
+  PairwiseDistanceEstimation(
+      std::shared_ptr<const TransitionModelInterface> model,
+      std::shared_ptr<const DiscreteDistributionInterface> rateDist,
+      size_t verbose = 1) :
+    model_(model),
+    rateDist_(rateDist),
+    sites_(nullptr),
+    dist_(nullptr),
+    minimumDistance_(0.000001),
+    maximumDistance_(10000),
+    tolerance_(0.000001),
+    maximumNumberOfIterations_(100),
+    verbose_(verbose)
+  {}
+
+  /**
+   * @brief Copy constructor.
+   *
+   * Only the distance matrix is hard-copied, if there is one.
+   */
+  PairwiseDistanceEstimation(const PairwiseDistanceEstimation& estimation) :
+    model_(estimation.model_),
+    rateDist_(estimation.rateDist_),
+    sites_(estimation.sites_),
+    dist_(estimation.dist_ ? std::make_shared<DistanceMatrix>(*estimation.dist_) : nullptr),
+    minimumDistance_(estimation.minimumDistance_),
+    maximumDistance_(estimation.maximumDistance_),
+    tolerance_(estimation.tolerance_),
+    maximumNumberOfIterations_(estimation.maximumNumberOfIterations_),
+    verbose_(estimation.verbose_)
+  {}
+
+  PairwiseDistanceEstimation& operator=(const PairwiseDistanceEstimation& estimation)
+  {
+    model_                     = estimation.model_;
+    rateDist_                  = estimation.rateDist_;
+    sites_                     = estimation.sites_;
+    dist_                      = estimation.dist_ ? std::make_shared<DistanceMatrix>(*estimation.dist_) : nullptr;
+    minimumDistance_           = estimation.minimumDistance_;
+    maximumDistance_           = estimation.maximumDistance_;
+    tolerance_                 = estimation.tolerance_;
+    maximumNumberOfIterations_ = estimation.maximumNumberOfIterations_;
+    verbose_                   = estimation.verbose_;
+    return *this;
+  }
+
+  virtual ~PairwiseDistanceEstimation() {}
+
+  PairwiseDistanceEstimation* clone() const override { return new PairwiseDistanceEstimation(*this); }
+
+public:
+  /**
+   * @brief Perform the distance computation.
+   *
+   * Result can be called by the getMatrix() method.
+   *
+   * @throw NullPointerException if at least one of the model,
+   * rate distribution or data are not initialized.
+   */
+  void computeMatrix();
+
+  /**
+   * @brief Get the distance matrix.
+   *
+   * @return A pointer toward the computed distance matrix.
+   */
+  std::unique_ptr<DistanceMatrix> getMatrix() const
+  {
+    return dist_ == nullptr ? nullptr : std::make_unique<DistanceMatrix>(*dist_);
+  }
+
+  std::shared_ptr<const TransitionModelInterface> getModel() const { return model_; }
+
+  void setModel(std::shared_ptr<const TransitionModelInterface> model) { model_ = model; }
+
+  std::shared_ptr<const DiscreteDistributionInterface> getRateDistribution() const { return rateDist_; }
+
+  void setRateDistribution(std::shared_ptr<const DiscreteDistributionInterface> rateDist) { rateDist_ = rateDist; }
+
+  void setData(std::shared_ptr<const SiteContainerInterface> sites = nullptr) { sites_ = sites; }
+
+  std::shared_ptr<const SiteContainerInterface> getData() const { return sites_; }
+
+  /**
+   * @brief Set the interval of the estimated distances.
+   */
+  void setDistanceInterval(double min, double max)
+  {
+    minimumDistance_ = min;
+    maximumDistance_ = max;
+  }
+
+  double getMinimumDistance() const { return minimumDistance_; }
+
+  double getMaximumDistance() const { return maximumDistance_; }
+
+  /**
+   * @brief Set the stop condition of the Newton-Raphson iterations.
+   *
+   * @param tolerance     The tolerance on the distance.
+   * @param maxIterations The maximum number of iterations per pair.
+   */
+  void setStopCondition(double tolerance, unsigned int maxIterations)
+  {
+    tolerance_ = tolerance;
+    maximumNumberOfIterations_ = maxIterations;
+  }
+
+  void setVerbose(size_t verbose) { verbose_ = verbose; }
+
+  size_t getVerbose() const { return verbose_; }
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_DISTANCE_PAIRWISEDISTANCEESTIMATION_H
@@ -22,6 +22,11 @@ using namespace bpp;
 // From the STL:
 #include <iostream>
 #include <fstream>
+#include <iterator>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -41,6 +46,425 @@ const string Newick::getFormatDescription() const
 /*  INPUT */
 /**********************************************************/
 
+namespace
+{
+/**
+ * @brief Builds a TreeTemplate<Node> while parsing.
+ */
+class TreeTemplateBuilder
+{
+public:
+  typedef Node* NodeType;
+
+  std::unique_ptr<TreeTemplate<Node>> tree;
+  bool bootstrap;
+  std::string propertyName;
+  bool verbose;
+  unsigned int nodeCounter;
+
+public:
+  TreeTemplateBuilder(bool useBootstrap, const std::string& bootstrapPropertyName, bool verb) :
+    tree(new TreeTemplate<Node>()),
+    bootstrap(useBootstrap),
+    propertyName(bootstrapPropertyName),
+    verbose(verb),
+    nodeCounter(0)
+  {}
+
+  Node* createNode(Node* const* father)
+  {
+    Node* node = new Node();
+    if (father)
+      (*father)->addSon(node);
+    else
+      tree->setRootNode(node);
+    return node;
+  }
+
+  void setName(Node* node, const std::string& name) { node->setName(name); }
+
+  void setLength(Node* node, double length) { node->setDistanceToFather(length); }
+
+  void setLabel(Node* node, const std::string& label)
+  {
+    if (bootstrap)
+      node->setBranchProperty(TreeTools::BOOTSTRAP, Number<double>(TextTools::toDouble(label)));
+    else
+      node->setBranchProperty(propertyName, BppString(label));
+  }
+
+  void closeNode(Node* node)
+  {
+    nodeCounter++;
+    if (verbose)
+      ApplicationTools::displayUnlimitedGauge(nodeCounter);
+  }
+
+  std::unique_ptr<TreeTemplate<Node>> finish()
+  {
+    tree->resetNodesId();
+    return std::move(tree);
+  }
+};
+
+/**
+ * @brief Builds a PhyloTree while parsing.
+ */
+class PhyloTreeBuilder
+{
+public:
+  typedef std::pair<std::shared_ptr<PhyloNode>, std::shared_ptr<PhyloBranch>> NodeType;
+
+  std::unique_ptr<PhyloTree> tree;
+  std::shared_ptr<PhyloNode> root;
+  bool bootstrap;
+  std::string propertyName;
+  bool verbose;
+  unsigned int nodeCounter;
+
+public:
+  PhyloTreeBuilder(bool useBootstrap, const std::string& bootstrapPropertyName, bool verb) :
+    tree(new PhyloTree()),
+    root(),
+    bootstrap(useBootstrap),
+    propertyName(bootstrapPropertyName),
+    verbose(verb),
+    nodeCounter(0)
+  {}
+
+  NodeType createNode(const NodeType* father)
+  {
+    auto node = std::make_shared<PhyloNode>();
+    std::shared_ptr<PhyloBranch> branch;
+    if (father)
+    {
+      branch = std::make_shared<PhyloBranch>();
+      tree->createNode(father->first, node, branch);
+    }
+    else
+    {
+      tree->createNode(node);
+      root = node;
+    }
+    return NodeType(node, branch);
+  }
+
+  void setName(const NodeType& node, const std::string& name) { node.first->setName(name); }
+
+  void setLength(const NodeType& node, double length)
+  {
+    if (node.second)
+      node.second->setLength(length);
+  }
+
+  void setLabel(const NodeType& node, const std::string& label)
+  {
+    if (!node.second)
+      return;
+    if (bootstrap)
+      node.second->setProperty("bootstrap", Number<double>(TextTools::toDouble(label)));
+    else
+      node.second->setProperty(propertyName, BppString(label));
+  }
+
+  void closeNode(const NodeType& node)
+  {
+    tree->setNodeIndex(node.first, nodeCounter);
+    if (node.second)
+      tree->setEdgeIndex(node.second, nodeCounter);
+    nodeCounter++;
+    if (verbose)
+      ApplicationTools::displayUnlimitedGauge(nodeCounter);
+  }
+
+  std::unique_ptr<PhyloTree> finish()
+  {
+    tree->rootAt(root);
+    return std::move(tree);
+  }
+};
+
+/**
+ * @brief Skip blanks and comments.
+ */
+void skipBlanks(const char*& p, const char* end, bool allowComments)
+{
+  while (p != end)
+  {
+    if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+      ++p;
+    else if (allowComments && *p == '[')
+    {
+      while (p != end && *p != ']')
+      {
+        ++p;
+      }
+      if (p == end)
+        throw IOException("Newick: unterminated comment.");
+      ++p;
+    }
+    else
+      break;
+  }
+}
+
+/**
+ * @brief Read a name, label or length, till the next delimiter.
+ *
+ * Line breaks are ignored and surrounding white spaces are removed.
+ */
+void readText(const char*& p, const char* end, bool allowComments, std::string& text)
+{
+  text.clear();
+  while (p != end)
+  {
+    char c = *p;
+    if (c == '(' || c == ')' || c == ',' || c == ':' || c == ';')
+      break;
+    if (allowComments && c == '[')
+    {
+      skipBlanks(p, end, allowComments);
+      continue;
+    }
+    if (c != '\n' && c != '\r')
+      text += c;
+    ++p;
+  }
+  size_t first = text.find_first_not_of(" \t");
+  if (first == std::string::npos)
+    text.clear();
+  else
+    text = text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+/**
+ * @brief Read an optional label and branch length after a node.
+ */
+template<class Builder>
+void readNodeEnd(const char*& p, const char* end, bool allowComments, bool isLeaf, Builder& builder, const typename Builder::NodeType& node, std::string& text)
+{
+  readText(p, end, allowComments, text);
+  if (isLeaf)
+    builder.setName(node, text);
+  else if (!text.empty())
+    builder.setLabel(node, text);
+  if (p != end && *p == ':')
+  {
+    ++p;
+    readText(p, end, allowComments, text);
+    if (!text.empty())
+      builder.setLength(node, TextTools::toDouble(text));
+  }
+  builder.closeNode(node);
+}
+
+/**
+ * @brief Single pass parser of a Newick description.
+ *
+ * Nodes are created in preorder and closed in postorder. An explicit
+ * stack of open nodes is used, so that deep trees do not exhaust the
+ * call stack.
+ */
+template<class Builder>
+void parseDescription(const char* begin, const char* end, bool allowComments, Builder& builder)
+{
+  typedef typename Builder::NodeType NodeType;
+  std::vector<NodeType> stack;
+  std::string text;
+  bool hasRoot = false;
+  bool expectNode = true;
+  const char* p = begin;
+  while (true)
+  {
+    skipBlanks(p, end, allowComments);
+    if (p == end)
+      throw IOException("Newick: bad format, no semi-colon found.");
+    char c = *p;
+    if (expectNode)
+    {
+      if (stack.empty() && hasRoot)
+        throw IOException("Newick: bad format, several nodes at the root.");
+      NodeType node = builder.createNode(stack.empty() ? nullptr : &stack.back());
+      hasRoot = true;
+      if (c == '(')
+      {
+        stack.push_back(node);
+        ++p;
+      }
+      else
+      {
+        // This is a leaf, which name may be empty:
+        readNodeEnd(p, end, allowComments, true, builder, node, text);
+        expectNode = false;
+      }
+    }
+    else if (c == ',')
+    {
+      if (stack.empty())
+        throw IOException("Newick: bad format, unexpected ',' at the root.");
+      expectNode = true;
+      ++p;
+    }
+    else if (c == ')')
+    {
+      if (stack.empty())
+        throw IOException("Newick: bad format, unexpected ')'.");
+      NodeType node = stack.back();
+      stack.pop_back();
+      ++p;
+      readNodeEnd(p, end, allowComments, false, builder, node, text);
+    }
+    else if (c == ';')
+    {
+      if (!stack.empty())
+        throw IOException("Newick: bad format, missing ')'.");
+      break;
+    }
+    else
+      throw IOException("Newick: bad format, unexpected character '" + std::string(1, c) + "'.");
+  }
+}
+} // end of anonymous namespace.
+
+/******************************************************************************/
+
+unique_ptr<TreeTemplate<Node>> Newick::parseTreeTemplate(const char* begin, const char* end) const
+{
+  TreeTemplateBuilder builder(useBootstrap_, bootstrapPropertyName_, verbose_);
+  parseDescription(begin, end, allowComments_, builder);
+  if (verbose_)
+  {
+    (*ApplicationTools::message) << " nodes loaded.";
+    ApplicationTools::message->endLine();
+  }
+  return builder.finish();
+}
+
+/******************************************************************************/
+
+unique_ptr<PhyloTree> Newick::parsePhyloTree(const char* begin, const char* end) const
+{
+  PhyloTreeBuilder builder(useBootstrap_, bootstrapPropertyName_, verbose_);
+  parseDescription(begin, end, allowComments_, builder);
+  if (verbose_)
+  {
+    (*ApplicationTools::message) << " nodes loaded.";
+    ApplicationTools::message->endLine();
+  }
+  return builder.finish();
+}
+
+/******************************************************************************/
+
+const char* Newick::findTreeEnd(const char* begin, const char* end, bool& inComment) const
+{
+  for (const char* p = begin; p != end; ++p)
+  {
+    if (inComment)
+    {
+      if (*p == ']')
+        inComment = false;
+    }
+    else if (allowComments_ && *p == '[')
+      inComment = true;
+    else if (*p == ';')
+      return p;
+  }
+  return end;
+}
+
+/******************************************************************************/
+
+namespace
+{
+/**
+ * @brief Split a buffer in tree descriptions, including their final semicolon.
+ *
+ * Text after the last semicolon is ignored.
+ */
+vector<pair<const char*, const char*>> splitTrees(const Newick& reader, const char* begin, const char* end)
+{
+  vector<pair<const char*, const char*>> descriptions;
+  bool inComment = false;
+  const char* p = begin;
+  while (p != end)
+  {
+    const char* semi = reader.findTreeEnd(p, end, inComment);
+    if (semi == end)
+      break;
+    descriptions.push_back(make_pair(p, semi + 1));
+    p = semi + 1;
+  }
+  return descriptions;
+}
+} // end of anonymous namespace.
+
+void Newick::parseTrees(const char* begin, const char* end, vector<unique_ptr<Tree>>& trees) const
+{
+  auto descriptions = splitTrees(*this, begin, end);
+  vector<unique_ptr<TreeTemplate<Node>>> parsed(descriptions.size());
+  string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (!verbose_)
+#endif
+  for (size_t i = 0; i < descriptions.size(); ++i)
+  {
+    try
+    {
+      parsed[i] = parseTreeTemplate(descriptions[i].first, descriptions[i].second);
+    }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (Newick_parseTrees_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = "tree " + TextTools::toString(i + 1) + ": " + e.what();
+    }
+  }
+  if (errorMessage != "")
+    throw IOException("Newick::parseTrees. Error when reading " + errorMessage);
+  for (auto& tree : parsed)
+  {
+    trees.push_back(std::move(tree));
+  }
+}
+
+/******************************************************************************/
+
+void Newick::parsePhyloTrees(const char* begin, const char* end, vector<unique_ptr<PhyloTree>>& trees) const
+{
+  auto descriptions = splitTrees(*this, begin, end);
+  vector<unique_ptr<PhyloTree>> parsed(descriptions.size());
+  string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (!verbose_)
+#endif
+  for (size_t i = 0; i < descriptions.size(); ++i)
+  {
+    try
+    {
+      parsed[i] = parsePhyloTree(descriptions[i].first, descriptions[i].second);
+    }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (Newick_parsePhyloTrees_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = "tree " + TextTools::toString(i + 1) + ": " + e.what();
+    }
+  }
+  if (errorMessage != "")
+    throw IOException("Newick::parsePhyloTrees. Error when reading " + errorMessage);
+  for (auto& tree : parsed)
+  {
+    trees.push_back(std::move(tree));
+  }
+}
+
+/******************************************************************************/
+
 unique_ptr<TreeTemplate<Node>> Newick::readTreeTemplate(istream& in) const
 {
   // Checking the existence of specified file
@@ -64,11 +488,9 @@ unique_ptr<TreeTemplate<Node>> Newick::readTreeTemplate(istream& in) const
       description += temp;
   }
 
-  if (allowComments_)
-    description = TextTools::removeSubstrings(description, '[', ']');
   if (TextTools::isEmpty(description))
     throw IOException("Newick::read: no tree was found!");
-  return TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  return parseTreeTemplate(description.data(), description.data() + description.size());
 }
 
 /*********************************************************************************/
@@ -96,11 +518,9 @@ unique_ptr<PhyloTree> Newick::readPhyloTree(istream& in) const
       description += temp;
   }
 
-  if (allowComments_)
-    description = TextTools::removeSubstrings(description, '[', ']');
   if (TextTools::isEmpty(description))
     throw IOException("Newick::read: no tree was found!");
-  return parenthesisToPhyloTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_);
+  return parsePhyloTree(description.data(), description.data() + description.size());
 }
 
 /******************************************************************************/
@@ -113,24 +533,8 @@ void Newick::readTrees(istream& in, vector<unique_ptr<Tree>>& trees) const
     throw IOException ("Newick::readTrees(vector): failed to read from stream");
   }
 
-  // Main loop : for all file lines
-  string temp, description; // Initialization
-  string::size_type index;
-  // We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
-  {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_)
-        description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(TreeTemplateTools::parenthesisToTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else
-      description += temp;
-  }
+  string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  parseTrees(content.data(), content.data() + content.size(), trees);
   // In case the file is empty, the method will not add any neww tree to the vector.
 }
 
@@ -144,24 +548,8 @@ void Newick::readPhyloTrees(istream& in, vector<unique_ptr<PhyloTree>>& trees) c
     throw IOException ("Newick::readTrees(vector): failed to read from stream");
   }
 
-  // Main loop : for all file lines
-  string temp, description; // Initialization
-  string::size_type index;
-  // We concatenate all line in file till we reach the ending semi colon:
-  while (getline(in, temp, '\n'))
-  {
-    index = temp.find(";");
-    if (index != string::npos)
-    {
-      description += temp.substr(0, index + 1);
-      if (allowComments_)
-        description = TextTools::removeSubstrings(description, '[', ']');
-      trees.push_back(parenthesisToPhyloTree(description, useBootstrap_, bootstrapPropertyName_, false, verbose_));
-      description = temp.substr(index + 1);
-    }
-    else
-      description += temp;
-  }
+  string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  parsePhyloTrees(content.data(), content.data() + content.size(), trees);
   // In case the file is empty, the method will not add any neww tree to the vector.
 }
 
@@ -667,3 +1055,74 @@ string Newick::treeToParenthesis(const PhyloTree& tree, bool bootstrap, const st
   s << ";" << endl;
   return s.str();
 }
+
+/******************************************************************************/
+
+NewickTreeIterator::NewickTreeIterator(const Newick& reader, istream& in, size_t chunkSize) :
+  reader_(reader),
+  in_(in),
+  chunkSize_(chunkSize),
+  buffer_(),
+  begin_(0),
+  scanned_(0),
+  inComment_(false),
+  end_(string::npos)
+{
+  if (!in_)
+    throw IOException("NewickTreeIterator: failed to read from stream");
+  if (chunkSize_ == 0)
+    throw Exception("NewickTreeIterator: chunk size must be positive.");
+}
+
+/******************************************************************************/
+
+bool NewickTreeIterator::hasMoreTrees()
+{
+  vector<char> chunk;
+  while (end_ == string::npos)
+  {
+    const char* data = buffer_.data();
+    const char* semi = reader_.findTreeEnd(data + scanned_, data + buffer_.size(), inComment_);
+    if (semi != data + buffer_.size())
+    {
+      end_ = static_cast<size_t>(semi - data);
+      break;
+    }
+    scanned_ = buffer_.size();
+    if (!in_)
+      return false; // Text after the last semicolon is ignored.
+
+    // Discard the previous trees and read a new chunk:
+    buffer_.erase(0, begin_);
+    scanned_ -= begin_;
+    begin_ = 0;
+    chunk.resize(chunkSize_);
+    in_.read(chunk.data(), static_cast<streamsize>(chunkSize_));
+    buffer_.append(chunk.data(), static_cast<size_t>(in_.gcount()));
+  }
+  return true;
+}
+
+/******************************************************************************/
+
+pair<const char*, const char*> NewickTreeIterator::nextDescription_()
+{
+  if (!hasMoreTrees())
+    throw Exception("NewickTreeIterator: no more tree in stream.");
+  pair<const char*, const char*> description(buffer_.data() + begin_, buffer_.data() + end_ + 1);
+  begin_ = scanned_ = end_ + 1;
+  end_ = string::npos;
+  return description;
+}
+
+unique_ptr<TreeTemplate<Node>> NewickTreeIterator::nextTree()
+{
+  auto description = nextDescription_();
+  return reader_.parseTreeTemplate(description.first, description.second);
+}
+
+unique_ptr<PhyloTree> NewickTreeIterator::nextPhyloTree()
+{
+  auto description = nextDescription_();
+  return reader_.parsePhyloTree(description.first, description.second);
+}
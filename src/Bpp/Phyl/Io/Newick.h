@@ -10,6 +10,12 @@
 #include "../Tree/TreeTemplate.h"
 #include "IoTree.h"
 
+// From the STL:
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace bpp
 {
 /**
@@ -45,6 +51,12 @@ namespace bpp
  * This is achieved by calling the enableExtendedBootstrapProperty method, and providing a property name to use.
  * The additional information will be stored at each node as a property, in a String object.
  * The disableExtendedBootstrapProperty method restores the default behavior.
+ *
+ * Trees are parsed in a single pass over the characters of their
+ * description, without copying subtrees, so that parsing time is linear in
+ * the size of the description whatever the shape of the tree. When reading
+ * several trees, they are parsed in parallel if the library is built with
+ * OpenMP. Use NewickTreeIterator to read a large file one tree at a time.
  */
 class Newick :
   public AbstractITree,
@@ -129,6 +141,47 @@ private:
       bool verbose) const;
 
 public:
+  /**
+   * @brief Parse a tree from a buffer.
+   *
+   * @param begin The beginning of the description.
+   * @param end   The end of the buffer. Characters after the first semicolon are ignored.
+   * @throw IOException If the description is not valid.
+   */
+  std::unique_ptr<TreeTemplate<Node>> parseTreeTemplate(const char* begin, const char* end) const;
+
+  /**
+   * @brief Parse a tree from a buffer.
+   *
+   * @see parseTreeTemplate
+   */
+  std::unique_ptr<PhyloTree> parsePhyloTree(const char* begin, const char* end) const;
+
+  /**
+   * @brief Parse all trees from a buffer, in parallel.
+   *
+   * The buffer is split on semicolons (outside comments), and trees are
+   * appended to the vector in the order of the buffer.
+   */
+  void parseTrees(const char* begin, const char* end, std::vector<std::unique_ptr<Tree>>& trees) const;
+
+  /**
+   * @brief Parse all trees from a buffer, in parallel.
+   *
+   * @see parseTrees
+   */
+  void parsePhyloTrees(const char* begin, const char* end, std::vector<std::unique_ptr<PhyloTree>>& trees) const;
+
+  /**
+   * @brief Find the end of the next tree in a buffer.
+   *
+   * @param begin     The beginning of the buffer.
+   * @param end       The end of the buffer.
+   * @param inComment [in,out] Tell if the beginning of the buffer is inside a comment.
+   * @return A pointer toward the next semicolon outside comments, or end if there is none.
+   */
+  const char* findTreeEnd(const char* begin, const char* end, bool& inComment) const;
+
   std::unique_ptr<PhyloTree> parenthesisToPhyloTree(
       const std::string& description,
       bool bootstrap = false,
@@ -272,5 +325,82 @@ protected:
  */
   std::string treeToParenthesis(const PhyloTree& tree, bool bootstrap, const std::string& propertyName) const;
 };
+
+/**
+ * @brief Read the trees of a Newick stream one at a time.
+ *
+ * The stream is read by chunks, and only the description of the current
+ * tree is kept in memory, so that arbitrarily large files (e.g. posterior
+ * samples of trees) can be processed.
+ *
+ * @code
+ * ifstream in("trees.dnd");
+ * NewickTreeIterator it(Newick(true), in);
+ * while (it.hasMoreTrees())
+ * {
+ *   auto tree = it.nextTree();
+ *   ...
+ * }
+ * @endcode
+ */
+class NewickTreeIterator
+{
+private:
+  Newick reader_;
+  std::istream& in_;
+  size_t chunkSize_;
+  std::string buffer_;
+
+  /**
+   * @brief Position of the next tree in the buffer.
+   */
+  size_t begin_;
+
+  /**
+   * @brief Position up to which the buffer was searched for a semicolon.
+   */
+  size_t scanned_;
+  bool inComment_;
+
+  /**
+   * @brief Position of the semicolon ending the next tree, if found.
+   */
+  size_t end_;
+
+public:
+  /**
+   * @param reader    The Newick reader, which options are used for parsing.
+   * @param in        The input stream.
+   * @param chunkSize The number of characters read from the stream at once.
+   */
+  NewickTreeIterator(const Newick& reader, std::istream& in, size_t chunkSize = 1048576);
+
+  NewickTreeIterator(const NewickTreeIterator& it) = delete;
+
+  NewickTreeIterator& operator=(const NewickTreeIterator& it) = delete;
+
+  virtual ~NewickTreeIterator() {}
+
+public:
+  /**
+   * @return true if there is another tree in the stream.
+   */
+  bool hasMoreTrees();
+
+  /**
+   * @return The next tree of the stream.
+   * @throw Exception If there is no more tree.
+   */
+  std::unique_ptr<TreeTemplate<Node>> nextTree();
+
+  /**
+   * @return The next tree of the stream.
+   * @throw Exception If there is no more tree.
+   */
+  std::unique_ptr<PhyloTree> nextPhyloTree();
+
+private:
+  std::pair<const char*, const char*> nextDescription_();
+};
 } // end of namespace bpp.
 #endif // BPP_PHYL_IO_NEWICK_H
@@ -455,3 +455,90 @@ shared_ptr<DRTreeParsimonyScore> LegacyOptimizationTools::optimizeTreeNNI(
   topoSearch.search();
   return dynamic_pointer_cast<DRTreeParsimonyScore>(topoSearch.getSearchableObject());
 }
+
+/******************************************************************************/
+
+shared_ptr<BitParallelTreeParsimonyScore> LegacyOptimizationTools::optimizeTreeNNI(
+    shared_ptr<BitParallelTreeParsimonyScore> tp,
+    unsigned int verbose)
+{
+  auto topo = dynamic_pointer_cast<NNISearchable>(tp);
+  NNITopologySearch topoSearch(topo, NNITopologySearch::PHYML, verbose);
+  topoSearch.search();
+  return dynamic_pointer_cast<BitParallelTreeParsimonyScore>(topoSearch.getSearchableObject());
+}
+
+/******************************************************************************/
+
+shared_ptr<BitParallelTreeParsimonyScore> LegacyOptimizationTools::optimizeTreeSPR(
+    shared_ptr<BitParallelTreeParsimonyScore> tp,
+    unsigned int verbose)
+{
+  if (verbose > 0)
+    ApplicationTools::displayResult("Initial parsimony score", tp->getScore());
+  unsigned int round = 0;
+  bool improved = true;
+  while (improved)
+  {
+    improved = false;
+    round++;
+    vector<int> ids = tp->getTreeTemplate()->getNodesId();
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+      // Previous moves may have changed the possible ones:
+      if (!tp->isSPRPossible(ids[i]))
+        continue;
+      int targetId;
+      if (tp->testSPR(ids[i], targetId) < 0)
+      {
+        tp->doSPR(ids[i], targetId);
+        improved = true;
+      }
+    }
+    if (verbose > 0)
+      ApplicationTools::displayResult("Parsimony score after SPR round " + TextTools::toString(round), tp->getScore());
+  }
+  return tp;
+}
+
+/******************************************************************************/
+
+shared_ptr<BitParallelTreeParsimonyScore> LegacyOptimizationTools::optimizeTreeSPR(
+    const vector<shared_ptr<BitParallelTreeParsimonyScore>>& tps,
+    unsigned int verbose)
+{
+  if (tps.size() == 0)
+    throw Exception("LegacyOptimizationTools::optimizeTreeSPR. No starting tree.");
+
+  string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (size_t i = 0; i < tps.size(); ++i)
+  {
+    try
+    {
+      optimizeTreeSPR(tps[i], 0);
+    }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (LegacyOptimizationTools_optimizeTreeSPR_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = e.what();
+    }
+  }
+  if (errorMessage != "")
+    throw Exception("LegacyOptimizationTools::optimizeTreeSPR. " + errorMessage);
+
+  size_t best = 0;
+  for (size_t i = 0; i < tps.size(); ++i)
+  {
+    if (verbose > 0)
+      ApplicationTools::displayResult("Parsimony score of starting tree " + TextTools::toString(i + 1), tps[i]->getScore());
+    if (tps[i]->getScore() < tps[best]->getScore())
+      best = i;
+  }
+  return tps[best];
+}
@@ -10,6 +10,7 @@
 #include <Bpp/Numeric/Function/SimpleNewtonMultiDimensions.h>
 #include <Bpp/Phyl/OptimizationTools.h>
 
+#include "../Parsimony/BitParallelTreeParsimonyScore.h"
 #include "../Parsimony/DRTreeParsimonyScore.h"
 #include "../Tree/TreeTemplate.h"
 #include "Likelihood/NNIHomogeneousTreeLikelihood.h"
@@ -539,6 +540,45 @@ public:
   static std::shared_ptr<DRTreeParsimonyScore> optimizeTreeNNI(
       std::shared_ptr<DRTreeParsimonyScore> tp,
       unsigned int verbose = 1);
+
+  /**
+   * @brief Optimize tree topology from a BitParallelTreeParsimonyScore using Nearest Neighbor Interchanges.
+   *
+   * @param tp               A pointer toward the BitParallelTreeParsimonyScore object to optimize.
+   * @param verbose          The verbose level.
+   * @return A pointer toward the final parsimony score object.
+   */
+  static std::shared_ptr<BitParallelTreeParsimonyScore> optimizeTreeNNI(
+      std::shared_ptr<BitParallelTreeParsimonyScore> tp,
+      unsigned int verbose = 1);
+
+  /**
+   * @brief Optimize tree topology from a BitParallelTreeParsimonyScore using Subtree Pruning and Regrafting.
+   *
+   * Each subtree is in turn pruned and regrafted at its best position,
+   * if this improves the score, until no move improves it.
+   *
+   * @param tp               A pointer toward the BitParallelTreeParsimonyScore object to optimize.
+   * @param verbose          The verbose level.
+   * @return A pointer toward the final parsimony score object (the same as tp).
+   */
+  static std::shared_ptr<BitParallelTreeParsimonyScore> optimizeTreeSPR(
+      std::shared_ptr<BitParallelTreeParsimonyScore> tp,
+      unsigned int verbose = 1);
+
+  /**
+   * @brief Optimize several starting trees using Subtree Pruning and Regrafting, in parallel.
+   *
+   * The searches are run in parallel if the library is built with OpenMP.
+   * The score objects must not share their trees.
+   *
+   * @param tps              The BitParallelTreeParsimonyScore objects to optimize, one per starting tree.
+   * @param verbose          The verbose level.
+   * @return A pointer toward the score object with the best final score.
+   */
+  static std::shared_ptr<BitParallelTreeParsimonyScore> optimizeTreeSPR(
+      const std::vector<std::shared_ptr<BitParallelTreeParsimonyScore>>& tps,
+      unsigned int verbose = 1);
 };
 } // end of namespace bpp.
 #endif // BPP_PHYL_LEGACY_OPTIMIZATIONTOOLS_H
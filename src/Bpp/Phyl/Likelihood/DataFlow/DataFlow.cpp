@@ -4,17 +4,22 @@
 
 #include <Bpp/Exceptions.h>
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <fstream> // debug
 #include <functional> // std::hash
 #include <iomanip>
 #include <iostream> // debug
+#include <mutex> // registration of dependent nodes
 #include <ostream> // debug
 #include <regex>
-#include <stack> // invalidate/compute recursively + debug
+#include <stack> // debug
 #include <type_traits> // DotOptions flags
 #include <typeinfo>
 #include <unordered_set> // debug
 #include <set>
+#include <thread> // wait for nodes computed by other threads
+#include <vector> // invalidate/compute recursively
 
 #include "DataFlow.h"
 #include "DataFlowNumeric.h"
@@ -180,6 +185,48 @@ NodeRef Node_DF::recreate(Context&, NodeRefVec&&)
   throw Exception ("Node does not support recreate(deps): " + description ());
 }
 
+/* Stacks of nodes used to traverse the graph when computing or
+ * invalidating. Their storage is kept per thread and reused, so that a
+ * steady-state re-evaluation does not allocate. A traversal started
+ * while another one is running on the same thread (from a compute())
+ * uses its own storage.
+ */
+namespace
+{
+class TraversalStacks
+{
+private:
+  struct Storage
+  {
+    std::vector<Node_DF*> first;
+    std::vector<Node_DF*> second;
+    bool inUse{false};
+  };
+
+  Storage local_;
+  Storage* storage_;
+
+public:
+  TraversalStacks ()
+    : local_ (), storage_ (nullptr)
+  {
+    static thread_local Storage shared;
+    storage_ = shared.inUse ? &local_ : &shared;
+    storage_->inUse = true;
+    storage_->first.clear ();
+    storage_->second.clear ();
+  }
+
+  TraversalStacks (const TraversalStacks&) = delete;
+  TraversalStacks& operator= (const TraversalStacks&) = delete;
+
+  ~TraversalStacks () { storage_->inUse = false; }
+
+  std::vector<Node_DF*>& first () { return storage_->first; }
+  std::vector<Node_DF*>& second () { return storage_->second; }
+};
+} // namespace
+
 void Node_DF::computeRecursively ()
 {
   // Compute the current node (and dependencies recursively) if needed
@@ -187,63 +234,113 @@ void Node_DF::computeRecursively ()
     return;
 
   // Discover then recompute needed nodes
-  std::stack<Node_DF*> nodesToVisit;
-  std::stack<Node_DF*> nodesToRecompute;
-  nodesToVisit.push (this);
+  TraversalStacks stacks;
+  auto& nodesToVisit = stacks.first ();
+  auto& nodesToRecompute = stacks.second ();
+  nodesToVisit.push_back (this);
   while (!nodesToVisit.empty ())
   {
-    auto* n = nodesToVisit.top();
-    nodesToVisit.pop();
+    auto* n = nodesToVisit.back();
+    nodesToVisit.pop_back();
     if (!n->isValid())
     {
-      nodesToRecompute.push(n);
+      nodesToRecompute.push_back(n);
       for (auto& dep : n->dependencies())
       {
         if (dep)
-          nodesToVisit.push(dep.get());
+          nodesToVisit.push_back(dep.get());
       }
     }
   }
   while (!nodesToRecompute.empty())
   {
-    auto* n = nodesToRecompute.top();
-    nodesToRecompute.pop ();
-    if (!n->isValid())
+    auto* n = nodesToRecompute.back();
+    nodesToRecompute.pop_back ();
+    n->computeOnce_ ();
+  }
+}
+
+void Node_DF::computeOnce_ ()
+{
+  for ( ; ; )
+  {
+    unsigned char state = state_.load (std::memory_order_acquire);
+    if (state == validState)
+      return;
+    if (state == computingState)
     {
-      n->compute();
-      n->makeValid();
+      // Computed by another thread.
+      std::this_thread::yield ();
+      continue;
+    }
+    if (state_.compare_exchange_weak (state, computingState, std::memory_order_acquire))
+    {
+      try
+      {
+        compute ();
+      }
+      catch (...)
+      {
+        makeInvalid ();
+        throw;
+      }
+      makeValid ();
+      return;
     }
   }
 }
 
+void Node_DF::invalidateDependentNodes () noexcept
+{
+  for (auto* dependent : dependentNodes_)
+  {
+    dependent->invalidateRecursively ();
+  }
+}
+
 void Node_DF::invalidateRecursively () noexcept
 {
   if (!isValid ())
     return;
-  std::stack<Node_DF*> nodesToInvalidate;
-  nodesToInvalidate.push (this);
+  TraversalStacks stacks;
+  auto& nodesToInvalidate = stacks.first ();
+  nodesToInvalidate.push_back (this);
   while (!nodesToInvalidate.empty ())
   {
-    auto* n = nodesToInvalidate.top ();
-    nodesToInvalidate.pop ();
+    auto* n = nodesToInvalidate.back ();
+    nodesToInvalidate.pop_back ();
     if (n->isValid ())
     {
       n->makeInvalid ();
       for (auto* dependent : n->dependentNodes_)
       {
-        nodesToInvalidate.push (dependent);
+        nodesToInvalidate.push_back (dependent);
       }
     }
   }
 }
 
+/* Nodes shared by graphs built concurrently get dependent nodes
+ * registered from several threads. A fixed set of mutexes, selected
+ * from the address of the registered-to node, guards these updates
+ * without adding a mutex to every node.
+ */
+static std::mutex& registrationMutex (const Node_DF* node)
+{
+  // Never destroyed, as nodes may be destroyed at exit.
+  static auto* mutexes = new std::array<std::mutex, 64>();
+  return (*mutexes)[(reinterpret_cast<std::uintptr_t>(node) / alignof(Node_DF)) % mutexes->size ()];
+}
+
 void Node_DF::registerNode (Node_DF* n)
 {
+  std::lock_guard<std::mutex> lock (registrationMutex (this));
   dependentNodes_.emplace_back (n);
 }
 
 void Node_DF::unregisterNode (const Node_DF* n)
 {
+  std::lock_guard<std::mutex> lock (registrationMutex (this));
   dependentNodes_.erase (std::remove (dependentNodes_.begin (), dependentNodes_.end (), n),
       dependentNodes_.end ());
 }
@@ -315,8 +412,11 @@ Context::Context() : nodeCache_(), zero_(ConstantZero<size_t>::create(*this, Dim
 NodeRef Context::cached(NodeRef&& newNode)
 {
   assert (newNode != nullptr);
+  CachedNodeRef cachedRef(std::move (newNode));
+  auto& shard = nodeCache_[CachedNodeRefHash()(cachedRef) % nbShards_];
+  std::lock_guard<std::mutex> lock(shard.mutex);
   // Try inserting it, which will fail if already present and return the old one
-  auto r = nodeCache_.emplace(std::move (newNode));
+  auto r = shard.nodes.emplace(std::move (cachedRef));
   return r.first->ref;
 }
 
@@ -324,25 +424,68 @@ NodeRef Context::cached (NodeRef& newNode)
 {
   assert (newNode != nullptr);
   // First remove this object from the set if it is already
-  for (auto it = nodeCache_.begin(); it != nodeCache_.end();)
-  {
-    if (it->ref == newNode)
-      it = nodeCache_.erase(it);
-    else
-      ++it;
-  }
+  eraseFromCache_(newNode.get());
 
   // Try inserting it, which will fail if already present and return the old one
-  auto r = nodeCache_.emplace (newNode);
+  CachedNodeRef cachedRef(newNode);
+  auto& shard = nodeCache_[CachedNodeRefHash()(cachedRef) % nbShards_];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto r = shard.nodes.emplace (std::move (cachedRef));
   return r.first->ref;
 }
 
+bool Context::eraseFromCache_(const Node_DF* node)
+{
+  // The node may have been stored with another hash (if its
+  // dependencies were reset), so all the shards are searched.
+  bool found = false;
+  for (auto& shard : nodeCache_)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto it = shard.nodes.begin(); it != shard.nodes.end();)
+    {
+      if (it->ref.get() == node)
+      {
+        it = shard.nodes.erase(it);
+        found = true;
+      }
+      else
+        ++it;
+    }
+  }
+  return found;
+}
+
+size_t Context::size() const
+{
+  size_t s = 0;
+  for (const auto& shard : nodeCache_)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    s += shard.nodes.size();
+  }
+  return s;
+}
+
+void Context::clear()
+{
+  for (auto& shard : nodeCache_)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.nodes.clear();
+  }
+}
+
 std::vector<const Node_DF*> Context::getAllNodes() const
 {
   std::vector<const Node_DF*> ret;
-  for (const auto& it : nodeCache_)
+  for (const auto& shard : nodeCache_)
   {
-    ret.push_back(it.ref.get());
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& it : shard.nodes)
+    {
+      ret.push_back(it.ref.get());
+    }
   }
   return ret;
 }
@@ -363,27 +506,18 @@ bool Context::erase(const NodeRef& node)
     flag = false;
     for (auto n : sNodes)
     {
-      if (n->nbDependentNodes() == 0)
+      if (n->nbDependentNodes() == 0 && eraseFromCache_(n.get()))
       {
-        for (auto it = nodeCache_.begin(); it != nodeCache_.end();)
+        sNodes.erase(n);
+        for (auto dep:n->dependencies())
         {
-          if (it->ref == n)
-          {
-            sNodes.erase(n);
-            for (auto dep:n->dependencies())
-            {
-              if (!dep)
-                continue;
-              sNodes.emplace(dep);
-              dep->unregisterNode (n.get());
-            }
-            it = nodeCache_.erase(it);
-            flag = true;
-            ret = true;
-          }
-          else
-            ++it;
+          if (!dep)
+            continue;
+          sNodes.emplace(dep);
+          dep->unregisterNode (n.get());
         }
+        flag = true;
+        ret = true;
       }
       if (flag)
         break;
@@ -6,10 +6,13 @@
 #define BPP_PHYL_LIKELIHOOD_DATAFLOW_DATAFLOW_H
 
 #include <Bpp/Exceptions.h>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <typeinfo>
@@ -163,7 +166,7 @@ public:
   Node_DF (NodeRefVec&& dependenciesArg);
 
   // Accessors
-  bool isValid () const noexcept { return isValid_; }
+  bool isValid () const noexcept { return state_.load (std::memory_order_acquire) == validState; }
 
   /**
    * @brief Number of dependent nodes (ie nodes that depend on this)
@@ -239,10 +242,19 @@ public:
 
   /** @brief Compute this node value, recomputing dependencies (transitively) as needed.
    *
-   * Not thread safe !
+   * Can be called concurrently from several threads (see Context):
+   * each invalid node is computed by a single thread, the others wait
+   * for its value.
    */
   void computeRecursively ();
 
+  /** @brief Invalidate (transitively) the nodes depending on this one.
+   *
+   * Used to force the recomputation of the nodes above this one, without
+   * changing any value. Not thread safe !
+   */
+  void invalidateDependentNodes () noexcept;
+
 protected:
   /** @brief Computation implementation.
    *
@@ -267,8 +279,8 @@ protected:
    */
   void invalidateRecursively () noexcept;
 
-  void makeInvalid () noexcept { isValid_ = false; }
-  void makeValid () noexcept { isValid_ = true; }
+  void makeInvalid () noexcept { state_.store (invalidState, std::memory_order_release); }
+  void makeValid () noexcept { state_.store (validState, std::memory_order_release); }
 
 protected:
   // void setDependencies_(NodeRefVec && dependenciesArg)
@@ -309,9 +321,16 @@ private:
   void registerNode (Node_DF* n);
   void unregisterNode (const Node_DF* n);
 
+  // Compute the node if invalid, or wait for the thread computing it.
+  void computeOnce_ ();
+
+  // A node being computed is not valid, and only the thread which
+  // switched it from invalid to computing calls compute.
+  enum : unsigned char { invalidState, computingState, validState };
+
   NodeRefVec dependencyNodes_{};         // Nodes that we depend on.
   std::vector<Node_DF*> dependentNodes_{}; // Nodes that depend on us.
-  bool isValid_{false};
+  std::atomic<unsigned char> state_{invalidState};
 
   friend class Context;
 };
@@ -522,12 +541,34 @@ void checkDependencyRangeIsValue (const std::type_info& contextNodeType, const N
  * - same additional arguments (constants, etc).
  * Which is equivalent to the value if all additional arguments are compared.
  * (compare|hash)AdditionalArguments implement polymorphic comparison of additional arguments.
+ *
+ * Threading contract:
+ * - Nodes can be created (create, derive, recreate, cached) concurrently
+ *   from several threads with the same Context. The set of nodes is split
+ *   in shards guarded by their own mutex, and the registration of a new
+ *   node as dependent of its dependencies is guarded by striped locks.
+ *   Concurrent creations of the same node return the same node.
+ * - Nodes can be computed (computeRecursively, targetValue) concurrently
+ *   from several threads. A node shared by these computations is computed
+ *   by a single thread, the others wait for its value. The objects of
+ *   distinct nodes must be independent: for example, nodes computed
+ *   concurrently must not use the same model object (see
+ *   ConfiguredParametrizable), and shared values must only be read by
+ *   methods which do not write into them.
+ * - Invalidating nodes (setValue, invalidateDependentNodes, ...) is NOT
+ *   thread safe, and must not happen concurrently with the computation of
+ *   the invalidated nodes, or with the creation of nodes depending on them.
+ * - clear and erase must not be called concurrently with the
+ *   creation of nodes.
  */
 class Context
 {
 public:
   Context ();
 
+  Context (const Context&) = delete;
+  Context& operator=(const Context&) = delete;
+
   /**
    * @brief For a newly created node, return its equivalent from the cache.
    * If not already present in the cache, add it and return newNode.
@@ -540,18 +581,12 @@ public:
 
   NodeRef cached(NodeRef& newNode);
 
-  size_t size() const
-  {
-    return nodeCache_.size();
-  }
+  size_t size() const;
 
   /**
    * @brief Clear the context
    */
-  void clear()
-  {
-    nodeCache_.clear();
-  }
+  void clear();
 
   /**
    * @brief Remove an element from the map, only if it has no
@@ -605,9 +640,30 @@ private:
     std::size_t operator()(const CachedNodeRef& ref) const;
   };
 
-  std::unordered_set<CachedNodeRef, CachedNodeRefHash> nodeCache_;
+  /**
+   * @brief A part of the set of nodes, with its own lock.
+   *
+   * A node is stored in the shard selected by its CachedNodeRefHash.
+   */
+  struct CacheShard
+  {
+    mutable std::mutex mutex;
+    std::unordered_set<CachedNodeRef, CachedNodeRefHash> nodes;
+  };
+
+  static constexpr std::size_t nbShards_ = 16;
+
+  std::array<CacheShard, nbShards_> nodeCache_;
 
   NodeRef zero_;
+
+  /**
+   * @brief Remove a node from the shard it is stored in, whatever its
+   * current hash.
+   *
+   * @return if the node was found.
+   */
+  bool eraseFromCache_(const Node_DF* node);
 };
 
 /// Helper: Same as Context::cached but with a shared_ptr<T> node.
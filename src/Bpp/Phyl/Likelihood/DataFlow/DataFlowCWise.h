@@ -68,6 +68,100 @@ inline ExtendedFloatArrayWrapper<R, C> cwise (ExtendedFloatMatrix<R, C>& m)
 {
   return ExtendedFloatArrayWrapper<R, C>(m);
 }
+
+/*
+ * Component-wise operations writing into an existing value.
+ *
+ * The generic versions use cwise. The ExtendedFloatMatrix versions
+ * work on the float parts directly, without the temporary arrays built
+ * by cwise on const values, so they do not allocate when r already has
+ * the right dimension.
+ */
+
+// r = x0 * x1
+template<typename R, typename T0, typename T1>
+void cwiseMulTo (R& r, const T0& x0, const T1& x1)
+{
+  r = cwise (x0) * cwise (x1);
+}
+
+template<int R, int C>
+void cwiseMulTo (ExtendedFloatMatrix<R, C>& r, const ExtendedFloatMatrix<R, C>& x0, const ExtendedFloatMatrix<R, C>& x1)
+{
+  r.float_part ().array () = x0.float_part ().array () * x1.float_part ().array ();
+  r.exponent_part () = x0.exponent_part () + x1.exponent_part ();
+  r.normalize ();
+}
+
+template<int R, int C, typename S>
+typename std::enable_if<std::is_arithmetic<S>::value || std::is_same<S, ExtendedFloat>::value, void>::type
+cwiseMulTo (ExtendedFloatMatrix<R, C>& r, const S& s, const ExtendedFloatMatrix<R, C>& x)
+{
+  const ExtendedFloat es (s);
+  r.float_part ().array () = es.float_part () * x.float_part ().array ();
+  r.exponent_part () = es.exponent_part () + x.exponent_part ();
+  r.normalize ();
+}
+
+// r *= x
+template<typename R, typename T>
+void cwiseMulInPlace (R& r, const T& x)
+{
+  cwise (r) *= cwise (x);
+}
+
+template<int R, int C>
+void cwiseMulInPlace (ExtendedFloatMatrix<R, C>& r, const ExtendedFloatMatrix<R, C>& x)
+{
+  r.float_part ().array () *= x.float_part ().array ();
+  r.exponent_part () += x.exponent_part ();
+  r.normalize ();
+}
+
+// r += s * x, with s a scalar
+template<typename R, typename S, typename T>
+void cwiseAddScaledInPlace (R& r, const S& s, const T& x)
+{
+  cwise (r) += s * cwise (x);
+}
+
+template<int R, int C, typename S>
+typename std::enable_if<std::is_arithmetic<S>::value || std::is_same<S, ExtendedFloat>::value, void>::type
+cwiseAddScaledInPlace (ExtendedFloatMatrix<R, C>& r, const S& s, const ExtendedFloatMatrix<R, C>& x)
+{
+  const ExtendedFloat es (s);
+  const auto xExp = es.exponent_part () + x.exponent_part ();
+  if (r.float_part ().isZero ())
+  {
+    r.float_part () = es.float_part () * x.float_part ();
+    r.exponent_part () = xExp;
+  }
+  else if (r.exponent_part () >= xExp)
+  {
+    r.float_part () += (es.float_part () * constexpr_power<double>(ExtendedFloat::radix, xExp - r.exponent_part ())) * x.float_part ();
+  }
+  else
+  {
+    r.float_part () = es.float_part () * x.float_part () + r.float_part () * constexpr_power<double>(ExtendedFloat::radix, r.exponent_part () - xExp);
+    r.exponent_part () = xExp;
+  }
+  r.normalize ();
+}
+
+// Component i of vector v, by copy: operator() of ExtendedFloatMatrix
+// writes a temporary of v, which must not happen when v is read from
+// several threads.
+template<typename T>
+auto coefficient (const T& v, Eigen::Index i) -> typename std::decay<decltype(v(i))>::type
+{
+  return v(i);
+}
+
+template<int R, int C>
+ExtendedFloat coefficient (const ExtendedFloatMatrix<R, C>& v, Eigen::Index i)
+{
+  return ExtendedFloat (v.float_part ()(i), v.exponent_part ());
+}
 }
 
 /******************************************************************************
@@ -515,7 +515,7 @@ private:
   {
     using namespace numeric;
     auto& result = this->accessValueMutable ();
-    result = zero (targetDimension_);
+    setZero (result, targetDimension_);
     for (const auto& depNodeRef : this->dependencies ())
     {
       result += accessValueConstCast<T>(*depNodeRef);
@@ -770,11 +770,11 @@ private:
   {
     using namespace numeric;
     auto& result = this->accessValueMutable ();
-    result = zero (targetDimension_);
+    setZero (result, targetDimension_);
     size_t half = this->nbDependencies() / 2;
     for (size_t i = 0; i < half; i++)
     {
-      cwise(result) += cwise (accessValueConstCast<P>(*this->dependency(i + half))) * cwise (accessValueConstCast<T>(*this->dependency(i)));
+      cwiseAddScaledInPlace (result, accessValueConstCast<P>(*this->dependency(i + half)), accessValueConstCast<T>(*this->dependency(i)));
     }
   }
 
@@ -885,10 +885,10 @@ private:
     std::cerr << "=== end CWiseMean === " << this << std::endl << std::endl;
 #endif
 
-    result = cwise(p)[0] * cwise (accessValueConstCast<T>(*this->dependency(0)));
-    for (Eigen::Index i = 1; i < Eigen::Index(this->nbDependencies() - 1); i++)
+    setZero (result, targetDimension_);
+    for (Eigen::Index i = 0; i < Eigen::Index(this->nbDependencies() - 1); i++)
     {
-      cwise(result) += cwise(p)[i] * cwise (accessValueConstCast<T>(*this->dependency(size_t(i))));
+      cwiseAddScaledInPlace (result, coefficient (p, i), accessValueConstCast<T>(*this->dependency(size_t(i))));
     }
   }
 
@@ -1017,7 +1017,7 @@ private:
     std::cerr << "x0= "     << x0 << std::endl;
     std::cerr << "x1= "     << x1 << std::endl;
 #endif
-    result = cwise (x0) * cwise (x1);
+    cwiseMulTo (result, x0, x1);
 
 #ifdef DEBUG
     std::cerr << "result= " << result << std::endl;
@@ -1173,10 +1173,10 @@ private:
   {
     using namespace numeric;
     auto& result = this->accessValueMutable ();
-    result = one (targetDimension_);
+    setOne (result, targetDimension_);
     for (const auto& depNodeRef : this->dependencies ())
     {
-      cwise(result) *= cwise (accessValueConstCast<T>(*depNodeRef));
+      cwiseMulInPlace (result, accessValueConstCast<T>(*depNodeRef));
     }
   }
 
@@ -2210,8 +2210,8 @@ private:
     auto& result = this->accessValueMutable ();
     const auto& x0 = accessValueConstCast<DepT0>(*this->dependency (0));
     const auto& x1 = accessValueConstCast<DepT1>(*this->dependency (1));
-    result.noalias () =
-        NumericalDependencyTransform<T0>::transform (x0) * NumericalDependencyTransform<T1>::transform (x1);
+    numeric::matrixProductTo (result,
+        NumericalDependencyTransform<T0>::transform (x0), NumericalDependencyTransform<T1>::transform (x1));
 #ifdef DEBUG
     if ((x1.cols() + x1.rows() < 100 ) &&  (x0.cols() + x0.rows() < 100))
     {
@@ -2529,11 +2529,11 @@ private:
     auto& result = this->accessValueMutable ();
     const auto& delta = accessValueConstCast<double>(*this->dependency (0));
     const double lambda = pow (delta, -n_);
-    result = zero (targetDimension_);
+    setZero (result, targetDimension_);
     for (std::size_t i = 0; i < coeffs_.size (); ++i)
     {
       const auto& x = accessValueConstCast<T>(*this->dependency (1 + i));
-      cwise (result) += (lambda * coeffs_[i]) * cwise (x);
+      cwiseAddScaledInPlace (result, lambda * coeffs_[i], x);
     }
   }
 
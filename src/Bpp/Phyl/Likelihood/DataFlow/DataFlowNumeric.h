@@ -509,6 +509,82 @@ TransitionFunction one (const Dimension<TransitionFunction>& dim)
       });
 }
 
+// Set a value to zero (or one) with the given dimension, reusing its
+// storage when the dimension is unchanged (no allocation).
+template<typename T>
+void setZero (T& t, const Dimension<T>& dim)
+{
+  t = zero (dim);
+}
+
+template<typename T,  int Rows,  int Cols>
+void setZero (Eigen::Matrix<T, Rows, Cols>& t, const Dimension<Eigen::Matrix<T, Rows, Cols>>& dim)
+{
+  t.setZero (dim.rows, dim.cols);
+}
+
+template< int R,  int C, template< int R2 = R,  int C2 = C> class MatType >
+void setZero (ExtendedFloatEigen<R, C, MatType>& t, const Dimension<ExtendedFloatEigen<R, C, MatType>>& dim)
+{
+  t.float_part ().setZero (dim.rows, dim.cols);
+  t.exponent_part () = 0;
+}
+
+template<typename T>
+void setOne (T& t, const Dimension<T>& dim)
+{
+  t = one (dim);
+}
+
+template<typename T,  int Rows,  int Cols>
+void setOne (Eigen::Matrix<T, Rows, Cols>& t, const Dimension<Eigen::Matrix<T, Rows, Cols>>& dim)
+{
+  t.setOnes (dim.rows, dim.cols);
+}
+
+template< int R,  int C, template< int R2 = R,  int C2 = C> class MatType >
+void setOne (ExtendedFloatEigen<R, C, MatType>& t, const Dimension<ExtendedFloatEigen<R, C, MatType>>& dim)
+{
+  t.float_part ().setOnes (dim.rows, dim.cols);
+  t.exponent_part () = 0;
+}
+
+// Matrix product r = x0 * x1, computed directly into r. With extended
+// float operands, the product is done on the float parts, to avoid the
+// temporary built by the ExtendedFloatEigen operators.
+template<typename R, typename T0, typename T1>
+typename std::enable_if<!std::is_base_of<ExtendedFloatEigenCore, R>::value, void>::type
+matrixProductTo (R& r, const T0& x0, const T1& x1)
+{
+  r.noalias () = x0 * x1;
+}
+
+template<int R, int C, typename T0, int R1, int C1>
+typename std::enable_if<std::is_base_of<Eigen::EigenBase<T0>, T0>::value, void>::type
+matrixProductTo (ExtendedFloatMatrix<R, C>& r, const T0& x0, const ExtendedFloatMatrix<R1, C1>& x1)
+{
+  r.float_part ().noalias () = x0 * x1.float_part ();
+  r.exponent_part () = x1.exponent_part ();
+  r.normalize ();
+}
+
+template<int R, int C, int R0, int C0, typename T1>
+typename std::enable_if<std::is_base_of<Eigen::EigenBase<T1>, T1>::value, void>::type
+matrixProductTo (ExtendedFloatMatrix<R, C>& r, const ExtendedFloatMatrix<R0, C0>& x0, const T1& x1)
+{
+  r.float_part ().noalias () = x0.float_part () * x1;
+  r.exponent_part () = x0.exponent_part ();
+  r.normalize ();
+}
+
+template<int R, int C, int R0, int C0, int R1, int C1>
+void matrixProductTo (ExtendedFloatMatrix<R, C>& r, const ExtendedFloatMatrix<R0, C0>& x0, const ExtendedFloatMatrix<R1, C1>& x1)
+{
+  r.float_part ().noalias () = x0.float_part () * x1.float_part ();
+  r.exponent_part () = x0.exponent_part () + x1.exponent_part ();
+  r.normalize ();
+}
+
 // Create an identity value of the given dimension (fails if not a square matrix)
 template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
 T identity (const Dimension<T>&)
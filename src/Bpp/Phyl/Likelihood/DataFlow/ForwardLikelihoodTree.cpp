@@ -57,8 +57,18 @@ ForwardLikelihoodBelowRef ForwardLikelihoodTree::makeForwardLikelihoodAtEdge(
 
       processEdge->setTransitionMatrix(transitionMatrix);
 
-      forwardEdge = ForwardTransition::create (
-            context_, {transitionMatrix, childConditionalLikelihood}, likelihoodMatrixDim_);
+      // Positions evolving independently, or action of the exponential
+      // of a sparse generator: the whole transition matrix is only
+      // computed if needed elsewhere (eg backward likelihoods).
+      if (!nMod && ForwardKroneckerTransitionFromModel::isFactored(*model->targetValue()))
+        forwardEdge = ForwardKroneckerTransitionFromModel::create (
+              context_, {model, brlen, zero, childConditionalLikelihood}, likelihoodMatrixDim_);
+      else if (!nMod && ForwardExpmvTransitionFromModel::isExpmv(*model->targetValue()))
+        forwardEdge = ForwardExpmvTransitionFromModel::create (
+              context_, {model, brlen, zero, childConditionalLikelihood}, likelihoodMatrixDim_);
+      else
+        forwardEdge = ForwardTransition::create (
+              context_, {transitionMatrix, childConditionalLikelihood}, likelihoodMatrixDim_);
     }
     else
     {
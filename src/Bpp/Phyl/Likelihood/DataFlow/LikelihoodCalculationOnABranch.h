@@ -54,7 +54,7 @@ using SiteLikelihoodsRef = ValueRef<RowLik>;
 
 using AllRatesSiteLikelihoods = MatrixLik;
 
-using SiteWeights = NumericConstant<Eigen::RowVectorXi>;
+using SiteWeights = NumericMutable<Eigen::RowVectorXi>;
 
 using ForwardTransition =
     MatrixProduct<MatrixLik, Eigen::MatrixXd, MatrixLik>;
@@ -6,6 +6,8 @@
 #include <numeric>
 #include <unordered_map>
 
+#include <Bpp/Numeric/Random/RandomTools.h>
+
 #include "Bpp/Phyl/Model/MixedTransitionModel.h"
 #include "Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h"
 #include "Bpp/Phyl/Likelihood/DataFlow/BackwardLikelihoodTree.h"
@@ -23,7 +25,7 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(
     shared_ptr<const AlignmentDataInterface> sites,
     shared_ptr<const SubstitutionProcessInterface> process) :
   AlignedLikelihoodCalculation(context), process_(process), psites_(sites),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), sharedPatterns_(),
   processNodes_(), rFreqs_(),
   vRateCatTrees_(), catProb_(), condLikelihoodTree_(0)
 {
@@ -41,7 +43,7 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(
     shared_ptr<const SubstitutionProcessInterface> process) :
   AlignedLikelihoodCalculation(context),
   process_(process), psites_(),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), sharedPatterns_(),
   processNodes_(), rFreqs_(),
   vRateCatTrees_(), catProb_(), condLikelihoodTree_(0)
 {
@@ -61,7 +63,7 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(
   AlignedLikelihoodCalculation(collection->context()),
   process_(collection->collection().getSubstitutionProcess(nProcess)),
   psites_(sites),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), sharedPatterns_(),
   processNodes_(), rFreqs_(),
   vRateCatTrees_(), catProb_(), condLikelihoodTree_(0)
 {
@@ -82,7 +84,7 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(
   AlignedLikelihoodCalculation(collection->context()),
   process_(collection->collection().getSubstitutionProcess(nProcess)),
   psites_(),
-  rootPatternLinks_(), rootWeights_(), shrunkData_(),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), sharedPatterns_(),
   processNodes_(), rFreqs_(),
   vRateCatTrees_(), catProb_(), condLikelihoodTree_(0)
 {
@@ -97,10 +99,30 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(const Lik
   AlignedLikelihoodCalculation(lik),
   process_(lik.process_), psites_(lik.psites_),
   rootPatternLinks_(lik.rootPatternLinks_), rootWeights_(), shrunkData_(lik.shrunkData_),
+  sharedPatterns_(lik.sharedPatterns_),
   processNodes_(), rFreqs_(),
   vRateCatTrees_(), catProb_(), condLikelihoodTree_(0)
 {
-  setPatterns_();
+  // Patterns are shared with lik, only the weights are owned.
+  if (lik.rootWeights_)
+    rootWeights_ = SiteWeights::create(getContext_(), lik.rootWeights_->targetValue());
+  makeProcessNodes_();
+
+  // Default Derivate
+  setNumericalDerivateConfiguration(0.0001, NumericalDerivativeType::ThreePoints);
+}
+
+LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(
+    Context& context,
+    const LikelihoodCalculationSingleProcess& lik) :
+  AlignedLikelihoodCalculation(context),
+  process_(lik.process_), psites_(lik.psites_),
+  rootPatternLinks_(), rootWeights_(), shrunkData_(), sharedPatterns_(lik.sharedPatterns_),
+  processNodes_(), rFreqs_(),
+  vRateCatTrees_(), catProb_(), condLikelihoodTree_(0)
+{
+  if (sharedPatterns_)
+    makePatternNodes_();
   makeProcessNodes_();
 
   // Default Derivate
@@ -109,8 +131,14 @@ LikelihoodCalculationSingleProcess::LikelihoodCalculationSingleProcess(const Lik
 
 void LikelihoodCalculationSingleProcess::setPatterns_()
 {
-  SitePatterns patterns(*psites_, process_->getParametrizablePhyloTree()->getAllLeavesNames());
-  shrunkData_       = patterns.getSites();
+  sharedPatterns_ = SharedSitePatterns::get(psites_, process_->getParametrizablePhyloTree()->getAllLeavesNames());
+  makePatternNodes_();
+}
+
+void LikelihoodCalculationSingleProcess::makePatternNodes_()
+{
+  const auto& patterns = sharedPatterns_->getPatterns();
+  shrunkData_       = sharedPatterns_->getSites();
   rootPatternLinks_ = NumericConstant<PatternType>::create(getContext_(), patterns.getIndices());
   size_t nbSites    = shrunkData_->getNumberOfSites();
   Eigen::RowVectorXi weights(nbSites);
@@ -121,6 +149,45 @@ void LikelihoodCalculationSingleProcess::setPatterns_()
   rootWeights_ = SiteWeights::create(getContext_(), std::move(weights));
 }
 
+void LikelihoodCalculationSingleProcess::setRootWeights(const Eigen::RowVectorXi& weights)
+{
+  if (!rootWeights_)
+    throw Exception("LikelihoodCalculationSingleProcess::setRootWeights. Sites are not compressed.");
+  if (weights.size() != Eigen::Index(getNumberOfDistinctSites()))
+    throw Exception("LikelihoodCalculationSingleProcess::setRootWeights. Wrong number of weights: " + TextTools::toString(weights.size()) + " instead of " + TextTools::toString(getNumberOfDistinctSites()) + ".");
+  if (weights.size() != 0 && weights.minCoeff() < 0)
+    throw Exception("LikelihoodCalculationSingleProcess::setRootWeights. Negative weight.");
+  rootWeights_->setValue(weights);
+}
+
+void LikelihoodCalculationSingleProcess::resetRootWeights()
+{
+  if (!rootWeights_)
+    return;
+  const auto& links = rootPatternLinks_->targetValue();
+  Eigen::RowVectorXi weights = Eigen::RowVectorXi::Zero(Eigen::Index(getNumberOfDistinctSites()));
+  for (Eigen::Index i = 0; i < links.size(); i++)
+  {
+    weights(Eigen::Index(links(i)))++;
+  }
+  rootWeights_->setValue(weights);
+}
+
+Eigen::MatrixXi LikelihoodCalculationSingleProcess::drawBootstrapWeights(size_t nbReplicates) const
+{
+  size_t nbSites = getNumberOfSites();
+  Eigen::MatrixXi weights = Eigen::MatrixXi::Zero(Eigen::Index(nbReplicates), Eigen::Index(getNumberOfDistinctSites()));
+  for (size_t r = 0; r < nbReplicates; r++)
+  {
+    for (size_t i = 0; i < nbSites; i++)
+    {
+      size_t site = RandomTools::giveIntRandomNumberBetweenZeroAndEntry<size_t>(nbSites);
+      weights(Eigen::Index(r), Eigen::Index(getRootArrayPosition(site)))++;
+    }
+  }
+  return weights;
+}
+
 void LikelihoodCalculationSingleProcess::makeProcessNodes_()
 {
 #ifdef DEBUG
@@ -809,6 +876,7 @@ void LikelihoodCalculationSingleProcess::cleanAllLikelihoods()
   rootPatternLinks_.reset();
   rootWeights_.reset();
   shrunkData_.reset();
+  sharedPatterns_.reset();
   condLikelihoodTree_.reset();
 
   vRateCatTrees_.clear();
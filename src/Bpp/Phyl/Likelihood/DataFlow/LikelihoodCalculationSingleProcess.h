@@ -90,7 +90,7 @@ using SiteLikelihoodsRef = ValueRef<RowLik>;
 
 using AllRatesSiteLikelihoods = MatrixLik;
 
-using SiteWeights = NumericConstant<Eigen::RowVectorXi>;
+using SiteWeights = NumericMutable<Eigen::RowVectorXi>;
 
 /*
  * @brief DAG of the conditional likelihoods (product of above and
@@ -190,7 +190,13 @@ public:
    */
 
   std::shared_ptr<SiteWeights> rootWeights_;
-  std::shared_ptr<AlignmentDataInterface> shrunkData_;
+  std::shared_ptr<const AlignmentDataInterface> shrunkData_;
+
+  /**
+   * @brief The site patterns, shared with the other likelihoods
+   * computed on the same data.
+   */
+  std::shared_ptr<const SharedSitePatterns> sharedPatterns_;
 
   /************************************/
   /* DataFlow objects */
@@ -244,6 +250,15 @@ public:
 
   LikelihoodCalculationSingleProcess(const LikelihoodCalculationSingleProcess& lik);
 
+  /*
+   * @brief Build a likelihood calculation IN ANOTHER CONTEXT, on the
+   * data and process of lik, sharing its site patterns instead of
+   * computing them again.
+   *
+   * The root weights are the ones of the patterns.
+   */
+  LikelihoodCalculationSingleProcess(Context& context, const LikelihoodCalculationSingleProcess& lik);
+
   LikelihoodCalculationSingleProcess* clone() const
   {
     throw bpp::Exception("LikelihoodCalculationSingleProcess clone should not happen.");
@@ -432,6 +447,34 @@ public:
     return rootWeights_;
   }
 
+  /**
+   * @brief Set the weights of the distinct sites, for instance the
+   * counts of a bootstrap replicate (see drawBootstrapWeights()).
+   *
+   * The likelihood graph is not rebuilt: only the sum over the
+   * distinct sites is recomputed, and the likelihood can be
+   * re-optimized on the replicate.
+   *
+   * @param weights One non-negative weight per distinct site.
+   * @throw Exception If the sites are not compressed or if the weights are not valid.
+   */
+  void setRootWeights(const Eigen::RowVectorXi& weights);
+
+  /**
+   * @brief Restore the numbers of occurrences of the distinct sites as weights.
+   */
+  void resetRootWeights();
+
+  /**
+   * @brief Draw the weights of the distinct sites for nonparametric
+   * bootstrap replicates.
+   *
+   * @param nbReplicates The number of replicates.
+   * @return One row per replicate, with the number of draws of each
+   * distinct site among getNumberOfSites() draws with replacement.
+   */
+  Eigen::MatrixXi drawBootstrapWeights(size_t nbReplicates) const;
+
   ValueRef<Eigen::RowVectorXd> getRootFreqs()
   {
     return rFreqs_;
@@ -591,6 +634,11 @@ public:
 private:
   void setPatterns_();
 
+  /**
+   * @brief Build the pattern nodes from sharedPatterns_.
+   */
+  void makePatternNodes_();
+
   void makeForwardLikelihoodTree_();
 
   void makeProcessNodes_();
@@ -5,7 +5,10 @@
 #include <Bpp/Exceptions.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/Model.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/Parametrizable.h>
+#include <Bpp/Phyl/Model/AbstractBiblioSubstitutionModel.h>
+#include <Bpp/Phyl/Model/AbstractSubstitutionModel.h>
 #include <Bpp/Phyl/Model/MixedTransitionModel.h>
+#include <Bpp/Phyl/Model/WordSubstitutionModel.h>
 
 
 using namespace std;
@@ -160,13 +163,19 @@ NodeRef TransitionMatrixFromModel::derive (Context& c, const Node_DF& node)
 
   const auto nDeriv = accessValueConstCast<size_t>(*derivNode);
 
-  // Model part
+  // Model part, analytic for the transition matrix of a substitution
+  // model if available, numerical otherwise
   auto& model = static_cast<Dep&>(*modelDep);
   auto buildFWithNewModel = [this, &c, &brlenDep, &derivNode, &subNode](NodeRef&& newModel) {
         return ConfiguredParametrizable::createMatrix<Dep, Self>(c, {std::move (newModel), brlenDep, derivNode, subNode}, targetDimension_);
       };
+  auto buildAnalyticDerivative = [this, &c, &model, &modelDep, &brlenDep, nDeriv, &subNode](size_t i) {
+        if (nDeriv != 0 || subNode || !TransitionMatrixDerivativeFromModel::isAnalytic(*model.targetValue(), i))
+          return ValueRef<T>();
+        return TransitionMatrixDerivativeFromModel::create(c, {modelDep, brlenDep, NumericConstant<size_t>::create(c, i)}, targetDimension_);
+      };
   NodeRefVec derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
-        c, model, node, targetDimension_, buildFWithNewModel);
+        c, model, node, targetDimension_, buildFWithNewModel, buildAnalyticDerivative);
   // Brlen part, use specific node
   auto dbrlen_dn = brlenDep->derive (c, node);
   if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
@@ -249,6 +258,128 @@ void TransitionMatrixFromModel::compute ()
   }
 }
 
+// TransitionMatrixDerivativeFromModel
+
+TransitionMatrixDerivativeFromModel::TransitionMatrixDerivativeFromModel (NodeRefVec&& deps,
+    const Dimension<Eigen::MatrixXd>& dim)
+  : Value<Eigen::MatrixXd>(std::move (deps)), targetDimension_ (dim)
+{}
+
+std::string TransitionMatrixDerivativeFromModel::debugInfo () const
+{
+  using namespace numeric;
+  const auto nParam = accessValueConstCast<size_t>(*this->dependency (2));
+  return debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) + ":nParam=" + TextTools::toString(nParam);
+}
+
+// TransitionMatrixDerivativeFromModel additional arguments = ().
+bool TransitionMatrixDerivativeFromModel::compareAdditionalArguments (const Node_DF& other) const
+{
+  return dynamic_cast<const Self*>(&other) != nullptr;
+}
+
+ValueRef<Eigen::MatrixXd> TransitionMatrixDerivativeFromModel::create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim)
+{
+  checkDependenciesNotNull (typeid (Self), deps);
+  checkDependencyVectorSize (typeid (Self), deps, 3);
+  checkNthDependencyIs<ConfiguredModel>(typeid (Self), deps, 0);
+  checkNthDependencyIs<ConfiguredParameter>(typeid (Self), deps, 1);
+  checkNthDependencyIsValue<size_t>(typeid (Self), deps, 2);
+
+  return cachedAs<Value<T>>(c, std::make_shared<Self>(std::move (deps), dim));
+}
+
+namespace
+{
+/*
+ * The substitution model giving the analytic derivatives of the
+ * transition matrices of a model, and the name in it of the nParam-th
+ * independent parameter of the model (null if there is none). The
+ * models matching the bibliography (such as YN98 or MG94) delegate to
+ * the model they are defined through.
+ */
+const AbstractSubstitutionModel* derivableModel (const BranchModelInterface& model, size_t nParam, std::string& name)
+{
+  if (nParam >= model.getIndependentParameters().size())
+    return nullptr;
+  name = model.getIndependentParameters()[nParam].getName();
+
+  const auto* biblio = dynamic_cast<const AbstractBiblioSubstitutionModel*>(&model);
+  if (!biblio)
+    return dynamic_cast<const AbstractSubstitutionModel*>(&model);
+
+  try
+  {
+    name = biblio->getPmodelParName(biblio->getParameterNameWithoutNamespace(name));
+  }
+  catch (Exception&)
+  {
+    return nullptr;
+  }
+  return dynamic_cast<const AbstractSubstitutionModel*>(&biblio->substitutionModel());
+}
+}
+
+bool TransitionMatrixDerivativeFromModel::isAnalytic (const BranchModelInterface& model, size_t nParam)
+{
+  std::string name;
+  const auto* subModel = derivableModel (model, nParam, name);
+  return subModel && subModel->hasGeneratorDerivative(name);
+}
+
+NodeRef TransitionMatrixDerivativeFromModel::derive (Context& c, const Node_DF& node)
+{
+  // d(dtm/dx)/dn = sum_i d(dtm/dx)/dx_i * dx_i/dn + d(dtm/dbrlen)/dx * dbrlen/dn.
+  auto modelDep = this->dependency (0);
+  auto brlenDep = this->dependency (1);
+  auto paramDep = this->dependency (2);
+  const auto nParam = accessValueConstCast<size_t>(*paramDep);
+
+  // Model part, numerical
+  auto& model = static_cast<Dep&>(*modelDep);
+  auto buildFWithNewModel = [this, &c, &brlenDep, &paramDep](NodeRef&& newModel) {
+        return Self::create(c, {std::move (newModel), brlenDep, paramDep}, targetDimension_);
+      };
+  NodeRefVec derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
+        c, model, node, targetDimension_, buildFWithNewModel);
+
+  // Brlen part, numerical derivative of dtm/dbrlen with respect to the parameter
+  auto dbrlen_dn = brlenDep->derive (c, node);
+  if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+  {
+    auto one = NumericConstant<size_t>::create(c, 1);
+    auto buildDtmWithNewParam = [this, &c, &model, nParam, &brlenDep, &one](std::shared_ptr<ConfiguredParameter> newDep) {
+          NodeRefVec newModelDeps = model.dependencies ();
+          newModelDeps[nParam] = std::move (newDep);
+          auto newModel = model.recreate (c, std::move (newModelDeps));
+          return ConfiguredParametrizable::createMatrix<Dep, TransitionMatrixFromModel>(c, {std::move (newModel), brlenDep, one}, targetDimension_);
+        };
+    auto d2f = generateNumericalDerivative<T>(c, model.config, model.dependency (nParam), targetDimension_, buildDtmWithNewParam);
+    derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
+          c, {std::move (dbrlen_dn), std::move (d2f)}, targetDimension_));
+  }
+  return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+}
+
+NodeRef TransitionMatrixDerivativeFromModel::recreate (Context& c, NodeRefVec&& deps)
+{
+  return Self::create (c, std::move (deps), targetDimension_);
+}
+
+void TransitionMatrixDerivativeFromModel::compute ()
+{
+  const auto brlen = accessValueConstCast<double>(*this->dependency (1)->dependency(0));
+  const auto nParam = accessValueConstCast<size_t>(*this->dependency (2));
+
+  std::string name;
+  const auto* model = derivableModel (*accessValueConstCast<const BranchModelInterface*>(*this->dependency (0)), nParam, name);
+  if (!model)
+    throw Exception("TransitionMatrixDerivativeFromModel::compute only possible for AbstractSubstitutionModel.");
+
+  auto& r = this->accessValueMutable ();
+  copyBppToEigen (model->getdPij_dparam (brlen, name), r);
+}
+
 ////////////////////////////////////////////////////////////
 // TransitionFunctionFromModel
 
@@ -350,6 +481,316 @@ void TransitionFunctionFromModel::compute ()
 }
 
 
+////////////////////////////////////////////////////////////
+// ForwardKroneckerTransitionFromModel
+
+ForwardKroneckerTransitionFromModel::ForwardKroneckerTransitionFromModel (NodeRefVec&& deps,
+    const Dimension<T>& dim)
+  : Value<T>(std::move (deps)), targetDimension_ (dim),
+  factors_(), dFactors_(), d2Factors_(), term_(), work_()
+{}
+
+std::string ForwardKroneckerTransitionFromModel::debugInfo () const
+{
+  using namespace numeric;
+  const auto nDeriv = accessValueConstCast<size_t>(*this->dependency (2));
+  auto ret = debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) + ":nDeriv=" + TextTools::toString(nDeriv);
+  return ret;
+}
+
+// ForwardKroneckerTransitionFromModel additional arguments = ().
+bool ForwardKroneckerTransitionFromModel::compareAdditionalArguments (const Node_DF& other) const
+{
+  return dynamic_cast<const Self*>(&other) != nullptr;
+}
+
+bool ForwardKroneckerTransitionFromModel::isFactored (const BranchModelInterface& model)
+{
+  return dynamic_cast<const WordSubstitutionModel*>(&model) != nullptr;
+}
+
+ValueRef<MatrixLik> ForwardKroneckerTransitionFromModel::create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim)
+{
+  checkDependenciesNotNull (typeid (Self), deps);
+  checkDependencyVectorSize (typeid (Self), deps, 4);
+  checkNthDependencyIs<ConfiguredModel>(typeid (Self), deps, 0);
+  checkNthDependencyIs<ConfiguredParameter>(typeid (Self), deps, 1);
+  checkNthDependencyIsValue<T>(typeid (Self), deps, 3);
+
+  if (deps[3]->hasNumericalProperty (NumericalProperty::ConstantZero))
+    return ConstantZero<T>::create (c, dim);
+
+  return cachedAs<Value<T>>(c, std::make_shared<Self>(std::move (deps), dim));
+}
+
+NodeRef ForwardKroneckerTransitionFromModel::derive (Context& c, const Node_DF& node)
+{
+  // df/dn = sum_i df/dx_i * dx_i/dn + df/dbrlen * dbrlen/dn + P * dchild/dn (x_i = model parameters).
+  if (&node == this)
+    return ConstantOne<T>::create (c, targetDimension_);
+
+  auto modelDep = this->dependency (0);
+  auto brlenDep = this->dependency (1);
+  NodeRef derivNode = this->dependency (2);
+  auto childDep = this->dependency (3);
+
+  const auto nDeriv = accessValueConstCast<size_t>(*derivNode);
+
+  // Model part
+  auto& model = static_cast<Dep&>(*modelDep);
+  auto buildFWithNewModel = [this, &c, &brlenDep, &derivNode, &childDep](NodeRef&& newModel) {
+        return Self::create(c, {std::move (newModel), brlenDep, derivNode, childDep}, targetDimension_);
+      };
+  NodeRefVec derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
+        c, model, node, targetDimension_, buildFWithNewModel);
+
+  // Brlen part, use specific node
+  auto dbrlen_dn = brlenDep->derive (c, node);
+  if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+  {
+    auto nDerivp = NumericConstant<size_t>::create(c, nDeriv + 1);
+    auto df_dbrlen = Self::create(c, {modelDep, brlenDep, nDerivp, childDep}, targetDimension_);
+    derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
+          c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
+  }
+
+  // Likelihoods part, the transition is linear
+  auto dchild_dn = childDep->derive (c, node);
+  if (!dchild_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+    derivativeSumDeps.emplace_back (Self::create(c, {modelDep, brlenDep, derivNode, std::move (dchild_dn)}, targetDimension_));
+
+  return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+}
+
+NodeRef ForwardKroneckerTransitionFromModel::recreate (Context& c, NodeRefVec&& deps)
+{
+  return Self::create(c, std::move (deps), targetDimension_);
+}
+
+void ForwardKroneckerTransitionFromModel::applyFactors_(const vector<const Eigen::MatrixXd*>& factors)
+{
+  term_ = accessValueConstCast<T>(*this->dependency (3)).float_part();
+  const Eigen::Index nbRows = term_.rows();
+  const Eigen::Index nbCols = term_.cols();
+  work_.resize(nbRows, nbCols);
+
+  // States are numbered with the last position varying the fastest,
+  // and sites are the slowest dimension, so that the product on one
+  // position is a product on contiguous blocks of the array.
+  Eigen::Index inner = nbRows;
+  for (const auto* factor : factors)
+  {
+    const Eigen::Index n = factor->rows();
+    inner /= n;
+    const Eigen::Index nbBlocks = nbRows * nbCols / (n * inner);
+    if (inner == 1)
+    {
+      Eigen::Map<const Eigen::MatrixXd> x(term_.data(), n, nbBlocks);
+      Eigen::Map<Eigen::MatrixXd> y(work_.data(), n, nbBlocks);
+      y.noalias() = *factor * x;
+    }
+    else
+    {
+      for (Eigen::Index b = 0; b < nbBlocks; ++b)
+      {
+        Eigen::Map<const Eigen::MatrixXd> x(term_.data() + b * n * inner, inner, n);
+        Eigen::Map<Eigen::MatrixXd> y(work_.data() + b * n * inner, inner, n);
+        y.noalias() = x * factor->transpose();
+      }
+    }
+    term_.swap(work_);
+  }
+}
+
+void ForwardKroneckerTransitionFromModel::compute ()
+{
+  const auto brlen = accessValueConstCast<double>(*this->dependency (1)->dependency(0));
+  const auto nDeriv = accessValueConstCast<size_t>(*this->dependency (2));
+  const auto& child = accessValueConstCast<T>(*this->dependency (3));
+
+  const auto* model = dynamic_cast<const WordSubstitutionModel*>(accessValueConstCast<const BranchModelInterface*>(*this->dependency (0)));
+  if (!model)
+    throw Exception("ForwardKroneckerTransitionFromModel::compute only possible for WordSubstitutionModel.");
+
+  // The models of the positions may be the same object, so matrices
+  // are copied as soon as they are computed.
+  size_t nbPos = model->getNumberOfModels();
+  factors_.resize(nbPos);
+  dFactors_.resize(nbPos);
+  d2Factors_.resize(nbPos);
+  for (size_t i = 0; i < nbPos; ++i)
+  {
+    const auto& subModel = model->nModel(i);
+    double rate = model->getPositionRate(i);
+    copyBppToEigen (subModel.getPij_t (brlen * rate), factors_[i]);
+    if (nDeriv >= 1)
+    {
+      copyBppToEigen (subModel.getdPij_dt (brlen * rate), dFactors_[i]);
+      dFactors_[i] *= rate;
+    }
+    if (nDeriv >= 2)
+    {
+      copyBppToEigen (subModel.getd2Pij_dt2 (brlen * rate), d2Factors_[i]);
+      d2Factors_[i] *= rate * rate;
+    }
+  }
+
+  vector<const Eigen::MatrixXd*> factors(nbPos);
+  for (size_t i = 0; i < nbPos; ++i)
+  {
+    factors[i] = &factors_[i];
+  }
+
+  auto& r = this->accessValueMutable ();
+  auto& rf = r.float_part();
+
+  switch (nDeriv)
+  {
+  case 0:
+    applyFactors_(factors);
+    rf.swap(term_);
+    break;
+  case 1:
+    rf.setZero(child.float_part().rows(), child.float_part().cols());
+    for (size_t i = 0; i < nbPos; ++i)
+    {
+      factors[i] = &dFactors_[i];
+      applyFactors_(factors);
+      rf += term_;
+      factors[i] = &factors_[i];
+    }
+    break;
+  case 2:
+    rf.setZero(child.float_part().rows(), child.float_part().cols());
+    for (size_t i = 0; i < nbPos; ++i)
+    {
+      factors[i] = &d2Factors_[i];
+      applyFactors_(factors);
+      rf += term_;
+      factors[i] = &dFactors_[i];
+      for (size_t j = i + 1; j < nbPos; ++j)
+      {
+        factors[j] = &dFactors_[j];
+        applyFactors_(factors);
+        rf += 2. * term_;
+        factors[j] = &factors_[j];
+      }
+      factors[i] = &factors_[i];
+    }
+    break;
+  default:
+    throw Exception("ForwardKroneckerTransitionFromModel likelihood derivate " + TextTools::toString(nDeriv) + " not defined.");
+  }
+
+  r.exponent_part() = child.exponent_part();
+  r.normalize();
+}
+
+
+
+////////////////////////////////////////////////////////////
+// ForwardExpmvTransitionFromModel
+
+ForwardExpmvTransitionFromModel::ForwardExpmvTransitionFromModel (NodeRefVec&& deps,
+    const Dimension<T>& dim)
+  : Value<T>(std::move (deps)), targetDimension_ (dim)
+{}
+
+std::string ForwardExpmvTransitionFromModel::debugInfo () const
+{
+  using namespace numeric;
+  const auto nDeriv = accessValueConstCast<size_t>(*this->dependency (2));
+  auto ret = debug (this->accessValueConst ()) + " targetDim=" + to_string (targetDimension_) + ":nDeriv=" + TextTools::toString(nDeriv);
+  return ret;
+}
+
+// ForwardExpmvTransitionFromModel additional arguments = ().
+bool ForwardExpmvTransitionFromModel::compareAdditionalArguments (const Node_DF& other) const
+{
+  return dynamic_cast<const Self*>(&other) != nullptr;
+}
+
+bool ForwardExpmvTransitionFromModel::isExpmv (const BranchModelInterface& model)
+{
+  const auto* subModel = dynamic_cast<const AbstractSubstitutionModel*>(&model);
+  return subModel && subModel->getExponentialMethod() == AbstractSubstitutionModel::ExponentialMethod::EXPMV;
+}
+
+ValueRef<MatrixLik> ForwardExpmvTransitionFromModel::create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim)
+{
+  checkDependenciesNotNull (typeid (Self), deps);
+  checkDependencyVectorSize (typeid (Self), deps, 4);
+  checkNthDependencyIs<ConfiguredModel>(typeid (Self), deps, 0);
+  checkNthDependencyIs<ConfiguredParameter>(typeid (Self), deps, 1);
+  checkNthDependencyIsValue<T>(typeid (Self), deps, 3);
+
+  if (deps[3]->hasNumericalProperty (NumericalProperty::ConstantZero))
+    return ConstantZero<T>::create (c, dim);
+
+  return cachedAs<Value<T>>(c, std::make_shared<Self>(std::move (deps), dim));
+}
+
+NodeRef ForwardExpmvTransitionFromModel::derive (Context& c, const Node_DF& node)
+{
+  // df/dn = sum_i df/dx_i * dx_i/dn + df/dbrlen * dbrlen/dn + P * dchild/dn (x_i = model parameters).
+  if (&node == this)
+    return ConstantOne<T>::create (c, targetDimension_);
+
+  auto modelDep = this->dependency (0);
+  auto brlenDep = this->dependency (1);
+  NodeRef derivNode = this->dependency (2);
+  auto childDep = this->dependency (3);
+
+  const auto nDeriv = accessValueConstCast<size_t>(*derivNode);
+
+  // Model part
+  auto& model = static_cast<Dep&>(*modelDep);
+  auto buildFWithNewModel = [this, &c, &brlenDep, &derivNode, &childDep](NodeRef&& newModel) {
+        return Self::create(c, {std::move (newModel), brlenDep, derivNode, childDep}, targetDimension_);
+      };
+  NodeRefVec derivativeSumDeps = ConfiguredParametrizable::generateDerivativeSumDepsForComputations<Dep, T>(
+        c, model, node, targetDimension_, buildFWithNewModel);
+
+  // Brlen part, use specific node
+  auto dbrlen_dn = brlenDep->derive (c, node);
+  if (!dbrlen_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+  {
+    auto nDerivp = NumericConstant<size_t>::create(c, nDeriv + 1);
+    auto df_dbrlen = Self::create(c, {modelDep, brlenDep, nDerivp, childDep}, targetDimension_);
+    derivativeSumDeps.emplace_back (CWiseMul<T, std::tuple<double, T>>::create (
+          c, {std::move (dbrlen_dn), std::move (df_dbrlen)}, targetDimension_));
+  }
+
+  // Likelihoods part, the transition is linear
+  auto dchild_dn = childDep->derive (c, node);
+  if (!dchild_dn->hasNumericalProperty (NumericalProperty::ConstantZero))
+    derivativeSumDeps.emplace_back (Self::create(c, {modelDep, brlenDep, derivNode, std::move (dchild_dn)}, targetDimension_));
+
+  return CWiseAdd<T, ReductionOf<T>>::create (c, std::move (derivativeSumDeps), targetDimension_);
+}
+
+NodeRef ForwardExpmvTransitionFromModel::recreate (Context& c, NodeRefVec&& deps)
+{
+  return Self::create(c, std::move (deps), targetDimension_);
+}
+
+void ForwardExpmvTransitionFromModel::compute ()
+{
+  const auto brlen = accessValueConstCast<double>(*this->dependency (1)->dependency(0));
+  const auto nDeriv = accessValueConstCast<size_t>(*this->dependency (2));
+  const auto& child = accessValueConstCast<T>(*this->dependency (3));
+
+  const auto* model = dynamic_cast<const AbstractSubstitutionModel*>(accessValueConstCast<const BranchModelInterface*>(*this->dependency (0)));
+  if (!model)
+    throw Exception("ForwardExpmvTransitionFromModel::compute only possible for AbstractSubstitutionModel.");
+
+  auto& r = this->accessValueMutable ();
+  model->applyPij_t (brlen, child.float_part(), r.float_part(), nDeriv);
+
+  r.exponent_part() = child.exponent_part();
+  r.normalize();
+}
+
 ////////////////////////////////////////
 // ProbabilitiesFromMixedModel
 
@@ -11,6 +11,7 @@
 #include <Bpp/Phyl/Model/SubstitutionModel.h>
 #include <functional>
 #include <unordered_map>
+#include <vector>
 
 #include "Definitions.h"
 
@@ -178,6 +179,69 @@ private:
   void compute () final;
 };
 
+/** dtransitionMatrix/dparam = f(model, branchLen, nParam).
+ * dtransitionMatrix/dparam: Matrix(fromState, toState).
+ * model: ConfiguredModel of an AbstractSubstitutionModel.
+ * branchLen: double.
+ * nParam: size_t, index of the derivation parameter in the model
+ *         dependencies.
+ *
+ * The derivative is computed from the analytic derivative of the
+ * generator and the eigen decomposition of the model (see
+ * AbstractSubstitutionModel::getdPij_dparam), instead of models with
+ * shifted parameters.
+ *
+ * Node construction should be done with the create static method.
+ */
+
+class TransitionMatrixDerivativeFromModel : public Value<Eigen::MatrixXd>
+{
+public:
+  using Self = TransitionMatrixDerivativeFromModel;
+  using Dep = ConfiguredModel;
+  using T = Eigen::MatrixXd;
+
+private:
+  Dimension<T> targetDimension_;
+
+public:
+  TransitionMatrixDerivativeFromModel (NodeRefVec&& deps, const Dimension<T>& dim);
+
+  std::string debugInfo () const final;
+
+  bool compareAdditionalArguments (const Node_DF& other) const;
+
+  NodeRef derive (Context& c, const Node_DF& node) final;
+  NodeRef recreate (Context& c, NodeRefVec&& deps) final;
+
+  std::string color () const final
+  {
+    return "#aaff00";
+  }
+
+  std::string description () const final
+  {
+    return "TransitionMatrixDerivative";
+  }
+
+  std::string shape() const
+  {
+    return "octagon";
+  }
+
+private:
+  void compute () final;
+
+public:
+  static ValueRef<T> create (Context& c, NodeRefVec&& deps, const Dimension<T>& dim);
+
+  /**
+   * @return true if the derivative with respect to the nParam-th
+   * parameter of the model is analytic.
+   */
+  static bool isAnalytic (const BranchModelInterface& model, size_t nParam);
+};
+
 /** transitionProbability = f(model, branchLen, nDeriv).
  * transitionProbability: f(fromState, vector) -> probability
  *
@@ -231,6 +295,151 @@ public:
   static std::shared_ptr<Self> create(Context& c, NodeRefVec&& deps, const Dimension<T>& dim);
 };
 
+/** forwardLikelihood = f(model, branchLen, nDeriv, childLikelihood).
+ * forwardLikelihood: Matrix(fromState, site).
+ * model: ConfiguredModel, of a WordSubstitutionModel.
+ * branchLen: double.
+ * nDeriv: degree of derivate.
+ * childLikelihood: Matrix(toState, site).
+ *
+ * The positions of a WordSubstitutionModel evolve independently, so
+ * that its transition matrix is the Kronecker product of the
+ * transition matrices of the positions. The product of this matrix
+ * with the likelihoods below the branch is computed as one product
+ * per position, without building the whole matrix: for k positions
+ * with n states, it costs O(k.n^(k+1)) per site instead of O(n^(2k)).
+ *
+ * Node construction should be done with the create static method.
+ */
+
+class ForwardKroneckerTransitionFromModel : public Value<MatrixLik>
+{
+public:
+  using Self = ForwardKroneckerTransitionFromModel;
+  using Dep = ConfiguredModel;
+  using T = MatrixLik;
+
+private:
+  Dimension<T> targetDimension_;
+
+  /**
+   * @brief Transition matrices of the positions, their derivatives
+   * (scaled by the rates of the positions), and work arrays.
+   */
+  std::vector<Eigen::MatrixXd> factors_;
+  std::vector<Eigen::MatrixXd> dFactors_;
+  std::vector<Eigen::MatrixXd> d2Factors_;
+  Eigen::MatrixXd term_;
+  Eigen::MatrixXd work_;
+
+public:
+  ForwardKroneckerTransitionFromModel(NodeRefVec&& deps, const Dimension<T>& dim);
+
+  std::string debugInfo() const final;
+
+  bool compareAdditionalArguments(const Node_DF& other) const;
+
+  NodeRef derive(Context& c, const Node_DF& node) final;
+  NodeRef recreate(Context& c, NodeRefVec&& deps) final;
+
+  std::string color () const final
+  {
+    return "#aaff00";
+  }
+
+  std::string description () const final
+  {
+    return "KroneckerTransition";
+  }
+
+  std::string shape() const
+  {
+    return "doubleoctagon";
+  }
+
+private:
+  void compute() final;
+
+  /**
+   * @brief Compute in term_ the product of the Kronecker product of
+   * the given matrices with the likelihoods below the branch.
+   */
+  void applyFactors_(const std::vector<const Eigen::MatrixXd*>& factors);
+
+public:
+  static ValueRef<T> create(Context& c, NodeRefVec&& deps, const Dimension<T>& dim);
+
+  /**
+   * @return true if the transition probabilities of the model can be
+   * used in factored form.
+   */
+  static bool isFactored(const BranchModelInterface& model);
+};
+
+/** forwardLikelihood = f(model, branchLen, nDeriv, childLikelihood).
+ * forwardLikelihood: Matrix(fromState, site).
+ * model: ConfiguredModel, of an AbstractSubstitutionModel.
+ * branchLen: double.
+ * nDeriv: degree of derivate.
+ * childLikelihood: Matrix(toState, site).
+ *
+ * The product of the transition matrix with the likelihoods below
+ * the branch is computed as the action of the exponential of the
+ * sparse generator (see AbstractSubstitutionModel::applyPij_t), without
+ * building the transition matrix. It is used for models with the
+ * EXPMV exponential method, with large and sparse generators.
+ *
+ * Node construction should be done with the create static method.
+ */
+
+class ForwardExpmvTransitionFromModel : public Value<MatrixLik>
+{
+public:
+  using Self = ForwardExpmvTransitionFromModel;
+  using Dep = ConfiguredModel;
+  using T = MatrixLik;
+
+private:
+  Dimension<T> targetDimension_;
+
+public:
+  ForwardExpmvTransitionFromModel(NodeRefVec&& deps, const Dimension<T>& dim);
+
+  std::string debugInfo() const final;
+
+  bool compareAdditionalArguments(const Node_DF& other) const;
+
+  NodeRef derive(Context& c, const Node_DF& node) final;
+  NodeRef recreate(Context& c, NodeRefVec&& deps) final;
+
+  std::string color () const final
+  {
+    return "#aaff00";
+  }
+
+  std::string description () const final
+  {
+    return "ExpmvTransition";
+  }
+
+  std::string shape() const
+  {
+    return "doubleoctagon";
+  }
+
+private:
+  void compute() final;
+
+public:
+  static ValueRef<T> create(Context& c, NodeRefVec&& deps, const Dimension<T>& dim);
+
+  /**
+   * @return true if the model uses the action of the exponential of
+   * its generator for likelihood computations.
+   */
+  static bool isExpmv(const BranchModelInterface& model);
+};
+
 /**
  * dtransitionMatrix/dbrlen = f(model, branchLen).
  * dtransitionMatrix/dbrlen: Matrix(fromState, toState).
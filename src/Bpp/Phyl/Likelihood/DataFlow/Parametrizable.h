@@ -240,6 +240,19 @@ public:
   template<typename ConfiguredObject, typename T, typename B>
   static NodeRefVec generateDerivativeSumDepsForComputations (
       Context& c, ConfiguredObject& object, const Node_DF& derivationNode, const Dimension<T>& targetDimension, B buildFWithNewObject)
+  {
+    return generateDerivativeSumDepsForComputations<ConfiguredObject, T>(
+          c, object, derivationNode, targetDimension, buildFWithNewObject,
+          [](std::size_t) { return ValueRef<T>(); });
+  }
+
+  /* Same, where buildAnalyticDerivative(i) may return a node
+   * computing df/dx_i directly, or nullptr if df/dx_i must be
+   * computed numerically.
+   */
+  template<typename ConfiguredObject, typename T, typename B, typename D>
+  static NodeRefVec generateDerivativeSumDepsForComputations (
+      Context& c, ConfiguredObject& object, const Node_DF& derivationNode, const Dimension<T>& targetDimension, B buildFWithNewObject, D buildAnalyticDerivative)
   {
     NodeRefVec derivativeSumDeps;
 
@@ -260,8 +273,10 @@ public:
               return buildFWithNewObject (std::move (newObject));
             };
 
-        auto df_dxi = generateNumericalDerivative<T>(
-              c, object.config, object.dependency (i), targetDimension, buildFWithNewXi);
+        ValueRef<T> df_dxi = buildAnalyticDerivative (i);
+        if (!df_dxi)
+          df_dxi = generateNumericalDerivative<T>(
+                c, object.config, object.dependency (i), targetDimension, buildFWithNewXi);
 
         if (dxi_dn->hasNumericalProperty (NumericalProperty::ConstantOne))
           derivativeSumDeps.emplace_back (std::move (df_dxi));
@@ -25,40 +25,37 @@ void ForwardHmmLikelihood_DF::compute()
   auto& condLik = dynamic_pointer_cast<CondLikelihood>(condLik_)->accessValueMutable();
 
   auto nbSites = hmmEmis.cols();
-  auto nbStates = hmmEmis.rows();
-
-  VDataLik tscales((size_t)nbSites);
 
-  VectorLik tmp((int)nbStates);
+  // The emission likelihoods share a single exponent: the scales are
+  // computed on the float parts, in the member buffers.
+  const auto& emis = hmmEmis.float_part();
 
   // Initialisation:
-  parCondLik_[0] = hmmTrans * hmmEq;
+  parCondLik_[0].noalias() = hmmTrans * hmmEq;
 
-  cwise(tmp) = cwise(parCondLik_[0]) * cwise(hmmEmis.col(0));
-  tscales[0] = tmp.sum();
+  tmp_ = parCondLik_[0].cwiseProduct(emis.col(0));
+  double scale = tmp_.sum();
+  tscales_[0] = ExtendedFloat(scale, hmmEmis.exponent_part());
+  tscales_[0].normalize();
 
-  for (auto s = 0; s < nbStates; s++)
-  {
-    condLik(s, 0) = convert(tmp(s) / tscales[0]);
-  }
+  condLik.col(0) = tmp_ / scale;
   // tmp = condLik * scales
 
   // Iteration
   for (auto i = 1; i < nbSites; i++)
   {
-    parCondLik_[(size_t)i] =  hmmTrans * condLik.col(i - 1);
+    parCondLik_[(size_t)i].noalias() =  hmmTrans * condLik.col(i - 1);
 
-    cwise(tmp) = cwise(parCondLik_[(size_t)i]) * cwise(hmmEmis.col(i));
-    tscales[(size_t)i] = tmp.sum();
+    tmp_ = parCondLik_[(size_t)i].cwiseProduct(emis.col(i));
+    scale = tmp_.sum();
+    tscales_[(size_t)i] = ExtendedFloat(scale, hmmEmis.exponent_part());
+    tscales_[(size_t)i].normalize();
 
     // tmp = condLik * scales
-    for (auto s = 0; s < nbStates; s++)
-    {
-      condLik(s, i) = convert(tmp(s) / tscales[(size_t)i]);
-    }
+    condLik.col(i) = tmp_ / scale;
   }
 
-  copyBppToEigen(tscales, this->accessValueMutable ());
+  copyBppToEigen(tscales_, this->accessValueMutable ());
 }
 
 NodeRef ForwardHmmLikelihood_DF::derive (Context& c, const Node_DF& node)
@@ -137,6 +137,15 @@ private:
 
   std::vector<Eigen::VectorXd> parCondLik_;
 
+  /*
+   * @brief Buffers reused between computations: scales per site, and
+   * unscaled likelihoods of the current site.
+   */
+
+  VDataLik tscales_;
+
+  Eigen::VectorXd tmp_;
+
   /*
    * @brief Dimension of the data : states X sites
    *
@@ -164,7 +173,8 @@ public:
   }
 
   ForwardHmmLikelihood_DF (NodeRefVec&& deps, const Dimension<Eigen::MatrixXd>& dim)
-    : Value<RowLik>(std::move (deps)), condLik_(), parCondLik_((size_t)dim.cols), targetDimension_ (dim)
+    : Value<RowLik>(std::move (deps)), condLik_(), parCondLik_((size_t)dim.cols),
+    tscales_((size_t)dim.cols), tmp_(dim.rows), targetDimension_ (dim)
   {
     for (auto& v:parCondLik_)
     {
@@ -0,0 +1,303 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Text/TextTools.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Container/SiteContainer.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+
+#include "PhyloLikelihoodSnapshot.h"
+#include "SingleProcessPhyloLikelihood.h"
+
+// From the STL:
+#include <cstring>
+#include <fstream>
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+const char MAGIC[8] = {'B', 'P', 'P', 'L', 'S', 'N', 'A', 'P'};
+
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+template<typename T>
+void writeRaw(ostream& out, const T& x)
+{
+  out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+void writeString(ostream& out, const string& s)
+{
+  writeRaw(out, static_cast<uint32_t>(s.size()));
+  out.write(s.data(), static_cast<streamsize>(s.size()));
+}
+
+template<typename T>
+void readRaw(istream& in, T& x)
+{
+  in.read(reinterpret_cast<char*>(&x), sizeof(T));
+  if (!in)
+    throw IOException("PhyloLikelihoodSnapshot: unexpected end of file.");
+}
+
+void readString(istream& in, string& s)
+{
+  uint32_t length;
+  readRaw(in, length);
+  s.resize(length);
+  if (length > 0)
+    in.read(&s[0], static_cast<streamsize>(length));
+  if (!in)
+    throw IOException("PhyloLikelihoodSnapshot: unexpected end of file.");
+}
+}
+
+/******************************************************************************/
+
+void PhyloLikelihoodSnapshot::write(
+    const string& path,
+    const map<size_t, shared_ptr<const PhyloLikelihoodInterface>>& likelihoods)
+{
+  ParameterList parameters;
+  map<size_t, shared_ptr<LikelihoodCalculationSingleProcess>> calculations;
+  for (const auto& it : likelihoods)
+  {
+    parameters.includeParameters(it.second->getParameters());
+
+    auto spl = dynamic_pointer_cast<const SingleProcessPhyloLikelihood>(it.second);
+    if (!spl)
+      continue;
+    auto likCal = spl->getLikelihoodCalculationSingleProcess();
+    // Only plain sequences, compressed in patterns, are stored.
+    if (dynamic_pointer_cast<const SiteContainerInterface>(likCal->getShrunkData()) && likCal->getRootWeights())
+      calculations[it.first] = likCal;
+  }
+
+  ofstream file(path.c_str(), ios::out | ios::binary);
+  if (!file)
+    throw IOException("PhyloLikelihoodSnapshot::write: could not open file " + path);
+
+  file.write(MAGIC, sizeof(MAGIC));
+  writeRaw(file, BYTE_ORDER_MARK);
+  writeRaw(file, static_cast<uint32_t>(VERSION));
+
+  writeRaw(file, static_cast<uint64_t>(parameters.size()));
+  for (size_t i = 0; i < parameters.size(); ++i)
+  {
+    writeString(file, parameters[i].getName());
+    writeRaw(file, parameters[i].getValue());
+  }
+
+  writeRaw(file, static_cast<uint64_t>(calculations.size()));
+  for (const auto& it : calculations)
+  {
+    auto& likCal = *it.second;
+    auto sites = dynamic_pointer_cast<const SiteContainerInterface>(likCal.getShrunkData());
+    size_t nbPatterns = sites->getNumberOfSites();
+    size_t nbSites = likCal.getNumberOfSites();
+
+    writeRaw(file, static_cast<uint64_t>(it.first));
+    writeString(file, sites->getAlphabet()->getAlphabetType());
+    writeRaw(file, static_cast<uint64_t>(sites->getNumberOfSequences()));
+    writeRaw(file, static_cast<uint64_t>(nbPatterns));
+    writeRaw(file, static_cast<uint64_t>(nbSites));
+
+    for (const auto& name : sites->getSequenceNames())
+    {
+      writeString(file, name);
+      const Sequence& seq = sites->sequence(name);
+      for (size_t i = 0; i < nbPatterns; ++i)
+      {
+        writeRaw(file, static_cast<int32_t>(seq.getValue(i)));
+      }
+    }
+
+    const auto& links = likCal.getRootArrayPositions();
+    for (Eigen::Index i = 0; i < links.size(); ++i)
+    {
+      writeRaw(file, static_cast<uint64_t>(links(i)));
+    }
+
+    const auto& weights = likCal.getRootWeights()->targetValue();
+    for (Eigen::Index i = 0; i < weights.size(); ++i)
+    {
+      writeRaw(file, static_cast<int32_t>(weights(i)));
+    }
+  }
+
+  if (!file)
+    throw IOException("PhyloLikelihoodSnapshot::write: error while writing file " + path);
+  file.close();
+}
+
+void PhyloLikelihoodSnapshot::write(
+    const string& path,
+    const PhyloLikelihoodContainer& container)
+{
+  map<size_t, shared_ptr<const PhyloLikelihoodInterface>> likelihoods;
+  for (auto n : container.getNumbersOfPhyloLikelihoods())
+  {
+    likelihoods[n] = container[n];
+  }
+  write(path, likelihoods);
+}
+
+/******************************************************************************/
+
+PhyloLikelihoodSnapshot::PhyloLikelihoodSnapshot(const string& path, shared_ptr<const Alphabet> alphabet) :
+  parameters_(),
+  data_()
+{
+  ifstream file(path.c_str(), ios::in | ios::binary);
+  if (!file)
+    throw IOException("PhyloLikelihoodSnapshot: could not open file " + path);
+
+  char magic[8];
+  file.read(magic, sizeof(magic));
+  if (!file || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    throw IOException("PhyloLikelihoodSnapshot: " + path + " is not a likelihood snapshot file.");
+
+  uint32_t bom, version;
+  readRaw(file, bom);
+  if (bom != BYTE_ORDER_MARK)
+    throw IOException("PhyloLikelihoodSnapshot: " + path + " was written with a different byte order.");
+  readRaw(file, version);
+  if (version != VERSION)
+    throw IOException("PhyloLikelihoodSnapshot: unsupported version " + TextTools::toString(version) + " in " + path);
+
+  uint64_t nbParameters;
+  readRaw(file, nbParameters);
+  for (uint64_t i = 0; i < nbParameters; ++i)
+  {
+    string name;
+    double value;
+    readString(file, name);
+    readRaw(file, value);
+    parameters_.addParameter(Parameter(name, value));
+  }
+
+  uint64_t nbData;
+  readRaw(file, nbData);
+  for (uint64_t d = 0; d < nbData; ++d)
+  {
+    uint64_t number, nbSequences, nbPatterns, nbSites;
+    string alphabetType;
+    readRaw(file, number);
+    readString(file, alphabetType);
+    if (alphabetType != alphabet->getAlphabetType())
+      throw IOException("PhyloLikelihoodSnapshot: data of likelihood " + TextTools::toString(number) + " in " + path + " is on alphabet " + alphabetType + ", not " + alphabet->getAlphabetType() + ".");
+    readRaw(file, nbSequences);
+    readRaw(file, nbPatterns);
+    readRaw(file, nbSites);
+
+    auto sites = make_shared<VectorSiteContainer>(alphabet);
+    vector<int> states(static_cast<size_t>(nbPatterns));
+    for (uint64_t s = 0; s < nbSequences; ++s)
+    {
+      string name;
+      readString(file, name);
+      for (auto& x : states)
+      {
+        int32_t state;
+        readRaw(file, state);
+        x = static_cast<int>(state);
+      }
+      auto seq = make_unique<Sequence>(name, states, alphabet);
+      sites->addSequence(name, seq);
+    }
+
+    DataSnapshot& data = data_[static_cast<size_t>(number)];
+    data.sites = sites;
+
+    data.links.resize(static_cast<size_t>(nbSites));
+    for (auto& l : data.links)
+    {
+      uint64_t x;
+      readRaw(file, x);
+      if (x >= nbPatterns)
+        throw IOException("PhyloLikelihoodSnapshot: bad site link in " + path);
+      l = static_cast<size_t>(x);
+    }
+
+    data.weights.resize(Eigen::Index(nbPatterns));
+    for (Eigen::Index i = 0; i < data.weights.size(); ++i)
+    {
+      int32_t x;
+      readRaw(file, x);
+      data.weights(i) = static_cast<int>(x);
+    }
+  }
+}
+
+/******************************************************************************/
+
+const PhyloLikelihoodSnapshot::DataSnapshot& PhyloLikelihoodSnapshot::getDataSnapshot_(size_t nPhyl) const
+{
+  auto it = data_.find(nPhyl);
+  if (it == data_.end())
+    throw Exception("PhyloLikelihoodSnapshot: no data for likelihood " + TextTools::toString(nPhyl));
+  return it->second;
+}
+
+shared_ptr<const AlignmentDataInterface> PhyloLikelihoodSnapshot::getData(size_t nPhyl) const
+{
+  return getDataSnapshot_(nPhyl).sites;
+}
+
+const vector<size_t>& PhyloLikelihoodSnapshot::getPatternLinks(size_t nPhyl) const
+{
+  return getDataSnapshot_(nPhyl).links;
+}
+
+const Eigen::RowVectorXi& PhyloLikelihoodSnapshot::getWeights(size_t nPhyl) const
+{
+  return getDataSnapshot_(nPhyl).weights;
+}
+
+void PhyloLikelihoodSnapshot::restoreWeights(size_t nPhyl, LikelihoodCalculationSingleProcess& likCal) const
+{
+  const auto& data = getDataSnapshot_(nPhyl);
+  if (likCal.getNumberOfSites() != data.sites->getNumberOfSites())
+    throw BadSizeException("PhyloLikelihoodSnapshot::restoreWeights: the likelihood is not built on the data of the snapshot", likCal.getNumberOfSites(), data.sites->getNumberOfSites());
+
+  // The distinct sites of the snapshot may be ordered differently in
+  // the patterns of likCal.
+  const auto& links = likCal.getRootArrayPositions();
+  Eigen::RowVectorXi weights = Eigen::RowVectorXi::Zero(Eigen::Index(likCal.getNumberOfDistinctSites()));
+  for (Eigen::Index i = 0; i < links.size(); ++i)
+  {
+    weights(Eigen::Index(links(i))) += data.weights(i);
+  }
+  likCal.setRootWeights(weights);
+}
+
+void PhyloLikelihoodSnapshot::restore(const map<size_t, shared_ptr<PhyloLikelihoodInterface>>& likelihoods) const
+{
+  for (const auto& it : likelihoods)
+  {
+    if (hasData(it.first))
+    {
+      auto spl = dynamic_pointer_cast<SingleProcessPhyloLikelihood>(it.second);
+      if (!spl)
+        throw Exception("PhyloLikelihoodSnapshot::restore: likelihood " + TextTools::toString(it.first) + " is not a single process likelihood.");
+      restoreWeights(it.first, *spl->getLikelihoodCalculationSingleProcess());
+    }
+    it.second->matchParametersValues(parameters_);
+  }
+}
+
+void PhyloLikelihoodSnapshot::restore(PhyloLikelihoodContainer& container) const
+{
+  map<size_t, shared_ptr<PhyloLikelihoodInterface>> likelihoods;
+  for (auto n : container.getNumbersOfPhyloLikelihoods())
+  {
+    likelihoods[n] = container[n];
+  }
+  restore(likelihoods);
+}
+
+/******************************************************************************/
@@ -0,0 +1,159 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_LIKELIHOOD_PHYLOLIKELIHOODS_PHYLOLIKELIHOODSNAPSHOT_H
+#define BPP_PHYL_LIKELIHOOD_PHYLOLIKELIHOODS_PHYLOLIKELIHOODSNAPSHOT_H
+
+#include <Bpp/Numeric/ParameterList.h>
+
+// From bpp-seq:
+#include <Bpp/Seq/Alphabet/Alphabet.h>
+#include <Bpp/Seq/Container/AlignmentData.h>
+
+#include "PhyloLikelihoodContainer.h"
+#include "../DataFlow/LikelihoodCalculationSingleProcess.h"
+
+// From the STL:
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace bpp
+{
+/**
+ * @brief Binary snapshot of the state of phylo likelihoods, for fast
+ * restart.
+ *
+ * A snapshot stores the values of the parameters of the
+ * likelihoods, and for each single process likelihood on plain
+ * sequences the compressed data: the distinct sites, their weights,
+ * and the links from the sites of the original alignment to them.
+ *
+ * On restart, the likelihoods are built on the distinct sites
+ * returned by getData, which skips reading and compressing the
+ * original alignment, then restore sets back the weights and the
+ * parameter values. The dataflow graph itself is built again from
+ * the substitution processes, since its nodes refer to model objects.
+ *
+ * Layout of a file (integers and values in the byte order of the
+ * writing machine, checked by the reader through a byte order mark):
+ *
+ * - char[8]   magic "BPPLSNAP"
+ * - uint32    byte order mark 0x01020304
+ * - uint32    version (1)
+ * - uint64    number of parameters
+ * - per parameter: uint32 length, char[] name, float64 value
+ * - uint64    number of data sets
+ * - per data set:
+ *   - uint64    number of the likelihood
+ *   - uint32    length, char[] alphabet type
+ *   - uint64    number of sequences, distinct sites, and sites
+ *   - per sequence: uint32 length, char[] name, int32[] states
+ *   - uint64[]  distinct site of each site
+ *   - int32[]   weight of each distinct site
+ */
+class PhyloLikelihoodSnapshot
+{
+public:
+  static const uint32_t VERSION = 1;
+
+private:
+  struct DataSnapshot
+  {
+    std::shared_ptr<const AlignmentDataInterface> sites;
+    std::vector<size_t> links;
+    Eigen::RowVectorXi weights;
+  };
+
+  ParameterList parameters_;
+
+  std::map<size_t, DataSnapshot> data_;
+
+public:
+  /**
+   * @brief Read a snapshot.
+   *
+   * @param path     The file to read.
+   * @param alphabet The alphabet of the data.
+   * @throw IOException If the file can not be read or is not in the
+   * expected format.
+   */
+  PhyloLikelihoodSnapshot(const std::string& path, std::shared_ptr<const Alphabet> alphabet);
+
+  virtual ~PhyloLikelihoodSnapshot() {}
+
+public:
+  /**
+   * @brief Write a snapshot of numbered likelihoods.
+   *
+   * Data are stored for SingleProcessPhyloLikelihood objects on
+   * plain sequences, parameters for all the likelihoods.
+   *
+   * @param path        The file to write.
+   * @param likelihoods The likelihoods, with their numbers.
+   * @throw IOException If an output error happens.
+   */
+  static void write(
+      const std::string& path,
+      const std::map<size_t, std::shared_ptr<const PhyloLikelihoodInterface>>& likelihoods);
+
+  /**
+   * @brief Write a snapshot of all the likelihoods of a container.
+   */
+  static void write(
+      const std::string& path,
+      const PhyloLikelihoodContainer& container);
+
+public:
+  const ParameterList& getParameters() const { return parameters_; }
+
+  bool hasData(size_t nPhyl) const { return data_.find(nPhyl) != data_.end(); }
+
+  /**
+   * @return The distinct sites of the data of a likelihood.
+   * @throw Exception If there is no data for this likelihood.
+   */
+  std::shared_ptr<const AlignmentDataInterface> getData(size_t nPhyl) const;
+
+  /**
+   * @return The distinct site of each site of the original data.
+   * @throw Exception If there is no data for this likelihood.
+   */
+  const std::vector<size_t>& getPatternLinks(size_t nPhyl) const;
+
+  /**
+   * @return The weight of each distinct site.
+   * @throw Exception If there is no data for this likelihood.
+   */
+  const Eigen::RowVectorXi& getWeights(size_t nPhyl) const;
+
+  /**
+   * @brief Set the stored weights on a likelihood calculation built
+   * on getData(nPhyl).
+   *
+   * @throw Exception If there is no data for this likelihood, or if
+   * the calculation is on other data.
+   */
+  void restoreWeights(size_t nPhyl, LikelihoodCalculationSingleProcess& likCal) const;
+
+  /**
+   * @brief Restore the weights and the parameter values of numbered
+   * likelihoods.
+   */
+  void restore(const std::map<size_t, std::shared_ptr<PhyloLikelihoodInterface>>& likelihoods) const;
+
+  /**
+   * @brief Restore the weights and the parameter values of the
+   * likelihoods of a container.
+   */
+  void restore(PhyloLikelihoodContainer& container) const;
+
+private:
+  const DataSnapshot& getDataSnapshot_(size_t nPhyl) const;
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_LIKELIHOOD_PHYLOLIKELIHOODS_PHYLOLIKELIHOODSNAPSHOT_H
@@ -2,8 +2,14 @@
 //
 // SPDX-License-Identifier: CECILL-2.1
 
+#include <Bpp/Text/TextTools.h>
+
 #include "SingleProcessPhyloLikelihood.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace bpp;
 using namespace std;
 using namespace numeric;
@@ -142,3 +148,115 @@ Vdouble SingleProcessPhyloLikelihood::getPosteriorStateFrequencies(uint nodeId)
   }
   return v;
 }
+
+/******************************************************************************/
+
+Vdouble SingleProcessPhyloLikelihood::getLogLikelihoods(const vector<string>& names, const VVdouble& points, size_t nbLanes) const
+{
+  for (const auto& point : points)
+  {
+    if (point.size() != names.size())
+      throw Exception("SingleProcessPhyloLikelihood::getLogLikelihoods. Wrong number of values: " + TextTools::toString(point.size()) + " instead of " + TextTools::toString(names.size()) + ".");
+  }
+
+  if (nbLanes == 0)
+  {
+#ifdef _OPENMP
+    nbLanes = static_cast<size_t>(omp_get_max_threads());
+#else
+    nbLanes = 1;
+#endif
+  }
+  nbLanes = max(size_t(1), min(nbLanes, points.size()));
+
+  if (!getSubstitutionProcess())
+    throw Exception("SingleProcessPhyloLikelihood::getLogLikelihoods. Not available for a likelihood built from a process collection.");
+
+  // Lanes are built once, sharing the site patterns of this likelihood,
+  // and their parameters are updated at each call:
+  lock_guard<mutex> lock(lanesMutex_);
+  while (lanes_.size() < nbLanes)
+  {
+    auto context = make_shared<Context>();
+    auto likCal = make_shared<LikelihoodCalculationSingleProcess>(*context, likelihoodCalculationSingleProcess());
+    auto lane = make_shared<SingleProcessPhyloLikelihood>(*context, likCal);
+    laneContexts_.push_back(context);
+    lanes_.push_back(lane);
+  }
+
+  ParameterList current = getParameters();
+  Vdouble values(points.size());
+  string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel num_threads(static_cast<int>(nbLanes))
+#endif
+  {
+#ifdef _OPENMP
+    size_t nLane = static_cast<size_t>(omp_get_thread_num());
+#else
+    size_t nLane = 0;
+#endif
+    auto& lane = *lanes_[nLane];
+    ParameterList pl;
+    try
+    {
+      lane.matchParametersValues(current);
+      pl = lane.getParameters().createSubList(names);
+    }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (SingleProcessPhyloLikelihood_getLogLikelihoods_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = e.what();
+    }
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      if (pl.size() != names.size())
+        continue;
+      try
+      {
+        for (size_t k = 0; k < names.size(); ++k)
+        {
+          pl.setParameterValue(names[k], points[i][k]);
+        }
+        lane.matchParametersValues(pl);
+        values[i] = lane.getLogLikelihood();
+      }
+      catch (exception& e)
+      {
+#ifdef _OPENMP
+#pragma omp critical (SingleProcessPhyloLikelihood_getLogLikelihoods_error)
+#endif
+        if (errorMessage == "")
+          errorMessage = e.what();
+      }
+    }
+  }
+  if (errorMessage != "")
+    throw Exception("SingleProcessPhyloLikelihood::getLogLikelihoods. " + errorMessage);
+
+  return values;
+}
+
+/******************************************************************************/
+
+Eigen::VectorXd SingleProcessPhyloLikelihood::getRELLLogLikelihoods(const Eigen::MatrixXi& weights) const
+{
+  auto& likCal = likelihoodCalculationSingleProcess();
+  size_t nbDistinctSites = likCal.getNumberOfDistinctSites();
+  if (weights.cols() != Eigen::Index(nbDistinctSites))
+    throw Exception("SingleProcessPhyloLikelihood::getRELLLogLikelihoods. Wrong number of weights: " + TextTools::toString(weights.cols()) + " instead of " + TextTools::toString(nbDistinctSites) + ".");
+
+  Eigen::VectorXd logLiks(nbDistinctSites);
+  for (size_t i = 0; i < nbDistinctSites; ++i)
+  {
+    logLiks(Eigen::Index(i)) = convert(likCal.getLogLikelihoodForASite(i, true));
+  }
+  return weights.cast<double>() * logLiks;
+}
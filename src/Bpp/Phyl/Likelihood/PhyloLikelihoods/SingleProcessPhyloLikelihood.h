@@ -9,6 +9,7 @@
 #include <Bpp/Numeric/Function/Functions.h>
 #include <Bpp/Numeric/Parameter.h>
 #include <Bpp/Numeric/ParameterList.h>
+#include <mutex>
 #include <unordered_map>
 
 #include "../DataFlow/DataFlowNumeric.h"
@@ -48,6 +49,19 @@ protected:
       StringPairHash>
   secondOrderDerivativeVectors_;
 
+  /**
+   * @brief Independent copies of the likelihood, each in its own
+   * Context, for getLogLikelihoods().
+   */
+  mutable std::vector<std::shared_ptr<Context>> laneContexts_;
+  mutable std::vector<std::shared_ptr<SingleProcessPhyloLikelihood>> lanes_;
+
+  /**
+   * @brief Serializes the calls to getLogLikelihoods(), which build and
+   * set the lanes.
+   */
+  mutable std::mutex lanesMutex_;
+
 public:
   SingleProcessPhyloLikelihood (Context& context,
       std::shared_ptr<LikelihoodCalculationSingleProcess> likCal,
@@ -57,7 +71,9 @@ public:
     AbstractAlignedPhyloLikelihood(context, likCal->getNumberOfSites()),
     AbstractSingleDataPhyloLikelihood(context, likCal->getNumberOfSites(), likCal->stateMap().getNumberOfModelStates(), nData),
     AbstractParametrizable(""),
-    likCal_(likCal), nProc_(nProc)
+    likCal_(likCal), nProc_(nProc),
+    firstOrderDerivativeVectors_(), secondOrderDerivativeVectors_(),
+    laneContexts_(), lanes_(), lanesMutex_()
   {
     shareParameters_(variableNodes);
   }
@@ -72,7 +88,9 @@ public:
     AbstractAlignedPhyloLikelihood(context, likCal->getNumberOfSites()),
     AbstractSingleDataPhyloLikelihood(context, likCal->getNumberOfSites(), likCal->stateMap().getNumberOfModelStates(), nData),
     AbstractParametrizable(""),
-    likCal_(likCal), nProc_(nProc)
+    likCal_(likCal), nProc_(nProc),
+    firstOrderDerivativeVectors_(), secondOrderDerivativeVectors_(),
+    laneContexts_(), lanes_(), lanesMutex_()
   {
 #ifdef DEBUG
     std::cerr << "SingleProcessPhyloLikelihood(context, LikelihoodCalculationSingleProcess)" << std::endl;
@@ -349,6 +367,52 @@ public:
   Vdouble getPosteriorRatePerSite() const;
 
   Vdouble getPosteriorStateFrequencies(uint nodeId);
+
+  /**
+   * @brief Compute the log-likelihood for many parameter vectors.
+   *
+   * The points are evaluated concurrently (with OpenMP) on
+   * independent copies of the likelihood graph, each in its own
+   * Context and sharing the data and site patterns with this one. The
+   * copies are built from the substitution process at the first call,
+   * and kept for the next calls. The parameters of this likelihood are
+   * not modified. Concurrent calls on the same likelihood are
+   * serialized, since they use the same copies.
+   *
+   * Building a copy costs as much as building the likelihood graph
+   * (without compressing the sites again), and each copy holds its
+   * own conditional likelihood arrays: the first call, and the memory
+   * used, grow linearly with the number of copies. Further calls only
+   * update the parameters of the copies.
+   *
+   * The copies do not include later modifications of the graph (such
+   * as setClockLike()), and the likelihood must not be built from a
+   * collection of processes.
+   *
+   * @param names   The names of the parameters set at each point.
+   * @param points  The parameter values, one vector (in the order of
+   *                names) per point. The other parameters keep their
+   *                current values.
+   * @param nbLanes The number of copies, i.e. of concurrent evaluations
+   *                (0 for the number of threads).
+   * @return The log-likelihood at each point.
+   * @throw Exception If a parameter is not found or a value is not valid.
+   */
+  Vdouble getLogLikelihoods(const std::vector<std::string>& names, const VVdouble& points, size_t nbLanes = 0) const;
+
+  /**
+   * @brief RELL log-likelihoods of bootstrap replicates.
+   *
+   * The log-likelihoods of the distinct sites at the current
+   * parameter values are reweighted for each replicate, without
+   * re-optimization (Kishino, Miyata & Hasegawa, 1990, J. Mol. Evol.
+   * 31:151-160), in a single matrix product.
+   *
+   * @param weights One row of weights of the distinct sites per
+   * replicate (see LikelihoodCalculationSingleProcess::drawBootstrapWeights()).
+   * @return The log-likelihood of each replicate.
+   */
+  Eigen::VectorXd getRELLLogLikelihoods(const Eigen::MatrixXi& weights) const;
 };
 } // namespace bpp
 #endif // BPP_PHYL_LIKELIHOOD_PHYLOLIKELIHOODS_SINGLEPROCESSPHYLOLIKELIHOOD_H
@@ -0,0 +1,491 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Text/TextTools.h>
+
+#include "ColumnarMappingFormat.h"
+
+#ifdef BPP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// From the STL:
+#include <cstring>
+#include <map>
+
+using namespace bpp;
+using namespace std;
+
+const short ColumnarMappingFormat::FLOAT32 = 4;
+const short ColumnarMappingFormat::FLOAT64 = 8;
+
+const short ColumnarMappingFormat::NO_COMPRESSION = 0;
+const short ColumnarMappingFormat::ZLIB_COMPRESSION = 1;
+
+const uint32_t ColumnarMappingFormat::VERSION = 1;
+
+namespace
+{
+const char MAGIC[8] = {'B', 'P', 'P', 'C', 'O', 'U', 'N', 'T'};
+
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+template<typename T>
+void writeRaw(ostream& out, const T& x)
+{
+  out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+template<typename T>
+void readRaw(istream& in, T& x)
+{
+  in.read(reinterpret_cast<char*>(&x), sizeof(T));
+  if (!in)
+    throw IOException("ColumnarMappingReader: unexpected end of file.");
+}
+
+/**
+ * @brief Convert the values of a chunk to their stored form (raw or
+ * compressed bytes).
+ */
+void encodeChunk(const vector<double>& values, size_t valueSize, short compression, vector<char>& bytes)
+{
+  vector<char> raw(values.size() * valueSize);
+  if (valueSize == ColumnarMappingFormat::FLOAT32)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+      float x = static_cast<float>(values[i]);
+      memcpy(&raw[i * valueSize], &x, valueSize);
+    }
+  }
+  else
+    memcpy(raw.data(), values.data(), raw.size());
+
+  if (compression == ColumnarMappingFormat::NO_COMPRESSION)
+  {
+    bytes.swap(raw);
+    return;
+  }
+
+#ifdef BPP_HAVE_ZLIB
+  uLongf destLen = compressBound(static_cast<uLong>(raw.size()));
+  bytes.resize(destLen);
+  if (compress2(reinterpret_cast<Bytef*>(bytes.data()), &destLen,
+                reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+    throw IOException("ColumnarMappingFormat::write: compression failed.");
+  bytes.resize(destLen);
+#else
+  throw Exception("ColumnarMappingFormat::write: the library was built without zlib support.");
+#endif
+}
+
+/**
+ * @brief Write a file, given an accessor value(pattern, branch, type).
+ */
+template<class Accessor>
+void writeColumnar(
+    const string& path,
+    size_t nbPatterns,
+    const vector<size_t>& patternLinks,
+    const vector<uint>& ids,
+    const vector<string>& typeNames,
+    const vector<int>& coordinates,
+    short valueSize,
+    short compression,
+    size_t chunkSize,
+    const Accessor& value)
+{
+  if (valueSize != ColumnarMappingFormat::FLOAT32 && valueSize != ColumnarMappingFormat::FLOAT64)
+    throw Exception("ColumnarMappingFormat::write: unknown value size " + TextTools::toString(valueSize));
+  if (compression != ColumnarMappingFormat::NO_COMPRESSION && compression != ColumnarMappingFormat::ZLIB_COMPRESSION)
+    throw Exception("ColumnarMappingFormat::write: unknown compression " + TextTools::toString(compression));
+  if (compression == ColumnarMappingFormat::ZLIB_COMPRESSION && !ColumnarMappingFormat::hasCompressionSupport())
+    throw Exception("ColumnarMappingFormat::write: the library was built without zlib support.");
+  if (chunkSize == 0)
+    throw Exception("ColumnarMappingFormat::write: chunk size must be positive.");
+  if (coordinates.size() != patternLinks.size())
+    throw BadSizeException("ColumnarMappingFormat::write: number of coordinates does not match the number of sites", coordinates.size(), patternLinks.size());
+
+  ofstream file(path.c_str(), ios::out | ios::binary);
+  if (!file)
+    throw IOException("ColumnarMappingFormat::write: could not open file " + path);
+
+  size_t nbBranches = ids.size();
+  size_t nbTypes = typeNames.size();
+  size_t nbChunks = (nbPatterns + chunkSize - 1) / chunkSize;
+  size_t nbColumns = nbBranches * nbTypes;
+
+  // Header
+  file.write(MAGIC, sizeof(MAGIC));
+  writeRaw(file, BYTE_ORDER_MARK);
+  writeRaw(file, static_cast<uint32_t>(ColumnarMappingFormat::VERSION));
+  writeRaw(file, static_cast<uint32_t>(valueSize));
+  writeRaw(file, static_cast<uint32_t>(compression));
+  writeRaw(file, static_cast<uint64_t>(patternLinks.size()));
+  writeRaw(file, static_cast<uint64_t>(nbPatterns));
+  writeRaw(file, static_cast<uint64_t>(nbBranches));
+  writeRaw(file, static_cast<uint64_t>(nbTypes));
+  writeRaw(file, static_cast<uint64_t>(chunkSize));
+
+  for (auto id : ids)
+  {
+    writeRaw(file, static_cast<uint32_t>(id));
+  }
+
+  for (const auto& name : typeNames)
+  {
+    writeRaw(file, static_cast<uint32_t>(name.size()));
+    file.write(name.data(), static_cast<streamsize>(name.size()));
+  }
+
+  for (auto c : coordinates)
+  {
+    writeRaw(file, static_cast<int32_t>(c));
+  }
+
+  for (auto p : patternLinks)
+  {
+    writeRaw(file, static_cast<uint64_t>(p));
+  }
+
+  // Chunk index, filled once the chunks are written
+  streampos indexPos = file.tellp();
+  vector<uint64_t> index(2 * nbColumns * nbChunks, 0);
+  file.write(reinterpret_cast<const char*>(index.data()), static_cast<streamsize>(index.size() * sizeof(uint64_t)));
+
+  // Chunks
+  vector<double> values;
+  vector<char> bytes;
+  size_t pos = 0;
+  for (size_t t = 0; t < nbTypes; ++t)
+  {
+    for (size_t b = 0; b < nbBranches; ++b)
+    {
+      for (size_t c = 0; c < nbChunks; ++c)
+      {
+        size_t first = c * chunkSize;
+        size_t last = std::min(first + chunkSize, nbPatterns);
+        values.resize(last - first);
+        for (size_t p = first; p < last; ++p)
+        {
+          values[p - first] = value(p, b, t);
+        }
+
+        encodeChunk(values, static_cast<size_t>(valueSize), compression, bytes);
+
+        index[pos++] = static_cast<uint64_t>(file.tellp());
+        index[pos++] = static_cast<uint64_t>(bytes.size());
+        file.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+      }
+    }
+  }
+
+  file.seekp(indexPos);
+  file.write(reinterpret_cast<const char*>(index.data()), static_cast<streamsize>(index.size() * sizeof(uint64_t)));
+
+  if (!file)
+    throw IOException("ColumnarMappingFormat::write: error while writing file " + path);
+  file.close();
+}
+}
+
+/******************************************************************************/
+
+bool ColumnarMappingFormat::hasCompressionSupport()
+{
+#ifdef BPP_HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+/******************************************************************************/
+
+void ColumnarMappingFormat::write(
+    const string& path,
+    const ProbabilisticSubstitutionMapping& mapping,
+    const vector<uint>& ids,
+    const vector<string>& typeNames,
+    const vector<int>& coordinates,
+    short valueSize,
+    short compression,
+    size_t chunkSize)
+{
+  if (typeNames.size() != mapping.getNumberOfSubstitutionTypes())
+    throw BadSizeException("ColumnarMappingFormat::write: number of type names does not match the mapping", typeNames.size(), mapping.getNumberOfSubstitutionTypes());
+
+  size_t nbSites = mapping.getNumberOfSites();
+  vector<size_t> patternLinks(nbSites);
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    patternLinks[i] = mapping.getSiteIndex(i);
+  }
+
+  vector<shared_ptr<PhyloBranchMapping>> branches;
+  for (auto id : ids)
+  {
+    branches.push_back(mapping.getEdge(id));
+  }
+
+  writeColumnar(path, mapping.getNumberOfDistinctSites(), patternLinks, ids, typeNames, coordinates, valueSize, compression, chunkSize,
+                [&branches](size_t p, size_t b, size_t t) -> double {
+    return (*branches[b])(p, t);
+  });
+}
+
+/******************************************************************************/
+
+void ColumnarMappingFormat::write(
+    const string& path,
+    const VVVdouble& counts,
+    const vector<uint>& ids,
+    const vector<string>& typeNames,
+    const vector<int>& coordinates,
+    short valueSize,
+    short compression,
+    size_t chunkSize)
+{
+  size_t nbSites = counts.size();
+  vector<size_t> patternLinks(nbSites);
+  for (size_t i = 0; i < nbSites; ++i)
+  {
+    if (counts[i].size() != ids.size())
+      throw BadSizeException("ColumnarMappingFormat::write: number of branches does not match the counts at site " + TextTools::toString(i), counts[i].size(), ids.size());
+    for (const auto& branchCounts : counts[i])
+    {
+      if (branchCounts.size() != typeNames.size())
+        throw BadSizeException("ColumnarMappingFormat::write: number of types does not match the counts at site " + TextTools::toString(i), branchCounts.size(), typeNames.size());
+    }
+    patternLinks[i] = i;
+  }
+
+  writeColumnar(path, nbSites, patternLinks, ids, typeNames, coordinates, valueSize, compression, chunkSize,
+                [&counts](size_t p, size_t b, size_t t) -> double {
+    return counts[p][b][t];
+  });
+}
+
+/******************************************************************************/
+
+ColumnarMappingReader::ColumnarMappingReader(const string& path) :
+  file_(path.c_str(), ios::in | ios::binary),
+  valueSize_(0),
+  compression_(0),
+  nbSites_(0),
+  nbPatterns_(0),
+  chunkSize_(0),
+  nbChunks_(0),
+  ids_(),
+  typeNames_(),
+  coordinates_(),
+  patternLinks_(),
+  offsets_(),
+  sizes_()
+{
+  if (!file_)
+    throw IOException("ColumnarMappingReader: could not open file " + path);
+
+  char magic[8];
+  file_.read(magic, sizeof(magic));
+  if (!file_ || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    throw IOException("ColumnarMappingReader: " + path + " is not a columnar mapping file.");
+
+  uint32_t bom, version, valueSize, compression;
+  readRaw(file_, bom);
+  if (bom != BYTE_ORDER_MARK)
+    throw IOException("ColumnarMappingReader: " + path + " was written with a different byte order.");
+  readRaw(file_, version);
+  if (version != ColumnarMappingFormat::VERSION)
+    throw IOException("ColumnarMappingReader: unsupported version " + TextTools::toString(version) + " in " + path);
+  readRaw(file_, valueSize);
+  readRaw(file_, compression);
+  valueSize_ = static_cast<size_t>(valueSize);
+  compression_ = static_cast<short>(compression);
+  if (valueSize_ != ColumnarMappingFormat::FLOAT32 && valueSize_ != ColumnarMappingFormat::FLOAT64)
+    throw IOException("ColumnarMappingReader: unknown value size " + TextTools::toString(valueSize) + " in " + path);
+  if (compression_ == ColumnarMappingFormat::ZLIB_COMPRESSION && !ColumnarMappingFormat::hasCompressionSupport())
+    throw IOException("ColumnarMappingReader: " + path + " is compressed, but the library was built without zlib support.");
+
+  uint64_t nbSites, nbPatterns, nbBranches, nbTypes, chunkSize;
+  readRaw(file_, nbSites);
+  readRaw(file_, nbPatterns);
+  readRaw(file_, nbBranches);
+  readRaw(file_, nbTypes);
+  readRaw(file_, chunkSize);
+  nbSites_ = static_cast<size_t>(nbSites);
+  nbPatterns_ = static_cast<size_t>(nbPatterns);
+  chunkSize_ = static_cast<size_t>(chunkSize);
+  if (chunkSize_ == 0)
+    throw IOException("ColumnarMappingReader: null chunk size in " + path);
+  nbChunks_ = (nbPatterns_ + chunkSize_ - 1) / chunkSize_;
+
+  ids_.resize(static_cast<size_t>(nbBranches));
+  for (auto& id : ids_)
+  {
+    uint32_t x;
+    readRaw(file_, x);
+    id = static_cast<uint>(x);
+  }
+
+  typeNames_.resize(static_cast<size_t>(nbTypes));
+  for (auto& name : typeNames_)
+  {
+    uint32_t length;
+    readRaw(file_, length);
+    name.resize(length);
+    if (length > 0)
+      file_.read(&name[0], static_cast<streamsize>(length));
+  }
+
+  coordinates_.resize(nbSites_);
+  for (auto& c : coordinates_)
+  {
+    int32_t x;
+    readRaw(file_, x);
+    c = static_cast<int>(x);
+  }
+
+  patternLinks_.resize(nbSites_);
+  for (auto& p : patternLinks_)
+  {
+    uint64_t x;
+    readRaw(file_, x);
+    if (x >= nbPatterns)
+      throw IOException("ColumnarMappingReader: bad pattern link in " + path);
+    p = static_cast<size_t>(x);
+  }
+
+  size_t nbEntries = ids_.size() * typeNames_.size() * nbChunks_;
+  offsets_.resize(nbEntries);
+  sizes_.resize(nbEntries);
+  for (size_t i = 0; i < nbEntries; ++i)
+  {
+    readRaw(file_, offsets_[i]);
+    readRaw(file_, sizes_[i]);
+  }
+}
+
+/******************************************************************************/
+
+size_t ColumnarMappingReader::getBranchIndex(uint id) const
+{
+  for (size_t i = 0; i < ids_.size(); ++i)
+  {
+    if (ids_[i] == id)
+      return i;
+  }
+  throw Exception("ColumnarMappingReader::getBranchIndex: unknown branch " + TextTools::toString(id));
+}
+
+/******************************************************************************/
+
+size_t ColumnarMappingReader::getTypeIndex(const string& name) const
+{
+  for (size_t i = 0; i < typeNames_.size(); ++i)
+  {
+    if (typeNames_[i] == name)
+      return i;
+  }
+  throw Exception("ColumnarMappingReader::getTypeIndex: unknown type " + name);
+}
+
+/******************************************************************************/
+
+void ColumnarMappingReader::readChunk_(size_t column, size_t chunk, vector<double>& values) const
+{
+  size_t entry = column * nbChunks_ + chunk;
+  size_t first = chunk * chunkSize_;
+  size_t nbValues = std::min(first + chunkSize_, nbPatterns_) - first;
+
+  vector<char> bytes(static_cast<size_t>(sizes_[entry]));
+  file_.clear();
+  file_.seekg(static_cast<streamoff>(offsets_[entry]));
+  file_.read(bytes.data(), static_cast<streamsize>(bytes.size()));
+  if (!file_)
+    throw IOException("ColumnarMappingReader::readChunk_: unexpected end of file.");
+
+  vector<char> raw;
+  if (compression_ == ColumnarMappingFormat::NO_COMPRESSION)
+    raw.swap(bytes);
+  else
+  {
+#ifdef BPP_HAVE_ZLIB
+    uLongf destLen = static_cast<uLongf>(nbValues * valueSize_);
+    raw.resize(destLen);
+    if (uncompress(reinterpret_cast<Bytef*>(raw.data()), &destLen,
+                   reinterpret_cast<const Bytef*>(bytes.data()), static_cast<uLong>(bytes.size())) != Z_OK)
+      throw IOException("ColumnarMappingReader::readChunk_: decompression failed.");
+#endif
+  }
+
+  if (raw.size() != nbValues * valueSize_)
+    throw IOException("ColumnarMappingReader::readChunk_: bad chunk size.");
+
+  values.resize(nbValues);
+  if (valueSize_ == ColumnarMappingFormat::FLOAT32)
+  {
+    for (size_t i = 0; i < nbValues; ++i)
+    {
+      float x;
+      memcpy(&x, &raw[i * valueSize_], valueSize_);
+      values[i] = static_cast<double>(x);
+    }
+  }
+  else
+    memcpy(values.data(), raw.data(), raw.size());
+}
+
+/******************************************************************************/
+
+void ColumnarMappingReader::readPatternColumn(size_t branchIndex, size_t typeIndex, vector<double>& values) const
+{
+  if (branchIndex >= ids_.size())
+    throw IndexOutOfBoundsException("ColumnarMappingReader::readPatternColumn: bad branch index", branchIndex, 0, ids_.size() - 1);
+  if (typeIndex >= typeNames_.size())
+    throw IndexOutOfBoundsException("ColumnarMappingReader::readPatternColumn: bad type index", typeIndex, 0, typeNames_.size() - 1);
+
+  size_t column = typeIndex * ids_.size() + branchIndex;
+  values.resize(nbPatterns_);
+  vector<double> chunkValues;
+  for (size_t c = 0; c < nbChunks_; ++c)
+  {
+    readChunk_(column, c, chunkValues);
+    std::copy(chunkValues.begin(), chunkValues.end(), values.begin() + static_cast<ptrdiff_t>(c * chunkSize_));
+  }
+}
+
+/******************************************************************************/
+
+void ColumnarMappingReader::readSiteColumn(size_t branchIndex, size_t typeIndex, size_t begin, size_t end, vector<double>& values) const
+{
+  if (branchIndex >= ids_.size())
+    throw IndexOutOfBoundsException("ColumnarMappingReader::readSiteColumn: bad branch index", branchIndex, 0, ids_.size() - 1);
+  if (typeIndex >= typeNames_.size())
+    throw IndexOutOfBoundsException("ColumnarMappingReader::readSiteColumn: bad type index", typeIndex, 0, typeNames_.size() - 1);
+  if (begin > end || end > nbSites_)
+    throw Exception("ColumnarMappingReader::readSiteColumn: bad range of sites [" + TextTools::toString(begin) + ", " + TextTools::toString(end) + "[");
+
+  size_t column = typeIndex * ids_.size() + branchIndex;
+
+  // Only the chunks holding the patterns of the sites are read
+  map<size_t, vector<double>> chunks;
+
+  values.resize(end - begin);
+  for (size_t i = begin; i < end; ++i)
+  {
+    size_t p = patternLinks_[i];
+    size_t c = p / chunkSize_;
+    auto it = chunks.find(c);
+    if (it == chunks.end())
+    {
+      readChunk_(column, c, chunks[c]);
+      it = chunks.find(c);
+    }
+    values[i - begin] = it->second[p - c * chunkSize_];
+  }
+}
+
+/******************************************************************************/
@@ -0,0 +1,221 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_MAPPING_COLUMNARMAPPINGFORMAT_H
+#define BPP_PHYL_MAPPING_COLUMNARMAPPINGFORMAT_H
+
+#include <Bpp/Exceptions.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+#include "ProbabilisticSubstitutionMapping.h"
+
+// From the STL:
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Binary columnar format for per-site, per-branch and per-type
+ * mapping results.
+ *
+ * Values are stored per distinct site pattern, with the links from
+ * sites to patterns, so that a pattern-compressed mapping is written
+ * without expansion. Each column (one branch and one type) is stored
+ * contiguously, split into chunks of a fixed number of patterns.
+ * Chunks are either raw or zlib-compressed (if the library was built
+ * with zlib).
+ *
+ * Layout of a file (integers and values in the byte order of the
+ * writing machine, checked by the reader through a byte order mark):
+ *
+ * - char[8]   magic "BPPCOUNT"
+ * - uint32    byte order mark 0x01020304
+ * - uint32    version (1)
+ * - uint32    size of values, in bytes (4: float32, 8: float64)
+ * - uint32    compression (0: none, 1: zlib)
+ * - uint64    number of sites, patterns, branches, types, and number
+ *             of patterns per chunk
+ * - uint32[]  branch ids
+ * - per type: uint32 length, char[] name
+ * - int32[]   site coordinates
+ * - uint64[]  pattern of each site
+ * - per column (types first, then branches within a type), per
+ *   chunk: uint64 offset of the chunk from the start of the file,
+ *   uint64 stored size of the chunk in bytes
+ * - chunks
+ *
+ * Without compression, each column is a plain contiguous array of
+ * values, which can be memory-mapped directly.
+ */
+class ColumnarMappingFormat
+{
+public:
+  static const short FLOAT32;
+  static const short FLOAT64;
+
+  static const short NO_COMPRESSION;
+  static const short ZLIB_COMPRESSION;
+
+  static const uint32_t VERSION;
+
+public:
+  ColumnarMappingFormat() {}
+  virtual ~ColumnarMappingFormat() {}
+
+public:
+  /**
+   * @return true if the library was built with zlib support.
+   */
+  static bool hasCompressionSupport();
+
+  /**
+   * @brief Write a mapping, without expanding the site patterns.
+   *
+   * @param path        The file to write.
+   * @param mapping     The mapping (possibly with patterns).
+   * @param ids         The ids of the branches to write.
+   * @param typeNames   The names of the substitution types.
+   * @param coordinates The coordinates of the sites.
+   * @param valueSize   FLOAT32 or FLOAT64.
+   * @param compression NO_COMPRESSION or ZLIB_COMPRESSION.
+   * @param chunkSize   The number of patterns per chunk.
+   * @throw IOException If an output error happens.
+   */
+  static void write(
+      const std::string& path,
+      const ProbabilisticSubstitutionMapping& mapping,
+      const std::vector<uint>& ids,
+      const std::vector<std::string>& typeNames,
+      const std::vector<int>& coordinates,
+      short valueSize = FLOAT32,
+      short compression = NO_COMPRESSION,
+      size_t chunkSize = 65536);
+
+  /**
+   * @brief Write per-site counts, such as those returned by
+   * SubstitutionMappingTools::getCountsPerSitePerBranchPerType.
+   *
+   * @param path        The file to write.
+   * @param counts      The counts, indexed [site][branch][type].
+   * @param ids         The ids of the branches.
+   * @param typeNames   The names of the substitution types.
+   * @param coordinates The coordinates of the sites.
+   * @param valueSize   FLOAT32 or FLOAT64.
+   * @param compression NO_COMPRESSION or ZLIB_COMPRESSION.
+   * @param chunkSize   The number of sites per chunk.
+   * @throw IOException If an output error happens.
+   */
+  static void write(
+      const std::string& path,
+      const VVVdouble& counts,
+      const std::vector<uint>& ids,
+      const std::vector<std::string>& typeNames,
+      const std::vector<int>& coordinates,
+      short valueSize = FLOAT32,
+      short compression = NO_COMPRESSION,
+      size_t chunkSize = 65536);
+};
+
+/**
+ * @brief Reader for the ColumnarMappingFormat.
+ *
+ * The header is read at construction, and values are read on demand,
+ * chunk by chunk, so that columns or ranges of sites can be extracted
+ * without loading the whole file.
+ */
+class ColumnarMappingReader
+{
+private:
+  mutable std::ifstream file_;
+
+  size_t valueSize_;
+  short compression_;
+
+  size_t nbSites_;
+  size_t nbPatterns_;
+  size_t chunkSize_;
+  size_t nbChunks_;
+
+  std::vector<uint> ids_;
+  std::vector<std::string> typeNames_;
+  std::vector<int> coordinates_;
+  std::vector<size_t> patternLinks_;
+
+  /**
+   * @brief Offsets and sizes of the chunks, per column and chunk.
+   */
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> sizes_;
+
+public:
+  /**
+   * @param path The file to read.
+   * @throw IOException If the file can not be read or is not in the
+   * expected format.
+   */
+  ColumnarMappingReader(const std::string& path);
+
+  ColumnarMappingReader(const ColumnarMappingReader&) = delete;
+
+  ColumnarMappingReader& operator=(const ColumnarMappingReader&) = delete;
+
+  virtual ~ColumnarMappingReader() {}
+
+public:
+  size_t getNumberOfSites() const { return nbSites_; }
+
+  size_t getNumberOfPatterns() const { return nbPatterns_; }
+
+  size_t getNumberOfBranches() const { return ids_.size(); }
+
+  size_t getNumberOfTypes() const { return typeNames_.size(); }
+
+  const std::vector<uint>& getBranchIds() const { return ids_; }
+
+  const std::vector<std::string>& getTypeNames() const { return typeNames_; }
+
+  const std::vector<int>& getCoordinates() const { return coordinates_; }
+
+  const std::vector<size_t>& getPatternLinks() const { return patternLinks_; }
+
+  /**
+   * @return The position of a branch id in the file.
+   * @throw Exception If the branch is not in the file.
+   */
+  size_t getBranchIndex(uint id) const;
+
+  /**
+   * @return The position of a type name in the file.
+   * @throw Exception If the type is not in the file.
+   */
+  size_t getTypeIndex(const std::string& name) const;
+
+  /**
+   * @brief Read the values of all patterns, for a branch and a type.
+   *
+   * @param branchIndex The position of the branch in the file.
+   * @param typeIndex   The position of the type in the file.
+   * @param values      The vector filled with the values.
+   */
+  void readPatternColumn(size_t branchIndex, size_t typeIndex, std::vector<double>& values) const;
+
+  /**
+   * @brief Read the values of a range of sites, for a branch and a type.
+   *
+   * @param branchIndex The position of the branch in the file.
+   * @param typeIndex   The position of the type in the file.
+   * @param begin       The first site.
+   * @param end         The site after the last one.
+   * @param values      The vector filled with the values.
+   */
+  void readSiteColumn(size_t branchIndex, size_t typeIndex, size_t begin, size_t end, std::vector<double>& values) const;
+
+private:
+  void readChunk_(size_t column, size_t chunk, std::vector<double>& values) const;
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_MAPPING_COLUMNARMAPPINGFORMAT_H
@@ -2,6 +2,7 @@
 //
 // SPDX-License-Identifier: CECILL-2.1
 
+#include <map>
 #include <typeinfo>
 #include <vector>
 
@@ -108,6 +109,10 @@ void DecompositionSubstitutionCount::setDistanceBMatrices_()
 
 void DecompositionSubstitutionCount::computeCounts_(double length) const
 {
+  string key = SubstitutionCountCache::makeKey(*model_, length);
+  if (cache_->get(key, counts_))
+    return;
+
   computeExpectations(counts_, length);
 
   // Now we must divide by pijt and account for putative weights:
@@ -127,6 +132,24 @@ void DecompositionSubstitutionCount::computeCounts_(double length) const
       }
     }
   }
+
+  cache_->set(key, counts_);
+}
+
+/******************************************************************************/
+
+void DecompositionSubstitutionCount::storeCounts_(size_t type, Eigen::MatrixXd& mat) const
+{
+  mat.resize(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
+
+  const auto& ct = counts_[type - 1];
+  for (size_t i = 0; i < nbStates_; i++)
+  {
+    for (size_t j = 0; j < nbStates_; j++)
+    {
+      mat(Eigen::Index(i), Eigen::Index(j)) = isnan(ct(i, j)) ? 0 : ct(i, j);
+    }
+  }
 }
 
 /******************************************************************************/
@@ -162,15 +185,47 @@ void DecompositionSubstitutionCount::storeAllNumbersOfSubstitutions(double lengt
     currentLength_ = length;
   }
 
-  mat.resize(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
+  storeCounts_(type, mat);
+}
 
-  const auto& ct = counts_[type - 1];
-  for (size_t i = 0; i < nbStates_; i++)
+/******************************************************************************/
+
+void DecompositionSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths(const vector<double>& lengths, vector<vector<Eigen::MatrixXd>>& mats) const
+{
+  if (!model_)
+    throw Exception("DecompositionSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths: model not defined.");
+
+  mats.resize(lengths.size());
+
+  // Position of the first occurence of each length
+  map<double, size_t> done;
+
+  for (size_t l = 0; l < lengths.size(); ++l)
   {
-    for (size_t j = 0; j < nbStates_; j++)
+    double length = lengths[l];
+    if (length < 0)
+      throw Exception("DecompositionSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths. Negative branch length: " + TextTools::toString(length) + ".");
+
+    auto it = done.find(length);
+    if (it != done.end())
     {
-      mat(Eigen::Index(i), Eigen::Index(j)) = isnan(ct(i, j)) ? 0 : ct(i, j);
+      mats[l] = mats[it->second];
+      continue;
+    }
+
+    if (length != currentLength_)
+    {
+      computeCounts_(length);
+      currentLength_ = length;
+    }
+
+    mats[l].resize(nbTypes_);
+    for (size_t t = 0; t < nbTypes_; ++t)
+    {
+      storeCounts_(t + 1, mats[l][t]);
     }
+
+    done[length] = l;
   }
 }
 
@@ -263,6 +318,8 @@ void DecompositionSubstitutionCount::substitutionRegisterHasChanged()
 
 void DecompositionSubstitutionCount::weightsHaveChanged()
 {
+  resetCache_();
+
   if (typeid(weights_->getAlphabet()) != typeid(register_->getAlphabet()))
     throw Exception("DecompositionSubstitutionCount::weightsHaveChanged. Incorrect alphabet type.");
 
@@ -277,6 +334,8 @@ void DecompositionSubstitutionCount::weightsHaveChanged()
 
 void DecompositionSubstitutionCount::distancesHaveChanged()
 {
+  resetCache_();
+
   if (distances_->getAlphabet()->getAlphabetType() != register_->getAlphabet()->getAlphabetType())
     throw Exception("DecompositionSubstitutionCount::distancesHaveChanged. Incorrect alphabet type.");
 
@@ -74,6 +74,15 @@ public:
 
   void storeAllNumbersOfSubstitutions(double length, size_t type, Eigen::MatrixXd& mat) const override;
 
+  /**
+   * @brief Stores the numbers of substitutions for a set of branch
+   * lengths, for all types.
+   *
+   * The eigen decomposition of the model is shared by all lengths,
+   * and each distinct length is computed once for all types.
+   */
+  void storeAllNumbersOfSubstitutionsForLengths(const std::vector<double>& lengths, std::vector<std::vector<Eigen::MatrixXd>>& mats) const override;
+
   std::vector<double> getNumberOfSubstitutionsPerType(size_t initialState, size_t finalState, double length) const override;
 
   /**
@@ -88,6 +97,8 @@ protected:
 
   void computeCounts_(double length) const;
 
+  void storeCounts_(size_t type, Eigen::MatrixXd& mat) const;
+
   void substitutionRegisterHasChanged() override;
 
   void weightsHaveChanged() override;
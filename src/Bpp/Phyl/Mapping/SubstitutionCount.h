@@ -9,6 +9,7 @@
 
 #include "../Model/SubstitutionModel.h"
 #include "CategorySubstitutionRegister.h"
+#include "SubstitutionCountCache.h"
 #include "SubstitutionRegister.h"
 
 // From the STL:
@@ -118,6 +119,34 @@ public:
 
   virtual void storeAllNumbersOfSubstitutions(double length, size_t type, Eigen::MatrixXd& mat) const = 0;
 
+  /**
+   * @brief Stores the numbers of susbstitutions for a set of branch
+   * lengths, for each type and each initial and final states.
+   *
+   * This default implementation calls
+   * storeAllNumbersOfSubstitutions(double, size_t, Eigen::MatrixXd&)
+   * for each length and type. Implementations may share the
+   * computations between lengths.
+   *
+   * @param lengths      The lengths of the branches.
+   * @param mats         The tensor filled with all numbers of
+   * substitutions: mats[l][t] is the matrix for length lengths[l]
+   * and type t + 1.
+   */
+  virtual void storeAllNumbersOfSubstitutionsForLengths(const std::vector<double>& lengths, std::vector<std::vector<Eigen::MatrixXd>>& mats) const
+  {
+    size_t nbTypes = getNumberOfSubstitutionTypes();
+    mats.resize(lengths.size());
+    for (size_t l = 0; l < lengths.size(); ++l)
+    {
+      mats[l].resize(nbTypes);
+      for (size_t t = 0; t < nbTypes; ++t)
+      {
+        storeAllNumbersOfSubstitutions(lengths[l], t + 1, mats[l][t]);
+      }
+    }
+  }
+
   /**
    * @brief Get the numbers of susbstitutions on a branch for all types, for an initial and final states, given the branch length.
    *
@@ -145,9 +174,15 @@ class AbstractSubstitutionCount :
 protected:
   std::shared_ptr<const SubstitutionRegisterInterface> register_;
 
+  /**
+   * @brief Cache of computed counts, shared between clones.
+   */
+  std::shared_ptr<SubstitutionCountCache> cache_;
+
 public:
   AbstractSubstitutionCount(std::shared_ptr<const SubstitutionRegisterInterface> reg) :
-    register_(reg)
+    register_(reg),
+    cache_(std::make_shared<SubstitutionCountCache>())
   {}
 
   virtual ~AbstractSubstitutionCount() {}
@@ -164,13 +199,34 @@ public:
   void setSubstitutionRegister(std::shared_ptr<const SubstitutionRegisterInterface> reg)
   {
     register_ = reg;
+    resetCache_();
     substitutionRegisterHasChanged();
   }
 
   std::shared_ptr<const SubstitutionRegisterInterface> getSubstitutionRegister() const { return register_; }
 
+  /**
+   * @return The cache of counts, shared with the clones of this object.
+   */
+  std::shared_ptr<const SubstitutionCountCache> getCache() const { return cache_; }
+
+  /**
+   * @brief Set the maximum size in bytes of the cache of counts
+   * (0 disables the cache).
+   */
+  void setCacheSize(size_t size) { cache_->setMaxSize(size); }
+
 protected:
   virtual void substitutionRegisterHasChanged() = 0;
+
+  /**
+   * @brief Detach from the cache shared with clones, when the counts
+   * computed by this object change (register, weights, distances).
+   */
+  void resetCache_()
+  {
+    cache_ = std::make_shared<SubstitutionCountCache>(cache_->getMaxSize());
+  }
 };
 } // end of namespace bpp.
 #endif // BPP_PHYL_MAPPING_SUBSTITUTIONCOUNT_H
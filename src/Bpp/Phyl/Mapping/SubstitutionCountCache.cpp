@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include "SubstitutionCountCache.h"
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+bool SubstitutionCountCache::get(const string& key, vector< RowMatrix<double>>& counts)
+{
+  lock_guard<mutex> lock(mutex_);
+
+  auto it = cache_.find(key);
+  if (it == cache_.end())
+  {
+    nbMisses_++;
+    return false;
+  }
+
+  nbHits_++;
+  counts = it->second;
+  return true;
+}
+
+/******************************************************************************/
+
+void SubstitutionCountCache::set(const string& key, const vector< RowMatrix<double>>& counts)
+{
+  lock_guard<mutex> lock(mutex_);
+
+  if (cache_.find(key) != cache_.end())
+    return;
+
+  size_t size = entrySize_(key, counts);
+  if (size > maxSize_)
+    return;
+
+  makeRoom_(size);
+  cache_[key] = counts;
+  keys_.push_back(key);
+  size_ += size;
+}
+
+/******************************************************************************/
+
+void SubstitutionCountCache::clear()
+{
+  lock_guard<mutex> lock(mutex_);
+
+  cache_.clear();
+  keys_.clear();
+  size_ = 0;
+}
+
+/******************************************************************************/
+
+size_t SubstitutionCountCache::getNumberOfEntries() const
+{
+  lock_guard<mutex> lock(mutex_);
+
+  return cache_.size();
+}
+
+/******************************************************************************/
+
+void SubstitutionCountCache::setMaxSize(size_t maxSize)
+{
+  lock_guard<mutex> lock(mutex_);
+
+  maxSize_ = maxSize;
+  makeRoom_(0);
+}
+
+/******************************************************************************/
+
+size_t SubstitutionCountCache::getSize() const
+{
+  lock_guard<mutex> lock(mutex_);
+
+  return size_;
+}
+
+/******************************************************************************/
+
+size_t SubstitutionCountCache::entrySize_(const string& key, const vector< RowMatrix<double>>& counts)
+{
+  size_t size = key.size();
+  for (const auto& m : counts)
+  {
+    size += m.getNumberOfRows() * m.getNumberOfColumns() * sizeof(double);
+  }
+  return size;
+}
+
+/******************************************************************************/
+
+void SubstitutionCountCache::makeRoom_(size_t size)
+{
+  while (!keys_.empty() && size_ + size > maxSize_)
+  {
+    auto it = cache_.find(keys_.front());
+    size_ -= entrySize_(it->first, it->second);
+    cache_.erase(it);
+    keys_.pop_front();
+  }
+}
+
+/******************************************************************************/
+
+size_t SubstitutionCountCache::getNumberOfHits() const
+{
+  lock_guard<mutex> lock(mutex_);
+
+  return nbHits_;
+}
+
+/******************************************************************************/
+
+size_t SubstitutionCountCache::getNumberOfMisses() const
+{
+  lock_guard<mutex> lock(mutex_);
+
+  return nbMisses_;
+}
+
+/******************************************************************************/
+
+void SubstitutionCountCache::appendDouble_(string& key, double x)
+{
+  // Raw bytes, so that no precision is lost.
+  key.append(reinterpret_cast<const char*>(&x), sizeof(double));
+}
+
+/******************************************************************************/
+
+string SubstitutionCountCache::makeModelKey(const SubstitutionModelInterface& model)
+{
+  string key = model.getName();
+
+  const ParameterList& pl = model.getParameters();
+  for (size_t i = 0; i < pl.size(); ++i)
+  {
+    key += pl[i].getName();
+    appendDouble_(key, pl[i].getValue());
+  }
+
+  appendDouble_(key, model.getRate());
+
+  for (auto f : model.getFrequencies())
+  {
+    appendDouble_(key, f);
+  }
+
+  return key;
+}
+
+/******************************************************************************/
+
+string SubstitutionCountCache::makeKey(const SubstitutionModelInterface& model, double length)
+{
+  string key = makeModelKey(model);
+  appendDouble_(key, length);
+  return key;
+}
+
+/******************************************************************************/
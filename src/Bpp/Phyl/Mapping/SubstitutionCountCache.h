@@ -0,0 +1,149 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_MAPPING_SUBSTITUTIONCOUNTCACHE_H
+#define BPP_PHYL_MAPPING_SUBSTITUTIONCOUNTCACHE_H
+
+#include <Bpp/Numeric/Matrix/Matrix.h>
+
+#include "../Model/SubstitutionModel.h"
+
+// From the STL:
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Cache of substitution count matrices.
+ *
+ * Stores the count matrices of all substitution types computed for a
+ * given model and a given branch length. Entries are keyed on the
+ * name, parameter values, rate and equilibrium frequencies of the
+ * model, and on the branch length, so that the same counts are
+ * reused as long as the model is not modified.
+ *
+ * The cache is shared between the clones of a substitution count,
+ * hence it is protected against concurrent accesses.
+ *
+ * The size of the cache is bounded in bytes, counting the keys and
+ * the count matrices, since the size of an entry grows with the
+ * square of the number of states of the model. When the maximum size
+ * is reached, the oldest entries are discarded first. A maximum size
+ * of 0 disables the cache.
+ */
+class SubstitutionCountCache
+{
+private:
+  /**
+   * @brief The maximum size of the cache, in bytes.
+   */
+  size_t maxSize_;
+
+  /**
+   * @brief The current size of the cache, in bytes.
+   */
+  size_t size_;
+
+  std::map<std::string, std::vector< RowMatrix<double>>> cache_;
+
+  /**
+   * @brief The keys, in their order of insertion.
+   */
+  std::deque<std::string> keys_;
+
+  size_t nbHits_;
+  size_t nbMisses_;
+
+  mutable std::mutex mutex_;
+
+public:
+  SubstitutionCountCache(size_t maxSize = 16 * 1024 * 1024) :
+    maxSize_(maxSize),
+    size_(0),
+    cache_(),
+    keys_(),
+    nbHits_(0),
+    nbMisses_(0),
+    mutex_()
+  {}
+
+  SubstitutionCountCache(const SubstitutionCountCache&) = delete;
+
+  SubstitutionCountCache& operator=(const SubstitutionCountCache&) = delete;
+
+  virtual ~SubstitutionCountCache() {}
+
+public:
+  /**
+   * @brief Look for counts in the cache.
+   *
+   * @param key    The key of the counts.
+   * @param counts The vector (per type) of count matrices, set if
+   * the key is found.
+   * @return true if the key was found.
+   */
+  bool get(const std::string& key, std::vector< RowMatrix<double>>& counts);
+
+  /**
+   * @brief Store counts in the cache.
+   *
+   * @param key    The key of the counts.
+   * @param counts The vector (per type) of count matrices.
+   */
+  void set(const std::string& key, const std::vector< RowMatrix<double>>& counts);
+
+  void clear();
+
+  size_t getNumberOfEntries() const;
+
+  /**
+   * @return The current size of the cache, in bytes.
+   */
+  size_t getSize() const;
+
+  /**
+   * @return The maximum size of the cache, in bytes.
+   */
+  size_t getMaxSize() const { return maxSize_; }
+
+  /**
+   * @brief Set the maximum size of the cache, in bytes, discarding
+   * the oldest entries if needed.
+   */
+  void setMaxSize(size_t maxSize);
+
+  size_t getNumberOfHits() const;
+
+  size_t getNumberOfMisses() const;
+
+  /**
+   * @brief Build a key identifying the state of a model.
+   *
+   * The key holds the name, the parameter values, the rate and the
+   * equilibrium frequencies of the model.
+   */
+  static std::string makeModelKey(const SubstitutionModelInterface& model);
+
+  /**
+   * @brief Build a key identifying the state of a model and a branch length.
+   */
+  static std::string makeKey(const SubstitutionModelInterface& model, double length);
+
+private:
+  static size_t entrySize_(const std::string& key, const std::vector< RowMatrix<double>>& counts);
+
+  /**
+   * @brief Discard the oldest entries until there remains room for
+   * size bytes. The mutex must be locked.
+   */
+  void makeRoom_(size_t size);
+
+  static void appendDouble_(std::string& key, double x);
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_MAPPING_SUBSTITUTIONCOUNTCACHE_H
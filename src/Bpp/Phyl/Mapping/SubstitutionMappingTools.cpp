@@ -23,6 +23,28 @@ using namespace std;
 // From the STL:
 #include <iomanip>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+/**
+ * @brief Pointers to the values needed to compute counts on a given
+ * edge of the DAG, for a given rate class.
+ */
+struct EdgeCountData
+{
+  const SubstitutionModelInterface* model;
+  double brLen;
+  const Eigen::MatrixXd* pxy;
+  const MatrixLik* likelihoodsTopEdge;
+  const MatrixLik* likelihoodsBotEdge;
+  const RowLik* likelihoodsFather;
+  double probaFather;
+};
+}
+
 /******************************************************************************/
 
 unique_ptr<ProbabilisticSubstitutionMapping> SubstitutionMappingTools::computeCounts(
@@ -137,7 +159,6 @@ unique_ptr<ProbabilisticSubstitutionMapping> SubstitutionMappingTools::computeCo
   size_t nbClasses       = sp.getNumberOfClasses();
 
   size_t nbTypes         = substitutionCount.getNumberOfSubstitutionTypes();
-  size_t nbNodes         = edgeIds.size();
 
   const auto& rootPatternLinks = rltc.getRootArrayPositions();
 
@@ -153,47 +174,39 @@ unique_ptr<ProbabilisticSubstitutionMapping> SubstitutionMappingTools::computeCo
   if (verbose)
     ApplicationTools::displayTask("Compute counts", true);
 
+  /*
+   * The DataFlow graph is built and computed lazily, which is not
+   * thread-safe. So all the likelihood arrays needed for the counts
+   * are fetched first, and then branches are processed concurrently.
+   */
+
+  vector<shared_ptr<PhyloBranchMapping>> vBranches;
+  vector<uint> vSpeciesIds;
+
+  // For each branch, for each class, the list of the dag edges
+  vector<vector<vector<EdgeCountData>>> vEdgeData;
+
   unique_ptr<ProbabilisticSubstitutionMapping::mapTree::EdgeIterator> brIt = substitutions->allEdgesIterator();
 
-  size_t nn = 0;
   for ( ; !brIt->end(); brIt->next())
   {
-    if (verbose)
-      ApplicationTools::displayGauge(nn++, nbNodes - 1);
-
     shared_ptr<PhyloBranchMapping> br = **brIt;
 
-    // For each branch
     uint speciesId = substitutions->getEdgeIndex(br);
 
     if (edgeIds.size() > 0 && !VectorTools::contains(edgeIds, (int)speciesId))
       continue;
 
-// #pragma GCC diagnostic push
-// #pragma GCC diagnostic ignored "-Wdelete-non-abstract-non-virtual-dtor" //Disable warning coming from Eigen because of non-virtual destructor.
-    vector<RowLik> substitutionsForCurrentNode(nbTypes);
-// #pragma GCC diagnostic pop
-    for (auto& sub : substitutionsForCurrentNode)
-    {
-      sub = RowLik::Zero((int)nbDistinctSites);
-    }
+    vBranches.push_back(br);
+    vSpeciesIds.push_back(speciesId);
+    vEdgeData.push_back(vector<vector<EdgeCountData>>(nbClasses));
 
     for (size_t ncl = 0; ncl < nbClasses; ncl++)
     {
       processTree = rltc.getTreeNode(ncl);
-      double pr = sp.getProbabilityForModel(ncl);
-
-      vector<RowLik> substitutionsForCurrentClass(nbTypes);
-      for (auto& sub:substitutionsForCurrentClass)
-      {
-        sub = RowLik::Zero((int)nbDistinctSites);
-      }
 
       const auto& dagIndexes = rltc.getEdgesIds(speciesId, ncl);
 
-      Eigen::MatrixXd npxy;
-
-      // Sum on all dag edges for this speciesId
       for (auto id : dagIndexes)
       {
         auto edge = processTree->getEdge(id);
@@ -214,97 +227,203 @@ unique_ptr<ProbabilisticSubstitutionMapping> SubstitutionMappingTools::computeCo
           sm = dynamic_pointer_cast<const SubstitutionModelInterface>(ttm->getNModel(nmod));
         }
 
-        auto subCount = mModCount[sm.get()];
-
-        const auto& likelihoodsTopEdge = rltc.getBackwardLikelihoodsAtEdgeForClass(id, ncl)->targetValue();
-
         auto sonid = rltc.getForwardLikelihoodTree(ncl)->getSon(id);
         auto fatid = rltc.getForwardLikelihoodTree(ncl)->getFatherOfEdge(id);
 
-        const auto& likelihoodsBotEdge = rltc.getForwardLikelihoodsAtNodeForClass(sonid, ncl)->targetValue();
+        EdgeCountData ecd;
+        ecd.model = sm.get();
+        ecd.brLen = edge->getBrLen()->getValue();
+        ecd.pxy = &edge->getTransitionMatrix()->targetValue();
+        ecd.likelihoodsTopEdge = &rltc.getBackwardLikelihoodsAtEdgeForClass(id, ncl)->targetValue();
+        ecd.likelihoodsBotEdge = &rltc.getForwardLikelihoodsAtNodeForClass(sonid, ncl)->targetValue();
+        ecd.likelihoodsFather = &rltc.getLikelihoodsAtNodeForClass(fatid, ncl)->targetValue();
+        ecd.probaFather = probaDAG.getProbaAtNode(fatid);
 
-        const Eigen::MatrixXd& pxy = edge->getTransitionMatrix()->targetValue();
+        vEdgeData.back()[ncl].push_back(ecd);
+      }
+    }
+  }
 
-        const auto& likelihoodsFather = rltc.getLikelihoodsAtNodeForClass(fatid, ncl)->targetValue();
+  /*
+   * Substitution counts (and the models they rely on) keep mutable
+   * caches, so each thread works on its own copies.
+   */
 
-        for (size_t t = 0; t < nbTypes; ++t)
-        {
-          // compute all nxy * pxy first:
+  size_t nbThreads = 1;
+#ifdef _OPENMP
+  nbThreads = static_cast<size_t>(omp_get_max_threads());
+#endif
+
+  vector<map<const SubstitutionModelInterface*, shared_ptr<SubstitutionCountInterface>>> vModCount(nbThreads);
+  vModCount[0] = mModCount;
+  for (size_t th = 1; th < nbThreads; th++)
+  {
+    for (const auto& modCount : mModCount)
+    {
+      shared_ptr<const SubstitutionModelInterface> sm(modCount.first->clone());
+      vModCount[th][modCount.first] = shared_ptr<SubstitutionCountInterface>(substitutionCount.clone());
+      vModCount[th][modCount.first]->setSubstitutionModel(sm);
+    }
+  }
 
-          subCount->storeAllNumbersOfSubstitutions(edge->getBrLen()->getValue(), t + 1, npxy);
+  vector<double> vClassProbas(nbClasses);
+  for (size_t ncl = 0; ncl < nbClasses; ncl++)
+  {
+    vClassProbas[ncl] = sp.getProbabilityForModel(ncl);
+  }
 
-          npxy.array() *= pxy.array();
+  size_t nbBranches = vBranches.size();
+  size_t nbDone = 0;
+  string errorMessage = "";
 
-          // Now loop over sites:
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (size_t nbr = 0; nbr < nbBranches; nbr++)
+  {
+    size_t th = 0;
+#ifdef _OPENMP
+    th = static_cast<size_t>(omp_get_thread_num());
+#endif
 
-          auto counts = npxy * likelihoodsBotEdge;
+    try
+    {
+      auto& mThreadModCount = vModCount[th];
 
-          auto bb = (cwise(likelihoodsTopEdge) * cwise(counts)).colwise().sum();
+      vector<RowLik> substitutionsForCurrentNode(nbTypes);
+      for (auto& sub : substitutionsForCurrentNode)
+      {
+        sub = RowLik::Zero((int)nbDistinctSites);
+      }
 
-          Eigen::VectorXd ff(likelihoodsBotEdge.cols());
-          switch (unresolvedOption)
-          {
-          case SubstitutionMappingTools::UNRESOLVED_ZERO:
-          case SubstitutionMappingTools::UNRESOLVED_AVERAGE:
+      Eigen::MatrixXd npxy;
 
-            // Nullify counts where sum likelihoods > 1 : ie unknown
-            for (auto i = 0; i < ff.size(); i++)
-            {
-              const DataLik s = likelihoodsBotEdge.col(i).sum();
-              if (s >= 2.)
-                ff[i] = (unresolvedOption == SubstitutionMappingTools::UNRESOLVED_ZERO) ? 0. : 1. / convert(s);
-              else
-                ff[i] = 1;
-            }
+      for (size_t ncl = 0; ncl < nbClasses; ncl++)
+      {
+        vector<RowLik> substitutionsForCurrentClass(nbTypes);
+        for (auto& sub:substitutionsForCurrentClass)
+        {
+          sub = RowLik::Zero((int)nbDistinctSites);
+        }
 
-            bb *= ff.array();
-          default:
-            ;
+        // Sum on all dag edges for this speciesId
+        for (const auto& ecd : vEdgeData[nbr][ncl])
+        {
+          auto subCount = mThreadModCount[ecd.model];
+
+          const auto& likelihoodsTopEdge = *ecd.likelihoodsTopEdge;
+          const auto& likelihoodsBotEdge = *ecd.likelihoodsBotEdge;
+          const auto& likelihoodsFather = *ecd.likelihoodsFather;
+
+          // Nullify counts where sum likelihoods > 1 : ie unknown
+          Eigen::VectorXd ff;
+          if (unresolvedOption == SubstitutionMappingTools::UNRESOLVED_ZERO
+              || unresolvedOption == SubstitutionMappingTools::UNRESOLVED_AVERAGE)
+          {
+            Eigen::VectorXd s = likelihoodsBotEdge.float_part().colwise().sum().transpose()
+                                * constexpr_power<double>(ExtendedFloat::radix, likelihoodsBotEdge.exponent_part());
+            Eigen::VectorXd unres = (unresolvedOption == SubstitutionMappingTools::UNRESOLVED_ZERO)
+                                    ? Eigen::VectorXd(Eigen::VectorXd::Zero(s.size()))
+                                    : Eigen::VectorXd(s.cwiseInverse());
+            ff = (s.array() >= 2.).select(unres.array(), 1.).matrix();
           }
 
-          // Normalizes by likelihood on this node
-          auto cc = bb / cwise(likelihoodsFather);
+          for (size_t t = 0; t < nbTypes; ++t)
+          {
+            // compute all nxy * pxy first:
 
-          // adds, with branch ponderation  ( * edge / edge * father) probs
-          cwise(substitutionsForCurrentClass[t]) += cc * probaDAG.getProbaAtNode(fatid);
+            subCount->storeAllNumbersOfSubstitutions(ecd.brLen, t + 1, npxy);
+
+            npxy.array() *= ecd.pxy->array();
+
+            // Now all sites at once:
+
+            auto counts = npxy * likelihoodsBotEdge;
+
+            auto bb = (cwise(likelihoodsTopEdge) * cwise(counts)).colwise().sum();
+
+            if (ff.size() != 0)
+              bb *= ff.array();
+
+            // Normalizes by likelihood on this node
+            auto cc = bb / cwise(likelihoodsFather);
+
+            // adds, with branch ponderation  ( * edge / edge * father) probs
+            cwise(substitutionsForCurrentClass[t]) += cc * ecd.probaFather;
+          }
         }
-      }
 
-      // sum for all rate classes, with class ponderation
-      for (size_t t = 0; t < nbTypes; ++t)
-      {
-        substitutionsForCurrentNode[t] += substitutionsForCurrentClass[t] * pr;
+        // sum for all rate classes, with class ponderation
+        for (size_t t = 0; t < nbTypes; ++t)
+        {
+          substitutionsForCurrentNode[t] += substitutionsForCurrentClass[t] * vClassProbas[ncl];
+        }
       }
-    }
 
-    // Now we just have to copy the substitutions into the result vector:
+      // Now we just have to copy the substitutions into the result vector:
+
+      auto& br = vBranches[nbr];
+      uint speciesId = vSpeciesIds[nbr];
 
-    for (size_t i = 0; i < nbDistinctSites; ++i)
-    {
       for (size_t t = 0; t < nbTypes; ++t)
       {
-        double x = convert(substitutionsForCurrentNode[t](Eigen::Index(i)));
-        if (std::isnan(x) || std::isinf(x))
-        {
-          if (verbose)
-            ApplicationTools::displayWarning("On branch " + TextTools::toString(speciesId) + ", site index " + TextTools::toString(i) + ", and type " + TextTools::toString(t) + ", counts could not be computed.");
-          (*br)(i, t) = 0;
-        }
-        else
+        Eigen::RowVectorXd x = substitutionsForCurrentNode[t].float_part()
+                               * constexpr_power<double>(ExtendedFloat::radix, substitutionsForCurrentNode[t].exponent_part());
+
+        for (size_t i = 0; i < nbDistinctSites; ++i)
         {
-          if (threshold >= 0 && x > threshold)
+          double xi = x(Eigen::Index(i));
+          if (std::isnan(xi) || std::isinf(xi))
           {
             if (verbose)
-              ApplicationTools::displayWarning("On branch " + TextTools::toString(speciesId) + ", site index" + TextTools::toString(i) + ", and type " + TextTools::toString(t) + " count has been ignored because it is presumably saturated.");
+            {
+#ifdef _OPENMP
+#pragma omp critical (SubstitutionMappingTools_computeCounts_display)
+#endif
+              ApplicationTools::displayWarning("On branch " + TextTools::toString(speciesId) + ", site index " + TextTools::toString(i) + ", and type " + TextTools::toString(t) + ", counts could not be computed.");
+            }
             (*br)(i, t) = 0;
           }
           else
-            (*br)(i, t) = x;
+          {
+            if (threshold >= 0 && xi > threshold)
+            {
+              if (verbose)
+              {
+#ifdef _OPENMP
+#pragma omp critical (SubstitutionMappingTools_computeCounts_display)
+#endif
+                ApplicationTools::displayWarning("On branch " + TextTools::toString(speciesId) + ", site index" + TextTools::toString(i) + ", and type " + TextTools::toString(t) + " count has been ignored because it is presumably saturated.");
+              }
+              (*br)(i, t) = 0;
+            }
+            else
+              (*br)(i, t) = xi;
+          }
         }
       }
     }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (SubstitutionMappingTools_computeCounts_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = e.what();
+    }
+
+    if (verbose)
+    {
+#ifdef _OPENMP
+#pragma omp critical (SubstitutionMappingTools_computeCounts_display)
+#endif
+      ApplicationTools::displayGauge(nbDone++, nbBranches - 1);
+    }
   } // end of loop on branches
 
+  if (errorMessage != "")
+    throw Exception("SubstitutionMappingTools::computeCounts : " + errorMessage);
+
   if (verbose)
   {
     if (ApplicationTools::message)
@@ -1392,6 +1511,61 @@ void SubstitutionMappingTools::outputPerSitePerBranchPerType(
 }
 
 
+/**************************************************************************************************/
+
+namespace
+{
+vector<string> getTypeNames(const SubstitutionRegisterInterface& reg)
+{
+  vector<string> typeNames(reg.getNumberOfSubstitutionTypes());
+  for (size_t i = 0; i < typeNames.size(); ++i)
+  {
+    typeNames[i] = reg.getTypeName(i + 1);
+    if (typeNames[i] == "")
+      typeNames[i] = TextTools::toString(i + 1);
+  }
+  return typeNames;
+}
+
+vector<int> getCoordinates(const AlignmentDataInterface& sites)
+{
+  vector<int> coordinates(sites.getNumberOfSites());
+  for (size_t i = 0; i < coordinates.size(); ++i)
+  {
+    coordinates[i] = sites.site(i).getCoordinate();
+  }
+  return coordinates;
+}
+}
+
+void SubstitutionMappingTools::outputPerSitePerBranchPerTypeBinary(
+    const string& filename,
+    const vector<uint>& ids,
+    const SubstitutionRegisterInterface& reg,
+    const AlignmentDataInterface& sites,
+    const VVVdouble& counts,
+    short valueSize,
+    short compression)
+{
+  ApplicationTools::displayResult("Output counts to binary file", filename);
+  ColumnarMappingFormat::write(filename, counts, ids, getTypeNames(reg), getCoordinates(sites), valueSize, compression);
+}
+
+/**************************************************************************************************/
+
+void SubstitutionMappingTools::outputMappingBinary(
+    const string& filename,
+    const ProbabilisticSubstitutionMapping& mapping,
+    const vector<uint>& ids,
+    const SubstitutionRegisterInterface& reg,
+    const AlignmentDataInterface& sites,
+    short valueSize,
+    short compression)
+{
+  ApplicationTools::displayResult("Output mapping to binary file", filename);
+  ColumnarMappingFormat::write(filename, mapping, ids, getTypeNames(reg), getCoordinates(sites), valueSize, compression);
+}
+
 /**************************************************************************************************/
 
 void SubstitutionMappingTools::writeToStream(
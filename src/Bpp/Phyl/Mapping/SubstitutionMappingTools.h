@@ -9,6 +9,7 @@
 
 #include "../Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h"
 #include "BranchedModelSet.h"
+#include "ColumnarMappingFormat.h"
 #include "OneJumpSubstitutionCount.h"
 #include "ProbabilisticSubstitutionMapping.h"
 #include "SubstitutionCount.h"
@@ -673,6 +674,45 @@ public:
       const AlignmentDataInterface& sites,
       const VVVdouble& counts);
 
+  /**
+   * @brief Output Per Site Per Branch Per Type, in a single binary
+   * file (see ColumnarMappingFormat).
+   *
+   * @param filename    The file to write.
+   * @param ids         The ids of the branches.
+   * @param reg         The register of the types.
+   * @param sites       The sites, for their coordinates.
+   * @param counts      The counts, indexed [site][branch][type].
+   * @param valueSize   ColumnarMappingFormat::FLOAT32 or ColumnarMappingFormat::FLOAT64.
+   * @param compression ColumnarMappingFormat::NO_COMPRESSION or ColumnarMappingFormat::ZLIB_COMPRESSION.
+   */
+  static void outputPerSitePerBranchPerTypeBinary(const std::string& filename,
+      const std::vector<uint>& ids,
+      const SubstitutionRegisterInterface& reg,
+      const AlignmentDataInterface& sites,
+      const VVVdouble& counts,
+      short valueSize = ColumnarMappingFormat::FLOAT32,
+      short compression = ColumnarMappingFormat::NO_COMPRESSION);
+
+  /**
+   * @brief Output a mapping in a single binary file (see
+   * ColumnarMappingFormat), keeping the site patterns.
+   *
+   * @param filename    The file to write.
+   * @param mapping     The mapping.
+   * @param ids         The ids of the branches.
+   * @param reg         The register of the types.
+   * @param sites       The sites, for their coordinates.
+   * @param valueSize   ColumnarMappingFormat::FLOAT32 or ColumnarMappingFormat::FLOAT64.
+   * @param compression ColumnarMappingFormat::NO_COMPRESSION or ColumnarMappingFormat::ZLIB_COMPRESSION.
+   */
+  static void outputMappingBinary(const std::string& filename,
+      const ProbabilisticSubstitutionMapping& mapping,
+      const std::vector<uint>& ids,
+      const SubstitutionRegisterInterface& reg,
+      const AlignmentDataInterface& sites,
+      short valueSize = ColumnarMappingFormat::FLOAT32,
+      short compression = ColumnarMappingFormat::NO_COMPRESSION);
 
   /**
    * @brief Write the substitutions std::vectors to a stream.
@@ -2,6 +2,7 @@
 //
 // SPDX-License-Identifier: CECILL-2.1
 
+#include <map>
 #include <vector>
 
 #include "Bpp/Numeric/Matrix/MatrixTools.h"
@@ -26,6 +27,7 @@ UniformizationSubstitutionCount::UniformizationSubstitutionCount(
   bMatrices_(reg->getNumberOfSubstitutionTypes()),
   power_(),
   s_(reg->getNumberOfSubstitutionTypes()),
+  powersKey_(),
   miu_(0),
   counts_(reg->getNumberOfSubstitutionTypes()),
   currentLength_(0)
@@ -63,6 +65,7 @@ UniformizationSubstitutionCount::UniformizationSubstitutionCount(
   bMatrices_(reg->getNumberOfSubstitutionTypes()),
   power_(),
   s_(reg->getNumberOfSubstitutionTypes()),
+  powersKey_(),
   miu_(0),
   counts_(reg->getNumberOfSubstitutionTypes()),
   currentLength_(0)
@@ -76,6 +79,17 @@ void UniformizationSubstitutionCount::resetBMatrices_()
   bMatrices_.resize(nbTypes);
   counts_.resize(nbTypes);
   s_.resize(nbTypes);
+  resetPowers_();
+}
+
+void UniformizationSubstitutionCount::resetPowers_() const
+{
+  power_.clear();
+  for (auto& si : s_)
+  {
+    si.clear();
+  }
+  powersKey_ = "";
 }
 
 
@@ -84,26 +98,33 @@ void UniformizationSubstitutionCount::initBMatrices_()
   // Re-initialize all B matrices according to substitution register.
   for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i)
   {
-    bMatrices_[i].resize(nbStates_, nbStates_);
+    bMatrices_[i].resize(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
     counts_[i].resize(nbStates_, nbStates_);
   }
 }
 
 void UniformizationSubstitutionCount::fillBMatrices_()
 {
-  vector<int> supportedStates = model_->getAlphabetStates();
-  for (size_t j = 0; j < nbStates_; ++j)
+  // Only the non-zero rates of the generator are registered:
+  const auto& generator = model_->sparseGenerator();
+  vector< vector< Eigen::Triplet<double>>> triplets(bMatrices_.size());
+  for (Eigen::Index j = 0; j < generator.outerSize(); ++j)
   {
-    for (size_t k = 0; k < nbStates_; ++k)
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(generator, j); it; ++it)
     {
-      size_t i = register_->getType(j, k);
-      if (i > 0 && k != j)
-      {
-        bMatrices_[i - 1](j, k) = model_->Qij(j, k);
-      }
+      size_t k = size_t(it.col());
+      size_t i = register_->getType(size_t(j), k);
+      if (i > 0 && k != size_t(j))
+        triplets[i - 1].push_back(Eigen::Triplet<double>(static_cast<int>(j), static_cast<int>(k), it.value()));
     }
   }
 
+  for (size_t i = 0; i < bMatrices_.size(); ++i)
+  {
+    bMatrices_[i].resize(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
+    bMatrices_[i].setFromTriplets(triplets[i].begin(), triplets[i].end());
+  }
+
   if (distances_)
     setDistanceBMatrices_();
 }
@@ -111,14 +132,13 @@ void UniformizationSubstitutionCount::fillBMatrices_()
 void UniformizationSubstitutionCount::setDistanceBMatrices_()
 {
   vector<int> supportedStates = model_->getAlphabetStates();
-  for (size_t j = 0; j < nbStates_; ++j)
+  for (auto& bMatrix : bMatrices_)
   {
-    for (size_t k = 0; k < nbStates_; ++k)
+    for (Eigen::Index j = 0; j < bMatrix.outerSize(); ++j)
     {
-      size_t i = register_->getType(j, k);
-      if (i > 0 && k != j)
+      for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(bMatrix, j); it; ++it)
       {
-        bMatrices_[i - 1](j, k) *= distances_->getIndex(supportedStates[j], supportedStates[k]);
+        it.valueRef() *= distances_->getIndex(supportedStates[size_t(j)], supportedStates[size_t(it.col())]);
       }
     }
   }
@@ -127,47 +147,88 @@ void UniformizationSubstitutionCount::setDistanceBMatrices_()
 
 /******************************************************************************/
 
-void UniformizationSubstitutionCount::computeCounts_(double length) const
+void UniformizationSubstitutionCount::computePowers_(size_t nMax) const
 {
-  double lam = miu_ * length;
-  RowMatrix<double> I;
-  MatrixTools::getId(nbStates_, I);
-  RowMatrix<double> R(model_->generator());
-  MatrixTools::scale(R, 1. / miu_);
-  MatrixTools::add(R, I);
+  // Powers computed for another state of the model are discarded
+  string key = SubstitutionCountCache::makeModelKey(*model_);
+  if (key != powersKey_)
+  {
+    resetPowers_();
+    powersKey_ = key;
+  }
 
-  // compute the stopping point
-  // use the tail of Poisson distribution
-  // can be approximated by 4 + 6 * sqrt(lam) + lam
-  size_t nMax = static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam));
+  if (power_.size() > nMax)
+    return;
+
+  // R = I + Q / miu, as sparse as the generator
+  const auto n = Eigen::Index(nbStates_);
+  Eigen::SparseMatrix<double, Eigen::RowMajor> I(n, n);
+  I.setIdentity();
+  Eigen::SparseMatrix<double, Eigen::RowMajor> R = model_->sparseGenerator() * (1. / miu_) + I;
 
   // compute the powers of R
+  size_t n0 = power_.size();
   power_.resize(nMax + 1);
-  power_[0] = I;
-  for (size_t i = 1; i < nMax + 1; ++i)
+  if (n0 == 0)
   {
-    MatrixTools::mult(power_[i - 1], R, power_[i]);
+    power_[0] = Eigen::MatrixXd::Identity(n, n);
+    n0 = 1;
+  }
+  for (size_t i = n0; i < nMax + 1; ++i)
+  {
+    power_[i] = power_[i - 1] * R;
   }
 
   for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i)
   {
+    size_t l0 = s_[i].size();
     s_[i].resize(nMax + 1);
-    MatrixTools::mult(bMatrices_[i], power_[0], s_[i][0]);
-    RowMatrix<double> tmp(nbStates_, nbStates_);
-    for (size_t l = 1; l < nMax + 1; ++l)
+    if (l0 == 0)
     {
-      MatrixTools::mult(R, s_[i][l - 1], s_[i][l]);
-      MatrixTools::mult(bMatrices_[i], power_[l], tmp);
-      MatrixTools::add(s_[i][l], tmp);
+      s_[i][0] = Eigen::MatrixXd(bMatrices_[i]);
+      l0 = 1;
     }
-    MatrixTools::fill(counts_[i], 0);
+    for (size_t l = l0; l < nMax + 1; ++l)
+    {
+      s_[i][l].noalias() = R * s_[i][l - 1];
+      s_[i][l].noalias() += bMatrices_[i] * power_[l];
+    }
+  }
+}
+
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::computeCounts_(double length) const
+{
+  string key = SubstitutionCountCache::makeKey(*model_, length);
+  if (cache_->get(key, counts_))
+    return;
+
+  double lam = miu_ * length;
+
+  // compute the stopping point
+  // use the tail of Poisson distribution
+  // can be approximated by 4 + 6 * sqrt(lam) + lam
+  size_t nMax = static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam));
+
+  computePowers_(nMax);
+
+  Eigen::MatrixXd tmp;
+  for (size_t i = 0; i < register_->getNumberOfSubstitutionTypes(); ++i)
+  {
+    tmp.setZero(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
     for (size_t l = 0; l < nMax + 1; ++l)
     {
-      tmp = s_[i][l];
       // double f = (pow(lam, static_cast<double>(l + 1)) * exp(-lam) / static_cast<double>(NumTools::fact(l + 1))) / miu_;
       double logF = static_cast<double>(l + 1) * log(lam) - lam - log(miu_) - NumTools::logFact(static_cast<double>(l + 1));
-      MatrixTools::scale(tmp, exp(logF));
-      MatrixTools::add(counts_[i], tmp);
+      tmp += exp(logF) * s_[i][l];
+    }
+    for (size_t j = 0; j < nbStates_; j++)
+    {
+      for (size_t k = 0; k < nbStates_; k++)
+      {
+        counts_[i](j, k) = tmp(Eigen::Index(j), Eigen::Index(k));
+      }
     }
   }
 
@@ -188,6 +249,24 @@ void UniformizationSubstitutionCount::computeCounts_(double length) const
       }
     }
   }
+
+  cache_->set(key, counts_);
+}
+
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::storeCounts_(size_t type, Eigen::MatrixXd& mat) const
+{
+  mat.resize(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
+
+  const auto& ct = counts_[type - 1];
+  for (size_t i = 0; i < nbStates_; i++)
+  {
+    for (size_t j = 0; j < nbStates_; j++)
+    {
+      mat(Eigen::Index(i), Eigen::Index(j)) = isnan(ct(i, j)) ? 0 : ct(i, j);
+    }
+  }
 }
 
 /******************************************************************************/
@@ -222,15 +301,59 @@ void UniformizationSubstitutionCount::storeAllNumbersOfSubstitutions(double leng
     currentLength_ = length;
   }
 
-  mat.resize(Eigen::Index(nbStates_), Eigen::Index(nbStates_));
+  storeCounts_(type, mat);
+}
 
-  const auto& ct = counts_[type - 1];
-  for (size_t i = 0; i < nbStates_; i++)
+/******************************************************************************/
+
+void UniformizationSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths(const vector<double>& lengths, vector<vector<Eigen::MatrixXd>>& mats) const
+{
+  if (!model_)
+    throw Exception("UniformizationSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths: model not defined.");
+
+  size_t nbTypes = register_->getNumberOfSubstitutionTypes();
+  mats.resize(lengths.size());
+
+  if (lengths.size() == 0)
+    return;
+
+  // Powers are computed once, for the longest branch
+  double maxLength = VectorTools::max(lengths);
+  if (maxLength < 0)
+    throw Exception("UniformizationSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths. Negative branch length: " + TextTools::toString(maxLength) + ".");
+
+  double lam = miu_ * maxLength;
+  computePowers_(static_cast<size_t>(ceil(4 + 6 * sqrt(lam) + lam)));
+
+  // Position of the first occurence of each length
+  map<double, size_t> done;
+
+  for (size_t l = 0; l < lengths.size(); ++l)
   {
-    for (size_t j = 0; j < nbStates_; j++)
+    double length = lengths[l];
+    if (length < 0)
+      throw Exception("UniformizationSubstitutionCount::storeAllNumbersOfSubstitutionsForLengths. Negative branch length: " + TextTools::toString(length) + ".");
+
+    auto it = done.find(length);
+    if (it != done.end())
     {
-      mat(Eigen::Index(i), Eigen::Index(j)) = isnan(ct(i, j)) ? 0 : ct(i, j);
+      mats[l] = mats[it->second];
+      continue;
+    }
+
+    if (length != currentLength_)
+    {
+      computeCounts_(length);
+      currentLength_ = length;
     }
+
+    mats[l].resize(nbTypes);
+    for (size_t t = 0; t < nbTypes; ++t)
+    {
+      storeCounts_(t + 1, mats[l][t]);
+    }
+
+    done[length] = l;
   }
 }
 
@@ -295,6 +418,7 @@ void UniformizationSubstitutionCount::setSubstitutionModel(
     initBMatrices_();
   }
   fillBMatrices_();
+  resetPowers_();
 
   miu_ = 0;
   for (size_t i = 0; i < nbStates_; ++i)
@@ -336,6 +460,8 @@ void UniformizationSubstitutionCount::substitutionRegisterHasChanged()
 
 void UniformizationSubstitutionCount::weightsHaveChanged()
 {
+  resetCache_();
+
   if (!model_)
     return;
 
@@ -349,6 +475,8 @@ void UniformizationSubstitutionCount::weightsHaveChanged()
 
 void UniformizationSubstitutionCount::distancesHaveChanged()
 {
+  resetCache_();
+
   if (!model_)
     return;
 
@@ -357,6 +485,7 @@ void UniformizationSubstitutionCount::distancesHaveChanged()
 
   // Recompute counts:
   setDistanceBMatrices_();
+  resetPowers_();
 
   if (currentLength_ > 0)
     computeCounts_(currentLength_);
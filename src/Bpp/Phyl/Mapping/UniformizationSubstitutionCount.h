@@ -27,9 +27,26 @@ class UniformizationSubstitutionCount :
 private:
   std::shared_ptr<const SubstitutionModelInterface> model_;
   size_t nbStates_;
-  std::vector< RowMatrix<double>> bMatrices_;
-  mutable std::vector< RowMatrix<double>> power_;
-  mutable std::vector< std::vector< RowMatrix<double>>> s_;
+
+  /**
+   * @brief The rates of the registered substitutions, per type, with
+   * only the non-zero rates of the generator.
+   */
+  std::vector< Eigen::SparseMatrix<double, Eigen::RowMajor>> bMatrices_;
+
+  /**
+   * @brief Powers of the uniformized matrix, and the matching sums
+   * used for the counts. They do not depend on the branch length, so
+   * they are kept and extended as longer branches are met, as long
+   * as the model is not modified (see powersKey_).
+   *
+   * As the uniformized matrix is as sparse as the generator, each
+   * power costs a number of operations proportional to the number of
+   * states times the number of non-zero rates.
+   */
+  mutable std::vector< Eigen::MatrixXd> power_;
+  mutable std::vector< std::vector< Eigen::MatrixXd>> s_;
+  mutable std::string powersKey_;
   double miu_;
   mutable std::vector< RowMatrix<double>> counts_;
   mutable double currentLength_;
@@ -56,6 +73,7 @@ public:
     bMatrices_(usc.bMatrices_),
     power_(usc.power_),
     s_(usc.s_),
+    powersKey_(usc.powersKey_),
     miu_(usc.miu_),
     counts_(usc.counts_),
     currentLength_(usc.currentLength_)
@@ -71,6 +89,7 @@ public:
     bMatrices_      = usc.bMatrices_;
     power_          = usc.power_;
     s_              = usc.s_;
+    powersKey_      = usc.powersKey_;
     miu_            = usc.miu_;
     counts_         = usc.counts_;
     currentLength_  = usc.currentLength_;
@@ -88,18 +107,37 @@ public:
 
   void storeAllNumbersOfSubstitutions(double length, size_t type, Eigen::MatrixXd& mat) const override;
 
+  /**
+   * @brief Stores the numbers of substitutions for a set of branch
+   * lengths, for all types.
+   *
+   * The powers of the uniformized matrix are computed once, up to
+   * the order needed by the longest branch, and shared by all
+   * lengths.
+   */
+  void storeAllNumbersOfSubstitutionsForLengths(const std::vector<double>& lengths, std::vector<std::vector<Eigen::MatrixXd>>& mats) const override;
+
   std::vector<double> getNumberOfSubstitutionsPerType(size_t initialState, size_t finalState, double length) const override;
 
   void setSubstitutionModel(std::shared_ptr<const SubstitutionModelInterface> model) override;
 
 protected:
   void computeCounts_(double length) const;
+
+  /**
+   * @brief Compute the powers of the uniformized matrix, and the
+   * matching sums, up to order nMax.
+   */
+  void computePowers_(size_t nMax) const;
+
+  void storeCounts_(size_t type, Eigen::MatrixXd& mat) const;
   void substitutionRegisterHasChanged() override;
   void weightsHaveChanged() override;
   void distancesHaveChanged() override;
 
 private:
   void resetBMatrices_();
+  void resetPowers_() const;
   void initBMatrices_();
   void fillBMatrices_();
 
@@ -114,6 +114,11 @@ public:
     return mixedModel().getNRate(i);
   }
 
+  size_t getNumberOfEigenDecompositions() const override
+  {
+    return mixedModel().getNumberOfEigenDecompositions();
+  }
+
   /**
    * @brief retrieve a pointer to the submodel with the given name.
    *
@@ -18,7 +18,8 @@ AbstractMixedTransitionModel::AbstractMixedTransitionModel(
   AbstractTransitionModel(alpha, stateMap, prefix),
   modelsContainer_(),
   vProbas_(),
-  vRates_()
+  vRates_(),
+  nbEigenDecompositions_(0)
 {}
 
 AbstractMixedTransitionModel::AbstractMixedTransitionModel(const AbstractMixedTransitionModel& msm) :
@@ -26,7 +27,8 @@ AbstractMixedTransitionModel::AbstractMixedTransitionModel(const AbstractMixedTr
   AbstractTransitionModel(msm),
   modelsContainer_(),
   vProbas_(),
-  vRates_()
+  vRates_(),
+  nbEigenDecompositions_(msm.nbEigenDecompositions_)
 {
   for (size_t i = 0; i < msm.modelsContainer_.size(); ++i)
   {
@@ -51,10 +53,35 @@ AbstractMixedTransitionModel& AbstractMixedTransitionModel::operator=(const Abst
     vProbas_.push_back(model.vProbas_[i]);
     vRates_.push_back(model.vRates_[i]);
   }
+  nbEigenDecompositions_ = model.nbEigenDecompositions_;
 
   return *this;
 }
 
+void AbstractMixedTransitionModel::updateNModel_(size_t i, const ParameterList& parameters)
+{
+  auto model = dynamic_cast<AbstractSubstitutionModel*>(modelsContainer_[i].get());
+  if (!model)
+  {
+    modelsContainer_[i]->matchParametersValues(parameters);
+    return;
+  }
+
+  vector<const AbstractSubstitutionModel*> donors;
+  for (size_t j = 0; j < i; ++j)
+  {
+    auto donor = dynamic_cast<const AbstractSubstitutionModel*>(modelsContainer_[j].get());
+    if (donor)
+      donors.push_back(donor);
+  }
+
+  size_t nbDecompositions = model->getNumberOfEigenDecompositions();
+  model->setEigenDecompositionDonors(donors);
+  model->matchParametersValues(parameters);
+  model->setEigenDecompositionDonors(vector<const AbstractSubstitutionModel*>());
+  nbEigenDecompositions_ += model->getNumberOfEigenDecompositions() - nbDecompositions;
+}
+
 const Matrix<double>& AbstractMixedTransitionModel::getPij_t(double t) const
 {
   vector<const Matrix<double>* > vM;
@@ -59,6 +59,12 @@ protected:
    */
   std::vector<double> vRates_;
 
+  /**
+   * @brief The number of eigen decompositions computed by the
+   * submodels during the last update of the mixture.
+   */
+  size_t nbEigenDecompositions_;
+
 public:
   AbstractMixedTransitionModel(
       std::shared_ptr<const Alphabet>,
@@ -204,7 +210,25 @@ public:
     setFreq(freqs);
   }
 
+  size_t getNumberOfEigenDecompositions() const override
+  {
+    return nbEigenDecompositions_;
+  }
+
 protected:
+  /**
+   * @brief Set the parameters of the ith submodel, the submodels
+   * being updated in increasing order.
+   *
+   * The submodel is updated only if one of its parameters changed.
+   * If it is a substitution model with a generator proportional to
+   * the one of a previous submodel (eg rate-scaled copies), it takes
+   * the eigen decomposition of this submodel. The computed eigen
+   * decompositions are added to nbEigenDecompositions_, to be reset
+   * before the update of the first submodel.
+   */
+  void updateNModel_(size_t i, const ParameterList& parameters);
+
   TransitionModelInterface& nModel_(size_t i) override
   {
     return *modelsContainer_[i];
@@ -13,6 +13,14 @@
 // From SeqLib:
 #include <Bpp/Seq/Container/SequenceContainerTools.h>
 
+// From Eigen:
+#include <unsupported/Eigen/MatrixFunctions>
+
+// From the STL:
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace bpp;
 using namespace std;
 
@@ -127,7 +135,12 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(
   isNonSingular_(false),
   leftEigenVectors_(size_, size_),
   vPowGen_(),
-  tmpMat_(size_, size_)
+  tmpMat_(size_, size_),
+  dpijParam_(size_, size_),
+  eigenDonors_(),
+  nbEigenDecompositions_(0),
+  expMethod_(ExponentialMethod::EIGEN),
+  sparseGenerator_()
 {}
 
 
@@ -135,41 +148,40 @@ AbstractSubstitutionModel::AbstractSubstitutionModel(
 
 void AbstractSubstitutionModel::updateMatrices_()
 {
+  sparseGenerator_.invalidate();
+
   // Compute eigen values and vectors:
   if (enableEigenDecomposition())
   {
     // Look for null lines (such as stop lines)
-    // ie null diagonal elements
+    // ie null columns, from the non-zero rates only
 
-    size_t nbStop = 0;
     size_t salph = getNumberOfStates();
-    vector<bool> vnull(salph); // vector of the indices of lines with
-                               // only zeros
+    vector<bool> vnull(salph, true); // vector of the indices of lines with
+                                     // only zeros
 
-    for (size_t i = 0; i < salph; i++)
+    const auto& sgen = sparseGenerator();
+    for (Eigen::Index i = 0; i < sgen.outerSize(); i++)
     {
-      bool flag = (abs(generator_(i, i)) < NumConstants::TINY());
-
-      if (flag)
-        for (size_t j = 0; j < salph; j++)
-        {
-          if (abs(generator_(j, i)) >= NumConstants::TINY())
-          {
-            flag = false;
-            break;
-          }
-        }
-
-      if (flag)
+      for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(sgen, i); it; ++it)
       {
-        nbStop++;
-        vnull[i] = true;
+        if (abs(it.value()) >= NumConstants::TINY())
+          vnull[size_t(it.col())] = false;
       }
-      else
-        vnull[i] = false;
     }
 
-    if (nbStop != 0)
+    size_t nbStop = static_cast<size_t>(std::count(vnull.begin(), vnull.end(), true));
+
+    // Generators proportional to the one of an up to date model share
+    // its decomposition:
+    bool copied = copyEigenDecomposition_();
+    if (!copied)
+      nbEigenDecompositions_++;
+
+    // Reversible generators are diagonalized with a symmetric solver:
+    bool symmetric = !copied && updateSymmetricEigenDecomposition_(vnull);
+
+    if (!copied && !symmetric && nbStop != 0)
     {
       size_t salphok = salph - nbStop;
 
@@ -235,7 +247,7 @@ void AbstractSubstitutionModel::updateMatrices_()
         }
       }
     }
-    else
+    else if (!copied && !symmetric)
     {
       EigenValue<double> ev(generator_);
       rightEigenVectors_ = ev.getV();
@@ -247,7 +259,8 @@ void AbstractSubstitutionModel::updateMatrices_()
     /// Now check inversion and diagonalization
     try
     {
-      MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
+      if (!copied && !symmetric)
+        MatrixTools::inv(rightEigenVectors_, leftEigenVectors_);
 
       // is it diagonalizable ?
       isDiagonalizable_ = true;
@@ -385,12 +398,182 @@ void AbstractSubstitutionModel::updateMatrices_()
     // normalization
     normalize();
 
-    if (!isNonSingular_)
+    // Pade approximants do not need the powers of the generator:
+    if (!isNonSingular_ && expMethod_ == ExponentialMethod::EIGEN)
       MatrixTools::Taylor(generator_, 30, vPowGen_);
   }
 }
 
 
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::copyEigenDecomposition_()
+{
+  size_t salph = getNumberOfStates();
+  const auto& sgen = sparseGenerator();
+  double trace = 0;
+  double maxAbs = 0;
+  for (size_t i = 0; i < salph; i++)
+  {
+    trace += generator_(i, i);
+  }
+  for (Eigen::Index k = 0; k < sgen.nonZeros(); k++)
+  {
+    maxAbs = max(maxAbs, abs(sgen.valuePtr()[k]));
+  }
+  if (trace == 0)
+    return false;
+
+  for (const auto* donor : eigenDonors_)
+  {
+    if (!donor || donor == this || donor->getNumberOfStates() != salph
+        || !donor->eigenDecompose_ || !donor->isNonSingular_
+        || donor->eigenValues_.size() != salph)
+      continue;
+
+    double dtrace = 0;
+    for (size_t i = 0; i < salph; i++)
+    {
+      dtrace += donor->generator_(i, i);
+    }
+    if (dtrace == 0)
+      continue;
+
+    // Compare the non-zero rates of both generators, row by row:
+    double scale = trace / dtrace;
+    const auto& dgen = donor->sparseGenerator();
+    bool proportional = true;
+    for (Eigen::Index i = 0; proportional && i < sgen.outerSize(); i++)
+    {
+      Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(sgen, i);
+      Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator dit(dgen, i);
+      while (it || dit)
+      {
+        double diff;
+        if (dit && (!it || dit.col() < it.col()))
+        {
+          diff = scale * dit.value();
+          ++dit;
+        }
+        else if (it && (!dit || it.col() < dit.col()))
+        {
+          diff = it.value();
+          ++it;
+        }
+        else
+        {
+          diff = it.value() - scale * dit.value();
+          ++it;
+          ++dit;
+        }
+        if (abs(diff) > NumConstants::NANO() * maxAbs)
+        {
+          proportional = false;
+          break;
+        }
+      }
+    }
+    if (!proportional)
+      continue;
+
+    eigenValues_ = donor->eigenValues_;
+    eigenValues_ *= scale;
+    iEigenValues_ = donor->iEigenValues_;
+    iEigenValues_ *= scale;
+    rightEigenVectors_ = donor->rightEigenVectors_;
+    leftEigenVectors_ = donor->leftEigenVectors_;
+    return true;
+  }
+  return false;
+}
+
+/******************************************************************************/
+
+bool AbstractSubstitutionModel::updateSymmetricEigenDecomposition_(const vector<bool>& vnull)
+{
+  size_t salph = getNumberOfStates();
+  vector<size_t> states;
+  for (size_t i = 0; i < salph; i++)
+  {
+    if (vnull[i])
+      continue;
+    if (freq_[i] < NumConstants::TINY())
+      return false;
+    states.push_back(i);
+  }
+  size_t n = states.size();
+
+  // Check detailed balance: pi_i Q_ij = pi_j Q_ji
+  for (size_t k = 0; k < n; k++)
+  {
+    for (size_t l = k + 1; l < n; l++)
+    {
+      double a = freq_[states[k]] * generator_(states[k], states[l]);
+      double b = freq_[states[l]] * generator_(states[l], states[k]);
+      if (abs(a - b) > NumConstants::NANO() * max(abs(a), abs(b)))
+        return false;
+    }
+  }
+
+  // Symmetrized generator, exactly symmetric so that the symmetric solver is used:
+  vector<double> sqrtFreq(n);
+  for (size_t k = 0; k < n; k++)
+  {
+    sqrtFreq[k] = sqrt(freq_[states[k]]);
+  }
+  RowMatrix<double> sym(n, n);
+  for (size_t k = 0; k < n; k++)
+  {
+    sym(k, k) = generator_(states[k], states[k]);
+    for (size_t l = k + 1; l < n; l++)
+    {
+      double v = (sqrtFreq[k] / sqrtFreq[l] * generator_(states[k], states[l])
+                  + sqrtFreq[l] / sqrtFreq[k] * generator_(states[l], states[k])) / 2;
+      sym(k, l) = v;
+      sym(l, k) = v;
+    }
+  }
+
+  EigenValue<double> ev(sym);
+  const Matrix<double>& u = ev.getV();
+  eigenValues_ = ev.getRealEigenValues();
+  eigenValues_.resize(salph, 0);
+  iEigenValues_.assign(salph, 0);
+
+  // Q = Pi^-1/2 U L U' Pi^1/2, with U orthogonal:
+  rightEigenVectors_.resize(salph, salph);
+  leftEigenVectors_.resize(salph, salph);
+  for (size_t i = 0; i < salph; i++)
+  {
+    for (size_t j = 0; j < salph; j++)
+    {
+      rightEigenVectors_(i, j) = 0;
+      leftEigenVectors_(i, j) = 0;
+    }
+  }
+  for (size_t k = 0; k < n; k++)
+  {
+    size_t i = states[k];
+    for (size_t c = 0; c < n; c++)
+    {
+      rightEigenVectors_(i, c) = u(k, c) / sqrtFreq[k];
+      leftEigenVectors_(c, i) = u(k, c) * sqrtFreq[k];
+    }
+  }
+  // Null states get null eigen values, at the end:
+  size_t c = n;
+  for (size_t i = 0; i < salph; i++)
+  {
+    if (vnull[i])
+    {
+      rightEigenVectors_(i, c) = 1;
+      leftEigenVectors_(c, i) = 1;
+      c++;
+    }
+  }
+  return true;
+}
+
 /******************************************************************************/
 
 const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
@@ -399,6 +582,10 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
   {
     MatrixTools::getId(size_, pijt_);
   }
+  else if (usePadeExponential_())
+  {
+    computePadeExponential_(t, 0, pijt_);
+  }
   else if (isNonSingular_)
   {
     if (isDiagonalizable_)
@@ -486,7 +673,11 @@ const Matrix<double>& AbstractSubstitutionModel::getPij_t(double t) const
 
 const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
 {
-  if (isNonSingular_)
+  if (usePadeExponential_())
+  {
+    computePadeExponential_(t, 1, dpijt_);
+  }
+  else if (isNonSingular_)
   {
     if (isDiagonalizable_)
     {
@@ -557,7 +748,11 @@ const Matrix<double>& AbstractSubstitutionModel::getdPij_dt(double t) const
 
 const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
 {
-  if (isNonSingular_)
+  if (usePadeExponential_())
+  {
+    computePadeExponential_(t, 2, d2pijt_);
+  }
+  else if (isNonSingular_)
   {
     if (isDiagonalizable_)
     {
@@ -630,6 +825,304 @@ const Matrix<double>& AbstractSubstitutionModel::getd2Pij_dt2(double t) const
 
 /******************************************************************************/
 
+const Eigen::SparseMatrix<double, Eigen::RowMajor>& SparseGenerator::get(const Matrix<double>& generator)
+{
+  if (valid_.load(std::memory_order_acquire))
+    return matrix_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!valid_.load(std::memory_order_relaxed))
+  {
+    size_t n = generator.getNumberOfRows();
+
+    // Parameter updates seldom change which rates are null: the values
+    // are then refreshed in place, without allocation.
+    bool samePattern = matrix_.isCompressed() && matrix_.rows() == static_cast<Eigen::Index>(n);
+    for (size_t i = 0; samePattern && i < n; ++i)
+    {
+      auto k = matrix_.outerIndexPtr()[i];
+      auto end = matrix_.outerIndexPtr()[i + 1];
+      for (size_t j = 0; j < n; ++j)
+      {
+        if (generator(i, j) == 0)
+          continue;
+        if (k == end || matrix_.innerIndexPtr()[k] != static_cast<int>(j))
+        {
+          samePattern = false;
+          break;
+        }
+        matrix_.valuePtr()[k++] = generator(i, j);
+      }
+      if (k != end)
+        samePattern = false;
+    }
+
+    if (!samePattern)
+    {
+      vector<Eigen::Triplet<double>> triplets;
+      for (size_t i = 0; i < n; ++i)
+      {
+        for (size_t j = 0; j < n; ++j)
+        {
+          if (generator(i, j) != 0)
+            triplets.push_back(Eigen::Triplet<double>(static_cast<int>(i), static_cast<int>(j), generator(i, j)));
+        }
+      }
+      matrix_.resize(static_cast<Eigen::Index>(n), static_cast<Eigen::Index>(n));
+      matrix_.setFromTriplets(triplets.begin(), triplets.end());
+    }
+    valid_.store(true, std::memory_order_release);
+  }
+  return matrix_;
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computePadeExponential_(double t, size_t nDeriv, RowMatrix<double>& result) const
+{
+  const auto n = static_cast<Eigen::Index>(size_);
+  Eigen::MatrixXd q(n, n);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    for (Eigen::Index j = 0; j < n; ++j)
+    {
+      q(i, j) = rate_ * generator_(size_t(i), size_t(j));
+    }
+  }
+
+  // Scaling and squaring with a Pade approximant of degree up to 13
+  // (Higham, 2005, SIAM J. Matrix Anal. Appl. 26(4):1179-1193):
+  Eigen::MatrixXd a = q * t;
+  Eigen::MatrixXd p = a.exp();
+
+  // d^n/dt^n exp(r.t.Q) = (r.Q)^n exp(r.t.Q)
+  for (size_t k = 0; k < nDeriv; ++k)
+  {
+    a.noalias() = q * p;
+    p.swap(a);
+  }
+
+  result.resize(size_, size_);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    for (Eigen::Index j = 0; j < n; ++j)
+    {
+      result(size_t(i), size_t(j)) = p(i, j);
+    }
+  }
+}
+
+/******************************************************************************/
+
+namespace
+{
+/*
+ * Largest norms of the generator for which a Taylor series of degree
+ * m = 5, 10, ..., 55 reaches double precision (Al-Mohy & Higham, 2011,
+ * Table 3.1).
+ */
+const double EXPMV_THETA[] = {2.4e-3, 1.4e-1, 6.4e-1, 1.4, 2.4, 3.5, 4.7, 6.0, 7.2, 8.5, 9.9};
+}
+
+void AbstractSubstitutionModel::applyPij_t(double t, const Eigen::MatrixXd& values, Eigen::MatrixXd& result, size_t nDeriv) const
+{
+  if (nDeriv > 2)
+    throw Exception("AbstractSubstitutionModel::applyPij_t. Derivative of order " + TextTools::toString(nDeriv) + " not defined.");
+  if (values.rows() != static_cast<Eigen::Index>(size_))
+    throw Exception("AbstractSubstitutionModel::applyPij_t. Wrong number of states: " + TextTools::toString(values.rows()) + ".");
+
+  // Sparse generator, shifted by the mean of its diagonal to lower its norm:
+  const auto& sgen = sparseGenerator();
+  double mu = 0;
+  for (size_t i = 0; i < size_; ++i)
+  {
+    mu += generator_(i, i);
+  }
+  mu /= static_cast<double>(size_);
+
+  Vdouble colNorms(size_, 0.);
+  for (Eigen::Index i = 0; i < sgen.outerSize(); ++i)
+  {
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(sgen, i); it; ++it)
+    {
+      colNorms[size_t(it.col())] += abs(it.value() - (it.row() == it.col() ? mu : 0.));
+    }
+  }
+  for (size_t i = 0; i < size_; ++i)
+  {
+    if (generator_(i, i) == 0)
+      colNorms[i] += abs(mu);
+  }
+
+  const double l = rate_ * t;
+  const double norm = l * VectorTools::max(colNorms);
+
+  result = values;
+  if (l != 0 && values.cols() > 0)
+  {
+    // Degree m and number of steps s of minimal cost m.s:
+    size_t m = 0;
+    size_t s = 1;
+    double cost = numeric_limits<double>::infinity();
+    for (size_t k = 0; k < sizeof(EXPMV_THETA) / sizeof(double); ++k)
+    {
+      double sk = max(1., ceil(norm / EXPMV_THETA[k]));
+      double mk = static_cast<double>(5 * (k + 1));
+      if (mk * sk < cost)
+      {
+        cost = mk * sk;
+        m = 5 * (k + 1);
+        s = static_cast<size_t>(sk);
+      }
+    }
+
+    const double eta = exp(l * mu / static_cast<double>(s));
+    const double tol = numeric_limits<double>::epsilon() / 2;
+    Eigen::MatrixXd b = values;
+    Eigen::MatrixXd qb(b.rows(), b.cols());
+    for (size_t i = 0; i < s; ++i)
+    {
+      double c1 = b.cwiseAbs().maxCoeff();
+      for (size_t k = 1; k <= m; ++k)
+      {
+        qb.noalias() = sgen * b;
+        b = (l / static_cast<double>(s * k)) * (qb - mu * b);
+        double c2 = b.cwiseAbs().maxCoeff();
+        result += b;
+        if (c1 + c2 <= tol * result.cwiseAbs().maxCoeff())
+          break;
+        c1 = c2;
+      }
+      result *= eta;
+      b = result;
+    }
+  }
+
+  // d^n/dt^n exp(r.t.Q) = (r.Q)^n exp(r.t.Q)
+  for (size_t k = 0; k < nDeriv; ++k)
+  {
+    Eigen::MatrixXd qr = rate_ * (sgen * result);
+    result.swap(qr);
+  }
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  if (!hasGeneratorDerivative(name))
+    throw Exception("AbstractSubstitutionModel::computeGeneratorDerivative. No derivative of the generator of " + getName() + " with respect to " + name + ".");
+
+  // d(r.Q)/dr = Q
+  const auto n = static_cast<Eigen::Index>(size_);
+  derivative.resize(n, n);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    for (Eigen::Index j = 0; j < n; ++j)
+    {
+      derivative(i, j) = generator_(size_t(i), size_t(j));
+    }
+  }
+}
+
+/******************************************************************************/
+
+void AbstractSubstitutionModel::completeGeneratorDerivative_(Eigen::MatrixXd& derivative, bool normalized) const
+{
+  const auto n = static_cast<Eigen::Index>(size_);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    derivative(i, i) = 0;
+    derivative(i, i) = -derivative.row(i).sum();
+  }
+
+  if (normalized)
+  {
+    double ds = 0;
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+      ds += freq_[size_t(i)] * derivative(i, i);
+    }
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+      for (Eigen::Index j = 0; j < n; ++j)
+      {
+        derivative(i, j) += ds * generator_(size_t(i), size_t(j));
+      }
+    }
+  }
+  derivative *= rate_;
+}
+
+/******************************************************************************/
+
+const Matrix<double>& AbstractSubstitutionModel::getdPij_dparam(double t, const string& name) const
+{
+  const auto n = static_cast<Eigen::Index>(size_);
+  Eigen::MatrixXd da;
+  computeGeneratorDerivative(name, da);
+
+  Eigen::MatrixXd dp(n, n);
+  if (t == 0)
+  {
+    dp.setZero();
+  }
+  else if (eigenDecompose_ && isDiagonalizable_ && isNonSingular_ && !usePadeExponential_())
+  {
+    // Frechet derivative of the exponential in the eigen basis:
+    Eigen::MatrixXd u(n, n), v(n, n);
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+      for (Eigen::Index j = 0; j < n; ++j)
+      {
+        u(i, j) = rightEigenVectors_(size_t(i), size_t(j));
+        v(i, j) = leftEigenVectors_(size_t(i), size_t(j));
+      }
+    }
+    Eigen::MatrixXd f = v * da * u;
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+      double li = rate_ * eigenValues_[size_t(i)] * t;
+      for (Eigen::Index j = 0; j < n; ++j)
+      {
+        // (exp(t.a_i) - exp(t.a_j)) / (a_i - a_j) = t.exp(l_j).(exp(l_i - l_j) - 1) / (l_i - l_j)
+        double lj = rate_ * eigenValues_[size_t(j)] * t;
+        double x = li - lj;
+        f(i, j) *= t * exp(lj) * (x == 0 ? 1. : expm1(x) / x);
+      }
+    }
+    dp.noalias() = u * f * v;
+  }
+  else
+  {
+    // Upper right block of exp([[r.Q, d(r.Q)], [0, r.Q]] t):
+    Eigen::MatrixXd block = Eigen::MatrixXd::Zero(2 * n, 2 * n);
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+      for (Eigen::Index j = 0; j < n; ++j)
+      {
+        block(i, j) = rate_ * generator_(size_t(i), size_t(j)) * t;
+      }
+    }
+    block.bottomRightCorner(n, n) = block.topLeftCorner(n, n);
+    block.topRightCorner(n, n) = da * t;
+    Eigen::MatrixXd e = block.exp();
+    dp = e.topRightCorner(n, n);
+  }
+
+  dpijParam_.resize(size_, size_);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    for (Eigen::Index j = 0; j < n; ++j)
+    {
+      dpijParam_(size_t(i), size_t(j)) = dp(i, j);
+    }
+  }
+  return dpijParam_;
+}
+
+/******************************************************************************/
+
 double AbstractSubstitutionModel::getScale() const
 {
   vector<double> v;
@@ -644,6 +1137,7 @@ void AbstractSubstitutionModel::setScale(double scale)
   if (isScalable_)
   {
     MatrixTools::scale(generator_, scale);
+    sparseGenerator_.scale(scale);
     eigenValues_ *= scale;
     iEigenValues_ *= scale;
   }
@@ -654,6 +1148,7 @@ void AbstractSubstitutionModel::setScale(double scale)
 
 void AbstractSubstitutionModel::setDiagonal()
 {
+  sparseGenerator_.invalidate();
   for (size_t i = 0; i < size_; i++)
   {
     double lambda = 0;
@@ -7,7 +7,9 @@
 
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
 #include <Bpp/Numeric/VectorTools.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 #include "SubstitutionModel.h"
 
@@ -281,10 +283,73 @@ public:
 };
 
 
+/**
+ * @brief The generator of a model as a sparse matrix, built from the
+ * dense generator on demand.
+ *
+ * The matrix is built at the first call of get() after an
+ * invalidate(), in place if the null rates are unchanged. Concurrent
+ * calls of get() are safe, invalidate() must not be called
+ * concurrently with them. Copies are invalid.
+ */
+class SparseGenerator
+{
+private:
+  Eigen::SparseMatrix<double, Eigen::RowMajor> matrix_;
+  std::atomic<bool> valid_;
+  std::mutex mutex_;
+
+public:
+  SparseGenerator() : matrix_(), valid_(false), mutex_() {}
+
+  SparseGenerator(const SparseGenerator&) : matrix_(), valid_(false), mutex_() {}
+
+  SparseGenerator& operator=(const SparseGenerator&)
+  {
+    invalidate();
+    return *this;
+  }
+
+public:
+  /**
+   * @return The sparse matrix of the non-zero entries of generator,
+   * which must not have changed since the last invalidate().
+   */
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& get(const Matrix<double>& generator);
+
+  void invalidate() { valid_.store(false, std::memory_order_release); }
+
+  /**
+   * @brief Scale the matrix, if built, along with the dense generator.
+   */
+  void scale(double scale)
+  {
+    if (valid_.load(std::memory_order_acquire))
+      matrix_ *= scale;
+  }
+};
+
+
 class AbstractSubstitutionModel :
   public AbstractTransitionModel,
   public virtual SubstitutionModelInterface
 {
+public:
+  /**
+   * @brief Methods to compute the exponential of the generator.
+   *
+   * - EIGEN: from the eigen decomposition, or with a Taylor series if
+   *   the generator is not diagonalizable (default).
+   * - PADE: from the eigen decomposition if the generator is
+   *   diagonalizable in R, or with a Pade approximant of degree 13 and
+   *   scaling and squaring otherwise.
+   * - EXPMV: as PADE for the transition matrices, but the likelihood
+   *   computations use the action of the exponential on the
+   *   likelihood vectors, computed with a truncated Taylor series
+   *   (see applyPij_t()), without computing the transition matrices.
+   */
+  enum class ExponentialMethod { EIGEN, PADE, EXPMV };
+
 protected:
   /**
    * @brief If the model is scalable (ie generator can be normalized
@@ -356,6 +421,31 @@ protected:
    */
   mutable RowMatrix<double> tmpMat_;
 
+  /**
+   * @brief The derivative of the transition matrix with respect to a
+   * parameter (see getdPij_dparam()).
+   */
+  mutable RowMatrix<double> dpijParam_;
+
+private:
+  /**
+   * @brief Models whose eigen decomposition may be used at the next
+   * update (see setEigenDecompositionDonors()).
+   */
+  std::vector<const AbstractSubstitutionModel*> eigenDonors_;
+
+  /**
+   * @brief The number of eigen decompositions computed by this model.
+   */
+  size_t nbEigenDecompositions_;
+
+  ExponentialMethod expMethod_;
+
+  /**
+   * @brief The generator as a sparse matrix (see sparseGenerator()).
+   */
+  mutable SparseGenerator sparseGenerator_;
+
 public:
   AbstractSubstitutionModel(
       std::shared_ptr<const Alphabet> alpha,
@@ -376,7 +466,12 @@ public:
     isNonSingular_(model.isNonSingular_),
     leftEigenVectors_(model.leftEigenVectors_),
     vPowGen_(model.vPowGen_),
-    tmpMat_(model.tmpMat_)
+    tmpMat_(model.tmpMat_),
+    dpijParam_(model.dpijParam_),
+    eigenDonors_(),
+    nbEigenDecompositions_(0),
+    expMethod_(model.expMethod_),
+    sparseGenerator_(model.sparseGenerator_)
   {}
 
   AbstractSubstitutionModel& operator=(const AbstractSubstitutionModel& model)
@@ -395,6 +490,10 @@ public:
     leftEigenVectors_  = model.leftEigenVectors_;
     vPowGen_           = model.vPowGen_;
     tmpMat_            = model.tmpMat_;
+    dpijParam_         = model.dpijParam_;
+    eigenDonors_.clear();
+    expMethod_         = model.expMethod_;
+    sparseGenerator_   = model.sparseGenerator_;
     return *this;
   }
 
@@ -407,6 +506,20 @@ public:
 
   const Matrix<double>& generator() const { return generator_; }
 
+  /**
+   * @brief The sparse generator.
+   *
+   * It is built from the dense generator at the first call after an
+   * update of the matrices, and can be called from several threads.
+   * Models using an eigen decomposition build it in updateMatrices_(),
+   * to find null lines and proportional generators from the non-zero
+   * rates.
+   */
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& sparseGenerator() const
+  {
+    return sparseGenerator_.get(generator_);
+  }
+
   const Matrix<double>& exchangeabilityMatrix() const { return exchangeability_; }
 
   const Matrix<double>& getPij_t(double t) const;
@@ -431,7 +544,116 @@ public:
 
   void enableEigenDecomposition(bool yn) { eigenDecompose_ = yn; }
 
-  bool enableEigenDecomposition() { return eigenDecompose_; }
+  bool enableEigenDecomposition() const { return eigenDecompose_; }
+
+  /**
+   * @brief Offer the eigen decompositions of other models to the
+   * next update of the matrices.
+   *
+   * If the generator of one of these models is proportional to the
+   * generator of this model (such as rate-scaled copies of a model in
+   * a mixture), its eigen vectors and scaled eigen values are used
+   * instead of being computed. These models must be up to date, and
+   * must not be destroyed until the next update, or until this method
+   * is called with an empty vector.
+   */
+  void setEigenDecompositionDonors(const std::vector<const AbstractSubstitutionModel*>& models)
+  {
+    eigenDonors_ = models;
+  }
+
+  /**
+   * @return The number of eigen decompositions computed by this model
+   * since its construction (and not taken from another model).
+   */
+  size_t getNumberOfEigenDecompositions() const { return nbEigenDecompositions_; }
+
+  /**
+   * @brief Set the method used to compute the exponential of the
+   * generator, and update the matrices accordingly.
+   *
+   * For large state spaces, PADE and EXPMV do not need the eigen
+   * decomposition, which can then be disabled with
+   * enableEigenDecomposition(false).
+   */
+  void setExponentialMethod(ExponentialMethod method)
+  {
+    if (method != expMethod_)
+    {
+      expMethod_ = method;
+      updateMatrices_();
+    }
+  }
+
+  ExponentialMethod getExponentialMethod() const { return expMethod_; }
+
+  /**
+   * @brief Compute the product of the transition matrix (or its
+   * derivatives) for a length t with a block of likelihood vectors,
+   * without computing the transition matrix.
+   *
+   * The action of the exponential of the generator is computed with
+   * a truncated Taylor series on the sparse generator, with scaling
+   * (Al-Mohy & Higham, 2011, SIAM J. Sci. Comput. 33(2):488-511), so
+   * that it costs a few products of the generator with the block.
+   * The sparse generator is built at the first call after an update
+   * (see SparseGenerator), so calls from several threads are safe.
+   *
+   * @param t      The length.
+   * @param values The block of vectors, one column per vector (e.g. per site).
+   * @param result The product of the nDeriv-th derivative of the
+   *               transition matrix by values.
+   * @param nDeriv The order of derivation with respect to t (0, 1 or 2).
+   */
+  void applyPij_t(double t, const Eigen::MatrixXd& values, Eigen::MatrixXd& result, size_t nDeriv = 0) const;
+
+  /**
+   * @return true if computeGeneratorDerivative() is available for
+   * this parameter. At this level, only the "rate" parameter is
+   * covered. K80 (kappa), T92 (kappa, theta), HKY85 (kappa), GTR (a,
+   * b, c, d, e) and the codon distance models (beta, which is the
+   * omega of YN98 and MG94) add their own parameters.
+   *
+   * @param name The name of an independent parameter of the model.
+   */
+  virtual bool hasGeneratorDerivative(const std::string& name) const
+  {
+    return name == getNamespace() + "rate" && getIndependentParameters().hasParameter(name);
+  }
+
+  /**
+   * @brief Compute the analytic derivative of the generator multiplied
+   * by the rate of the model (\f$r.Q\f$) with respect to an
+   * independent parameter.
+   *
+   * Models override this method (and hasGeneratorDerivative()) for
+   * their own parameters.
+   *
+   * @param name       The name of an independent parameter of the model.
+   * @param derivative The derivative of \f$r.Q\f$.
+   * @throw Exception If hasGeneratorDerivative(name) is false.
+   */
+  virtual void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const;
+
+  /**
+   * @brief The derivative of the transition matrix for a length t
+   * with respect to an independent parameter.
+   *
+   * If \f$r.Q = U \Lambda U^{-1}\f$ with real eigen values, the
+   * derivative is computed from the current eigen decomposition:
+   * \f[
+   * \frac{\partial P(t)}{\partial \theta} = U \left( \left(U^{-1} \frac{\partial r.Q}{\partial \theta} U \right) \circ F \right) U^{-1}
+   * \f]
+   * with \f$F_{ij} = \frac{e^{\lambda_i t} - e^{\lambda_j t}}{\lambda_i - \lambda_j}\f$
+   * (and \f$F_{ii} = t e^{\lambda_i t}\f$). Otherwise, it is the
+   * upper right block of the exponential of
+   * \f$\begin{pmatrix} r.Q & \partial r.Q / \partial \theta \\ 0 & r.Q \end{pmatrix} t\f$.
+   *
+   * @param t    The length.
+   * @param name The name of an independent parameter of the model.
+   * @throw Exception If hasGeneratorDerivative(name) is false.
+   */
+  const Matrix<double>& getdPij_dparam(double t, const std::string& name) const;
 
 protected:
   /**
@@ -449,10 +671,64 @@ protected:
    * The optional rate parameter is not taken into account in this
    * method to prevent unnecessary computation.
    *
+   * If the generator satisfies detailed balance with freq_ (as for
+   * all time-reversible models), it is symmetrized as
+   * \f$\Pi^{1/2} Q \Pi^{-1/2}\f$ and diagonalized with a symmetric
+   * solver, so that the left eigen vectors are obtained without matrix
+   * inversion and all eigen values are real.
+   *
    * !! Here there is no normalization of the generator.
    */
   virtual void updateMatrices_();
 
+  /**
+   * @brief Complete the derivative of \f$r.Q\f$ with respect to a
+   * parameter on which the off-diagonal rates depend linearly, the
+   * equilibrium frequencies being independent of it.
+   *
+   * If the generator is normalized, \f$Q = M / s(M)\f$ with
+   * \f$s(M) = -\sum_i \pi_i M_{ii}\f$, and
+   * \f$\partial Q = \partial M / s + (\sum_i \pi_i \partial M_{ii} / s) Q\f$.
+   *
+   * @param derivative On input, the derivatives of the off-diagonal
+   * entries of the generator before normalization, divided by
+   * \f$s\f$. On output, the derivative of \f$r.Q\f$.
+   * @param normalized true if the generator is normalized.
+   */
+  void completeGeneratorDerivative_(Eigen::MatrixXd& derivative, bool normalized) const;
+
+private:
+  /**
+   * @brief Diagonalize a reversible generator through its symmetrized form.
+   *
+   * @param vnull  Tell for each state if its line and column are null (such as stop codons).
+   * @return false, without modification, if the generator does not
+   * satisfy detailed balance with freq_ or if a frequency is null.
+   */
+  bool updateSymmetricEigenDecomposition_(const std::vector<bool>& vnull);
+
+  /**
+   * @brief Take the eigen decomposition of a donor model with a
+   * generator proportional to this one.
+   *
+   * @return false, without modification, if there is no such model.
+   */
+  bool copyEigenDecomposition_();
+
+  /**
+   * @brief Compute the nDeriv-th derivative of the transition matrix
+   * for a length t with a Pade approximant.
+   */
+  void computePadeExponential_(double t, size_t nDeriv, RowMatrix<double>& result) const;
+
+  /**
+   * @return true if the transition matrices are computed with a Pade approximant.
+   */
+  bool usePadeExponential_() const
+  {
+    return expMethod_ != ExponentialMethod::EIGEN && (!eigenDecompose_ || !isDiagonalizable_ || !isNonSingular_);
+  }
+
 public:
   /**
    * @brief sets if model is scalable, ie scale can be changed.
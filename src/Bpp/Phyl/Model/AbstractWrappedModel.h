@@ -234,13 +234,15 @@ public:
 
   const Matrix<double>& generator() const { return substitutionModel().generator(); }
 
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& sparseGenerator() const { return substitutionModel().sparseGenerator(); }
+
   const Matrix<double>& exchangeabilityMatrix() const { return substitutionModel().exchangeabilityMatrix(); }
 
   double Sij(size_t i, size_t j) const { return substitutionModel().Sij(i, j); }
 
   void enableEigenDecomposition(bool yn) { substitutionModel_().enableEigenDecomposition(yn); }
 
-  bool enableEigenDecomposition() { return substitutionModel_().enableEigenDecomposition(); }
+  bool enableEigenDecomposition() const { return substitutionModel().enableEigenDecomposition(); }
 
   bool isDiagonalizable() const { return substitutionModel().isDiagonalizable(); }
 
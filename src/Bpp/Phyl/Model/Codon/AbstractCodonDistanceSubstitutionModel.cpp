@@ -52,3 +52,22 @@ double AbstractCodonDistanceSubstitutionModel::getCodonsMulRate(size_t i, size_t
         pgencode_->translate(si),
         pgencode_->translate(sj)) / alpha_) : 1);
 }
+
+/******************************************************************************/
+
+void AbstractCodonDistanceSubstitutionModel::computeBetaDerivative_(const Matrix<double>& generator, Eigen::MatrixXd& derivative) const
+{
+  size_t n = generator.getNumberOfRows();
+  derivative = Eigen::MatrixXd::Zero(Eigen::Index(n), Eigen::Index(n));
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t j = 0; j < n; ++j)
+    {
+      // Null rates include the ones of stop codons.
+      if (i == j || generator(i, j) == 0)
+        continue;
+      if (!pgencode_->areSynonymous(stateMap_->getAlphabetStateAsInt(i), stateMap_->getAlphabetStateAsInt(j)))
+        derivative(Eigen::Index(i), Eigen::Index(j)) = generator(i, j) / beta_;
+    }
+  }
+}
@@ -6,6 +6,8 @@
 #define BPP_PHYL_MODEL_CODON_ABSTRACTCODONDISTANCESUBSTITUTIONMODEL_H
 
 #include <Bpp/Numeric/AbstractParameterAliasable.h>
+#include <Bpp/Numeric/Matrix/Matrix.h>
+#include <Eigen/Core>
 
 #include "CodonSubstitutionModel.h"
 
@@ -120,6 +122,17 @@ public:
   }
 
   void setFreq(std::map<int, double>& frequencies) override {}
+
+protected:
+  /**
+   * @brief Compute the derivatives with respect to beta of the
+   * off-diagonal entries of a generator built with getCodonsMulRate():
+   * the rates of non-synonymous substitutions are proportional to beta.
+   *
+   * @param generator  The generator.
+   * @param derivative The derivatives (the diagonal is null).
+   */
+  void computeBetaDerivative_(const Matrix<double>& generator, Eigen::MatrixXd& derivative) const;
 };
 } // end of namespace bpp.
 #endif // BPP_PHYL_MODEL_CODON_ABSTRACTCODONDISTANCESUBSTITUTIONMODEL_H
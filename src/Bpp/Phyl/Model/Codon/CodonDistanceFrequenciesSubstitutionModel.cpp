@@ -65,6 +65,24 @@ double CodonDistanceFrequenciesSubstitutionModel::getCodonsMulRate(size_t i, siz
          * AbstractCodonFrequenciesSubstitutionModel::getCodonsMulRate(i, j);
 }
 
+bool CodonDistanceFrequenciesSubstitutionModel::hasGeneratorDerivative(const string& name) const
+{
+  return (name == getNamespace() + "beta" && getIndependentParameters().hasParameter(name))
+         || AbstractCodonSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void CodonDistanceFrequenciesSubstitutionModel::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  if (name != getNamespace() + "beta")
+  {
+    AbstractCodonSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  computeBetaDerivative_(generator_, derivative);
+  completeGeneratorDerivative_(derivative, isScalable());
+}
+
 void CodonDistanceFrequenciesSubstitutionModel::setNamespace(const std::string& st)
 {
   AbstractParameterAliasable::setNamespace(st);
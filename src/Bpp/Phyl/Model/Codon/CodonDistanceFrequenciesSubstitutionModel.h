@@ -116,6 +116,13 @@ public:
 
   double getCodonsMulRate(size_t i, size_t j) const override;
 
+  /**
+   * @brief Analytic derivatives of the generator with respect to "beta".
+   */
+  bool hasGeneratorDerivative(const std::string& name) const override;
+
+  void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const override;
+
   void setNamespace(const std::string&) override;
 
   void setFreq(std::map<int, double>& frequencies) override;
@@ -62,6 +62,24 @@ double CodonDistancePhaseFrequenciesSubstitutionModel::getCodonsMulRate(size_t i
          * AbstractCodonPhaseFrequenciesSubstitutionModel::getCodonsMulRate(i, j);
 }
 
+bool CodonDistancePhaseFrequenciesSubstitutionModel::hasGeneratorDerivative(const string& name) const
+{
+  return (name == getNamespace() + "beta" && getIndependentParameters().hasParameter(name))
+         || AbstractCodonSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void CodonDistancePhaseFrequenciesSubstitutionModel::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  if (name != getNamespace() + "beta")
+  {
+    AbstractCodonSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  computeBetaDerivative_(generator_, derivative);
+  completeGeneratorDerivative_(derivative, isScalable());
+}
+
 void CodonDistancePhaseFrequenciesSubstitutionModel::setNamespace(const std::string& st)
 {
   AbstractParameterAliasable::setNamespace(st);
@@ -53,3 +53,21 @@ double CodonDistanceSubstitutionModel::getCodonsMulRate(size_t i, size_t j) cons
 {
   return AbstractCodonDistanceSubstitutionModel::getCodonsMulRate(i, j);
 }
+
+bool CodonDistanceSubstitutionModel::hasGeneratorDerivative(const string& name) const
+{
+  return (name == getNamespace() + "beta" && getIndependentParameters().hasParameter(name))
+         || AbstractCodonSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void CodonDistanceSubstitutionModel::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  if (name != getNamespace() + "beta")
+  {
+    AbstractCodonSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  computeBetaDerivative_(generator_, derivative);
+  completeGeneratorDerivative_(derivative, isScalable());
+}
@@ -90,6 +90,13 @@ public:
   std::string getName() const;
 
   double getCodonsMulRate(size_t i, size_t j) const;
+
+  /**
+   * @brief Analytic derivatives of the generator with respect to "beta".
+   */
+  bool hasGeneratorDerivative(const std::string& name) const;
+
+  void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const;
 };
 } // end of namespace bpp.
 #endif // BPP_PHYL_MODEL_CODON_CODONDISTANCESUBSTITUTIONMODEL_H
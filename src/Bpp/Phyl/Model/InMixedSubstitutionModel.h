@@ -154,13 +154,15 @@ public:
 
   const Matrix<double>& generator() const override { return substitutionModel().generator(); }
 
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& sparseGenerator() const override { return substitutionModel().sparseGenerator(); }
+
   const Matrix<double>& exchangeabilityMatrix() const override { return substitutionModel().exchangeabilityMatrix(); }
 
   double Sij(size_t i, size_t j) const override { return substitutionModel().Sij(i, j); }
 
   void enableEigenDecomposition(bool yn) override { substitutionModel_().enableEigenDecomposition(yn); }
 
-  bool enableEigenDecomposition() override { return substitutionModel_().enableEigenDecomposition(); }
+  bool enableEigenDecomposition() const override { return substitutionModel().enableEigenDecomposition(); }
 
   bool isDiagonalizable() const override { return substitutionModel().isDiagonalizable(); }
 
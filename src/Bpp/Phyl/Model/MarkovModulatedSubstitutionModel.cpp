@@ -25,6 +25,7 @@ MarkovModulatedSubstitutionModel::MarkovModulatedSubstitutionModel(
   ratesFreq_           (model.ratesFreq_),
   ratesGenerator_      (model.ratesGenerator_),
   generator_           (model.generator_),
+  sparseGenerator_     (model.sparseGenerator_),
   exchangeability_     (model.exchangeability_),
   leftEigenVectors_    (model.leftEigenVectors_),
   rightEigenVectors_   (model.rightEigenVectors_),
@@ -53,6 +54,7 @@ MarkovModulatedSubstitutionModel& MarkovModulatedSubstitutionModel::operator=(
   ratesFreq_            = model.ratesFreq_;
   ratesGenerator_       = model.ratesGenerator_;
   generator_            = model.generator_;
+  sparseGenerator_      = model.sparseGenerator_;
   exchangeability_      = model.exchangeability_;
   leftEigenVectors_     = model.leftEigenVectors_;
   rightEigenVectors_    = model.rightEigenVectors_;
@@ -74,6 +76,7 @@ MarkovModulatedSubstitutionModel& MarkovModulatedSubstitutionModel::operator=(
 void MarkovModulatedSubstitutionModel::updateMatrices_()
 {
   // ratesGenerator_ and rates_ must be initialized!
+  sparseGenerator_.invalidate();
   nbStates_        = model_->getNumberOfStates();
   nbRates_         = rates_.getNumberOfColumns();
   RowMatrix<double> Tmp1, Tmp2;
@@ -143,6 +146,7 @@ void MarkovModulatedSubstitutionModel::updateMatrices_()
 
 void MarkovModulatedSubstitutionModel::setDiagonal()
 {
+  sparseGenerator_.invalidate();
   for (size_t i = 0; i < getNumberOfStates(); i++)
   {
     double lambda = 0;
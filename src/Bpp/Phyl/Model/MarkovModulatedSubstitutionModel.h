@@ -71,6 +71,11 @@ protected:
    */
   RowMatrix<double> generator_;
 
+  /**
+   * @brief The generator as a sparse matrix, built on demand.
+   */
+  mutable SparseGenerator sparseGenerator_;
+
   /**
    * @brief The exchangeability matrix \f$S\f$ of the model.
    */
@@ -151,6 +156,7 @@ public:
     ratesFreq_(nbRates),
     ratesGenerator_(nbRates, nbRates),
     generator_(),
+    sparseGenerator_(),
     exchangeability_(),
     leftEigenVectors_(),
     rightEigenVectors_(),
@@ -200,6 +206,15 @@ public:
 
   const Matrix<double>& generator() const override { return generator_; }
 
+  /**
+   * @brief The sparse generator, built from the dense one at the first
+   * call after an update of the matrices.
+   */
+  const Eigen::SparseMatrix<double, Eigen::RowMajor>& sparseGenerator() const override
+  {
+    return sparseGenerator_.get(generator_);
+  }
+
   const Matrix<double>& getPij_t(double t) const override;
   const Matrix<double>& getdPij_dt(double t) const override;
   const Matrix<double>& getd2Pij_dt2(double t) const override;
@@ -294,7 +309,7 @@ public:
 
   void enableEigenDecomposition(bool yn) override { eigenDecompose_ = yn; }
 
-  bool enableEigenDecomposition() override { return eigenDecompose_; }
+  bool enableEigenDecomposition() const override { return eigenDecompose_; }
 
   bool computeFrequencies() const override { return compFreq_; }
 
@@ -90,6 +90,12 @@ public:
    */
   virtual Vuint getSubmodelNumbers(const std::string& desc) const = 0;
 
+  /**
+   * @brief Returns the number of eigen decompositions computed by the
+   * submodels during the last update of the mixture.
+   */
+  virtual size_t getNumberOfEigenDecompositions() const = 0;
+
 protected:
   virtual TransitionModelInterface& nModel_(size_t i) = 0;
 
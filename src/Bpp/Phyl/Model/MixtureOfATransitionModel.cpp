@@ -174,6 +174,7 @@ void MixtureOfATransitionModel::updateMatrices_()
     }
   }
 
+  nbEigenDecompositions_ = 0;
   for (size_t i = 0; i < modelsContainer_.size(); i++)
   {
     vProbas_[i] = 1;
@@ -193,7 +194,7 @@ void MixtureOfATransitionModel::updateMatrices_()
       j = j / distrib.second->getNumberOfCategories();
     }
 
-    modelsContainer_[i]->matchParametersValues(pl);
+    updateNModel_(i, pl);
   }
 
   //  setting the equilibrium freqs
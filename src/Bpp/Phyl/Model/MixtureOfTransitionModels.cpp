@@ -205,10 +205,11 @@ void MixtureOfTransitionModels::updateMatrices_()
 
   // models
 
+  nbEigenDecompositions_ = 0;
   for (i = 0; i < nbmod; i++)
   {
     modelsContainer_[i]->setRate(rate_ * vRates_[i]);
-    modelsContainer_[i]->matchParametersValues(getParameters());
+    updateNModel_(i, getParameters());
   }
 
   // / freq_
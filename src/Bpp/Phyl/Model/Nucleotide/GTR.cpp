@@ -9,6 +9,9 @@
 
 // From the STL:
 #include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
 
 using namespace bpp;
 using namespace std;
@@ -105,3 +108,40 @@ void GTR::setFreq(map<int, double>& freqs)
 }
 
 /******************************************************************************/
+
+bool GTR::hasGeneratorDerivative(const string& name) const
+{
+  static const vector<string> exchangeabilities = {"a", "b", "c", "d", "e"};
+  for (const auto& exch : exchangeabilities)
+  {
+    if (name == getNamespace() + exch)
+      return getIndependentParameters().hasParameter(name);
+  }
+  return AbstractReversibleNucleotideSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void GTR::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  // States of the substitutions of each exchangeability, in A, C, G, T order.
+  static const map<string, pair<Eigen::Index, Eigen::Index>> states = {
+    {"a", {1, 3}}, {"b", {0, 3}}, {"c", {2, 3}}, {"d", {0, 1}}, {"e", {1, 2}}
+  };
+
+  auto it = states.find(getParameterNameWithoutNamespace(name));
+  if (it == states.end() || name != getNamespace() + it->first)
+  {
+    AbstractReversibleNucleotideSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  // Q_ij = s_ij.pi_j / p, where p normalizes the generator whether or
+  // not the model is scalable.
+  Eigen::Index i = it->second.first;
+  Eigen::Index j = it->second.second;
+  derivative = Eigen::MatrixXd::Zero(4, 4);
+  derivative(i, j) = freq_[size_t(j)] / p_;
+  derivative(j, i) = freq_[size_t(i)] / p_;
+  completeGeneratorDerivative_(derivative, true);
+}
+
+/******************************************************************************/
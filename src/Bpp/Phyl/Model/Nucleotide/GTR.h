@@ -131,6 +131,14 @@ public:
    */
   void setFreq(std::map<int, double>& freqs) override;
 
+  /**
+   * @brief Analytic derivatives of the generator with respect to "a",
+   * "b", "c", "d" and "e".
+   */
+  bool hasGeneratorDerivative(const std::string& name) const override;
+
+  void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const override;
+
 protected:
   void updateMatrices_() override;
 };
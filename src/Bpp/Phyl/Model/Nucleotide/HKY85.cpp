@@ -435,3 +435,28 @@ void HKY85::setFreq(std::map<int, double>& freqs)
 }
 
 /******************************************************************************/
+
+bool HKY85::hasGeneratorDerivative(const string& name) const
+{
+  return (name == getNamespace() + "kappa" && getIndependentParameters().hasParameter(name))
+         || AbstractReversibleNucleotideSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void HKY85::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  if (name != getNamespace() + "kappa")
+  {
+    AbstractReversibleNucleotideSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  // Transitions: Q_ij = r.kappa.pi_j, with r = 1 if the model is not scalable.
+  derivative = Eigen::MatrixXd::Zero(4, 4);
+  derivative(2, 0) = r_ * piA_;
+  derivative(3, 1) = r_ * piC_;
+  derivative(0, 2) = r_ * piG_;
+  derivative(1, 3) = r_ * piT_;
+  completeGeneratorDerivative_(derivative, isScalable());
+}
+
+/******************************************************************************/
@@ -176,6 +176,13 @@ public:
    */
   void setFreq(std::map<int, double>& freqs);
 
+  /**
+   * @brief Analytic derivatives of the generator with respect to "kappa".
+   */
+  bool hasGeneratorDerivative(const std::string& name) const;
+
+  void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const;
+
   void updateMatrices_();
 };
 } // end of namespace bpp.
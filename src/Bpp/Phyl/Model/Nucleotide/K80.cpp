@@ -359,3 +359,42 @@ const Matrix<double>& K80::getd2Pij_dt2(double d) const
 }
 
 /******************************************************************************/
+
+bool K80::hasGeneratorDerivative(const string& name) const
+{
+  return (name == getNamespace() + "kappa" && getIndependentParameters().hasParameter(name))
+         || AbstractReversibleNucleotideSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void K80::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  if (name != getNamespace() + "kappa")
+  {
+    AbstractReversibleNucleotideSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  // Q = r/4 . M(kappa), with r = 4 / (kappa + 2) if the model is scalable.
+  derivative = Eigen::MatrixXd::Zero(4, 4);
+  for (Eigen::Index i = 0; i < 4; ++i)
+  {
+    derivative(i, i) = -1.;
+  }
+  derivative(0, 2) = 1.;
+  derivative(1, 3) = 1.;
+  derivative(2, 0) = 1.;
+  derivative(3, 1) = 1.;
+  derivative *= r_ / 4.;
+
+  if (isScalable())
+  {
+    for (Eigen::Index i = 0; i < 4; ++i)
+    {
+      for (Eigen::Index j = 0; j < 4; ++j)
+      {
+        derivative(i, j) -= generator_(size_t(i), size_t(j)) / (kappa_ + 2.);
+      }
+    }
+  }
+  derivative *= rate_;
+}
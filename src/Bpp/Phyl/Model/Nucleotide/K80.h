@@ -136,6 +136,13 @@ public:
 
   std::string getName() const override { return "K80"; }
 
+  /**
+   * @brief Analytic derivatives of the generator with respect to "kappa".
+   */
+  bool hasGeneratorDerivative(const std::string& name) const override;
+
+  void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const override;
+
   /**
    * @brief This method is disabled in this model since frequencies are not free parameters.
    *
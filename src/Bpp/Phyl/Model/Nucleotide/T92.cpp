@@ -412,3 +412,69 @@ void T92::setFreq(std::map<int, double>& freqs)
 }
 
 /******************************************************************************/
+
+bool T92::hasGeneratorDerivative(const string& name) const
+{
+  return ((name == getNamespace() + "kappa" || name == getNamespace() + "theta") && getIndependentParameters().hasParameter(name))
+         || AbstractReversibleNucleotideSubstitutionModel::hasGeneratorDerivative(name);
+}
+
+void T92::computeGeneratorDerivative(const string& name, Eigen::MatrixXd& derivative) const
+{
+  bool isKappa = (name == getNamespace() + "kappa");
+  if (!isKappa && name != getNamespace() + "theta")
+  {
+    AbstractReversibleNucleotideSubstitutionModel::computeGeneratorDerivative(name, derivative);
+    return;
+  }
+
+  // Q = r . M(kappa, theta), with r = 2 / (1 + 2.theta.kappa - 2.theta^2.kappa)
+  // if the model is scalable.
+  Eigen::MatrixXd dm = Eigen::MatrixXd::Zero(4, 4);
+  double dr = 0;
+  if (isKappa)
+  {
+    dm(0, 0) = -theta_ / 2;
+    dm(1, 1) = -(1. - theta_) / 2;
+    dm(2, 2) = -(1. - theta_) / 2;
+    dm(3, 3) = -theta_ / 2;
+    dm(2, 0) = (1. - theta_) / 2;
+    dm(3, 1) = theta_ / 2;
+    dm(0, 2) = theta_ / 2;
+    dm(1, 3) = (1. - theta_) / 2;
+    if (isScalable())
+      dr = -r_ * r_ * theta_ * (1. - theta_);
+  }
+  else
+  {
+    dm(0, 0) = -kappa_ / 2;
+    dm(1, 1) = kappa_ / 2;
+    dm(2, 2) = kappa_ / 2;
+    dm(3, 3) = -kappa_ / 2;
+    dm(1, 0) = -0.5;
+    dm(3, 0) = -0.5;
+    dm(0, 3) = -0.5;
+    dm(2, 3) = -0.5;
+    dm(0, 1) = 0.5;
+    dm(2, 1) = 0.5;
+    dm(1, 2) = 0.5;
+    dm(3, 2) = 0.5;
+    dm(2, 0) = -kappa_ / 2;
+    dm(3, 1) = kappa_ / 2;
+    dm(0, 2) = kappa_ / 2;
+    dm(1, 3) = -kappa_ / 2;
+    if (isScalable())
+      dr = -r_ * r_ * kappa_ * (1. - 2. * theta_);
+  }
+
+  // dQ = r.dM + dr.M = r.dM + dr/r.Q
+  derivative = r_ * dm;
+  for (Eigen::Index i = 0; i < 4; ++i)
+  {
+    for (Eigen::Index j = 0; j < 4; ++j)
+    {
+      derivative(i, j) += dr / r_ * generator_(size_t(i), size_t(j));
+    }
+  }
+  derivative *= rate_;
+}
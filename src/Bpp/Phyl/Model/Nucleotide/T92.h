@@ -145,6 +145,13 @@ public:
 
   std::string getName() const override { return "T92"; }
 
+  /**
+   * @brief Analytic derivatives of the generator with respect to "kappa" and "theta".
+   */
+  bool hasGeneratorDerivative(const std::string& name) const override;
+
+  void computeGeneratorDerivative(const std::string& name, Eigen::MatrixXd& derivative) const override;
+
   /**
    * @brief This method is over-defined to actualize the 'theta' parameter too.
    */
@@ -6,6 +6,7 @@
 #define BPP_PHYL_MODEL_SUBSTITUTIONMODEL_H
 
 #include <Eigen/Core>
+#include <Eigen/SparseCore>
 
 #include "FrequencySet/FrequencySet.h"
 #include "StateMap.h"
@@ -438,6 +439,14 @@ public:
    */
   virtual const Matrix<double>& generator() const = 0;
 
+  /**
+   * @return The generator as a sparse matrix (compressed rows), with
+   * only the non-zero rates of changes. It is equal to generator(),
+   * and is useful for large models where most of the rates are null
+   * (such as codon or POMO models).
+   */
+  virtual const Eigen::SparseMatrix<double, Eigen::RowMajor>& sparseGenerator() const = 0;
+
   /**
    * @return The matrix of exchangeability terms.
    * It is recommended that exchangeability matrix be normalized so that the normalized
@@ -460,7 +469,7 @@ public:
   /**
    * @brief Tell if eigenValues and Vectors must be computed
    */
-  virtual bool enableEigenDecomposition() = 0;
+  virtual bool enableEigenDecomposition() const = 0;
 
   /**
    * @return A vector with all real parts of the eigen values of the generator of this model;
@@ -94,6 +94,18 @@ public:
 
   virtual const RowMatrix<double>& getd2Pij_dt2(double d) const override;
 
+  /**
+   * @brief The rate of the ith position of the words.
+   *
+   * The transition probabilities of the words for a length d are the
+   * Kronecker product of nModel(i).getPij_t(d * getPositionRate(i))
+   * over the positions, the last position varying the fastest.
+   */
+  double getPositionRate(size_t i) const
+  {
+    return Vrate_[i] * rate_;
+  }
+
   virtual std::string getName() const override;
 };
 } // end of namespace bpp.
@@ -13,8 +13,11 @@
 #include <Bpp/Numeric/Function/ThreePointsNumericalDerivative.h>
 #include <Bpp/Numeric/Function/TwoPointsNumericalDerivative.h>
 #include <Bpp/Numeric/ParameterList.h>
+#include <Bpp/Numeric/Parametrizable.h>
+#include <Bpp/Io/FileTools.h>
 
 #include "Io/Newick.h"
+#include "Likelihood/DataFlow/Parameter.h"
 #include "OptimizationTools.h"
 #include "PseudoNewtonOptimizer.h"
 #include "Tree/PhyloTreeTools.h"
@@ -22,11 +25,72 @@
 // From bpp-seq:
 #include <Bpp/Seq/Io/Fasta.h>
 
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 using namespace bpp;
 using namespace std;
 
+namespace
+{
+/**
+ * @brief The lines identifying a likelihood in a backup file.
+ */
+vector<string> describeLikelihood(const PhyloLikelihoodInterface& lik)
+{
+  vector<string> description;
+  auto aligned = dynamic_cast<const AlignedPhyloLikelihoodInterface*>(&lik);
+  if (aligned)
+    description.push_back("sites=" + TextTools::toString(aligned->getNumberOfSites()));
+  auto single = dynamic_cast<const SingleProcessPhyloLikelihood*>(&lik);
+  if (single && single->getSubstitutionProcess())
+  {
+    auto process = single->getSubstitutionProcess();
+    string models;
+    for (auto n : process->getModelNumbers())
+    {
+      models += (models.empty() ? "" : ",") + process->getModel(n)->getName();
+    }
+    description.push_back("models=" + models);
+  }
+  return description;
+}
+
+/**
+ * @brief Restore the state of a previous run from a backup, if any,
+ * and update the number of evaluations left.
+ *
+ * @return true if the previous run was completed and the optimization
+ * has to be skipped.
+ */
+bool resumeFromBackup(
+    PhyloBackupListener* backup,
+    PhyloLikelihoodInterface& lik,
+    ParameterList& pl,
+    unsigned int& tlEvalMax,
+    unsigned int verbose)
+{
+  if (!backup || !backup->restore(lik))
+    return false;
+
+  pl.matchParametersValues(lik.getParameters());
+  if (verbose > 0)
+    ApplicationTools::displayResult("Optimization restored from", backup->getPath());
+  if (backup->isCompleted())
+    return backup->skipsCompleted();
+
+  unsigned int done = backup->getNumberOfEvaluations();
+  tlEvalMax = (tlEvalMax > done) ? tlEvalMax - done : 1;
+  return false;
+}
+}
+
 /******************************************************************************/
 
 OptimizationTools::OptimizationTools() {}
@@ -35,6 +99,145 @@ OptimizationTools::~OptimizationTools() {}
 
 /******************************************************************************/
 
+PhyloBackupListener::PhyloBackupListener(const string& path, bool skipCompleted) :
+  BackupListener(path),
+  path_(path),
+  skipCompleted_(skipCompleted),
+  optimizer_(0),
+  likelihood_(0),
+  nbEvaluations_(0),
+  previousEvaluations_(0),
+  completed_(false)
+{}
+
+bool PhyloBackupListener::restore(PhyloLikelihoodInterface& likelihood)
+{
+  if (!FileTools::fileExists(path_))
+    return false;
+
+  ifstream file(path_.c_str(), ios::in);
+  if (!file)
+    throw IOException("PhyloBackupListener::restore: could not open file " + path_);
+  vector<string> lines = FileTools::putStreamIntoVectorOfStrings(file);
+  file.close();
+  if (lines.size() == 0 || lines[0].substr(0, 5) != "f(x)=")
+    throw IOException("PhyloBackupListener::restore: " + path_ + " is not a backup file.");
+  double fval = TextTools::toDouble(lines[0].substr(5));
+
+  vector<string> description;
+  map<string, double> values;
+  unsigned int nbEvaluations = 0;
+  bool completed = false;
+  for (size_t l = 1; l < lines.size(); ++l)
+  {
+    string line = TextTools::removeSurroundingWhiteSpaces(lines[l]);
+    if (line.empty())
+      continue;
+    if (line[0] == '#')
+    {
+      line = TextTools::removeSurroundingWhiteSpaces(line.substr(1));
+      if (line == "completed")
+        completed = true;
+      else if (line.substr(0, 12) == "evaluations=")
+        nbEvaluations = TextTools::to<unsigned int>(line.substr(12));
+      else
+        description.push_back(line);
+      continue;
+    }
+    size_t pos = line.find('=');
+    if (pos == string::npos)
+      throw IOException("PhyloBackupListener::restore: corrupted backup file " + path_ + " at line " + TextTools::toString(l + 1) + ": " + lines[l]);
+    values[line.substr(0, pos)] = TextTools::toDouble(line.substr(pos + 1));
+  }
+
+  // The backup must have been written for this likelihood:
+  if (description.empty())
+    ApplicationTools::displayWarning("Backup file " + path_ + " does not identify its likelihood, only parameter names are checked.");
+  else if (description != describeLikelihood(likelihood))
+  {
+    string text;
+    for (const auto& line : description)
+    {
+      text += (text.empty() ? "" : ", ") + line;
+    }
+    throw IOException("PhyloBackupListener::restore: " + path_ + " was written for another likelihood (" + text + ").");
+  }
+  ParameterList pl = likelihood.getParameters();
+  if (values.size() != pl.size())
+    throw IOException("PhyloBackupListener::restore: " + path_ + " was written for another likelihood (" + TextTools::toString(values.size()) + " parameters instead of " + TextTools::toString(pl.size()) + ").");
+  for (size_t i = 0; i < pl.size(); ++i)
+  {
+    auto it = values.find(pl[i].getName());
+    if (it == values.end())
+      throw IOException("PhyloBackupListener::restore: " + path_ + " was written for another likelihood (no parameter " + pl[i].getName() + ").");
+    pl[i].setValue(it->second);
+  }
+  likelihood.matchParametersValues(pl);
+  if (abs(likelihood.getValue() - fval) > 0.000001)
+    ApplicationTools::displayMessage("Changed likelihood from backup file.");
+
+  nbEvaluations_ = nbEvaluations;
+  previousEvaluations_ = nbEvaluations;
+  completed_ = completed;
+  return true;
+}
+
+void PhyloBackupListener::write() const
+{
+  if (!likelihood_)
+    throw Exception("PhyloBackupListener::write: no likelihood attached.");
+
+  // Written aside, then renamed, so that an interruption never leaves
+  // a truncated backup.
+  string tmpPath = path_ + ".tmp";
+  ofstream file(tmpPath.c_str(), ios::out);
+  if (!file)
+    throw IOException("PhyloBackupListener::write: could not open file " + tmpPath);
+
+  file << "f(x)=" << setprecision(20) << likelihood_->getValue() << endl;
+  ParameterList pl = likelihood_->getParameters();
+  for (size_t i = 0; i < pl.size(); ++i)
+  {
+    file << pl[i].getName() << "=" << setprecision(20) << pl[i].getValue() << endl;
+  }
+  for (const auto& line : describeLikelihood(*likelihood_))
+  {
+    file << "# " << line << endl;
+  }
+  file << "# evaluations=" << nbEvaluations_ << endl;
+  if (completed_)
+    file << "# completed" << endl;
+
+  if (!file)
+    throw IOException("PhyloBackupListener::write: error while writing file " + tmpPath);
+  file.close();
+
+  if (std::rename(tmpPath.c_str(), path_.c_str()) != 0)
+    throw IOException("PhyloBackupListener::write: could not replace file " + path_);
+}
+
+void PhyloBackupListener::update_()
+{
+  if (!optimizer_ || !likelihood_)
+    throw Exception("PhyloBackupListener: no optimizer attached.");
+  nbEvaluations_ = previousEvaluations_ + optimizer_->getNumberOfEvaluations();
+}
+
+void PhyloBackupListener::optimizationStepPerformed(const OptimizationEvent& event)
+{
+  update_();
+  write();
+}
+
+void PhyloBackupListener::complete()
+{
+  update_();
+  completed_ = true;
+  write();
+}
+
+/******************************************************************************/
+
 std::string OptimizationTools::OPTIMIZATION_NEWTON = "newton";
 std::string OptimizationTools::OPTIMIZATION_GRADIENT = "gradient";
 std::string OptimizationTools::OPTIMIZATION_BRENT = "Brent";
@@ -54,15 +257,19 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
     bool reparametrization,
     unsigned int verbose,
     const std::string& optMethodDeriv,
-    const std::string& optMethodModel)
+    const std::string& optMethodModel,
+    shared_ptr<PhyloBackupListener> backup)
 {
   shared_ptr<SecondOrderDerivable> f = lik;
   ParameterList pl = parameters;
 
+  if (resumeFromBackup(backup.get(), *lik, pl, tlEvalMax, verbose))
+    return backup->getNumberOfEvaluations();
+
   // Shall we reparametrize the function to remove constraints?
   if (reparametrization)
   {
-    f = make_shared<ReparametrizationDerivableSecondOrderWrapper>(f, parameters);
+    f = make_shared<ReparametrizationDerivableSecondOrderWrapper>(f, pl);
 
     // Reset parameters to remove constraints:
     pl = f->getParameters().createSubList(parameters.getParameterNames());
@@ -130,6 +337,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
   poptimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
   auto nanListener = make_shared<NaNListener>(poptimizer.get(), lik.get());
   poptimizer->addOptimizationListener(nanListener);
+  if (backup)
+  {
+    backup->attach(poptimizer.get(), lik.get());
+    poptimizer->addOptimizationListener(backup);
+  }
   if (listener)
     poptimizer->addOptimizationListener(listener);
   poptimizer->init(pl);
@@ -139,6 +351,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters(
     ApplicationTools::displayMessage("\n");
 
   // We're done.
+  if (backup)
+  {
+    backup->complete();
+    return backup->getNumberOfEvaluations();
+  }
   uint nb = poptimizer->getNumberOfEvaluations();
   return nb;
 }
@@ -157,11 +374,15 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
     bool reparametrization,
     bool useClock,
     unsigned int verbose,
-    const std::string& optMethodDeriv)
+    const std::string& optMethodDeriv,
+    shared_ptr<PhyloBackupListener> backup)
 {
   shared_ptr<SecondOrderDerivable> f = lik;
   ParameterList pl = parameters;
 
+  if (resumeFromBackup(backup.get(), *lik, pl, tlEvalMax, verbose))
+    return backup->getNumberOfEvaluations();
+
   // Shall we use a molecular clock constraint on branch lengths?
   // unique_ptr<GlobalClockTreeLikelihoodFunctionWrapper> fclock;
   // if (useClock)
@@ -231,6 +452,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
   optimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
   auto nanListener = make_shared<NaNListener>(optimizer.get(), lik.get());
   optimizer->addOptimizationListener(nanListener);
+  if (backup)
+  {
+    backup->attach(optimizer.get(), lik.get());
+    optimizer->addOptimizationListener(backup);
+  }
   if (listener)
     optimizer->addOptimizationListener(listener);
 
@@ -241,6 +467,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
     ApplicationTools::displayMessage("\n");
 
   // We're done.
+  if (backup)
+  {
+    backup->complete();
+    return backup->getNumberOfEvaluations();
+  }
   return optimizer->getNumberOfEvaluations();
 }
 
@@ -257,16 +488,21 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
     bool reparametrization,
     bool useClock,
     unsigned int verbose,
-    const string& optMethodDeriv)
+    const string& optMethodDeriv,
+    shared_ptr<PhyloBackupListener> backup)
 {
   shared_ptr<SecondOrderDerivable> f = lik;
   ParameterList pl = parameters;
+
+  if (resumeFromBackup(backup.get(), *lik, pl, tlEvalMax, verbose))
+    return backup->getNumberOfEvaluations();
+
   if (reparametrization)
   {
     // Shall we reparametrize the function to remove constraints?
     if (reparametrization)
     {
-      f = make_shared<ReparametrizationDerivableSecondOrderWrapper>(f, parameters);
+      f = make_shared<ReparametrizationDerivableSecondOrderWrapper>(f, pl);
 
       // Reset parameters to remove constraints:
       pl = f->getParameters().createSubList(parameters.getParameterNames());
@@ -318,6 +554,11 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
   optimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
   auto nanListener = make_shared<NaNListener>(optimizer.get(), lik.get());
   optimizer->addOptimizationListener(nanListener);
+  if (backup)
+  {
+    backup->attach(optimizer.get(), lik.get());
+    optimizer->addOptimizationListener(backup);
+  }
   if (listener)
     optimizer->addOptimizationListener(listener);
 
@@ -328,9 +569,206 @@ unsigned int OptimizationTools::optimizeNumericalParameters2(
     ApplicationTools::displayMessage("\n");
 
   // We're done.
+  if (backup)
+  {
+    backup->complete();
+    return backup->getNumberOfEvaluations();
+  }
   return optimizer->getNumberOfEvaluations();
 }
 
+/************************************************************/
+
+unsigned int OptimizationTools::optimizeNumericalParametersByPartition(
+    shared_ptr<PhyloLikelihoodSetInterface> lik,
+    const ParameterList& parameters,
+    double tolerance,
+    unsigned int tlEvalMax,
+    shared_ptr<OutputStream> messageHandler,
+    shared_ptr<OutputStream> profiler,
+    unsigned int verbose,
+    const string& optMethodDeriv)
+{
+  vector<shared_ptr<PhyloLikelihoodInterface>> members;
+  for (auto n : lik->getNumbersOfPhyloLikelihoods())
+  {
+    members.push_back(lik->getPhyloLikelihood(n));
+  }
+
+  // Members using each value node, and name of the value node in each
+  // member:
+  map<const Node_DF*, vector<size_t>> users;
+  map<const Node_DF*, NodeRef> valueNodes;
+  vector<map<const Node_DF*, string>> memberNames(members.size());
+  for (size_t i = 0; i < members.size(); ++i)
+  {
+    const auto& pl = members[i]->getParameters();
+    for (size_t j = 0; j < pl.size(); ++j)
+    {
+      auto confP = dynamic_pointer_cast<ConfiguredParameter>(pl.getParameter(j));
+      if (!confP)
+        continue;
+      const Node_DF* valueNode = confP->dependency(0).get();
+      if (memberNames[i].find(valueNode) == memberNames[i].end())
+      {
+        memberNames[i][valueNode] = pl[j].getName();
+        users[valueNode].push_back(i);
+        valueNodes[valueNode] = confP->dependency(0);
+      }
+    }
+  }
+
+  vector<vector<string>> ownNames(members.size());
+  vector<NodeRef> ownValueNodes;
+  vector<string> sharedNames;
+  for (size_t k = 0; k < parameters.size(); ++k)
+  {
+    const string& name = parameters[k].getName();
+    const auto* confP = dynamic_cast<const ConfiguredParameter*>(&lik->parameter(name));
+    auto it = confP ? users.find(confP->dependency(0).get()) : users.end();
+    if (it != users.end() && it->second.size() == 1)
+    {
+      size_t i = it->second[0];
+      ownNames[i].push_back(memberNames[i][it->first]);
+      ownValueNodes.push_back(valueNodes[it->first]);
+    }
+    else
+      sharedNames.push_back(name);
+  }
+
+  vector<size_t> independent;
+  for (size_t i = 0; i < members.size(); ++i)
+  {
+    if (!ownNames[i].empty())
+      independent.push_back(i);
+  }
+
+  // Computations use the objects of the graph (models, distributions,
+  // ...) themselves, so members sharing such an object are optimized one
+  // after the other, in the same thread.
+  vector<size_t> group(members.size());
+  for (size_t i = 0; i < members.size(); ++i)
+  {
+    group[i] = i;
+  }
+  const auto findGroup = [&group](size_t i) {
+        while (group[i] != i)
+        {
+          i = group[i];
+        }
+        return i;
+      };
+
+  map<const Node_DF*, size_t> objectUser;
+  for (auto i : independent)
+  {
+    set<const Node_DF*> visited;
+    vector<const Node_DF*> nodesToVisit(1, members[i]->getLikelihoodNode().get());
+    while (!nodesToVisit.empty())
+    {
+      const Node_DF* n = nodesToVisit.back();
+      nodesToVisit.pop_back();
+      if (!visited.insert(n).second)
+        continue;
+      if (dynamic_cast<const Parametrizable*>(n))
+      {
+        auto it = objectUser.find(n);
+        if (it == objectUser.end())
+          objectUser[n] = i;
+        else
+          group[findGroup(i)] = findGroup(it->second);
+      }
+      for (const auto& dep : n->dependencies())
+      {
+        if (dep)
+          nodesToVisit.push_back(dep.get());
+      }
+    }
+  }
+
+  map<size_t, vector<size_t>> groupMembers;
+  for (auto i : independent)
+  {
+    groupMembers[findGroup(i)].push_back(i);
+  }
+  vector<vector<size_t>> groups;
+  for (const auto& g : groupMembers)
+  {
+    groups.push_back(g.second);
+  }
+
+  if (verbose > 0)
+  {
+    ApplicationTools::displayResult("Partitions optimized independently", independent.size());
+    ApplicationTools::displayResult("Concurrent groups of partitions", groups.size());
+    ApplicationTools::displayResult("Parameters optimized jointly", sharedNames.size());
+  }
+
+  unsigned int nbEval = 0;
+  double value = lik->getValue();
+  while (nbEval < tlEvalMax)
+  {
+    // All nodes are valid now. The nodes depending on the parameters of
+    // the members are invalidated before the parallel steps, so that
+    // the threads only invalidate the nodes of their own members.
+    for (auto& node : ownValueNodes)
+    {
+      node->invalidateDependentNodes();
+    }
+
+    vector<unsigned int> memberEval(members.size(), 0);
+    string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (size_t k = 0; k < groups.size(); ++k)
+    {
+      try
+      {
+        for (auto i : groups[k])
+        {
+          auto member = members[i];
+          ParameterList pl = member->getParameters().createSubList(ownNames[i]);
+          auto spl = dynamic_pointer_cast<SingleProcessPhyloLikelihood>(member);
+          if (spl)
+            memberEval[i] = optimizeNumericalParameters2(spl, pl, nullptr, tolerance, tlEvalMax, nullptr, nullptr, false, false, 0, optMethodDeriv);
+          else
+            memberEval[i] = optimizeNumericalParameters2(member, pl, nullptr, tolerance, tlEvalMax, nullptr, nullptr, false, false, 0, optMethodDeriv);
+        }
+      }
+      catch (exception& e)
+      {
+#ifdef _OPENMP
+#pragma omp critical (OptimizationTools_optimizeNumericalParametersByPartition_error)
+#endif
+        if (errorMessage == "")
+          errorMessage = e.what();
+      }
+    }
+    if (errorMessage != "")
+      throw Exception("OptimizationTools::optimizeNumericalParametersByPartition. " + errorMessage);
+    for (auto n : memberEval)
+    {
+      nbEval += n;
+    }
+
+    if (!sharedNames.empty() && nbEval < tlEvalMax)
+    {
+      ParameterList pl = lik->getParameters().createSubList(sharedNames);
+      nbEval += optimizeNumericalParameters2(lik, pl, nullptr, tolerance, tlEvalMax - nbEval, messageHandler, profiler, false, false, verbose > 0 ? verbose - 1 : 0, optMethodDeriv);
+    }
+
+    double newValue = lik->getValue();
+    if (verbose > 0)
+      ApplicationTools::displayResult("Log-likelihood after partition round", -newValue);
+    if (sharedNames.empty() || abs(value - newValue) < tolerance)
+      break;
+    value = newValue;
+  }
+
+  return nbEval;
+}
+
 
 /******************************************************************************/
 
@@ -7,12 +7,18 @@
 
 #include <Bpp/App/ApplicationTools.h>
 #include <Bpp/Io/OutputStream.h>
+#include <Bpp/Numeric/Function/Optimizer.h>
 #include <Bpp/Numeric/Function/SimpleNewtonMultiDimensions.h>
+#include <Bpp/Numeric/ParameterList.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/PhyloLikelihoodSet.h>
 #include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
 
 #include "Distance/DistanceEstimation.h"
 #include "Distance/AbstractAgglomerativeDistanceMethod.h"
 
+// From the STL:
+#include <string>
+
 
 namespace bpp
 {
@@ -55,6 +61,112 @@ public:
 };
 
 
+/**
+ * @brief A BackupListener able to resume the optimization of a phylo
+ * likelihood.
+ *
+ * As BackupListener, it writes at each optimization step the function
+ * value ("f(x)=value") and one "name=value" line per parameter, but:
+ * - the parameters written are the ones of the likelihood, and not the
+ *   ones of the optimized function, which may be reparametrized;
+ * - the file is replaced atomically, so that an interrupted job always
+ *   leaves a readable backup;
+ * - lines starting with '#' identify the likelihood (number of sites
+ *   and names of the models), and give the number of function
+ *   evaluations done and whether the optimization was completed.
+ *
+ * When passed as backup to the OptimizationTools methods, a backup
+ * found on disk is restored before the optimization starts, which then
+ * goes on from the saved parameter values with the remaining number of
+ * evaluations. A backup of another likelihood (other number of sites,
+ * models or parameters) is rejected. The optimization is skipped after
+ * a completed backup only if requested, otherwise it is run again from
+ * the restored values.
+ *
+ * The internal state of the optimizers (like the BFGS approximation of
+ * the Hessian) is not saved, and is rebuilt from the saved point.
+ */
+class PhyloBackupListener :
+  public BackupListener
+{
+private:
+  std::string path_;
+  bool skipCompleted_;
+
+  const OptimizerInterface* optimizer_;
+  const PhyloLikelihoodInterface* likelihood_;
+
+  unsigned int nbEvaluations_;
+  unsigned int previousEvaluations_;
+  bool completed_;
+
+public:
+  /**
+   * @param path          The backup file.
+   * @param skipCompleted Tell if an optimization is skipped when the
+   *                      backup found on disk was completed.
+   */
+  PhyloBackupListener(const std::string& path, bool skipCompleted = false);
+
+  PhyloBackupListener(const PhyloBackupListener&) = default;
+
+  PhyloBackupListener& operator=(const PhyloBackupListener&) = default;
+
+  virtual ~PhyloBackupListener() {}
+
+public:
+  const std::string& getPath() const { return path_; }
+
+  bool skipsCompleted() const { return skipCompleted_; }
+
+  /**
+   * @return The number of function evaluations, including the ones of
+   * the previous runs.
+   */
+  unsigned int getNumberOfEvaluations() const { return nbEvaluations_; }
+
+  bool isCompleted() const { return completed_; }
+
+  /**
+   * @brief Restore the parameter values of a likelihood from the
+   * backup file, if it exists.
+   *
+   * @param likelihood The likelihood the backup was written for.
+   * @return true if a backup was restored.
+   * @throw IOException If the file is not a valid backup, or was
+   * written for another likelihood.
+   */
+  bool restore(PhyloLikelihoodInterface& likelihood);
+
+  /**
+   * @brief Write the current state to the backup file.
+   *
+   * @throw IOException If an output error happens.
+   */
+  void write() const;
+
+  /**
+   * @brief Set the optimizer and the likelihood to save.
+   */
+  void attach(const OptimizerInterface* optimizer, const PhyloLikelihoodInterface* likelihood)
+  {
+    optimizer_ = optimizer;
+    likelihood_ = likelihood;
+    completed_ = false;
+  }
+
+  /**
+   * @brief Write the final state, marked as completed.
+   */
+  void complete();
+
+  void optimizationStepPerformed(const OptimizationEvent& event);
+
+private:
+  void update_();
+};
+
+
 /**
  * @brief Optimization methods for phylogenetic inference.
  *
@@ -99,6 +211,8 @@ public:
    * @see OPTIMIZATION_NEWTON, OPTIMIZATION_GRADIENT
    * @param optMethodModel Optimization type for model parameters (Brent or BFGS).
    * @see OPTIMIZATION_BRENT, OPTIMIZATION_BFGS
+   * @param backup         A backup, restored if found on disk, and updated during the optimization (none if null).
+   * @return The number of function evaluations, including the ones of a restored run.
    * @throw Exception any exception thrown by the Optimizer.
    */
   static unsigned int optimizeNumericalParameters(
@@ -113,7 +227,8 @@ public:
       bool reparametrization                         = false,
       unsigned int verbose                           = 1,
       const std::string& optMethodDeriv              = OPTIMIZATION_NEWTON,
-      const std::string& optMethodModel              = OPTIMIZATION_BRENT);
+      const std::string& optMethodModel              = OPTIMIZATION_BRENT,
+      std::shared_ptr<PhyloBackupListener> backup    = nullptr);
 
   /**
    * @brief Optimize numerical parameters (branch length, substitution model & rate distribution) of a TreeLikelihood function.
@@ -135,6 +250,8 @@ public:
    * @param verbose        The verbose level.
    * @param optMethodDeriv Optimization type for derivable parameters (first or second order derivatives).
    * @see OPTIMIZATION_NEWTON, OPTIMIZATION_GRADIENT
+   * @param backup         A backup, restored if found on disk, and updated during the optimization (none if null).
+   * @return The number of function evaluations, including the ones of a restored run.
    * @throw Exception any exception thrown by the Optimizer.
    */
 
@@ -149,7 +266,8 @@ public:
       bool reparametrization                         = false,
       bool useClock                                  = false,
       unsigned int verbose                           = 1,
-      const std::string& optMethodDeriv              = OPTIMIZATION_NEWTON);
+      const std::string& optMethodDeriv              = OPTIMIZATION_NEWTON,
+      std::shared_ptr<PhyloBackupListener> backup    = nullptr);
 
   static unsigned int optimizeNumericalParameters2(
       std::shared_ptr<SingleProcessPhyloLikelihood> lik,
@@ -162,6 +280,54 @@ public:
       bool reparametrization                         = false,
       bool useClock                                  = false,
       unsigned int verbose                           = 1,
+      const std::string& optMethodDeriv              = OPTIMIZATION_NEWTON,
+      std::shared_ptr<PhyloBackupListener> backup    = nullptr);
+
+  /**
+   * @brief Optimize numerical parameters of a set of phylo
+   * likelihoods, partition by partition.
+   *
+   * Parameters are matched to the member likelihoods through their
+   * value nodes, so that aliased parameters are recognized as the same
+   * one. Parameters used by a single member are optimized on this
+   * member only, with optimizeNumericalParameters2, the members being
+   * optimized in parallel when OpenMP is available. Parameters shared
+   * by several members (for instance a linked tree) are then optimized
+   * jointly on the whole set, and both steps are repeated until the
+   * likelihood improves by less than the tolerance.
+   *
+   * Members are computed concurrently in the same Context (see the
+   * threading contract of Context). Members whose graphs share an
+   * object node (model, rate distribution, ...) are optimized one after
+   * the other in the same thread, since computations use these objects.
+   *
+   * Each round optimizes each member separately, which is only relevant
+   * when the likelihood of the set is the sum of the likelihoods of its
+   * members (as for a product of likelihoods).
+   *
+   * @param lik            A pointer toward the PhyloLikelihoodSet object to optimize.
+   * @param parameters     The list of parameters to optimize.
+   * @param tolerance      The tolerance to use in the algorithm.
+   * @param tlEvalMax      The maximum number of function evaluations, for each member and for the joint steps.
+   * @param messageHandler The massage handler, for the joint steps.
+   * @param profiler       The profiler, for the joint steps.
+   * @param verbose        The verbose level.
+   * @param optMethodDeriv Optimization type for derivable parameters (first or second order derivatives).
+   * @see OPTIMIZATION_NEWTON, OPTIMIZATION_GRADIENT
+   * @return The number of function evaluations.
+   * @throw Exception any exception thrown by the Optimizers.
+   *
+   * No backup can be made of this optimization, made of several
+   * optimizers running concurrently.
+   */
+  static unsigned int optimizeNumericalParametersByPartition(
+      std::shared_ptr<PhyloLikelihoodSetInterface> lik,
+      const ParameterList& parameters,
+      double tolerance                               = 0.000001,
+      unsigned int tlEvalMax                         = 1000000,
+      std::shared_ptr<OutputStream> messageHandler   = ApplicationTools::message,
+      std::shared_ptr<OutputStream> profiler         = ApplicationTools::message,
+      unsigned int verbose                           = 1,
       const std::string& optMethodDeriv              = OPTIMIZATION_NEWTON);
 
   /**
@@ -0,0 +1,433 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Numeric/Function/SimpleMultiDimensions.h>
+#include <Bpp/Numeric/Parametrizable.h>
+#include <Bpp/Text/TextTools.h>
+
+#include "Likelihood/DataFlow/Parameter.h"
+#include "Likelihood/PhyloLikelihoods/AlignedPhyloLikelihoodProduct.h"
+#include "ParameterBlockScheduler.h"
+#include "PseudoNewtonOptimizer.h"
+
+// From the STL:
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace bpp;
+using namespace std;
+
+namespace
+{
+/**
+ * @brief Visit the nodes of the live graph that depend on a node.
+ */
+template<class Visitor>
+void visitDependents(const Node_DF& start, const unordered_set<const Node_DF*>& live, Visitor visit)
+{
+  unordered_set<const Node_DF*> seen;
+  stack<const Node_DF*> nodesToVisit;
+  nodesToVisit.push(&start);
+  while (!nodesToVisit.empty())
+  {
+    auto* n = nodesToVisit.top();
+    nodesToVisit.pop();
+    for (auto* dependent : n->dependentNodes())
+    {
+      if (live.count(dependent) != 0 && seen.insert(dependent).second)
+      {
+        visit(dependent);
+        nodesToVisit.push(dependent);
+      }
+    }
+  }
+}
+
+size_t findRoot(vector<size_t>& parent, size_t i)
+{
+  while (parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+}
+
+/******************************************************************************/
+
+ParameterBlockScheduler::ParameterBlockScheduler(
+    shared_ptr<PhyloLikelihoodInterface> lik,
+    const ParameterList& parameters) :
+  lik_(lik),
+  blocks_(),
+  batches_(),
+  members_(),
+  memberGroup_(),
+  nbComponents_(0),
+  tolerance_(0.000001),
+  nbEvalMax_(1000000)
+{
+  // Nodes the likelihood is computed from:
+  unordered_set<const Node_DF*> live;
+  stack<const Node_DF*> nodesToVisit;
+  nodesToVisit.push(lik_->getLikelihoodNode().get());
+  live.insert(nodesToVisit.top());
+  while (!nodesToVisit.empty())
+  {
+    auto* n = nodesToVisit.top();
+    nodesToVisit.pop();
+    for (const auto& dep : n->dependencies())
+    {
+      if (dep && live.insert(dep.get()).second)
+        nodesToVisit.push(dep.get());
+    }
+  }
+
+  // Parameter nodes:
+  vector<string> names;
+  vector<const Node_DF*> paramNodes;
+  for (size_t i = 0; i < parameters.size(); ++i)
+  {
+    const string& name = parameters[i].getName();
+    const auto* cp = dynamic_cast<const ConfiguredParameter*>(&lik_->parameter(name));
+    if (!cp)
+      throw Exception("ParameterBlockScheduler: parameter " + name + " is not a dataflow parameter.");
+    names.push_back(name);
+    paramNodes.push_back(cp);
+  }
+  size_t nbParams = names.size();
+
+  // Number of parameters affecting each node, and size of the
+  // affected subgraphs:
+  unordered_map<const Node_DF*, size_t> nbAffecting;
+  vector<size_t> affectedSize(nbParams, 0);
+  for (size_t p = 0; p < nbParams; ++p)
+  {
+    visitDependents(*paramNodes[p], live, [&](const Node_DF* n) {
+          nbAffecting[n]++;
+          affectedSize[p]++;
+        });
+  }
+
+  // Coupling of parameters through nodes outside the trunk:
+  vector<size_t> parent(nbParams);
+  iota(parent.begin(), parent.end(), 0);
+  unordered_map<const Node_DF*, size_t> owner;
+  for (size_t p = 0; p < nbParams; ++p)
+  {
+    visitDependents(*paramNodes[p], live, [&](const Node_DF* n) {
+          if (nbAffecting[n] == nbParams)
+            return;
+          auto it = owner.find(n);
+          if (it == owner.end())
+            owner[n] = p;
+          else
+            parent[findRoot(parent, p)] = findRoot(parent, it->second);
+        });
+  }
+
+  // Blocks, per component and kind of parameters:
+  vector<string> brlenNames = lik_->getBranchLengthParameters().getParameterNames();
+  unordered_set<string> brlen(brlenNames.begin(), brlenNames.end());
+  unordered_map<size_t, size_t> componentIndex;
+  map<pair<size_t, bool>, size_t> blockIndex;
+  for (size_t p = 0; p < nbParams; ++p)
+  {
+    if (affectedSize[p] == 0)
+      continue;
+    size_t root = findRoot(parent, p);
+    if (componentIndex.find(root) == componentIndex.end())
+    {
+      size_t c = componentIndex.size();
+      componentIndex[root] = c;
+    }
+    size_t c = componentIndex[root];
+    bool isBrLen = brlen.count(names[p]) != 0;
+    auto key = make_pair(c, isBrLen);
+    if (blockIndex.find(key) == blockIndex.end())
+    {
+      blockIndex[key] = blocks_.size();
+      Block block;
+      block.name = string(isBrLen ? "Branch length parameters" : "Other parameters") + " " + TextTools::toString(c + 1);
+      block.branchLengths = isBrLen;
+      block.component = c;
+      block.affectedSize = 0;
+      block.concurrent = false;
+      block.member = 0;
+      block.time = 0;
+      block.nbEvaluations = 0;
+      blocks_.push_back(block);
+    }
+    blocks_[blockIndex[key]].parameterNames.push_back(names[p]);
+  }
+  nbComponents_ = componentIndex.size();
+
+  // Size of the union of the affected subgraphs of each block:
+  for (auto& block : blocks_)
+  {
+    unordered_set<const Node_DF*> affected;
+    for (const auto& name : block.parameterNames)
+    {
+      visitDependents(dynamic_cast<const ConfiguredParameter&>(lik_->parameter(name)), live, [&](const Node_DF* n) {
+            affected.insert(n);
+          });
+    }
+    block.affectedSize = affected.size();
+  }
+
+  // Blocks optimized concurrently, on the members of a product:
+  auto product = dynamic_pointer_cast<AlignedPhyloLikelihoodProduct>(lik_);
+  if (product)
+  {
+    for (auto n : product->getNumbersOfPhyloLikelihoods())
+    {
+      members_.push_back(product->getPhyloLikelihood(n));
+    }
+
+    // Name of each value node in each member, and number of members
+    // using it:
+    vector<unordered_map<const Node_DF*, string>> memberNames(members_.size());
+    unordered_map<const Node_DF*, size_t> nbUsers;
+    for (size_t i = 0; i < members_.size(); ++i)
+    {
+      const auto& pl = members_[i]->getParameters();
+      for (size_t j = 0; j < pl.size(); ++j)
+      {
+        auto cp = dynamic_pointer_cast<ConfiguredParameter>(pl.getParameter(j));
+        if (cp && memberNames[i].emplace(cp->dependency(0).get(), pl[j].getName()).second)
+          nbUsers[cp->dependency(0).get()]++;
+      }
+    }
+
+    for (auto& block : blocks_)
+    {
+      for (size_t i = 0; i < members_.size() && !block.concurrent; ++i)
+      {
+        vector<string> memberParameterNames;
+        for (const auto& name : block.parameterNames)
+        {
+          const Node_DF* valueNode = dynamic_cast<const ConfiguredParameter&>(lik_->parameter(name)).dependency(0).get();
+          auto it = memberNames[i].find(valueNode);
+          if (it == memberNames[i].end() || nbUsers[valueNode] != 1)
+            break;
+          memberParameterNames.push_back(it->second);
+        }
+        if (memberParameterNames.size() == block.parameterNames.size())
+        {
+          block.concurrent = true;
+          block.member = i;
+          block.memberParameterNames = memberParameterNames;
+        }
+      }
+    }
+
+    // Computations use the objects of the graph (models,
+    // distributions...) themselves: members sharing such an object
+    // are in the same group, optimized in the same thread.
+    memberGroup_.resize(members_.size());
+    iota(memberGroup_.begin(), memberGroup_.end(), 0);
+    unordered_map<const Node_DF*, size_t> objectUser;
+    for (size_t i = 0; i < members_.size(); ++i)
+    {
+      unordered_set<const Node_DF*> visited;
+      nodesToVisit.push(members_[i]->getLikelihoodNode().get());
+      while (!nodesToVisit.empty())
+      {
+        auto* n = nodesToVisit.top();
+        nodesToVisit.pop();
+        if (!visited.insert(n).second)
+          continue;
+        if (dynamic_cast<const Parametrizable*>(n))
+        {
+          auto it = objectUser.find(n);
+          if (it == objectUser.end())
+            objectUser[n] = i;
+          else
+            memberGroup_[findRoot(memberGroup_, i)] = findRoot(memberGroup_, it->second);
+        }
+        for (const auto& dep : n->dependencies())
+        {
+          if (dep)
+            nodesToVisit.push(dep.get());
+        }
+      }
+    }
+    for (size_t i = 0; i < members_.size(); ++i)
+    {
+      memberGroup_[i] = findRoot(memberGroup_, i);
+    }
+  }
+
+  // Batches: the k-th largest block of each component.
+  vector<vector<size_t>> perComponent(nbComponents_);
+  for (size_t b = 0; b < blocks_.size(); ++b)
+  {
+    perComponent[blocks_[b].component].push_back(b);
+  }
+  for (auto& component : perComponent)
+  {
+    sort(component.begin(), component.end(), [this](size_t a, size_t b) {
+          return blocks_[a].affectedSize > blocks_[b].affectedSize;
+        });
+    for (size_t k = 0; k < component.size(); ++k)
+    {
+      if (batches_.size() <= k)
+        batches_.resize(k + 1);
+      batches_[k].push_back(component[k]);
+    }
+  }
+}
+
+/******************************************************************************/
+
+unsigned int ParameterBlockScheduler::optimizeBlock_(
+    Block& block,
+    shared_ptr<PhyloLikelihoodInterface> lik,
+    const vector<string>& parameterNames,
+    unsigned int nbEvalMax)
+{
+  auto start = chrono::steady_clock::now();
+
+  unique_ptr<OptimizerInterface> optimizer;
+  if (block.branchLengths)
+    optimizer = make_unique<PseudoNewtonOptimizer>(lik);
+  else
+    optimizer = make_unique<SimpleMultiDimensions>(lik);
+  optimizer->setVerbose(0);
+  optimizer->setProfiler(nullptr);
+  optimizer->setMessageHandler(nullptr);
+  optimizer->setMaximumNumberOfEvaluations(nbEvalMax);
+  optimizer->getStopCondition()->setTolerance(tolerance_);
+  optimizer->setConstraintPolicy(AutoParameter::CONSTRAINTS_AUTO);
+  optimizer->init(lik->getParameters().createSubList(parameterNames));
+  optimizer->optimize();
+
+  block.time += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  block.nbEvaluations += optimizer->getNumberOfEvaluations();
+  return optimizer->getNumberOfEvaluations();
+}
+
+/******************************************************************************/
+
+unsigned int ParameterBlockScheduler::optimize(unsigned int nbRounds)
+{
+  unsigned int nbEval = 0;
+  double value = lik_->getValue();
+  for (unsigned int round = 0; round < nbRounds && nbEval < nbEvalMax_; ++round)
+  {
+    double roundStart = value;
+    for (const auto& batch : batches_)
+    {
+      if (nbEval >= nbEvalMax_)
+        break;
+
+      // Concurrent blocks, per group of members:
+      map<size_t, vector<size_t>> groupBlocks;
+      vector<size_t> sequential;
+      for (auto b : batch)
+      {
+        if (blocks_[b].concurrent)
+          groupBlocks[memberGroup_[blocks_[b].member]].push_back(b);
+        else
+          sequential.push_back(b);
+      }
+      vector<vector<size_t>> groups;
+      for (const auto& g : groupBlocks)
+      {
+        groups.push_back(g.second);
+      }
+
+      // The nodes depending on the parameters of the concurrent blocks
+      // are invalidated before the parallel step, so that the threads
+      // only invalidate the nodes of their own members.
+      for (const auto& group : groups)
+      {
+        for (auto b : group)
+        {
+          for (const auto& name : blocks_[b].parameterNames)
+          {
+            dynamic_cast<const ConfiguredParameter&>(lik_->parameter(name)).dependency(0)->invalidateDependentNodes();
+          }
+        }
+      }
+
+      unsigned int batchEvalMax = nbEvalMax_ - nbEval;
+      vector<unsigned int> groupEval(groups.size(), 0);
+      string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (size_t k = 0; k < groups.size(); ++k)
+      {
+        try
+        {
+          for (auto b : groups[k])
+          {
+            Block& block = blocks_[b];
+            groupEval[k] += optimizeBlock_(block, members_[block.member], block.memberParameterNames, batchEvalMax);
+          }
+        }
+        catch (exception& e)
+        {
+#ifdef _OPENMP
+#pragma omp critical (ParameterBlockScheduler_optimize_error)
+#endif
+          if (errorMessage == "")
+            errorMessage = e.what();
+        }
+      }
+      if (errorMessage != "")
+        throw Exception("ParameterBlockScheduler::optimize. " + errorMessage);
+      for (auto n : groupEval)
+      {
+        nbEval += n;
+      }
+
+      // Blocks which need the trunk:
+      for (auto b : sequential)
+      {
+        if (nbEval >= nbEvalMax_)
+          break;
+        Block& block = blocks_[b];
+        nbEval += optimizeBlock_(block, lik_, block.parameterNames, nbEvalMax_ - nbEval);
+      }
+    }
+    value = lik_->getValue();
+    if (std::abs(roundStart - value) < tolerance_)
+      break;
+  }
+  return nbEval;
+}
+
+/******************************************************************************/
+
+void ParameterBlockScheduler::printReport(OutputStream& out) const
+{
+  for (size_t k = 0; k < batches_.size(); ++k)
+  {
+    out << "Batch " << TextTools::toString(k + 1) << ":";
+    out.endLine();
+    for (auto b : batches_[k])
+    {
+      const Block& block = blocks_[b];
+      out << "  " << block.name << " (" << TextTools::toString(block.parameterNames.size()) << " parameters, "
+          << TextTools::toString(block.affectedSize) << " nodes): "
+          << TextTools::toString(block.nbEvaluations) << " evaluations, "
+          << TextTools::toString(block.time) << " s"
+          << (block.concurrent ? " (concurrent)" : "");
+      out.endLine();
+    }
+  }
+  out.flush();
+}
+
+/******************************************************************************/
@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_PARAMETERBLOCKSCHEDULER_H
+#define BPP_PHYL_PARAMETERBLOCKSCHEDULER_H
+
+#include <Bpp/Io/OutputStream.h>
+#include <Bpp/Numeric/ParameterList.h>
+
+#include "Likelihood/PhyloLikelihoods/PhyloLikelihood.h"
+
+// From the STL:
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Block-coordinate optimization of the parameters of a phylo
+ * likelihood, scheduled from the dataflow graph.
+ *
+ * For each parameter, the set of nodes of the likelihood graph that
+ * depend on it (its affected subgraph) is computed. Nodes affected by
+ * all the parameters (the sums at the top of the graph) form the
+ * trunk. Two parameters are coupled if their affected subgraphs share
+ * a node outside the trunk: connected groups of coupled parameters are
+ * independent components (for instance the parameters of different
+ * partitions with unlinked models).
+ *
+ * Within each component, parameters are split in blocks, branch
+ * lengths on one side (optimized with PseudoNewtonOptimizer) and other
+ * parameters on the other side (optimized with Brent's method in each
+ * direction). Blocks are ordered by decreasing affected subgraph size
+ * within their component, and batch k gathers the k-th block of each
+ * component: blocks in a batch change disjoint parts of the graph.
+ *
+ * Since the dataflow graph only recomputes invalidated nodes, each
+ * function evaluation in a block only recomputes its affected
+ * subgraph.
+ *
+ * The blocks of a batch are optimized concurrently when the likelihood
+ * is an AlignedPhyloLikelihoodProduct, whose value is the sum of the
+ * values of its members: a block whose parameters all belong to one
+ * member is optimized on this member, without computing the trunk.
+ * Blocks of members sharing an object node (model, distribution...)
+ * are optimized in the same thread (see the threading contract of
+ * Context). Other blocks, whose optimization needs the trunk, are
+ * optimized one after the other on the whole likelihood.
+ *
+ * Time and number of function evaluations are recorded per block.
+ */
+class ParameterBlockScheduler
+{
+public:
+  struct Block
+  {
+    std::string name;
+    std::vector<std::string> parameterNames;
+    bool branchLengths;
+    size_t component;
+    /**
+     * @brief Number of nodes recomputed when the parameters of the block change.
+     */
+    size_t affectedSize;
+    /**
+     * @brief If the block is optimized concurrently, the member of the
+     * product it is optimized on, and the names of its parameters in
+     * this member.
+     */
+    bool concurrent;
+    size_t member;
+    std::vector<std::string> memberParameterNames;
+    /**
+     * @brief Time spent optimizing the block, in seconds.
+     */
+    double time;
+    unsigned int nbEvaluations;
+  };
+
+private:
+  std::shared_ptr<PhyloLikelihoodInterface> lik_;
+
+  std::vector<Block> blocks_;
+
+  std::vector<std::vector<size_t>> batches_;
+
+  /**
+   * @brief Members of the product, if lik_ is a product, and groups of
+   * members sharing object nodes.
+   */
+  std::vector<std::shared_ptr<PhyloLikelihoodInterface>> members_;
+  std::vector<size_t> memberGroup_;
+
+  size_t nbComponents_;
+
+  double tolerance_;
+
+  unsigned int nbEvalMax_;
+
+public:
+  /**
+   * @param lik        The likelihood to optimize.
+   * @param parameters The parameters to optimize. Parameters that do
+   *                   not change the likelihood are ignored.
+   */
+  ParameterBlockScheduler(
+      std::shared_ptr<PhyloLikelihoodInterface> lik,
+      const ParameterList& parameters);
+
+  virtual ~ParameterBlockScheduler() {}
+
+public:
+  const std::vector<Block>& getBlocks() const { return blocks_; }
+
+  /**
+   * @return The batches, as indices of blocks.
+   */
+  const std::vector<std::vector<size_t>>& getBatches() const { return batches_; }
+
+  size_t getNumberOfComponents() const { return nbComponents_; }
+
+  void setTolerance(double tolerance) { tolerance_ = tolerance; }
+
+  void setMaximumNumberOfEvaluations(unsigned int nbEvalMax) { nbEvalMax_ = nbEvalMax; }
+
+  /**
+   * @brief Optimize all blocks, batch after batch, until the
+   * likelihood improves by less than the tolerance during a round.
+   * The concurrent blocks of a batch are optimized in parallel when
+   * OpenMP is available.
+   *
+   * @param nbRounds The maximum number of rounds.
+   * @return The number of function evaluations.
+   */
+  unsigned int optimize(unsigned int nbRounds = 100);
+
+  /**
+   * @brief Print the blocks, with the time spent in each of them.
+   */
+  void printReport(OutputStream& out) const;
+
+private:
+  /**
+   * @brief Optimize the parameters of a block on a likelihood.
+   *
+   * @return The number of function evaluations.
+   */
+  unsigned int optimizeBlock_(
+      Block& block,
+      std::shared_ptr<PhyloLikelihoodInterface> lik,
+      const std::vector<std::string>& parameterNames,
+      unsigned int nbEvalMax);
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_PARAMETERBLOCKSCHEDULER_H
@@ -62,8 +62,6 @@ void AbstractTreeParsimonyScore::init_(shared_ptr<const SiteContainerInterface>
     throw Exception("Error, only 1 sequence!");
   if (data_->getNumberOfSequences() == 0)
     throw Exception("Error, no sequence!");
-  if (data_->getAlphabet()->getSize() > 20)
-    throw Exception("Error, only alphabet with size <= 20 are supported. See the source file of AbstractTreeParsimonyScore.");
 }
 
 std::vector<unsigned int> AbstractTreeParsimonyScore::getScorePerSite() const
@@ -0,0 +1,648 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Numeric/VectorTools.h>
+
+#include "../SitePatterns.h"
+#include "../Tree/TreeTemplateTools.h" // Needed for NNIs
+#include "BitParallelTreeParsimonyScore.h"
+
+// From SeqLib:
+#include <Bpp/Seq/Container/AlignedSequenceContainer.h>
+
+// From the STL:
+#include <algorithm>
+#include <bitset>
+#include <limits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+BitParallelTreeParsimonyScore::BitParallelTreeParsimonyScore(
+    shared_ptr<TreeTemplate<Node>> tree,
+    shared_ptr<const SiteContainerInterface> data,
+    bool verbose,
+    bool includeGaps) :
+  AbstractTreeParsimonyScore(tree, data, verbose, includeGaps),
+  nbStates_(0),
+  nbPatterns_(0),
+  nbWords_(0),
+  patternLinks_(),
+  weightPlanes_(),
+  nbWeightPlanes_(0),
+  nodeIndex_(),
+  planes_(),
+  scores_(),
+  rootPlanes_(),
+  score_(0),
+  any_(),
+  patternScores_(),
+  patternScoresUpToDate_(false)
+{
+  init_(data, verbose);
+}
+
+BitParallelTreeParsimonyScore::BitParallelTreeParsimonyScore(
+    shared_ptr<TreeTemplate<Node>> tree,
+    shared_ptr<const SiteContainerInterface> data,
+    shared_ptr<const StateMapInterface> statesMap,
+    bool verbose) :
+  AbstractTreeParsimonyScore(tree, data, statesMap, verbose),
+  nbStates_(0),
+  nbPatterns_(0),
+  nbWords_(0),
+  patternLinks_(),
+  weightPlanes_(),
+  nbWeightPlanes_(0),
+  nodeIndex_(),
+  planes_(),
+  scores_(),
+  rootPlanes_(),
+  score_(0),
+  any_(),
+  patternScores_(),
+  patternScoresUpToDate_(false)
+{
+  init_(data, verbose);
+}
+
+void BitParallelTreeParsimonyScore::init_(shared_ptr<const SiteContainerInterface> data, bool verbose)
+{
+  if (verbose)
+    ApplicationTools::displayTask("Initializing data structure");
+
+  if (treeTemplate().getRootNode()->isLeaf())
+    throw Exception("BitParallelTreeParsimonyScore::init_. The tree must not be rooted on a leaf.");
+
+  auto stateMap = getStateMap();
+  nbStates_ = stateMap->getNumberOfModelStates();
+
+  // Compress sites:
+  SitePatterns patterns(*data);
+  shared_ptr<const SiteContainerInterface> shrunkData(dynamic_cast<SiteContainerInterface*>(patterns.getSites().release()));
+  if (!shrunkData)
+    throw Exception("BitParallelTreeParsimonyScore::init_ : Data must be plain alignments.");
+
+  const vector<unsigned int>& weights = patterns.getWeights();
+  patternLinks_.resize(size_t(patterns.getIndices().size()));
+  SitePatterns::IndicesType::Map(&patternLinks_[0], patterns.getIndices().size()) = patterns.getIndices();
+  nbPatterns_ = shrunkData->getNumberOfSites();
+  nbWords_ = (nbPatterns_ + 63) / 64;
+
+  // Weights as bit-planes, padding patterns having a null weight:
+  unsigned int maxWeight = weights.size() > 0 ? VectorTools::max(weights) : 0;
+  nbWeightPlanes_ = 0;
+  while (maxWeight >> nbWeightPlanes_)
+  {
+    nbWeightPlanes_++;
+  }
+  weightPlanes_.assign(nbWeightPlanes_ * nbWords_, 0);
+  for (size_t i = 0; i < nbPatterns_; ++i)
+  {
+    for (size_t k = 0; k < nbWeightPlanes_; ++k)
+    {
+      if ((weights[i] >> k) & 1)
+        weightPlanes_[k * nbWords_ + i / 64] |= uint64_t(1) << (i % 64);
+    }
+  }
+
+  // Node positions:
+  vector<const Node*> nodes = treeTemplate().getNodes();
+  int maxId = 0;
+  for (auto node : nodes)
+  {
+    if (node->getId() < 0)
+      throw NodeException("BitParallelTreeParsimonyScore::init_. Node ids must not be negative.", node->getId());
+    maxId = max(maxId, node->getId());
+  }
+  nodeIndex_.assign(static_cast<size_t>(maxId) + 1, 0);
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    nodeIndex_[static_cast<size_t>(nodes[i]->getId())] = i;
+  }
+  planes_.assign(2 * nodes.size() * nbStates_ * nbWords_, 0);
+  scores_.assign(2 * nodes.size(), 0);
+  rootPlanes_.assign(nbStates_ * nbWords_, 0);
+  any_.assign(nbWords_, 0);
+
+  // Leaves, which do not change with topology:
+  // Clone data for more efficiency on sequences access:
+  AlignedSequenceContainer sequences(*shrunkData);
+  auto alphabet = sequences.getAlphabet();
+  for (auto node : nodes)
+  {
+    if (!node->isLeaf())
+      continue;
+    const Sequence* seq;
+    try
+    {
+      seq = &sequences.sequence(node->getName());
+    }
+    catch (SequenceNotFoundException& snfe)
+    {
+      throw SequenceNotFoundException("BitParallelTreeParsimonyScore::init_. Leaf name in tree not found in site container: ", (node->getName()));
+    }
+    uint64_t* leafPlanes = slotPlanes_(downSlot_(node));
+    for (size_t i = 0; i < nbPatterns_; ++i)
+    {
+      // Bits are set to 1 if the char correspond to the site in the sequence,
+      // otherwise value set to 0:
+      vector<int> states = alphabet->getAlias(seq->getValue(i));
+      for (size_t s = 0; s < nbStates_; ++s)
+      {
+        if (find(states.begin(), states.end(), stateMap->getAlphabetStateAsInt(s)) != states.end())
+          leafPlanes[s * nbWords_ + i / 64] |= uint64_t(1) << (i % 64);
+      }
+    }
+  }
+
+  computeScores();
+  if (verbose)
+    ApplicationTools::displayTaskDone();
+  if (verbose)
+    ApplicationTools::displayResult("Number of distinct sites",
+        TextTools::toString(nbPatterns_));
+}
+
+/******************************************************************************/
+
+void BitParallelTreeParsimonyScore::computeScores()
+{
+  patternScoresUpToDate_ = false;
+  const Node* root = treeTemplate().getRootNode();
+  computeScoresPostorder_(root);
+  computeScoresPreorder_(root);
+
+  vector<const uint64_t*> iPlanes;
+  unsigned int score = 0;
+  for (size_t k = 0; k < root->getNumberOfSons(); ++k)
+  {
+    size_t slot = downSlot_(root->getSon(k));
+    iPlanes.push_back(slotPlanes_(slot));
+    score += scores_[slot];
+  }
+  score_ = score + fitch_(iPlanes, &rootPlanes_[0], nullptr);
+}
+
+void BitParallelTreeParsimonyScore::computeScoresPostorder_(const Node* node)
+{
+  if (node->isLeaf())
+    return;
+  for (size_t k = 0; k < node->getNumberOfSons(); ++k)
+  {
+    computeScoresPostorder_(node->getSon(k));
+  }
+  // The root is dealt with in computeScores:
+  if (node->hasFather())
+    computeDown_(node);
+}
+
+void BitParallelTreeParsimonyScore::computeDown_(const Node* node)
+{
+  vector<const uint64_t*> iPlanes;
+  unsigned int score = 0;
+  for (size_t k = 0; k < node->getNumberOfSons(); ++k)
+  {
+    size_t slot = downSlot_(node->getSon(k));
+    iPlanes.push_back(slotPlanes_(slot));
+    score += scores_[slot];
+  }
+  size_t slot = downSlot_(node);
+  scores_[slot] = score + fitch_(iPlanes, slotPlanes_(slot), nullptr);
+}
+
+void BitParallelTreeParsimonyScore::computeScoresPreorder_(const Node* node)
+{
+  for (size_t k = 0; k < node->getNumberOfSons(); ++k)
+  {
+    const Node* son = node->getSon(k);
+    if (son->isLeaf())
+      continue;
+    size_t slot = upSlot_(son);
+    scores_[slot] = computeUp_(son, slotPlanes_(slot));
+    computeScoresPreorder_(son);
+  }
+}
+
+unsigned int BitParallelTreeParsimonyScore::computeUp_(const Node* node, uint64_t* oPlanes) const
+{
+  const Node* father = node->getFather();
+  vector<const uint64_t*> iPlanes;
+  unsigned int score = 0;
+  if (father->hasFather())
+  {
+    size_t slot = upSlot_(father);
+    iPlanes.push_back(slotPlanes_(slot));
+    score += scores_[slot];
+  }
+  for (size_t k = 0; k < father->getNumberOfSons(); ++k)
+  {
+    const Node* brother = father->getSon(k);
+    if (brother == node)
+      continue;
+    size_t slot = downSlot_(brother);
+    iPlanes.push_back(slotPlanes_(slot));
+    score += scores_[slot];
+  }
+  return score + fitch_(iPlanes, oPlanes, nullptr);
+}
+
+/******************************************************************************/
+
+unsigned int BitParallelTreeParsimonyScore::fitch_(
+    const vector<const uint64_t*>& iPlanes,
+    uint64_t* oPlanes,
+    unsigned int* patternScores) const
+{
+  if (iPlanes.size() < 1)
+    throw Exception("BitParallelTreeParsimonyScore::fitch_(); Error, input arrays must have a size >= 1.");
+  if (iPlanes[0] != oPlanes)
+    copy(iPlanes[0], iPlanes[0] + nbStates_ * nbWords_, oPlanes);
+  unsigned int changes = 0;
+  for (size_t k = 1; k < iPlanes.size(); ++k)
+  {
+    changes += fitchPair_(oPlanes, iPlanes[k], patternScores);
+  }
+  return changes;
+}
+
+unsigned int BitParallelTreeParsimonyScore::fitchPair_(
+    uint64_t* aPlanes,
+    const uint64_t* bPlanes,
+    unsigned int* patternScores) const
+{
+  intersect_(aPlanes, bPlanes);
+  const uint64_t* any = &any_[0];
+
+  // Intersection if not empty, union otherwise:
+  for (size_t s = 0; s < nbStates_; ++s)
+  {
+    uint64_t* a = aPlanes + s * nbWords_;
+    const uint64_t* b = bPlanes + s * nbWords_;
+    size_t w = 0;
+#ifdef __AVX2__
+    for ( ; w + 4 <= nbWords_; w += 4)
+    {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+      __m256i vany = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(any + w));
+      __m256i vres = _mm256_or_si256(_mm256_and_si256(va, vb), _mm256_andnot_si256(vany, _mm256_or_si256(va, vb)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + w), vres);
+    }
+#endif
+    for ( ; w < nbWords_; ++w)
+    {
+      a[w] = (a[w] & b[w]) | ((a[w] | b[w]) & ~any[w]);
+    }
+  }
+
+  return countChanges_(patternScores);
+}
+
+unsigned int BitParallelTreeParsimonyScore::fitchCount_(
+    const uint64_t* aPlanes,
+    const uint64_t* bPlanes) const
+{
+  intersect_(aPlanes, bPlanes);
+  return countChanges_(nullptr);
+}
+
+void BitParallelTreeParsimonyScore::intersect_(
+    const uint64_t* aPlanes,
+    const uint64_t* bPlanes) const
+{
+  uint64_t* any = &any_[0];
+
+  // Patterns with a non empty intersection:
+  fill(any_.begin(), any_.end(), 0);
+  for (size_t s = 0; s < nbStates_; ++s)
+  {
+    const uint64_t* a = aPlanes + s * nbWords_;
+    const uint64_t* b = bPlanes + s * nbWords_;
+    size_t w = 0;
+#ifdef __AVX2__
+    for ( ; w + 4 <= nbWords_; w += 4)
+    {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+      __m256i vany = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(any + w));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(any + w), _mm256_or_si256(vany, _mm256_and_si256(va, vb)));
+    }
+#endif
+    for ( ; w < nbWords_; ++w)
+    {
+      any[w] |= a[w] & b[w];
+    }
+  }
+}
+
+unsigned int BitParallelTreeParsimonyScore::countChanges_(unsigned int* patternScores) const
+{
+  // Count changes, weighted by the number of sites of each pattern:
+  unsigned int changes = 0;
+  for (size_t w = 0; w < nbWords_; ++w)
+  {
+    uint64_t m = ~any_[w];
+    for (size_t k = 0; k < nbWeightPlanes_; ++k)
+    {
+      changes += static_cast<unsigned int>(bitset<64>(m & weightPlanes_[k * nbWords_ + w]).count()) << k;
+    }
+    if (patternScores)
+    {
+      for (size_t j = 0; j < 64 && w * 64 + j < nbPatterns_; ++j)
+      {
+        if ((m >> j) & 1)
+          patternScores[w * 64 + j]++;
+      }
+    }
+  }
+  return changes;
+}
+
+/******************************************************************************/
+
+void BitParallelTreeParsimonyScore::computePatternScores_() const
+{
+  patternScores_.assign(nbPatterns_, 0);
+  vector<uint64_t> work(nbStates_ * nbWords_);
+  // Each change of the tree occurs while merging the sons of an inner node:
+  vector<const Node*> innerNodes = treeTemplate().getInnerNodes();
+  for (auto node : innerNodes)
+  {
+    vector<const uint64_t*> iPlanes;
+    for (size_t k = 0; k < node->getNumberOfSons(); ++k)
+    {
+      iPlanes.push_back(slotPlanes_(downSlot_(node->getSon(k))));
+    }
+    fitch_(iPlanes, &work[0], &patternScores_[0]);
+  }
+  patternScoresUpToDate_ = true;
+}
+
+unsigned int BitParallelTreeParsimonyScore::getScoreForSite(size_t site) const
+{
+  if (!patternScoresUpToDate_)
+    computePatternScores_();
+  return patternScores_[patternLinks_[site]];
+}
+
+vector<unsigned int> BitParallelTreeParsimonyScore::getScorePerSite() const
+{
+  if (!patternScoresUpToDate_)
+    computePatternScores_();
+  vector<unsigned int> scores(patternLinks_.size());
+  for (size_t i = 0; i < scores.size(); ++i)
+  {
+    scores[i] = patternScores_[patternLinks_[i]];
+  }
+  return scores;
+}
+
+/******************************************************************************/
+
+double BitParallelTreeParsimonyScore::testNNI(int nodeId) const
+{
+  const Node* son = treeTemplate().getNode(nodeId);
+  if (!son->hasFather())
+    throw NodePException("BitParallelTreeParsimonyScore::testNNI(). Node 'son' must not be the root node.", son);
+  const Node* parent = son->getFather();
+  if (!parent->hasFather())
+    throw NodePException("BitParallelTreeParsimonyScore::testNNI(). Node 'parent' must not be the root node.", parent);
+  const Node* grandFather = parent->getFather();
+  // From here: Bifurcation assumed.
+  // In case of multifurcation, an arbitrary uncle is chosen.
+  // If we are at root node with a trifurcation, this does not matter, since 2 NNI are possible (see doc of the NNISearchable interface).
+  size_t parentPosition = grandFather->getSonPosition(parent);
+  const Node* uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
+
+  // Grand-father node, with son instead of uncle:
+  vector<const uint64_t*> gfPlanes;
+  unsigned int gfScore = 0;
+  if (grandFather->hasFather())
+  {
+    gfPlanes.push_back(slotPlanes_(upSlot_(grandFather)));
+    gfScore += scores_[upSlot_(grandFather)];
+  }
+  for (size_t k = 0; k < grandFather->getNumberOfSons(); ++k)
+  {
+    const Node* n = grandFather->getSon(k);
+    if (n != parent && n != uncle)
+    {
+      gfPlanes.push_back(slotPlanes_(downSlot_(n)));
+      gfScore += scores_[downSlot_(n)];
+    }
+  }
+  gfPlanes.push_back(slotPlanes_(downSlot_(son)));
+  gfScore += scores_[downSlot_(son)];
+  vector<uint64_t> gfWork(nbStates_ * nbWords_);
+  gfScore += fitch_(gfPlanes, &gfWork[0], nullptr);
+
+  // Parent node, with uncle instead of son:
+  vector<const uint64_t*> pPlanes;
+  unsigned int score = 0;
+  for (size_t k = 0; k < parent->getNumberOfSons(); ++k)
+  {
+    const Node* n = parent->getSon(k);
+    if (n != son)
+    {
+      pPlanes.push_back(slotPlanes_(downSlot_(n)));
+      score += scores_[downSlot_(n)];
+    }
+  }
+  pPlanes.push_back(slotPlanes_(downSlot_(uncle)));
+  score += scores_[downSlot_(uncle)];
+  pPlanes.push_back(&gfWork[0]);
+  score += gfScore;
+  vector<uint64_t> pWork(nbStates_ * nbWords_);
+  score += fitch_(pPlanes, &pWork[0], nullptr);
+
+  return (double)score - (double)getScore();
+}
+
+/******************************************************************************/
+
+void BitParallelTreeParsimonyScore::doNNI(int nodeId)
+{
+  Node* son = treeTemplate_().getNode(nodeId);
+  if (!son->hasFather())
+    throw NodePException("BitParallelTreeParsimonyScore::doNNI(). Node 'son' must not be the root node.", son);
+  Node* parent = son->getFather();
+  if (!parent->hasFather())
+    throw NodePException("BitParallelTreeParsimonyScore::doNNI(). Node 'parent' must not be the root node.", parent);
+  Node* grandFather = parent->getFather();
+  // From here: Bifurcation assumed.
+  // In case of multifurcation, an arbitrary uncle is chosen.
+  // If we are at root node with a trifurcation, this does not matter, since 2 NNI are possible (see doc of the NNISearchable interface).
+  size_t parentPosition = grandFather->getSonPosition(parent);
+  Node* uncle = grandFather->getSon(parentPosition > 1 ? parentPosition - 1 : 1 - parentPosition);
+  // Swap nodes:
+  parent->removeSon(son);
+  grandFather->removeSon(uncle);
+  parent->addSon(uncle);
+  grandFather->addSon(son);
+}
+
+/******************************************************************************/
+
+bool BitParallelTreeParsimonyScore::isSPRPossible(int nodeId) const
+{
+  const Node* son = treeTemplate().getNode(nodeId);
+  if (!son->hasFather())
+    return false;
+  const Node* parent = son->getFather();
+  return parent->hasFather() && parent->getNumberOfSons() == 2;
+}
+
+Node* BitParallelTreeParsimonyScore::prune_(Node* son, size_t& sisterPosition)
+{
+  Node* parent = son->getFather();
+  Node* grandFather = parent->getFather();
+  Node* sister = parent->getSon(parent->getSonPosition(son) == 0 ? 1 : 0);
+  size_t parentPosition = grandFather->getSonPosition(parent);
+  sisterPosition = parent->getSonPosition(sister);
+  parent->removeSon(sister);
+  grandFather->setSon(parentPosition, sister);
+  parent->removeFather();
+  return sister;
+}
+
+void BitParallelTreeParsimonyScore::regraft_(Node* parent, Node* target, size_t position)
+{
+  Node* father = target->getFather();
+  father->setSon(father->getSonPosition(target), parent);
+  parent->addSon(min(position, parent->getNumberOfSons()), target);
+}
+
+double BitParallelTreeParsimonyScore::testSPR(int nodeId, int& targetId)
+{
+  if (!isSPRPossible(nodeId))
+    throw NodeException("BitParallelTreeParsimonyScore::testSPR(). The subtree can not be pruned.", nodeId);
+  Node* son = treeTemplate_().getNode(nodeId);
+  Node* parent = son->getFather();
+  Node* grandFather = parent->getFather();
+  size_t sisterPosition;
+  Node* sister = prune_(son, sisterPosition);
+
+  // Only the subtrees of the nodes from the pruning point to the root
+  // change, the arrays of the other subtrees and the up arrays of these
+  // nodes being still valid. The changed arrays are saved and updated:
+  size_t slotSize = nbStates_ * nbWords_;
+  vector<const Node*> path;
+  for (const Node* node = grandFather; node->hasFather(); node = node->getFather())
+  {
+    path.push_back(node);
+  }
+  vector<uint64_t> savedPlanes(path.size() * slotSize);
+  vector<unsigned int> savedScores(path.size());
+  for (size_t i = 0; i < path.size(); ++i)
+  {
+    size_t slot = downSlot_(path[i]);
+    copy(slotPlanes_(slot), slotPlanes_(slot) + slotSize, &savedPlanes[i * slotSize]);
+    savedScores[i] = scores_[slot];
+    computeDown_(path[i]);
+  }
+
+  // The subtree arrays are unchanged by the pruning:
+  size_t sonSlot = downSlot_(son);
+
+  // Score the insertion on the branch above each node of the pruned tree.
+  // The up arrays of the pruned tree are computed on the fly, one per depth:
+  const Node* root = treeTemplate().getRootNode();
+  vector< vector<uint64_t> > upWork(TreeTemplateTools::getDepth(*root) + 2, vector<uint64_t>(slotSize));
+  unsigned int bestScore = numeric_limits<unsigned int>::max();
+  testRegrafts_(root, nullptr, 0, slotPlanes_(sonSlot), 0, upWork, bestScore, targetId);
+  bestScore += scores_[sonSlot];
+
+  // Restore the original topology and arrays:
+  regraft_(parent, sister, sisterPosition);
+  for (size_t i = 0; i < path.size(); ++i)
+  {
+    size_t slot = downSlot_(path[i]);
+    copy(&savedPlanes[i * slotSize], &savedPlanes[(i + 1) * slotSize], slotPlanes_(slot));
+    scores_[slot] = savedScores[i];
+  }
+  return (double)bestScore - (double)getScore();
+}
+
+void BitParallelTreeParsimonyScore::testRegrafts_(
+    const Node* node,
+    const uint64_t* upPlanes,
+    unsigned int upScore,
+    const uint64_t* sonPlanes,
+    size_t depth,
+    vector< vector<uint64_t> >& upWork,
+    unsigned int& bestScore,
+    int& targetId) const
+{
+  vector<const uint64_t*> iPlanes;
+  uint64_t* work = &upWork[depth + 1][0];
+  if (node->hasFather())
+  {
+    size_t slot = downSlot_(node);
+    iPlanes.push_back(slotPlanes_(slot));
+    iPlanes.push_back(upPlanes);
+    unsigned int score = scores_[slot] + upScore + fitch_(iPlanes, work, nullptr);
+    score += fitchCount_(work, sonPlanes);
+    if (score < bestScore)
+    {
+      bestScore = score;
+      targetId = node->getId();
+    }
+  }
+
+  // Up arrays of the sons, stored at the next depth:
+  for (size_t k = 0; k < node->getNumberOfSons(); ++k)
+  {
+    const Node* sonNode = node->getSon(k);
+    iPlanes.clear();
+    unsigned int score = 0;
+    if (node->hasFather())
+    {
+      iPlanes.push_back(upPlanes);
+      score += upScore;
+    }
+    for (size_t l = 0; l < node->getNumberOfSons(); ++l)
+    {
+      if (l == k)
+        continue;
+      size_t slot = downSlot_(node->getSon(l));
+      iPlanes.push_back(slotPlanes_(slot));
+      score += scores_[slot];
+    }
+    score += fitch_(iPlanes, work, nullptr);
+    testRegrafts_(sonNode, work, score, sonPlanes, depth + 1, upWork, bestScore, targetId);
+  }
+}
+
+void BitParallelTreeParsimonyScore::doSPR(int nodeId, int targetId)
+{
+  if (!isSPRPossible(nodeId))
+    throw NodeException("BitParallelTreeParsimonyScore::doSPR(). The subtree can not be pruned.", nodeId);
+  Node* son = treeTemplate_().getNode(nodeId);
+  Node* parent = son->getFather();
+  Node* target = treeTemplate_().getNode(targetId);
+  size_t sisterPosition;
+  Node* sister = prune_(son, sisterPosition);
+
+  // The target must be in the pruned tree, out of the subtree:
+  const Node* node = target;
+  while (node->hasFather())
+  {
+    node = node->getFather();
+  }
+  if (node != treeTemplate().getRootNode() || target == treeTemplate().getRootNode())
+  {
+    regraft_(parent, sister, sisterPosition);
+    throw NodeException("BitParallelTreeParsimonyScore::doSPR(). Invalid regraft node.", targetId);
+  }
+  regraft_(parent, target, sisterPosition);
+  computeScores();
+}
@@ -0,0 +1,292 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_PARSIMONY_BITPARALLELTREEPARSIMONYSCORE_H
+#define BPP_PHYL_PARSIMONY_BITPARALLELTREEPARSIMONYSCORE_H
+
+
+#include "../Tree/NNISearchable.h"
+#include "AbstractTreeParsimonyScore.h"
+
+// From the STL:
+#include <cstdint>
+#include <vector>
+
+namespace bpp
+{
+/**
+ * @brief Bit-parallel implementation of interface TreeParsimonyScore.
+ *
+ * Fitch's algorithm is run on all distinct site patterns at once: the
+ * sets of states are stored as bit-planes, one 64 bits word holding one
+ * state for 64 patterns. The intersections and unions of the algorithm
+ * are then word-wise AND and OR operations, and the number of changes
+ * is obtained by counting bits (weighted by the number of sites of each
+ * pattern, also stored as bit-planes). Loops over words are vectorized
+ * with AVX2 when the library is compiled with it.
+ *
+ * The number of states is not limited, so that codon alphabets can be
+ * used.
+ *
+ * As in DRTreeParsimonyScore, the arrays are computed for both
+ * directions of each branch, so that NNI moves are evaluated without
+ * traversing the whole tree. Arrays are stored contiguously, with two
+ * slots per node: the subtree below the node, and the rest of the tree
+ * seen from the node.
+ *
+ * Scores are the same as the ones of DRTreeParsimonyScore.
+ */
+class BitParallelTreeParsimonyScore :
+  public AbstractTreeParsimonyScore,
+  public virtual NNISearchable
+{
+private:
+  size_t nbStates_;
+  size_t nbPatterns_;
+
+  /**
+   * @brief The number of 64 bits words per state.
+   */
+  size_t nbWords_;
+
+  std::vector<size_t> patternLinks_;
+
+  /**
+   * @brief The weights of the patterns, as bit-planes [bit][word].
+   */
+  std::vector<uint64_t> weightPlanes_;
+  size_t nbWeightPlanes_;
+
+  /**
+   * @brief Position of each node in the arrays, indexed by node id.
+   */
+  std::vector<size_t> nodeIndex_;
+
+  /**
+   * @brief The sets of states, as bit-planes [slot][state][word].
+   *
+   * Slot 2*i is the subtree of node i, slot 2*i+1 the rest of the tree
+   * seen from node i.
+   */
+  std::vector<uint64_t> planes_;
+
+  /**
+   * @brief The (weighted) score of each slot.
+   */
+  std::vector<unsigned int> scores_;
+
+  std::vector<uint64_t> rootPlanes_;
+  unsigned int score_;
+
+  /**
+   * @brief Work array, of one word per pattern block.
+   */
+  mutable std::vector<uint64_t> any_;
+
+  /**
+   * @brief Per pattern scores, computed on demand only.
+   */
+  mutable std::vector<unsigned int> patternScores_;
+  mutable bool patternScoresUpToDate_;
+
+public:
+  BitParallelTreeParsimonyScore(
+      std::shared_ptr<TreeTemplate<Node>> tree,
+      std::shared_ptr<const SiteContainerInterface> data,
+      bool verbose = true,
+      bool includeGaps = false);
+
+  BitParallelTreeParsimonyScore(
+      std::shared_ptr<TreeTemplate<Node>> tree,
+      std::shared_ptr<const SiteContainerInterface> data,
+      std::shared_ptr<const StateMapInterface> statesMap,
+      bool verbose = true);
+
+  virtual ~BitParallelTreeParsimonyScore() {}
+
+  BitParallelTreeParsimonyScore* clone() const override { return new BitParallelTreeParsimonyScore(*this); }
+
+private:
+  void init_(std::shared_ptr<const SiteContainerInterface> data, bool verbose);
+
+protected:
+  /**
+   * @brief Compute all arrays and the total score.
+   */
+  virtual void computeScores();
+
+private:
+  void computeScoresPostorder_(const Node* node);
+
+  void computeScoresPreorder_(const Node* node);
+
+  /**
+   * @brief Compute the arrays of the subtree of a node, from the ones of its sons.
+   */
+  void computeDown_(const Node* node);
+
+  void computePatternScores_() const;
+
+  /**
+   * @brief Compute the arrays of the rest of the tree, seen from a node.
+   *
+   * @return The score of these arrays.
+   */
+  unsigned int computeUp_(const Node* node, uint64_t* oPlanes) const;
+
+  /**
+   * @brief Remove a subtree and its father node from the tree.
+   *
+   * @param son            The root of the subtree.
+   * @param sisterPosition [out] The position of the sister node under the father.
+   * @return The sister node, which takes the place of the father.
+   */
+  Node* prune_(Node* son, size_t& sisterPosition);
+
+  /**
+   * @brief Insert a pruned father node on the branch above a target node.
+   */
+  void regraft_(Node* parent, Node* target, size_t position);
+
+  /**
+   * @brief Score the regraft of a subtree on the branches of the subtree of a node.
+   *
+   * @param node      The current node.
+   * @param upPlanes  The arrays of the rest of the tree seen from the node (unused for the root).
+   * @param upScore   The score of these arrays.
+   * @param sonPlanes The arrays of the subtree to regraft.
+   * @param depth     The depth of the node.
+   * @param upWork    Work arrays, one per depth, of the size of the tree depth + 2.
+   * @param bestScore [in,out] The best score found, not including the one of the subtree to regraft.
+   * @param targetId  [out] The node above which the subtree is best regrafted.
+   */
+  void testRegrafts_(
+      const Node* node,
+      const uint64_t* upPlanes,
+      unsigned int upScore,
+      const uint64_t* sonPlanes,
+      size_t depth,
+      std::vector< std::vector<uint64_t> >& upWork,
+      unsigned int& bestScore,
+      int& targetId) const;
+
+  size_t downSlot_(const Node* node) const { return 2 * nodeIndex_[static_cast<size_t>(node->getId())]; }
+
+  size_t upSlot_(const Node* node) const { return 2 * nodeIndex_[static_cast<size_t>(node->getId())] + 1; }
+
+  uint64_t* slotPlanes_(size_t slot) { return &planes_[slot * nbStates_ * nbWords_]; }
+
+  const uint64_t* slotPlanes_(size_t slot) const { return &planes_[slot * nbStates_ * nbWords_]; }
+
+  /**
+   * @brief Fitch's algorithm on several sets of states.
+   *
+   * @param iPlanes       The input bit-planes. Only the first one may be the same as the output.
+   * @param oPlanes       The output bit-planes.
+   * @param patternScores If not null, incremented by the number of changes of each pattern.
+   * @return The weighted number of changes.
+   */
+  unsigned int fitch_(
+      const std::vector<const uint64_t*>& iPlanes,
+      uint64_t* oPlanes,
+      unsigned int* patternScores) const;
+
+  /**
+   * @brief Fitch's algorithm on two sets of states, the result being stored in the first one.
+   */
+  unsigned int fitchPair_(
+      uint64_t* aPlanes,
+      const uint64_t* bPlanes,
+      unsigned int* patternScores) const;
+
+  /**
+   * @brief The weighted number of changes of Fitch's algorithm on two sets of states.
+   */
+  unsigned int fitchCount_(
+      const uint64_t* aPlanes,
+      const uint64_t* bPlanes) const;
+
+  /**
+   * @brief Fill any_ with the patterns having a non empty intersection.
+   */
+  void intersect_(
+      const uint64_t* aPlanes,
+      const uint64_t* bPlanes) const;
+
+  /**
+   * @brief Count the patterns having an empty intersection, from any_.
+   */
+  unsigned int countChanges_(unsigned int* patternScores) const;
+
+public:
+  unsigned int getScore() const override { return score_; }
+
+  unsigned int getScoreForSite(size_t site) const override;
+
+  std::vector<unsigned int> getScorePerSite() const override;
+
+  size_t getNumberOfDistinctSites() const { return nbPatterns_; }
+
+  /**
+   * @name Thee NNISearchable interface.
+   *
+   * @{
+   */
+  double getTopologyValue() const override { return getScore(); }
+
+  double testNNI(int nodeId) const override;
+
+  void doNNI(int nodeId) override;
+
+  const Tree& topology() const override { return tree(); }
+
+  void topologyChangeTested(const TopologyChangeEvent& event) override
+  {
+    computeScores();
+  }
+
+  void topologyChangeSuccessful(const TopologyChangeEvent& event) override {}
+  /**@} */
+
+  /**
+   * @name SPR moves.
+   *
+   * A subtree is pruned together with its father node, which must be
+   * bifurcating and not the root, and regrafted on the branch above
+   * another node. After pruning, the arrays of both directions of each
+   * branch of the remaining tree give the exact score of every regraft
+   * position in a single pass over patterns.
+   *
+   * @{
+   */
+
+  /**
+   * @return true if the subtree of a node can be pruned.
+   */
+  bool isSPRPossible(int nodeId) const;
+
+  /**
+   * @brief Find the best regraft position of a subtree.
+   *
+   * The tree is left unchanged.
+   *
+   * @param nodeId   The root of the subtree.
+   * @param targetId [out] The node above which the subtree is best regrafted.
+   * @return The difference of score of the best move with the current score.
+   * @throw NodeException If the subtree can not be pruned.
+   */
+  double testSPR(int nodeId, int& targetId);
+
+  /**
+   * @brief Move a subtree on the branch above a target node.
+   *
+   * @param nodeId   The root of the subtree.
+   * @param targetId The node above which the subtree is regrafted.
+   * @throw NodeException If the subtree can not be pruned, or the target is not valid.
+   */
+  void doSPR(int nodeId, int targetId);
+  /**@} */
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_PARSIMONY_BITPARALLELTREEPARSIMONYSCORE_H
@@ -40,6 +40,8 @@ DRTreeParsimonyScore::DRTreeParsimonyScore(
 
 void DRTreeParsimonyScore::init_(shared_ptr<const SiteContainerInterface> data, bool verbose)
 {
+  if (data->getAlphabet()->getSize() > 20)
+    throw Exception("Error, only alphabet with size <= 20 are supported. See the source file of DRTreeParsimonyData, or use BitParallelTreeParsimonyScore.");
   if (verbose)
     ApplicationTools::displayTask("Initializing data structure");
   parsimonyData_->init(data, getStateMap());
@@ -2,11 +2,15 @@
 //
 // SPDX-License-Identifier: CECILL-2.1
 
+#include <Bpp/Numeric/NumConstants.h>
 #include <Bpp/Numeric/Random/RandomTools.h>
 #include <Bpp/Text/TextTools.h>
 
 #include "MutationProcess.h"
 
+// From the STL:
+#include <algorithm>
+
 using namespace bpp;
 using namespace std;
 
@@ -136,49 +140,72 @@ MutationPath AbstractMutationProcess::detailedEvolve(size_t initialState, size_t
 
 SimpleMutationProcess::SimpleMutationProcess(
     shared_ptr<const SubstitutionModelInterface> model) :
-  AbstractMutationProcess(model)
+  AbstractMutationProcess(model),
+  jumpStates_(),
+  jumpRepartition_()
 {
   size_ = model->getNumberOfStates();
-  repartition_ = VVdouble(size_);
-  // Each element contains the probabilities concerning each character in the alphabet.
+  jumpStates_.resize(size_);
+  jumpRepartition_.resize(size_);
 
-  // We will now initiate each of these probability vector.
-  RowMatrix<double> Q = model->generator();
-  for (size_t i = 0; i < size_; i++)
+  // Cumulative probabilities of the jumps, from the non-zero rates only.
+  // They are useful for the 'mutate(...)' function.
+  const auto& Q = model->sparseGenerator();
+  for (Eigen::Index i = 0; i < Q.outerSize(); i++)
   {
-    repartition_[i] = Vdouble(size_, 0);
-    if (abs(Q(i, i)) > NumConstants::TINY())
+    if (abs(model->Qij(size_t(i), size_t(i))) <= NumConstants::TINY())
+      continue;
+
+    double sum_Q = 0;
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(Q, i); it; ++it)
     {
-      double cum = 0;
-      double sum_Q = 0;
-      for (size_t j = 0; j < size_; j++)
-      {
-        if (j != i)
-          sum_Q += Q(i, j);
-      }
+      if (it.col() != i)
+        sum_Q += it.value();
+    }
 
-      for (size_t j = 0; j < size_; j++)
+    double cum = 0;
+    for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator it(Q, i); it; ++it)
+    {
+      if (it.col() != i)
       {
-        if (j != i)
-        {
-          cum += model->Qij(i, j) / sum_Q;
-          repartition_[i][j] = cum;
-        }
-        else
-          repartition_[i][j] = -1;
-        // Forbiden value: does not correspond to a change.
+        cum += it.value() / sum_Q;
+        jumpStates_[size_t(i)].push_back(size_t(it.col()));
+        jumpRepartition_[size_t(i)].push_back(cum);
       }
     }
   }
-
-  // Note that I use cumulative probabilities in repartition_ (hence the name).
-  // These cumulative probabilities are useful for the 'mutate(...)' function.
 }
 
 SimpleMutationProcess::~SimpleMutationProcess() {}
 
 /******************************************************************************/
 
+size_t SimpleMutationProcess::mutate(size_t state) const
+{
+  const auto& repartition = jumpRepartition_[state];
+  if (repartition.empty())
+    throw Exception("SimpleMutationProcess::mutate. Repartition function is incomplete for state " + TextTools::toString(state));
+
+  double alea = RandomTools::giveRandomNumberBetweenZeroAndEntry(1.0);
+  size_t j = static_cast<size_t>(upper_bound(repartition.begin(), repartition.end(), alea) - repartition.begin());
+  // The last cumulative probability may be below 1 by rounding:
+  return jumpStates_[state][min(j, repartition.size() - 1)];
+}
+
+/******************************************************************************/
+
+size_t SimpleMutationProcess::mutate(size_t state, unsigned int n) const
+{
+  size_t s = state;
+  for (unsigned int k = 0; k < n; k++)
+  {
+    s = mutate(s);
+  }
+  return s;
+}
+
+/******************************************************************************/
+
 size_t SimpleMutationProcess::evolve(size_t initialState, double time) const
 {
   // Compute all cumulative pijt:
@@ -270,7 +270,8 @@ public:
  * The mutate function hence draws a random number between 0 and 1 and gives the
  * corresponding character using the bijection of the repartition function.
  *
- * All derived classes must initialize the repartition_ and size_ fields.
+ * All derived classes must initialize the size_ field, and the
+ * repartition_ field unless they redefine the mutate methods.
  */
 class AbstractMutationProcess :
   public virtual MutationProcess
@@ -321,10 +322,22 @@ public:
  * to state @f$j@f$ is:
  * @f[ \frac{Q_{i,j}}{\sum_k Q_{i,k}}. @f]</li>
  * </ol>
+ *
+ * Only the non-zero rates of the generator are stored, so that the
+ * memory and the time of each jump do not depend on the number of
+ * states that can not be reached.
  */
 class SimpleMutationProcess :
   public AbstractMutationProcess
 {
+private:
+  /**
+   * @brief The states reachable from each state, and the cumulative
+   * probabilities of jumping to them.
+   */
+  std::vector< std::vector<size_t>> jumpStates_;
+  VVdouble jumpRepartition_;
+
 public:
   // Constructor and destructor:
 
@@ -337,6 +350,10 @@ public:
 
   virtual ~SimpleMutationProcess();
 
+  size_t mutate(size_t state) const;
+
+  size_t mutate(size_t state, unsigned int n) const;
+
   /**
    * @brief Method redefinition for better performance.
    *
@@ -9,6 +9,11 @@
 #include <Bpp/Seq/Container/AlignmentData.h>
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 
+// From the STL:
+#include <functional>
+#include <mutex>
+#include <tuple>
+
 using namespace bpp;
 using namespace std;
 
@@ -145,3 +150,103 @@ unique_ptr<AlignmentDataInterface> SitePatterns::getSites() const
 }
 
 /******************************************************************************/
+
+namespace
+{
+/**
+ * @brief The content of a container, restricted to a list of sequence
+ * names: number of sites and hash of the alphabet, the sequence
+ * names and the columns.
+ */
+struct SitePatternsKey
+{
+  std::vector<std::string> names;
+  size_t nbSites;
+  size_t hash;
+
+  bool operator<(const SitePatternsKey& key) const
+  {
+    return std::tie(nbSites, hash, names) < std::tie(key.nbSites, key.hash, key.names);
+  }
+};
+
+void combineHash(size_t& hash, const std::string& s)
+{
+  hash ^= std::hash<std::string>()(s) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+}
+
+SitePatternsKey makeSitePatternsKey(
+    const AlignmentDataInterface& sequences,
+    const std::vector<std::string>& names)
+{
+  SitePatternsKey key{names, sequences.getNumberOfSites(), 0};
+  combineHash(key.hash, sequences.getAlphabet()->getAlphabetType());
+  for (const auto& name : sequences.getSequenceNames())
+  {
+    combineHash(key.hash, name);
+  }
+  for (size_t i = 0; i < key.nbSites; ++i)
+  {
+    combineHash(key.hash, sequences.site(i).toString());
+  }
+  return key;
+}
+
+/**
+ * @brief Compare two containers exactly, the hash of their content
+ * being possibly the same for different data.
+ */
+bool areIdentical(
+    const AlignmentDataInterface& sequences1,
+    const AlignmentDataInterface& sequences2)
+{
+  if (&sequences1 == &sequences2)
+    return true;
+  if (sequences1.getAlphabet()->getAlphabetType() != sequences2.getAlphabet()->getAlphabetType()
+      || sequences1.getSequenceNames() != sequences2.getSequenceNames()
+      || sequences1.getNumberOfSites() != sequences2.getNumberOfSites())
+    return false;
+  for (size_t i = 0; i < sequences1.getNumberOfSites(); ++i)
+  {
+    if (!SymbolListTools::areSymbolListsIdentical(sequences1.site(i), sequences2.site(i)))
+      return false;
+  }
+  return true;
+}
+
+std::mutex sharedSitePatternsMutex;
+std::map<SitePatternsKey, std::weak_ptr<const SharedSitePatterns>> sharedSitePatterns;
+}
+
+shared_ptr<const SharedSitePatterns> SharedSitePatterns::get(
+    shared_ptr<const AlignmentDataInterface> sequences,
+    const vector<string>& names)
+{
+  auto key = makeSitePatternsKey(*sequences, names);
+  shared_ptr<const SharedSitePatterns> found;
+  {
+    lock_guard<mutex> lock(sharedSitePatternsMutex);
+    auto it = sharedSitePatterns.find(key);
+    if (it != sharedSitePatterns.end())
+      found = it->second.lock();
+  }
+  if (found && areIdentical(*sequences, *found->source_))
+    return found;
+
+  // Patterns are computed out of the lock, a concurrent computation
+  // of the same patterns only costs time.
+  auto patterns = make_shared<const SharedSitePatterns>(sequences, names);
+
+  lock_guard<mutex> lock(sharedSitePatternsMutex);
+  for (auto it = sharedSitePatterns.begin(); it != sharedSitePatterns.end();)
+  {
+    if (it->second.expired())
+      it = sharedSitePatterns.erase(it);
+    else
+      ++it;
+  }
+  sharedSitePatterns[key] = patterns;
+  return patterns;
+}
+
+/******************************************************************************/
@@ -15,6 +15,7 @@
 
 // From the STL:
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -107,5 +108,62 @@ public:
    */
   std::unique_ptr<AlignmentDataInterface> getSites() const;
 };
+
+/**
+ * @brief Site patterns shared by all the users of the same data.
+ *
+ * The patterns of a container, restricted to a list of sequence
+ * names, are computed once and shared, together with the container
+ * of unique sites, by all the objects that ask for them while a
+ * previous result is still in use (for instance a likelihood and its
+ * copies, or several likelihoods computed on the same alignment).
+ *
+ * The container is identified by its content: patterns are looked
+ * up from its alphabet, the names of its sequences, its number of
+ * sites and a hash of its columns, and are only shared if the sites
+ * are identical to the ones of the container they were computed from
+ * (which is kept). A modified container gets new patterns, and equal
+ * containers share the same ones. Computing the hash and comparing
+ * the sites read every site once, which is much cheaper than sorting
+ * the sites.
+ */
+class SharedSitePatterns
+{
+private:
+  SitePatterns patterns_;
+  std::shared_ptr<const AlignmentDataInterface> sites_;
+
+  /**
+   * @brief The container the patterns were computed from.
+   */
+  std::shared_ptr<const AlignmentDataInterface> source_;
+
+public:
+  SharedSitePatterns(
+      std::shared_ptr<const AlignmentDataInterface> sequences,
+      const std::vector<std::string>& names) :
+    patterns_(*sequences, names),
+    sites_(patterns_.getSites()),
+    source_(sequences)
+  {}
+
+  /**
+   * @brief Get the patterns of a container, computing them only if
+   * they are not already in use.
+   *
+   * @param sequences The container to look in.
+   * @param names The names of the sequences effectively used.
+   */
+  static std::shared_ptr<const SharedSitePatterns> get(
+      std::shared_ptr<const AlignmentDataInterface> sequences,
+      const std::vector<std::string>& names);
+
+  const SitePatterns& getPatterns() const { return patterns_; }
+
+  /**
+   * @return The container of unique sites.
+   */
+  std::shared_ptr<const AlignmentDataInterface> getSites() const { return sites_; }
+};
 } // end of namespace bpp.
 #endif // BPP_PHYL_SITEPATTERNS_H
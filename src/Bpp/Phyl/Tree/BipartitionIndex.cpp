@@ -0,0 +1,269 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Text/TextTools.h>
+
+#include "BipartitionIndex.h"
+#include "BipartitionTools.h"
+#include "TreeTemplate.h"
+
+// From the STL:
+#include <bitset>
+#include <climits> // defines CHAR_BIT
+#include <unordered_set>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace bpp;
+using namespace std;
+
+/******************************************************************************/
+
+Bipartition::Bipartition(const vector<uint64_t>& words, size_t nbElements) :
+  words_(words),
+  nbElements_(nbElements),
+  nbSet_(0),
+  hash_(0)
+{
+  if (words_.size() != (nbElements + 63) / 64)
+    throw Exception("Bipartition::Bipartition. Wrong number of words for " + TextTools::toString(nbElements) + " elements.");
+
+  // Canonicalize, so that the first element is unset:
+  if (nbElements_ > 0 && (words_[0] & 1))
+  {
+    for (auto& w : words_)
+    {
+      w = ~w;
+    }
+    if (nbElements_ % 64 != 0)
+      words_.back() &= (uint64_t(1) << (nbElements_ % 64)) - 1;
+  }
+
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ static_cast<uint64_t>(nbElements_);
+  for (auto w : words_)
+  {
+    nbSet_ += bitset<64>(w).count();
+    h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+  }
+  hash_ = h;
+}
+
+/******************************************************************************/
+
+bool Bipartition::isCompatibleWith(const Bipartition& bip) const
+{
+  if (bip.nbElements_ != nbElements_)
+    throw Exception("Bipartition::isCompatibleWith. Bipartitions on distinct numbers of elements.");
+  // Both sides with the first element always intersect, so that one of
+  // the three others intersections must be empty:
+  bool disjoint = true;
+  bool included = true;
+  bool includes = true;
+  for (size_t i = 0; i < words_.size(); ++i)
+  {
+    uint64_t a = words_[i];
+    uint64_t b = bip.words_[i];
+    if (a & b)
+      disjoint = false;
+    if (a & ~b)
+      included = false;
+    if (b & ~a)
+      includes = false;
+  }
+  return disjoint || included || includes;
+}
+
+/******************************************************************************/
+
+BipartitionIndex::BipartitionIndex(const vector<string>& elements) :
+  elements_(elements),
+  elementIndex_(),
+  nbWords_((elements.size() + 63) / 64),
+  counts_(),
+  nbTrees_(0)
+{
+  sort(elements_.begin(), elements_.end());
+  for (size_t i = 0; i < elements_.size(); ++i)
+  {
+    if (elementIndex_.find(elements_[i]) != elementIndex_.end())
+      throw Exception("BipartitionIndex::BipartitionIndex. Duplicated element: " + elements_[i]);
+    elementIndex_[elements_[i]] = i;
+  }
+}
+
+/******************************************************************************/
+
+vector<Bipartition> BipartitionIndex::computeBipartitions(const Tree& tree, vector<int>* nodeIds, bool includeTrivial) const
+{
+  vector<Bipartition> bips;
+  if (nodeIds)
+    nodeIds->clear();
+  size_t nbLeaves = 0;
+  const TreeTemplate<Node>* ttree = dynamic_cast<const TreeTemplate<Node>*>(&tree);
+  if (ttree)
+  {
+    buildBipartitions_(ttree->getRootNode(), bips, nodeIds, includeTrivial, nbLeaves);
+  }
+  else
+  {
+    TreeTemplate<Node> tmp(tree);
+    buildBipartitions_(tmp.getRootNode(), bips, nodeIds, includeTrivial, nbLeaves);
+  }
+  if (nbLeaves != elements_.size())
+    throw Exception("BipartitionIndex::computeBipartitions. Distinct leaf sets between tree and index.");
+  return bips;
+}
+
+vector<uint64_t> BipartitionIndex::buildBipartitions_(const Node* node, vector<Bipartition>& bips, vector<int>* nodeIds, bool includeTrivial, size_t& nbLeaves) const
+{
+  vector<uint64_t> words(nbWords_, 0);
+  if (node->isLeaf())
+  {
+    auto it = elementIndex_.find(node->getName());
+    if (it == elementIndex_.end())
+      throw Exception("BipartitionIndex::computeBipartitions. Leaf not in index: " + node->getName());
+    words[it->second / 64] |= uint64_t(1) << (it->second % 64);
+    nbLeaves++;
+    if (includeTrivial && node->hasFather() && elements_.size() > 1)
+    {
+      bips.push_back(Bipartition(words, elements_.size()));
+      if (nodeIds)
+        nodeIds->push_back(node->getId());
+    }
+    return words;
+  }
+  for (size_t k = 0; k < node->getNumberOfSons(); ++k)
+  {
+    vector<uint64_t> sonWords = buildBipartitions_(node->getSon(k), bips, nodeIds, includeTrivial, nbLeaves);
+    for (size_t i = 0; i < nbWords_; ++i)
+    {
+      if (words[i] & sonWords[i])
+        throw Exception("BipartitionIndex::computeBipartitions. Duplicated leaf names in tree.");
+      words[i] |= sonWords[i];
+    }
+  }
+  if (node->hasFather())
+  {
+    Bipartition bip(words, elements_.size());
+    if (includeTrivial ? bip.getPartitionSize() > 0 : !bip.isTrivial())
+    {
+      bips.push_back(bip);
+      if (nodeIds)
+        nodeIds->push_back(node->getId());
+    }
+  }
+  return words;
+}
+
+/******************************************************************************/
+
+void BipartitionIndex::addTree(const Tree& tree)
+{
+  vector<Bipartition> bips = computeBipartitions(tree);
+  unordered_set<Bipartition, BipartitionHash> seen;
+  for (auto& bip : bips)
+  {
+    if (seen.insert(bip).second)
+      counts_[bip]++;
+  }
+  nbTrees_++;
+}
+
+void BipartitionIndex::addTrees(const vector<unique_ptr<Tree>>& trees)
+{
+  string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    unordered_map<Bipartition, size_t, BipartitionHash> counts;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+      try
+      {
+        vector<Bipartition> bips = computeBipartitions(*trees[i]);
+        unordered_set<Bipartition, BipartitionHash> seen;
+        for (auto& bip : bips)
+        {
+          if (seen.insert(bip).second)
+            counts[bip]++;
+        }
+      }
+      catch (exception& e)
+      {
+#ifdef _OPENMP
+#pragma omp critical (BipartitionIndex_addTrees_error)
+#endif
+        if (errorMessage == "")
+          errorMessage = e.what();
+      }
+    }
+#ifdef _OPENMP
+#pragma omp critical (BipartitionIndex_addTrees_merge)
+#endif
+    for (auto& count : counts)
+    {
+      counts_[count.first] += count.second;
+    }
+  }
+  if (errorMessage != "")
+    throw Exception("BipartitionIndex::addTrees. " + errorMessage);
+  nbTrees_ += trees.size();
+}
+
+/******************************************************************************/
+
+size_t BipartitionIndex::getCount(const Bipartition& bip) const
+{
+  auto it = counts_.find(bip);
+  return it == counts_.end() ? 0 : it->second;
+}
+
+vector<pair<Bipartition, size_t>> BipartitionIndex::getBipartitions() const
+{
+  vector<pair<Bipartition, size_t>> bips(counts_.begin(), counts_.end());
+  sort(bips.begin(), bips.end(),
+      [](const pair<Bipartition, size_t>& a, const pair<Bipartition, size_t>& b) {
+        return a.second < b.second || (a.second == b.second && a.first < b.first);
+      });
+  return bips;
+}
+
+/******************************************************************************/
+
+unique_ptr<BipartitionList> BipartitionIndex::toBipartitionList(const vector<Bipartition>& bips) const
+{
+  size_t lword  = static_cast<size_t>(BipartitionTools::LWORD);
+  size_t nbword = (elements_.size() + lword - 1) / lword;
+  size_t nbint  = nbword * lword / (CHAR_BIT * sizeof(int));
+
+  vector<int*> bitBips(bips.size());
+  for (size_t i = 0; i < bips.size(); ++i)
+  {
+    bitBips[i] = new int[nbint];
+    for (size_t j = 0; j < nbint; ++j)
+    {
+      bitBips[i][j] = 0;
+    }
+    for (size_t j = 0; j < elements_.size(); ++j)
+    {
+      if (bips[i].test(j))
+        BipartitionTools::bit1(bitBips[i], static_cast<int>(j));
+    }
+  }
+  auto bipL = make_unique<BipartitionList>(elements_, bitBips);
+  for (auto bitBip : bitBips)
+  {
+    delete[] bitBip;
+  }
+  return bipL;
+}
+
+/******************************************************************************/
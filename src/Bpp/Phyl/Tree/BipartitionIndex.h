@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef BPP_PHYL_TREE_BIPARTITIONINDEX_H
+#define BPP_PHYL_TREE_BIPARTITIONINDEX_H
+
+#include <Bpp/Exceptions.h>
+
+#include "BipartitionList.h"
+#include "Tree.h"
+
+// From the STL:
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bpp
+{
+class Node;
+
+/**
+ * @brief A bipartition of a set of elements, as a canonical bit array.
+ *
+ * Bit i is set if element i is not on the side of the first element,
+ * so that a bipartition and its complement have the same
+ * representation. A 64 bits hash is computed at construction.
+ */
+class Bipartition
+{
+private:
+  std::vector<uint64_t> words_;
+  size_t nbElements_;
+  size_t nbSet_;
+  uint64_t hash_;
+
+public:
+  /**
+   * @param words      The bit array, 64 elements per word.
+   * @param nbElements The number of elements.
+   */
+  Bipartition(const std::vector<uint64_t>& words, size_t nbElements);
+
+  virtual ~Bipartition() {}
+
+public:
+  const std::vector<uint64_t>& getWords() const { return words_; }
+
+  size_t getNumberOfElements() const { return nbElements_; }
+
+  uint64_t getHash() const { return hash_; }
+
+  /**
+   * @return true if element i is not on the side of the first element.
+   */
+  bool test(size_t i) const { return (words_[i / 64] >> (i % 64)) & 1; }
+
+  /**
+   * @return The size of the smallest of the two partitions (e.g. 1 for external branches).
+   */
+  size_t getPartitionSize() const { return std::min(nbSet_, nbElements_ - nbSet_); }
+
+  /**
+   * @return true if the bipartition corresponds to an external branch (or to no branch at all).
+   */
+  bool isTrivial() const { return getPartitionSize() <= 1; }
+
+  /**
+   * @return true if both bipartitions can belong to the same tree.
+   */
+  bool isCompatibleWith(const Bipartition& bip) const;
+
+  bool operator==(const Bipartition& bip) const
+  {
+    return hash_ == bip.hash_ && nbElements_ == bip.nbElements_ && words_ == bip.words_;
+  }
+
+  bool operator!=(const Bipartition& bip) const { return !(*this == bip); }
+
+  /**
+   * @brief An arbitrary but deterministic order.
+   */
+  bool operator<(const Bipartition& bip) const { return words_ < bip.words_; }
+};
+
+struct BipartitionHash
+{
+  size_t operator()(const Bipartition& bip) const { return static_cast<size_t>(bip.getHash()); }
+};
+
+/**
+ * @brief Count the occurrences of bipartitions in a set of trees.
+ *
+ * Bipartitions are stored in a hash table, so that adding a tree or
+ * finding a bipartition takes a time linear in its number of
+ * bipartitions. Trees can be added in parallel (with OpenMP).
+ *
+ * Trivial bipartitions (external branches) are not stored.
+ */
+class BipartitionIndex
+{
+private:
+  std::vector<std::string> elements_;
+  std::map<std::string, size_t> elementIndex_;
+  size_t nbWords_;
+  std::unordered_map<Bipartition, size_t, BipartitionHash> counts_;
+  size_t nbTrees_;
+
+public:
+  /**
+   * @param elements The leaf names, which will be sorted.
+   */
+  BipartitionIndex(const std::vector<std::string>& elements);
+
+  virtual ~BipartitionIndex() {}
+
+public:
+  const std::vector<std::string>& getElementNames() const { return elements_; }
+
+  size_t getNumberOfElements() const { return elements_.size(); }
+
+  size_t getNumberOfTrees() const { return nbTrees_; }
+
+  size_t getNumberOfBipartitions() const { return counts_.size(); }
+
+  /**
+   * @brief Get the non-trivial bipartitions of a tree.
+   *
+   * For a rooted tree, the branches of the root yield the same
+   * bipartition twice. Branches that do not split the elements (e.g.
+   * above a node with a single son at the root) are never included.
+   *
+   * @param tree           The tree, with the same leaves as the index.
+   * @param nodeIds        If not null, filled with the id of the node below
+   *                       each branch.
+   * @param includeTrivial Also get the bipartitions of external branches.
+   * @throw Exception If the leaves of the tree are not the elements of the index.
+   */
+  std::vector<Bipartition> computeBipartitions(const Tree& tree, std::vector<int>* nodeIds = nullptr, bool includeTrivial = false) const;
+
+  /**
+   * @brief Count the bipartitions of a tree.
+   */
+  void addTree(const Tree& tree);
+
+  /**
+   * @brief Count the bipartitions of several trees, in parallel.
+   */
+  void addTrees(const std::vector<std::unique_ptr<Tree>>& trees);
+
+  /**
+   * @return The number of trees containing a bipartition.
+   */
+  size_t getCount(const Bipartition& bip) const;
+
+  /**
+   * @return The proportion of trees containing a bipartition.
+   */
+  double getFrequency(const Bipartition& bip) const
+  {
+    return nbTrees_ == 0 ? 0. : static_cast<double>(getCount(bip)) / static_cast<double>(nbTrees_);
+  }
+
+  /**
+   * @brief Get all bipartitions with their counts, sorted by increasing
+   * count (and in a deterministic order for equal counts).
+   */
+  std::vector<std::pair<Bipartition, size_t>> getBipartitions() const;
+
+  /**
+   * @brief Convert bipartitions to a BipartitionList on the elements of the index.
+   */
+  std::unique_ptr<BipartitionList> toBipartitionList(const std::vector<Bipartition>& bips) const;
+
+private:
+  std::vector<uint64_t> buildBipartitions_(const Node* node, std::vector<Bipartition>& bips, std::vector<int>* nodeIds, bool includeTrivial, size_t& nbLeaves) const;
+};
+} // end of namespace bpp.
+#endif // BPP_PHYL_TREE_BIPARTITIONINDEX_H
@@ -12,11 +12,13 @@
 #include <Bpp/Text/TextTools.h>
 
 #include "../Distance/BioNJ.h"
+#include "../Io/Newick.h"
 
 // #include "../Distance/DistanceEstimation.h"
 // #include "../OptimizationTools.h"
 #include "../Parsimony/DRTreeParsimonyScore.h"
 #include "../Model/Nucleotide/JCnuc.h"
+#include "BipartitionIndex.h"
 #include "BipartitionTools.h"
 #include "Tree.h"
 #include "TreeTools.h"
@@ -29,7 +31,13 @@ using namespace bpp;
 
 // From the STL:
 #include <iostream>
+#include <numeric>
 #include <sstream>
+#include <unordered_set>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -842,61 +850,28 @@ bool TreeTools::haveSameTopology(const Tree& tr1, const Tree& tr2)
 
 int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool checkNames, int* missing_in_tr2, int* missing_in_tr1)
 {
-  unique_ptr<BipartitionList> bipL1, bipL2;
-  size_t i, j;
-  vector<size_t> size1, size2;
-  vector<bool> bipOK2;
-
-
   if (checkNames && !VectorTools::haveSameElements(tr1.getLeavesNames(), tr2.getLeavesNames()))
     throw Exception("Distinct leaf sets between trees ");
 
-  /* prepare things */
+  BipartitionIndex index(tr1.getLeavesNames());
+  vector<Bipartition> bips1 = index.computeBipartitions(tr1);
+  vector<Bipartition> bips2 = index.computeBipartitions(tr2);
+  unordered_set<Bipartition, BipartitionHash> set1(bips1.begin(), bips1.end());
+  unordered_set<Bipartition, BipartitionHash> set2(bips2.begin(), bips2.end());
+
   int missing1 = 0;
   int missing2 = 0;
-
-  bipL1 = make_unique<BipartitionList>(tr1, true);
-  bipL1->removeTrivialBipartitions();
-  bipL1->sortByPartitionSize();
-  bipL2 = make_unique<BipartitionList>(tr2, true);
-  bipL2->removeTrivialBipartitions();
-  bipL2->sortByPartitionSize();
-
-
-  for (i = 0; i < bipL1->getNumberOfBipartitions(); i++)
-  {
-    size1.push_back(bipL1->getPartitionSize(i));
-  }
-  for (i = 0; i < bipL2->getNumberOfBipartitions(); i++)
-  {
-    size2.push_back(bipL2->getPartitionSize(i));
-  }
-
-  for (i = 0; i < bipL2->getNumberOfBipartitions(); i++)
+  for (auto& bip : set1)
   {
-    bipOK2.push_back(false);
+    if (set2.find(bip) == set2.end())
+      missing2++;
   }
-
-  /* main loops */
-
-  for (i = 0; i < bipL1->getNumberOfBipartitions(); i++)
+  for (auto& bip : set2)
   {
-    for (j = 0; j < bipL2->getNumberOfBipartitions(); j++)
-    {
-      if (bipOK2[j])
-        continue;
-      if (size1[i] == size2[j] && BipartitionTools::areIdentical(*bipL1, i, *bipL2, j))
-      {
-        bipOK2[j] = true;
-        break;
-      }
-    }
-    if (j == bipL2->getNumberOfBipartitions())
-      missing2++;
+    if (set1.find(bip) == set1.end())
+      missing1++;
   }
 
-  missing1 = static_cast<int>(bipL2->getNumberOfBipartitions()) - static_cast<int>(bipL1->getNumberOfBipartitions()) + missing2;
-
   if (missing_in_tr1)
     *missing_in_tr1 = missing1;
   if (missing_in_tr2)
@@ -908,60 +883,209 @@ int TreeTools::robinsonFouldsDistance(const Tree& tr1, const Tree& tr2, bool che
 
 unique_ptr<BipartitionList> TreeTools::bipartitionOccurrences(const vector<unique_ptr<Tree>>& vecTr, vector<size_t>& bipScore)
 {
-  vector<unique_ptr<BipartitionList>> vecBipL;
-  unique_ptr<BipartitionList> mergedBipL;
-  vector<size_t> bipSize;
-  size_t nbBip;
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::bipartitionOccurrences. Empty vector passed");
 
-  /*  build and merge bipartitions */
-  for (size_t i = 0; i < vecTr.size(); i++)
+  /* count distinct bipartitions, from the less to the most frequent */
+  BipartitionIndex index(vecTr[0]->getLeavesNames());
+  index.addTrees(vecTr);
+  vector<pair<Bipartition, size_t>> bips = index.getBipartitions();
+  vector<Bipartition> distinctBips;
+  bipScore.clear();
+  for (auto& bip : bips)
   {
-    vecBipL.push_back(make_unique<BipartitionList>(*vecTr[i]));
+    distinctBips.push_back(bip.first);
+    bipScore.push_back(bip.second);
   }
-  mergedBipL = BipartitionTools::mergeBipartitionLists(vecBipL);
+  auto bipL = index.toBipartitionList(distinctBips);
 
-  mergedBipL->removeTrivialBipartitions();
-  nbBip = mergedBipL->getNumberOfBipartitions();
-  bipScore.clear();
-  for (size_t i = 0; i < nbBip; i++)
+  /* add terminal branches */
+  bipL->addTrivialBipartitions(false);
+  for (size_t i = 0; i < bipL->getNumberOfElements(); i++)
   {
-    bipSize.push_back(mergedBipL->getPartitionSize(i));
-    bipScore.push_back(1);
+    bipScore.push_back(vecTr.size());
   }
 
-  /* compare bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  return bipL;
+}
+
+/******************************************************************************/
+
+namespace
+{
+/**
+ * @brief The distinct bipartitions of a tree, sorted by hash, with their branch lengths.
+ */
+struct BipartitionSignature
+{
+  vector<Bipartition> bipartitions;
+  vector<double> lengths;
+};
+
+bool hashLess(const Bipartition& bip1, const Bipartition& bip2)
+{
+  return bip1.getHash() < bip2.getHash() || (bip1.getHash() == bip2.getHash() && bip1 < bip2);
+}
+
+BipartitionSignature computeSignature(const BipartitionIndex& index, const Tree& tree, bool withLengths)
+{
+  vector<int> nodeIds;
+  vector<Bipartition> bips = index.computeBipartitions(tree, &nodeIds, withLengths);
+  vector<size_t> order(bips.size());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&bips](size_t i, size_t j) { return hashLess(bips[i], bips[j]); });
+
+  // The branches of the root of a rooted tree (and the branches above
+  // nodes with a single son) have the same bipartition, their lengths are summed:
+  BipartitionSignature signature;
+  for (size_t k : order)
+  {
+    double length = (withLengths && tree.hasDistanceToFather(nodeIds[k])) ? tree.getDistanceToFather(nodeIds[k]) : 0.;
+    if (!signature.bipartitions.empty() && signature.bipartitions.back() == bips[k])
+    {
+      signature.lengths.back() += length;
+    }
+    else
+    {
+      signature.bipartitions.push_back(bips[k]);
+      signature.lengths.push_back(length);
+    }
+  }
+  return signature;
+}
+
+double signatureDistance(const BipartitionSignature& sig1, const BipartitionSignature& sig2, TreeTools::BipartitionDistance type)
+{
+  double d = 0;
+  size_t i = 0, j = 0;
+  while (i < sig1.bipartitions.size() || j < sig2.bipartitions.size())
   {
-    if (bipScore[i - 1] == 0)
-      continue;
-    for (size_t j = i - 1; j > 0; j--)
+    double diff;
+    bool shared = false;
+    if (j == sig2.bipartitions.size() || (i < sig1.bipartitions.size() && hashLess(sig1.bipartitions[i], sig2.bipartitions[j])))
     {
-      if (bipScore[j - 1] && bipSize[i - 1] == bipSize[j - 1] && mergedBipL->areIdentical(i - 1, j - 1))
-      {
-        bipScore[i - 1]++;
-        bipScore[j - 1] = 0;
-      }
+      diff = sig1.lengths[i++];
+    }
+    else if (i == sig1.bipartitions.size() || hashLess(sig2.bipartitions[j], sig1.bipartitions[i]))
+    {
+      diff = sig2.lengths[j++];
+    }
+    else
+    {
+      diff = sig1.lengths[i++] - sig2.lengths[j++];
+      shared = true;
+    }
+    switch (type)
+    {
+    case TreeTools::BipartitionDistance::ROBINSON_FOULDS:
+      if (!shared)
+        d++;
+      break;
+    case TreeTools::BipartitionDistance::WEIGHTED_ROBINSON_FOULDS:
+      d += abs(diff);
+      break;
+    case TreeTools::BipartitionDistance::BRANCH_SCORE:
+      d += diff * diff;
+      break;
     }
   }
+  return type == TreeTools::BipartitionDistance::BRANCH_SCORE ? sqrt(d) : d;
+}
+
+unique_ptr<DistanceMatrix> signatureDistanceMatrix(const vector<BipartitionSignature>& signatures, TreeTools::BipartitionDistance type, bool verbose)
+{
+  size_t n = signatures.size();
+  vector<string> names(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    names[i] = "Tree" + TextTools::toString(i + 1);
+  }
+  auto dist = make_unique<DistanceMatrix>(names);
 
-  /* keep only distinct bipartitions */
-  for (size_t i = nbBip; i > 0; i--)
+  size_t nbDone = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (size_t i = 0; i < n; ++i)
   {
-    if (bipScore[i - 1] == 0)
+    (*dist)(i, i) = 0;
+    for (size_t j = i + 1; j < n; ++j)
     {
-      bipScore.erase(bipScore.begin() + static_cast<ptrdiff_t>(i - 1));
-      mergedBipL->deleteBipartition(i - 1);
+      (*dist)(i, j) = (*dist)(j, i) = signatureDistance(signatures[i], signatures[j], type);
+    }
+    if (verbose)
+    {
+#ifdef _OPENMP
+#pragma omp critical (TreeTools_bipartitionDistanceMatrix_display)
+#endif
+      ApplicationTools::displayGauge(nbDone++, n - 1, '=');
     }
   }
+  return dist;
+}
+} // end of anonymous namespace.
 
-  /* add terminal branches */
-  mergedBipL->addTrivialBipartitions(false);
-  for (size_t i = 0; i < mergedBipL->getNumberOfElements(); i++)
+/******************************************************************************/
+
+unique_ptr<DistanceMatrix> TreeTools::bipartitionDistanceMatrix(const vector<unique_ptr<Tree>>& vecTr, BipartitionDistance type, bool verbose)
+{
+  if (vecTr.size() == 0)
+    throw Exception("TreeTools::bipartitionDistanceMatrix. Empty vector passed");
+
+  BipartitionIndex index(vecTr[0]->getLeavesNames());
+  bool withLengths = (type != BipartitionDistance::ROBINSON_FOULDS);
+  vector<BipartitionSignature> signatures(vecTr.size());
+  string errorMessage = "";
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (size_t i = 0; i < vecTr.size(); ++i)
+  {
+    try
+    {
+      signatures[i] = computeSignature(index, *vecTr[i], withLengths);
+    }
+    catch (exception& e)
+    {
+#ifdef _OPENMP
+#pragma omp critical (TreeTools_bipartitionDistanceMatrix_error)
+#endif
+      if (errorMessage == "")
+        errorMessage = e.what();
+    }
+  }
+  if (errorMessage != "")
+    throw Exception("TreeTools::bipartitionDistanceMatrix. " + errorMessage);
+
+  return signatureDistanceMatrix(signatures, type, verbose);
+}
+
+/******************************************************************************/
+
+unique_ptr<DistanceMatrix> TreeTools::bipartitionDistanceMatrix(istream& in, BipartitionDistance type, bool verbose)
+{
+  if (!in)
+    throw IOException("TreeTools::bipartitionDistanceMatrix: failed to read from stream");
+
+  // Internal node labels are kept as text, comments are skipped:
+  Newick reader(true);
+  reader.enableExtendedBootstrapProperty(BOOTSTRAP);
+  NewickTreeIterator trees(reader, in);
+
+  unique_ptr<BipartitionIndex> index;
+  bool withLengths = (type != BipartitionDistance::ROBINSON_FOULDS);
+  vector<BipartitionSignature> signatures;
+  while (trees.hasMoreTrees())
   {
-    bipScore.push_back(vecTr.size());
+    auto tree = trees.nextTree();
+    if (!index)
+      index.reset(new BipartitionIndex(tree->getLeavesNames()));
+    signatures.push_back(computeSignature(*index, *tree, withLengths));
   }
+  if (signatures.size() == 0)
+    throw Exception("TreeTools::bipartitionDistanceMatrix. No tree found in stream.");
 
-  return mergedBipL;
+  return signatureDistanceMatrix(signatures, type, verbose);
 }
 
 /******************************************************************************/
@@ -1071,31 +1195,18 @@ unique_ptr<Tree> TreeTools::MRP(const vector<unique_ptr<Tree>>& vecTr)
 
 void TreeTools::computeBootstrapValues(Tree& tree, const vector<unique_ptr<Tree>>& vecTr, bool verbose, int format)
 {
+  BipartitionIndex bpIndex(tree.getLeavesNames());
+  bpIndex.addTrees(vecTr);
   vector<int> index;
-  BipartitionList bpTree(tree, true, &index);
-  vector<size_t> occurences;
-  auto bpList = bipartitionOccurrences(vecTr, occurences);
+  vector<Bipartition> bpTree = bpIndex.computeBipartitions(tree, &index);
 
-  vector< Number<double>> bootstrapValues(bpTree.getNumberOfBipartitions());
-
-  for (size_t i = 0; i < bpTree.getNumberOfBipartitions(); i++)
+  for (size_t i = 0; i < bpTree.size(); i++)
   {
     if (verbose)
-      ApplicationTools::displayGauge(i, bpTree.getNumberOfBipartitions() - 1, '=');
-    for (size_t j = 0; j < bpList->getNumberOfBipartitions(); j++)
-    {
-      if (BipartitionTools::areIdentical(bpTree, i, *bpList, j))
-      {
-        bootstrapValues[i] = format >= 0 ? round(static_cast<double>(occurences[j]) * std::pow(10., 2 + format) / static_cast<double>(vecTr.size())) / std::pow(10., format) : static_cast<double>(occurences[j]);
-        break;
-      }
-    }
-  }
-
-  for (size_t i = 0; i < index.size(); i++)
-  {
-    if (!tree.isLeaf(index[i]))
-      tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValues[i]);
+      ApplicationTools::displayGauge(i, bpTree.size() - 1, '=');
+    size_t occurences = bpIndex.getCount(bpTree[i]);
+    Number<double> bootstrapValue(format >= 0 ? round(static_cast<double>(occurences) * std::pow(10., 2 + format) / static_cast<double>(vecTr.size())) / std::pow(10., format) : static_cast<double>(occurences));
+    tree.setBranchProperty(index[i], BOOTSTRAP, bootstrapValue);
   }
 }
 
@@ -17,6 +17,9 @@
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/DistanceMatrix.h>
 
+// From the STL:
+#include <iostream>
+
 namespace bpp
 {
 /**
@@ -565,6 +568,8 @@ public:
    *
    * Returns the list of distinct bipartitions found at least once in the set of input trees,
    * and writes the number of occurrence of each of these bipartitions in vector bipScore.
+   * Non-trivial bipartitions are counted with a BipartitionIndex, and listed by
+   * increasing number of occurrences. Trivial bipartitions are appended at the end.
    *
    * @author Nicolas Galtier
    * @param vecTr Vector of input trees (must share a common set of leaves - not checked in this function)
@@ -573,6 +578,53 @@ public:
    */
   static std::unique_ptr<BipartitionList> bipartitionOccurrences(const std::vector<std::unique_ptr<Tree>>& vecTr, std::vector<size_t>& bipScore);
 
+  /**
+   * @brief Distances between trees computed from their bipartitions.
+   */
+  enum class BipartitionDistance
+  {
+    /** Number of non-trivial bipartitions found in only one of the two trees. */
+    ROBINSON_FOULDS,
+    /** Sum of the absolute differences of the branch lengths (0 for a missing branch), external branches included. */
+    WEIGHTED_ROBINSON_FOULDS,
+    /** Kuhner and Felsenstein's branch score: square root of the sum of the squared differences of the branch lengths. */
+    BRANCH_SCORE
+  };
+
+  /**
+   * @brief Compute the distances between all pairs of trees.
+   *
+   * The bipartitions of each tree are computed once and sorted by hash,
+   * so that each pair is compared in a time linear in the number of
+   * leaves. Pairs are computed in parallel if the library is built with
+   * OpenMP. The location of the root, if any, is ignored.
+   *
+   * The rows of the matrix are named "Tree1", "Tree2", etc. in the order
+   * of the trees, so that the matrix can be used with PGMA or NeighborJoining.
+   *
+   * @param vecTr   The trees, which must share a common set of leaves.
+   * @param type    The distance to compute.
+   * @param verbose Tell if a progress bar should be displayed.
+   * @return The distance matrix.
+   * @throw Exception If trees do not share the same leaves names.
+   */
+  static std::unique_ptr<DistanceMatrix> bipartitionDistanceMatrix(const std::vector<std::unique_ptr<Tree>>& vecTr, BipartitionDistance type = BipartitionDistance::ROBINSON_FOULDS, bool verbose = false);
+
+  /**
+   * @brief Compute the distances between all pairs of trees of a Newick stream.
+   *
+   * Trees are read one at a time, and only their bipartitions are kept
+   * in memory. Comments between brackets are ignored.
+   *
+   * @see bipartitionDistanceMatrix(const std::vector<std::unique_ptr<Tree>>&, BipartitionDistance, bool)
+   * @param in      The input stream, with one or several trees in Newick format.
+   * @param type    The distance to compute.
+   * @param verbose Tell if a progress bar should be displayed.
+   * @return The distance matrix.
+   * @throw Exception If trees do not share the same leaves names.
+   */
+  static std::unique_ptr<DistanceMatrix> bipartitionDistanceMatrix(std::istream& in, BipartitionDistance type = BipartitionDistance::ROBINSON_FOULDS, bool verbose = false);
+
   /**
    * @brief General greedy consensus tree method
    *
@@ -6,6 +6,7 @@
 #include "doctest.h"
 
 #include <algorithm>
+#include <thread>
 
 #include <Bpp/Exceptions.h>
 #include <Bpp/Phyl/Likelihood/DataFlow/DataFlowCWiseComputing.h>
@@ -484,6 +485,42 @@ struct OpaqueTestFunction : public Value<double>
   }
 };
 
+TEST_CASE("Context_concurrent_creation")
+{
+  Context c;
+  auto d = NumericMutable<double>::create(c, 42);
+  const std::size_t nbThreads = 8;
+  const std::size_t nbNodes = 200;
+
+  // Each thread builds the same nodes, which must be merged.
+  std::vector<std::vector<ValueRef<double>>> built(nbThreads);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < nbThreads; ++t)
+  {
+    threads.emplace_back([&c, &d, &built, t, nbNodes]() {
+          auto x = ValueRef<double>(d);
+          for (std::size_t i = 0; i < nbNodes; ++i)
+          {
+            x = CWiseAdd<double, std::tuple<double, double>>::create(c, {x, d}, Dimension<double>());
+            built[t].push_back(x);
+          }
+        });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  for (std::size_t t = 1; t < nbThreads; ++t)
+  {
+    CHECK(built[t] == built[0]);
+  }
+  // Discarded duplicates are unregistered: d is used twice by the
+  // first node, then once by each other node.
+  CHECK(d->nbDependentNodes() == nbNodes + 1);
+  CHECK(built[0].back()->targetValue() == 42 * double(nbNodes + 1));
+}
+
 TEST_CASE("numerical_derivation")
 {
   Context c;
@@ -0,0 +1,151 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Phyl/Tree/BipartitionIndex.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Tree/TreeTools.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+int main()
+{
+  vector<string> leaves(70);
+  for (size_t i = 0; i < leaves.size(); ++i)
+  {
+    leaves[i] = "leaf" + TextTools::toString(i);
+  }
+
+  vector<unique_ptr<Tree>> trees;
+  for (unsigned int j = 0; j < 20; ++j)
+  {
+    trees.push_back(TreeTemplateTools::getRandomTree(leaves, true));
+  }
+
+  // Robinson-Foulds distances:
+  for (size_t i = 0; i < trees.size(); ++i)
+  {
+    TreeTemplate<Node> copy(*trees[i]);
+    copy.getRootNode()->swap(0, 1);
+    if (TreeTools::robinsonFouldsDistance(*trees[i], copy) != 0)
+    {
+      cerr << "Non-zero distance between a tree and its copy." << endl;
+      return 1;
+    }
+    for (size_t j = 0; j < i; ++j)
+    {
+      int m1, m2;
+      int d12 = TreeTools::robinsonFouldsDistance(*trees[i], *trees[j], true, &m2, &m1);
+      int d21 = TreeTools::robinsonFouldsDistance(*trees[j], *trees[i]);
+      if (d12 != d21 || d12 != m1 + m2)
+      {
+        cerr << "Inconsistent distances: " << d12 << ", " << d21 << ", " << m1 << "+" << m2 << endl;
+        return 1;
+      }
+    }
+  }
+  cout << "RF distances ok." << endl;
+
+  // Counts over identical trees:
+  vector<unique_ptr<Tree>> same;
+  for (unsigned int j = 0; j < 10; ++j)
+  {
+    same.push_back(make_unique<TreeTemplate<Node>>(*trees[0]));
+  }
+  BipartitionIndex index(leaves);
+  index.addTrees(same);
+  index.addTree(*trees[1]);
+  if (index.getNumberOfTrees() != 11)
+    return 1;
+  for (auto& bip : index.computeBipartitions(*trees[0]))
+  {
+    if (index.getCount(bip) < 10)
+    {
+      cerr << "Wrong count: " << index.getCount(bip) << endl;
+      return 1;
+    }
+  }
+  auto bips = index.getBipartitions();
+  for (size_t i = 1; i < bips.size(); ++i)
+  {
+    if (bips[i].second < bips[i - 1].second)
+    {
+      cerr << "Bipartitions are not sorted by count." << endl;
+      return 1;
+    }
+  }
+  cout << "Bipartition counts ok." << endl;
+
+  // Consensus and bootstrap values:
+  same.push_back(make_unique<TreeTemplate<Node>>(*trees[1]));
+  auto consensus = TreeTools::majorityConsensus(same);
+  if (TreeTools::robinsonFouldsDistance(*consensus, *trees[0]) != 0)
+  {
+    cerr << "Majority consensus differs from majority tree." << endl;
+    return 1;
+  }
+  TreeTemplate<Node> support(*trees[0]);
+  TreeTools::computeBootstrapValues(support, same, false);
+  for (auto node : support.getInnerNodes())
+  {
+    if (!node->hasFather() || !node->hasBranchProperty(TreeTools::BOOTSTRAP))
+      continue;
+    double value = dynamic_cast<const Number<double>*>(node->getBranchProperty(TreeTools::BOOTSTRAP))->getValue();
+    if (value < 90.)
+    {
+      cerr << "Wrong bootstrap value: " << value << endl;
+      return 1;
+    }
+  }
+  cout << "Consensus ok." << endl;
+
+  // All-pairs distance matrices:
+  auto rf = TreeTools::bipartitionDistanceMatrix(trees);
+  for (size_t i = 0; i < trees.size(); ++i)
+  {
+    for (size_t j = 0; j < trees.size(); ++j)
+    {
+      if ((*rf)(i, j) != TreeTools::robinsonFouldsDistance(*trees[i], *trees[j]))
+      {
+        cerr << "Wrong RF distance in matrix for trees " << i << " and " << j << endl;
+        return 1;
+      }
+    }
+  }
+  stringstream ss;
+  for (auto& tree : trees)
+  {
+    TreeTools::initBranchLengthsGrafen(*tree);
+    ss << TreeTemplateTools::treeToParenthesis(dynamic_cast<const TreeTemplate<Node>&>(*tree)) << endl;
+  }
+  auto rfStream = TreeTools::bipartitionDistanceMatrix(ss);
+  if (rfStream->size() != trees.size())
+    return 1;
+  auto bs = TreeTools::bipartitionDistanceMatrix(trees, TreeTools::BipartitionDistance::BRANCH_SCORE);
+  auto wrf = TreeTools::bipartitionDistanceMatrix(trees, TreeTools::BipartitionDistance::WEIGHTED_ROBINSON_FOULDS);
+  for (size_t i = 0; i < trees.size(); ++i)
+  {
+    for (size_t j = 0; j < trees.size(); ++j)
+    {
+      if ((*rfStream)(i, j) != (*rf)(i, j))
+      {
+        cerr << "Streamed matrix differs for trees " << i << " and " << j << endl;
+        return 1;
+      }
+      if ((*bs)(i, j) > (*wrf)(i, j) + 1e-12 || ((*rf)(i, j) > 0) != ((*wrf)(i, j) > 0))
+      {
+        cerr << "Inconsistent branch distances for trees " << i << " and " << j << endl;
+        return 1;
+      }
+    }
+  }
+  cout << "Distance matrices ok." << endl;
+
+  return 0;
+}
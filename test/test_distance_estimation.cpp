@@ -6,15 +6,43 @@
 #include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/Container/SiteContainerTools.h>
 
+#include <Bpp/Phyl/Model/Nucleotide/HKY85.h>
 #include <Bpp/Phyl/Model/Nucleotide/JCnuc.h>
 #include <Bpp/Phyl/Model/RateDistribution/ConstantRateDistribution.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
 #include <Bpp/Phyl/Distance/DistanceEstimation.h>
+#include <Bpp/Phyl/Distance/PairwiseDistanceEstimation.h>
 
+#include <cmath>
 #include <iostream>
 
 using namespace bpp;
 using namespace std;
 
+// The pairwise engine must give the distances of DistanceEstimation:
+void compareDistances(const string& name,
+                      shared_ptr<SubstitutionModelInterface> model,
+                      shared_ptr<DiscreteDistributionInterface> rdist,
+                      shared_ptr<const SiteContainerInterface> sites)
+{
+  DistanceEstimation de(model, rdist, sites, 0, true);
+  PairwiseDistanceEstimation pde(model, rdist, 0);
+  pde.setData(sites);
+  pde.computeMatrix();
+  auto pdm = pde.getMatrix();
+  auto dm = de.getMatrix();
+  size_t n = sites->getNumberOfSequences();
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t j = i + 1; j < n; ++j)
+    {
+      cout << name << "\t" << i << "-" << j << "\t" << (*pdm)(i, j) << "\t" << (*dm)(i, j) << endl;
+      if (abs((*pdm)(i, j) - (*dm)(i, j)) > 1e-3 * max(1., (*dm)(i, j)))
+        throw Exception("Pairwise distance estimation failed with " + name + " for " + TextTools::toString(i) + " and " + TextTools::toString(j));
+    }
+  }
+}
+
 int main()
 {
   // Note: this only tests instanciation and exceptions. The correctness of calculations is not assessed.
@@ -42,6 +70,46 @@ int main()
     auto model1 = make_shared<JCnuc>(nucAlphabet);
     auto rdist = make_shared<ConstantRateDistribution>();
     DistanceEstimation de(model1, rdist, sites, 1, true);
+
+    // The pairwise engine must give the closed form JC distances:
+    PairwiseDistanceEstimation pde(model1, rdist, 0);
+    pde.setData(sites);
+    pde.computeMatrix();
+    auto pdm = pde.getMatrix();
+    auto dm = de.getMatrix();
+    size_t n = sites->getNumberOfSequences();
+    vector<string> names = sites->getSequenceNames();
+    size_t l = sites->getNumberOfSites();
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = i + 1; j < n; ++j)
+      {
+        double d = 0;
+        for (size_t k = 0; k < l; ++k)
+        {
+          if (sites->sequence(i).getValue(k) != sites->sequence(j).getValue(k))
+            d++;
+        }
+        double jc = -3. / 4. * log(1. - 4. / 3. * d / static_cast<double>(l));
+        cout << names[i] << "-" << names[j] << "\t" << (*pdm)(i, j) << "\t" << jc << "\t" << (*dm)(i, j) << endl;
+        if (abs((*pdm)(i, j) - jc) > 1e-4)
+          throw Exception("Pairwise distance estimation failed for " + TextTools::toString(i) + " and " + TextTools::toString(j));
+      }
+    }
+
+    // Gamma distributed rates, with the eigen decomposition of the
+    // generator:
+    auto model2 = make_shared<HKY85>(nucAlphabet, 2.5, 0.2, 0.3, 0.3, 0.2);
+    auto gamma = make_shared<GammaDiscreteRateDistribution>(4, 0.5);
+    compareDistances("HKY85+G", model2, gamma, sites);
+
+    // Without eigen decomposition, the transition probability matrices
+    // are used:
+    auto model3 = make_shared<HKY85>(nucAlphabet, 2.5, 0.2, 0.3, 0.3, 0.2);
+    model3->setExponentialMethod(AbstractSubstitutionModel::ExponentialMethod::PADE);
+    model3->enableEigenDecomposition(false);
+    compareDistances("HKY85 (Pade)", model3, rdist, sites);
+    compareDistances("HKY85+G (Pade)", model3, gamma, sites);
   }
   catch (exception& e)
   {
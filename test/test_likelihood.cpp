@@ -13,18 +13,50 @@
 #include <Bpp/Phyl/Legacy/OptimizationTools.h>
 
 #include <Bpp/Phyl/OptimizationTools.h>
+#include <Bpp/Phyl/ParameterBlockScheduler.h>
 #include <Bpp/Phyl/Likelihood/ParametrizablePhyloTree.h>
 #include <Bpp/Phyl/Likelihood/SimpleSubstitutionProcess.h>
 #include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
 
 #include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/AlignedPhyloLikelihoodProduct.h>
+#include <Bpp/Phyl/Likelihood/SubstitutionProcessCollection.h>
 
+#include <cstdio>
 #include <iostream>
 
 
 using namespace bpp;
 using namespace std;
 
+/**
+ * @brief Simulates the interruption of an optimization after a number
+ * of steps.
+ */
+class InterruptionException : public Exception
+{
+public:
+  InterruptionException() : Exception("Optimization interrupted.") {}
+};
+
+class InterruptionListener : public OptimizationListener
+{
+private:
+  unsigned int nbSteps_;
+  unsigned int maxSteps_;
+
+public:
+  InterruptionListener(unsigned int maxSteps) : nbSteps_(0), maxSteps_(maxSteps) {}
+
+  void optimizationInitializationPerformed(const OptimizationEvent& event) {}
+  void optimizationStepPerformed(const OptimizationEvent& event)
+  {
+    if (++nbSteps_ == maxSteps_)
+      throw InterruptionException();
+  }
+  bool listenerModifiesParameters () const { return false; }
+};
+
 void fitModelHSR(std::shared_ptr<SubstitutionModelInterface> model,
     std::shared_ptr<DiscreteDistributionInterface> rdist,
     const Tree& tree,
@@ -184,6 +216,111 @@ void fitModelHSR(std::shared_ptr<SubstitutionModelInterface> model,
   if (abs(llh2->getValue() - finalValue) > 0.001)
     throw Exception("Incorrect final value.");
   llh2->getParameters().printParameters(cout);
+
+  // Interrupted optimization, resumed from a backup:
+  string backupPath = "test_likelihood.bck";
+  std::remove(backupPath.c_str());
+  for (size_t run = 0; run < 2; ++run)
+  {
+    process = std::make_shared<RateAcrossSitesSubstitutionProcess>(
+          shared_ptr<SubstitutionModelInterface>(model->clone()),
+          shared_ptr<DiscreteDistributionInterface>(rdist->clone()),
+          partree);
+    Context context3;
+    auto llh3 = make_shared<SingleProcessPhyloLikelihood>(context3, make_shared<LikelihoodCalculationSingleProcess>(context3, sites, process));
+    auto backup = make_shared<PhyloBackupListener>(backupPath);
+    shared_ptr<OptimizationListener> interruption = (run == 0) ? make_shared<InterruptionListener>(3) : nullptr;
+    try
+    {
+      OptimizationTools::optimizeNumericalParameters2(llh3, llh3->getParameters(), interruption, 0.000001, nboptim, 0, 0, false, false, 0, OptimizationTools::OPTIMIZATION_NEWTON, backup);
+    }
+    catch (InterruptionException&)
+    {
+      continue;
+    }
+    ApplicationTools::displayResult("* lnL after resumed optimization", llh3->getValue());
+    if (abs(llh3->getValue() - finalValue) > 0.001)
+      throw Exception("Incorrect final value after resuming.");
+  }
+
+  // A completed optimization is skipped only on request:
+  {
+    process = std::make_shared<RateAcrossSitesSubstitutionProcess>(
+          shared_ptr<SubstitutionModelInterface>(model->clone()),
+          shared_ptr<DiscreteDistributionInterface>(rdist->clone()),
+          partree);
+    Context context3;
+    auto llh3 = make_shared<SingleProcessPhyloLikelihood>(context3, make_shared<LikelihoodCalculationSingleProcess>(context3, sites, process));
+    auto backup = make_shared<PhyloBackupListener>(backupPath, true);
+    unsigned int nbEval = OptimizationTools::optimizeNumericalParameters2(llh3, llh3->getParameters(), 0, 0.000001, nboptim, 0, 0, false, false, 0, OptimizationTools::OPTIMIZATION_NEWTON, backup);
+    if (!backup->isCompleted() || nbEval != backup->getNumberOfEvaluations())
+      throw Exception("Completed optimization not skipped.");
+    if (abs(llh3->getValue() - finalValue) > 0.001)
+      throw Exception("Incorrect value restored from a completed backup.");
+  }
+
+  // The backup of another likelihood is rejected:
+  {
+    auto otherProcess = std::make_shared<RateAcrossSitesSubstitutionProcess>(
+          shared_ptr<SubstitutionModelInterface>(model->clone()),
+          make_shared<ConstantRateDistribution>(),
+          partree);
+    Context context3;
+    auto llh3 = make_shared<SingleProcessPhyloLikelihood>(context3, make_shared<LikelihoodCalculationSingleProcess>(context3, sites, otherProcess));
+    auto backup = make_shared<PhyloBackupListener>(backupPath);
+    bool rejected = false;
+    try
+    {
+      backup->restore(*llh3);
+    }
+    catch (IOException&)
+    {
+      rejected = true;
+    }
+    if (!rejected)
+      throw Exception("Backup of another likelihood restored.");
+  }
+  std::remove(backupPath.c_str());
+
+  // Block-coordinate optimization:
+  process = std::make_shared<RateAcrossSitesSubstitutionProcess>(
+        shared_ptr<SubstitutionModelInterface>(model->clone()),
+        shared_ptr<DiscreteDistributionInterface>(rdist->clone()),
+        partree);
+  Context context4;
+  auto llh4 = make_shared<SingleProcessPhyloLikelihood>(context4, make_shared<LikelihoodCalculationSingleProcess>(context4, sites, process));
+  ParameterBlockScheduler scheduler(llh4, llh4->getParameters());
+  scheduler.setTolerance(0.000001);
+  scheduler.optimize();
+  scheduler.printReport(*ApplicationTools::message);
+  ApplicationTools::displayResult("* lnL after block optimization", llh4->getValue());
+  if (abs(llh4->getValue() - finalValue) > 0.001)
+    throw Exception("Incorrect final value after block optimization.");
+
+  // Product of two unlinked partitions: the blocks of each batch are
+  // optimized concurrently, on the members.
+  Context context5;
+  auto pc5 = make_shared<PhyloLikelihoodContainer>(context5, make_shared<SubstitutionProcessCollection>());
+  for (size_t i = 1; i <= 2; ++i)
+  {
+    auto processI = shared_ptr<SubstitutionProcessInterface>(process->clone());
+    pc5->addPhyloLikelihood(i, make_shared<SingleProcessPhyloLikelihood>(context5, make_shared<LikelihoodCalculationSingleProcess>(context5, sites, processI)));
+  }
+  auto prod5 = make_shared<AlignedPhyloLikelihoodProduct>(context5, pc5, vector<size_t>{1, 2}, false);
+  ParameterBlockScheduler productScheduler(prod5, prod5->getParameters());
+  if (productScheduler.getNumberOfComponents() != 2)
+    throw Exception("Unlinked partitions should be independent components.");
+  for (const auto& block : productScheduler.getBlocks())
+  {
+    if (!block.concurrent)
+      throw Exception("Blocks of unlinked partitions should be optimized concurrently.");
+  }
+  productScheduler.setTolerance(0.000001);
+  productScheduler.optimize();
+  productScheduler.printReport(*ApplicationTools::message);
+  ApplicationTools::displayResult("* lnL after concurrent block optimization", prod5->getValue());
+  if (abs(prod5->getValue() - 2 * finalValue) > 0.002)
+    throw Exception("Incorrect final value after concurrent block optimization.");
 }
 
 
@@ -0,0 +1,192 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <cstdlib>
+
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+
+#include <Bpp/Phyl/Likelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+
+#include <atomic>
+#include <cerrno>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+/*
+ * Once the nodes of the likelihood graph have been computed, their
+ * values are reused as buffers: re-evaluating the likelihood after a
+ * change of a branch length must not allocate memory.
+ *
+ * Allocations are counted by interposing all the C allocation
+ * functions, which are used by Eigen and by the default operator new.
+ * This relies on glibc, the test does nothing on other systems.
+ *
+ * The whole re-evaluation is checked, including the computation of
+ * the transition matrices by the models: this holds because T92
+ * computes them analytically. A model computing them from its eigen
+ * decomposition would allocate work matrices, which is out of the
+ * scope of this test.
+ */
+
+#if defined(__GLIBC__)
+
+static atomic<bool> countAllocations(false);
+static atomic<size_t> nbAllocations(0);
+
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+
+void* malloc(size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t nb, size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_calloc(nb, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  void* p = __libc_memalign(alignment, size);
+  if (!p)
+    return ENOMEM;
+  *ptr = p;
+  return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_memalign(alignment, size);
+}
+
+void* valloc(size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) noexcept
+{
+  if (countAllocations)
+    nbAllocations++;
+  return __libc_pvalloc(size);
+}
+}
+
+int main()
+{
+  Newick reader;
+  auto pTree = unique_ptr<PhyloTree>(reader.parenthesisToPhyloTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);", false, "", false, false));
+  auto paramphyloTree = make_shared<ParametrizablePhyloTree>(*pTree);
+
+  auto alphabet = AlphabetTools::DNA_ALPHABET;
+  auto sites = make_shared<VectorSiteContainer>(alphabet);
+  auto seqA = make_unique<Sequence>("A", "AAATGGCTGTGCACGTCTACGCCTAGGCTAGCATCG", alphabet);
+  sites->addSequence("A", seqA);
+  auto seqB = make_unique<Sequence>("B", "GACTGGATCTGCACGTTTACGCCTGGGCTCGCATCA", alphabet);
+  sites->addSequence("B", seqB);
+  auto seqC = make_unique<Sequence>("C", "CTCTGGATGTGCACGTGTACGCCTGGGCTCGCATCG", alphabet);
+  sites->addSequence("C", seqC);
+  auto seqD = make_unique<Sequence>("D", "AAATGGCTGTGCACGTCTACGCCTGAGCTAGCATCG", alphabet);
+  sites->addSequence("D", seqD);
+
+  auto model = make_shared<T92>(alphabet, 3., 0.6);
+  auto rdist = make_shared<GammaDiscreteRateDistribution>(4, 0.5);
+  auto process = make_shared<RateAcrossSitesSubstitutionProcess>(model, rdist, paramphyloTree);
+
+  try
+  {
+    Context context;
+    auto lik = make_shared<LikelihoodCalculationSingleProcess>(context, sites, process);
+    auto likNode = lik->getLikelihoodNode();
+    auto brLen = dynamic_cast<ConfiguredParameter*>(lik->getParameter("BrLen1").get());
+    double x = brLen->getValue();
+
+    // First evaluations: node values get their dimensions.
+    auto lnL0 = likNode->targetValue();
+    brLen->setValue(x * 1.5);
+    auto lnL1 = likNode->targetValue();
+    brLen->setValue(x);
+    if (likNode->targetValue() != lnL0)
+    {
+      cerr << "Wrong value after restoring the branch length." << endl;
+      return 1;
+    }
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+      brLen->setValue(i % 2 == 0 ? x * 1.5 : x);
+      countAllocations = true;
+      auto lnL = likNode->targetValue();
+      countAllocations = false;
+      if (lnL != (i % 2 == 0 ? lnL1 : lnL0))
+      {
+        cerr << "Wrong value at re-evaluation " << i << "." << endl;
+        return 1;
+      }
+    }
+
+    if (nbAllocations != 0)
+    {
+      cerr << nbAllocations << " allocations during re-evaluations." << endl;
+      return 1;
+    }
+  }
+  catch (exception& ex)
+  {
+    cerr << "ERROR!!!" << endl;
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+#else
+
+int main()
+{
+  cout << "Allocations can not be counted on this system." << endl;
+  return 0;
+}
+
+#endif
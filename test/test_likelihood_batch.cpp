@@ -0,0 +1,239 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Numeric/Random/RandomTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+
+#include <Bpp/Phyl/Likelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/PhyloLikelihoodSnapshot.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+/*
+ * The log-likelihoods computed in batch on independent lanes are
+ * compared to the ones computed one point after the other, and the
+ * RELL log-likelihoods of bootstrap replicates to the ones computed
+ * with the replicate weights. A likelihood restarted from a snapshot
+ * must have the same value as the saved one.
+ */
+int main()
+{
+  Newick reader;
+  auto pTree = unique_ptr<PhyloTree>(reader.parenthesisToPhyloTree("((A:0.01, B:0.02):0.03,C:0.01,D:0.1);", false, "", false, false));
+  auto paramphyloTree = make_shared<ParametrizablePhyloTree>(*pTree);
+
+  auto alphabet = AlphabetTools::DNA_ALPHABET;
+  auto sites = make_shared<VectorSiteContainer>(alphabet);
+  auto seqA = make_unique<Sequence>("A", "AAATGGCTGTGCACGTCTACGCCTAGGCTAGCATCG", alphabet);
+  sites->addSequence("A", seqA);
+  auto seqB = make_unique<Sequence>("B", "GACTGGATCTGCACGTTTACGCCTGGGCTCGCATCA", alphabet);
+  sites->addSequence("B", seqB);
+  auto seqC = make_unique<Sequence>("C", "CTCTGGATGTGCACGTGTACGCCTGGGCTCGCATCG", alphabet);
+  sites->addSequence("C", seqC);
+  auto seqD = make_unique<Sequence>("D", "AAATGGCTGTGCACGTCTACGCCTGAGCTAGCATCG", alphabet);
+  sites->addSequence("D", seqD);
+
+  auto model = make_shared<T92>(alphabet, 3., 0.6);
+  auto rdist = make_shared<GammaDiscreteRateDistribution>(4, 0.5);
+  auto process = make_shared<RateAcrossSitesSubstitutionProcess>(model, rdist, paramphyloTree);
+
+  try
+  {
+    Context context;
+    auto lik = make_shared<LikelihoodCalculationSingleProcess>(context, sites, process);
+    SingleProcessPhyloLikelihood llh(context, lik);
+    double lnL0 = llh.getLogLikelihood();
+
+    vector<string> names = {"T92.kappa", "T92.theta", "Gamma.alpha", "BrLen1"};
+    VVdouble points;
+    for (size_t i = 0; i < 50; ++i)
+    {
+      points.push_back({RandomTools::giveRandomNumberBetweenZeroAndEntry(10.) + 0.1,
+                        RandomTools::giveRandomNumberBetweenZeroAndEntry(0.8) + 0.1,
+                        RandomTools::giveRandomNumberBetweenZeroAndEntry(2.) + 0.1,
+                        RandomTools::giveRandomNumberBetweenZeroAndEntry(0.5) + 0.001});
+    }
+
+    Vdouble batch = llh.getLogLikelihoods(names, points);
+
+    // The parameters of the likelihood are not modified:
+    if (abs(llh.getLogLikelihood() - lnL0) > 1e-10)
+    {
+      cerr << "The batch evaluation modified the likelihood." << endl;
+      return 1;
+    }
+
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      for (size_t k = 0; k < names.size(); ++k)
+      {
+        llh.setParameterValue(names[k], points[i][k]);
+      }
+      double lnL = llh.getLogLikelihood();
+      if (abs(lnL - batch[i]) > 1e-8 * max(1., abs(lnL)))
+      {
+        cerr << "Wrong value at point " << i << ": " << setprecision(12) << batch[i] << " instead of " << lnL << endl;
+        return 1;
+      }
+    }
+
+    // With a single lane, and with lanes built by the previous call:
+    Vdouble batch1 = llh.getLogLikelihoods(names, points, 1);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+      if (abs(batch1[i] - batch[i]) > 1e-8 * max(1., abs(batch[i])))
+      {
+        cerr << "Wrong value at point " << i << " with a single lane." << endl;
+        return 1;
+      }
+    }
+
+    // Bootstrap replicates, by reweighting the distinct sites, and RELL:
+    auto likCal = llh.getLikelihoodCalculationSingleProcess();
+    double lnL = llh.getLogLikelihood();
+    Eigen::MatrixXi weights = likCal->drawBootstrapWeights(20);
+    Eigen::VectorXd rell = llh.getRELLLogLikelihoods(weights);
+    for (Eigen::Index r = 0; r < weights.rows(); ++r)
+    {
+      if (size_t(weights.row(r).sum()) != sites->getNumberOfSites())
+      {
+        cerr << "Wrong number of sites in bootstrap replicate " << r << endl;
+        return 1;
+      }
+      likCal->setRootWeights(weights.row(r));
+      double lnLr = llh.getLogLikelihood();
+      if (abs(lnLr - rell(r)) > 1e-8 * abs(lnLr))
+      {
+        cerr << "Wrong RELL value for replicate " << r << ": " << setprecision(12) << rell(r) << " instead of " << lnLr << endl;
+        return 1;
+      }
+    }
+    likCal->resetRootWeights();
+    if (abs(llh.getLogLikelihood() - lnL) > 1e-8 * abs(lnL))
+    {
+      cerr << "Weights not restored." << endl;
+      return 1;
+    }
+    Eigen::RowVectorXi twice = 2 * likCal->getRootWeights()->targetValue();
+    likCal->setRootWeights(twice);
+    if (abs(llh.getLogLikelihood() - 2 * lnL) > 1e-8 * abs(lnL))
+    {
+      cerr << "Wrong value with doubled weights." << endl;
+      return 1;
+    }
+    likCal->resetRootWeights();
+
+    // Likelihoods on the same data share their patterns:
+    auto likCopy = make_shared<LikelihoodCalculationSingleProcess>(*likCal);
+    Context context2;
+    auto lik2 = make_shared<LikelihoodCalculationSingleProcess>(context2, sites, process);
+    if (likCopy->getShrunkData() != likCal->getShrunkData() || lik2->getShrunkData() != likCal->getShrunkData())
+    {
+      cerr << "Site patterns are not shared." << endl;
+      return 1;
+    }
+    SingleProcessPhyloLikelihood llh2(context2, lik2);
+    if (abs(llh2.getLogLikelihood() - lnL) > 1e-8 * abs(lnL))
+    {
+      cerr << "Wrong value with shared patterns." << endl;
+      return 1;
+    }
+
+    // Copies in another context, as used by getLogLikelihoods, take
+    // the patterns of the original:
+    Context contextLane;
+    auto likLane = make_shared<LikelihoodCalculationSingleProcess>(contextLane, *likCal);
+    if (likLane->getShrunkData() != likCal->getShrunkData())
+    {
+      cerr << "Site patterns are not shared with a copy in another context." << endl;
+      return 1;
+    }
+    SingleProcessPhyloLikelihood llhLane(contextLane, likLane);
+    if (abs(llhLane.getLogLikelihood() - lnL) > 1e-8 * abs(lnL))
+    {
+      cerr << "Wrong value with a copy in another context." << endl;
+      return 1;
+    }
+
+    // Patterns are identified by the content of the data, not by its
+    // address:
+    auto sitesCopy = make_shared<VectorSiteContainer>(*sites);
+    auto sitesOther = make_shared<VectorSiteContainer>(alphabet);
+    auto seqA2 = make_unique<Sequence>("A", "AAATGGCTGTGCACGTCTACGCCTAGGCTAGCATCG", alphabet);
+    sitesOther->addSequence("A", seqA2);
+    auto seqB2 = make_unique<Sequence>("B", "GACTGGATCTGCACGTTTACGCCTGGGCTCGCATCA", alphabet);
+    sitesOther->addSequence("B", seqB2);
+    auto seqC2 = make_unique<Sequence>("C", "CTCTGGATGTGCACGTGTACGCCTGGGCTCGCATCG", alphabet);
+    sitesOther->addSequence("C", seqC2);
+    auto seqD2 = make_unique<Sequence>("D", "CAATGGCTGTGCACGTCTACGCCTGAGCTAGCATCG", alphabet);
+    sitesOther->addSequence("D", seqD2);
+    Context contextData;
+    auto lik3 = make_shared<LikelihoodCalculationSingleProcess>(contextData, sitesCopy, process);
+    auto lik4 = make_shared<LikelihoodCalculationSingleProcess>(contextData, sitesOther, process);
+    if (lik3->getShrunkData() != likCal->getShrunkData())
+    {
+      cerr << "Site patterns are not shared between equal data." << endl;
+      return 1;
+    }
+    if (lik4->getShrunkData() == likCal->getShrunkData())
+    {
+      cerr << "Site patterns are shared between different data." << endl;
+      return 1;
+    }
+
+    // Snapshot, and restart on the distinct sites:
+    Context context3;
+    auto likCal3 = make_shared<LikelihoodCalculationSingleProcess>(context3, sites, process);
+    auto llh3 = make_shared<SingleProcessPhyloLikelihood>(context3, likCal3);
+    llh3->setParameterValue("T92.kappa", 5.);
+    likCal3->setRootWeights(weights.row(0));
+    double lnL3 = llh3->getLogLikelihood();
+    string snapshotPath = "test_likelihood_batch.bin";
+    map<size_t, shared_ptr<const PhyloLikelihoodInterface>> saved = {{1, llh3}};
+    PhyloLikelihoodSnapshot::write(snapshotPath, saved);
+
+    PhyloLikelihoodSnapshot snapshot(snapshotPath, alphabet);
+    std::remove(snapshotPath.c_str());
+    Context context4;
+    auto llh4 = make_shared<SingleProcessPhyloLikelihood>(context4, make_shared<LikelihoodCalculationSingleProcess>(context4, snapshot.getData(1), process));
+    map<size_t, shared_ptr<PhyloLikelihoodInterface>> restored = {{1, llh4}};
+    snapshot.restore(restored);
+    if (snapshot.getPatternLinks(1).size() != sites->getNumberOfSites() || abs(llh4->getLogLikelihood() - lnL3) > 1e-8 * abs(lnL3))
+    {
+      cerr << "Wrong value after restart from a snapshot: " << setprecision(12) << llh4->getLogLikelihood() << " instead of " << lnL3 << endl;
+      return 1;
+    }
+
+    // Invalid values are reported:
+    try
+    {
+      llh.getLogLikelihoods(names, {{-1., 0.5, 1., 0.1}});
+      cerr << "A negative kappa should be rejected." << endl;
+      return 1;
+    }
+    catch (Exception&)
+    {}
+  }
+  catch (exception& ex)
+  {
+    cerr << "ERROR!!!" << endl;
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -21,6 +21,7 @@
 
 #include <Bpp/Phyl/Likelihood/PhyloLikelihoods/MixtureProcessPhyloLikelihood.h>
 #include <Bpp/Phyl/Likelihood/PhyloLikelihoods/AlignedPhyloLikelihoodMixture.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/AlignedPhyloLikelihoodProduct.h>
 #include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
 #include <Bpp/Phyl/Likelihood/PhyloLikelihoods/PhyloLikelihoodFormula.h>
 
@@ -239,6 +240,103 @@ int main()
 
   cerr << "--------------------------------" << endl;
 
+  // Product of unlinked partitions, optimized partition by partition
+
+  Context context3;
+
+  auto pc3 = make_shared<PhyloLikelihoodContainer>(context3, modelColl);
+
+  auto lik13 = make_shared<LikelihoodCalculationSingleProcess>(context3, sites, shared_ptr<SubstitutionProcessInterface>(subPro1->clone()));
+  pc3->addPhyloLikelihood(1, make_shared<SingleProcessPhyloLikelihood>(context3, lik13));
+
+  auto lik23 = make_shared<LikelihoodCalculationSingleProcess>(context3, sites, shared_ptr<SubstitutionProcessInterface>(subPro2->clone()));
+  pc3->addPhyloLikelihood(2, make_shared<SingleProcessPhyloLikelihood>(context3, lik23));
+
+  auto prod = make_shared<AlignedPhyloLikelihoodProduct>(context3, pc3, nPhylo, false);
+
+  unsigned int cP = OptimizationTools::optimizeNumericalParametersByPartition(
+        prod, prod->getParameters(),
+        0.0001, 10000,
+        messenger, profiler,
+        1, OptimizationTools::OPTIMIZATION_NEWTON);
+
+  cerr << "Opt by partition evaluations: " << cP << endl;
+
+  cerr << "Prod: " << prod->getValue() << endl;
+
+  if (abs(prod->getValue() - spl1->getValue() - spl2->getValue()) > 0.001)
+  {
+    cerr << "Wrong value after optimization by partition." << endl;
+    return 1;
+  }
+
+  // Same partitions built from the collection, where both processes use
+  // model 1: its parameters are linked, and optimized jointly between
+  // the optimizations of the partitions.
+
+  Context context4;
+
+  auto collNodes4 = make_shared<CollectionNodes>(context4, modelColl);
+  auto pc4 = make_shared<PhyloLikelihoodContainer>(context4, collNodes4);
+
+  auto lik14 = make_shared<LikelihoodCalculationSingleProcess>(collNodes4, sites, 1);
+  pc4->addPhyloLikelihood(1, make_shared<SingleProcessPhyloLikelihood>(context4, lik14, 1));
+
+  auto lik24 = make_shared<LikelihoodCalculationSingleProcess>(collNodes4, sites, 2);
+  pc4->addPhyloLikelihood(2, make_shared<SingleProcessPhyloLikelihood>(context4, lik24, 2));
+
+  auto prodLinked = make_shared<AlignedPhyloLikelihoodProduct>(context4, pc4, nPhylo, true);
+
+  // Reference: the same product optimized on all parameters at once.
+
+  Context context5;
+
+  auto collNodes5 = make_shared<CollectionNodes>(context5, modelColl);
+  auto pc5 = make_shared<PhyloLikelihoodContainer>(context5, collNodes5);
+
+  auto lik15 = make_shared<LikelihoodCalculationSingleProcess>(collNodes5, sites, 1);
+  pc5->addPhyloLikelihood(1, make_shared<SingleProcessPhyloLikelihood>(context5, lik15, 1));
+
+  auto lik25 = make_shared<LikelihoodCalculationSingleProcess>(collNodes5, sites, 2);
+  pc5->addPhyloLikelihood(2, make_shared<SingleProcessPhyloLikelihood>(context5, lik25, 2));
+
+  auto prodRef = make_shared<AlignedPhyloLikelihoodProduct>(context5, pc5, nPhylo, true);
+
+  double initLinked = prodLinked->getValue();
+
+  unsigned int cL = OptimizationTools::optimizeNumericalParametersByPartition(
+        prodLinked, prodLinked->getParameters(),
+        0.0001, 10000,
+        messenger, profiler,
+        1, OptimizationTools::OPTIMIZATION_NEWTON);
+
+  cerr << "Opt linked by partition evaluations: " << cL << endl;
+
+  unsigned int cR = OptimizationTools::optimizeNumericalParameters2(
+        prodRef, prodRef->getParameters(), 0,
+        0.0001, 10000,
+        messenger, profiler,
+        false, false,
+        1, OptimizationTools::OPTIMIZATION_NEWTON);
+
+  cerr << "Opt linked jointly evaluations: " << cR << endl;
+
+  cerr << "Linked prod: " << initLinked << " -> " << prodLinked->getValue() << "\tReference: " << prodRef->getValue() << endl;
+
+  if (prodLinked->getValue() > initLinked)
+  {
+    cerr << "Worse value after optimization by partition of linked partitions." << endl;
+    return 1;
+  }
+
+  if (abs(prodLinked->getValue() - prodRef->getValue()) > 0.05)
+  {
+    cerr << "Optimization by partition of linked partitions does not reach the joint optimum." << endl;
+    return 1;
+  }
+
+  cerr << "--------------------------------" << endl;
+
   unsigned int cM = OptimizationTools::optimizeNumericalParameters2(
         mlc, mlc->getParameters(), 0,
         0.0001, 10000,
@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/App/ApplicationTools.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Codon/TripletSubstitutionModel.h>
+#include <Bpp/Phyl/Model/RateDistribution/GammaDiscreteRateDistribution.h>
+#include <Bpp/Phyl/Tree/TreeTemplate.h>
+#include <Bpp/Phyl/Tree/TreeTemplateTools.h>
+#include <Bpp/Phyl/Legacy/Likelihood/RHomogeneousTreeLikelihood.h>
+
+#include <Bpp/Phyl/Likelihood/ParametrizablePhyloTree.h>
+#include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/LikelihoodCalculationSingleProcess.h>
+#include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
+
+#include <iomanip>
+#include <iostream>
+
+using namespace bpp;
+using namespace std;
+
+/*
+ * The likelihood of a word model is computed in factored form in the
+ * data flow likelihood, and with the whole transition matrices in the
+ * legacy one.
+ */
+bool compare(const string& name, double newValue, double oldValue)
+{
+  cout << name << ": " << setprecision(12) << newValue << " (legacy " << oldValue << ")" << endl;
+  if (abs(newValue - oldValue) > 1e-6 * max(1., abs(oldValue)))
+  {
+    cerr << "Wrong value for " << name << endl;
+    return false;
+  }
+  return true;
+}
+
+int main()
+{
+  string newick = "((A:0.01, B:0.02):0.03,C:0.01,D:0.1);";
+  unique_ptr<TreeTemplate<Node>> tree(TreeTemplateTools::parenthesisToTree(newick));
+  Newick reader;
+  auto pTree = unique_ptr<PhyloTree>(reader.parenthesisToPhyloTree(newick, false, "", false, false));
+  auto paramphyloTree = make_shared<ParametrizablePhyloTree>(*pTree);
+
+  auto gc = make_shared<StandardGeneticCode>(AlphabetTools::DNA_ALPHABET);
+  auto alphabet = dynamic_pointer_cast<const CodonAlphabet>(gc->getSourceAlphabet());
+
+  auto sites = make_shared<VectorSiteContainer>(alphabet);
+  auto seqA = make_unique<Sequence>("A", "ATCCAGACATGCCGGGACTTTGCAGAGAAGGAGTTGTTTCCCATTGCAGCCCAGGTGGATAAGGAACAG", alphabet);
+  sites->addSequence("A", seqA);
+  auto seqB = make_unique<Sequence>("B", "CGTCAGACATGCCGTGACTTTGCCGAGAAGGAGTTGGTCCCCATTGCGGCCCAGCTGGACAGGGAGCAT", alphabet);
+  sites->addSequence("B", seqB);
+  auto seqC = make_unique<Sequence>("C", "GGTCAGACATGCCGGGAATTTGCTGAAAAGGAGCTGGTTCCCATTGCAGCCCAGGTAGACAAGGAGCAT", alphabet);
+  sites->addSequence("C", seqC);
+  auto seqD = make_unique<Sequence>("D", "TTCCAGACATGCCGGGACTTTACCGAGAAGGAGTTGTTTTCCATTGCAGCCCAGGTGGATAAGGAACAT", alphabet);
+  sites->addSequence("D", seqD);
+
+  auto model = make_shared<TripletSubstitutionModel>(alphabet,
+        make_unique<T92>(AlphabetTools::DNA_ALPHABET, 3.),
+        make_unique<K80>(AlphabetTools::DNA_ALPHABET, 2.),
+        make_unique<T92>(AlphabetTools::DNA_ALPHABET, 5., 0.4));
+  model->setParameterValue("relrate1", 0.2);
+  model->setParameterValue("relrate2", 0.3);
+  auto rdist = make_shared<GammaDiscreteRateDistribution>(4, 0.5);
+
+  try
+  {
+    RHomogeneousTreeLikelihood tl(*tree, *sites, model, rdist, false, false);
+    tl.initialize();
+
+    auto process = make_shared<RateAcrossSitesSubstitutionProcess>(
+          shared_ptr<SubstitutionModelInterface>(model->clone()),
+          shared_ptr<DiscreteDistributionInterface>(rdist->clone()),
+          paramphyloTree);
+    Context context;
+    auto lik = make_shared<LikelihoodCalculationSingleProcess>(context, sites, process);
+    SingleProcessPhyloLikelihood llh(context, lik);
+
+    bool ok = compare("lnL", llh.getValue(), tl.getValue());
+    for (string brlen : {"BrLen1", "BrLen2"})
+    {
+      ok &= compare("d lnL / d " + brlen, llh.getFirstOrderDerivative(brlen), tl.getFirstOrderDerivative(brlen));
+      ok &= compare("d2 lnL / d " + brlen + "2", llh.getSecondOrderDerivative(brlen), tl.getSecondOrderDerivative(brlen));
+    }
+
+    // Model parameters of the positions and relative rates
+    vector<string> names = {"relrate2", "T92.kappa", "K80.kappa", "T92.theta"};
+    for (const auto& paramName : model->getParameters().getParameterNames())
+    {
+      bool toTest = false;
+      for (const auto& name : names)
+      {
+        toTest |= paramName.find(name) != string::npos;
+      }
+      if (!toTest)
+        continue;
+      double value = tl.getParameterValue(paramName) * 0.8;
+      tl.setParameterValue(paramName, value);
+      llh.setParameterValue(paramName + "_1", value);
+      ok &= compare("lnL with " + paramName + "=" + TextTools::toString(value), llh.getValue(), tl.getValue());
+    }
+    if (!ok)
+      return 1;
+  }
+  catch (exception& ex)
+  {
+    cerr << "ERROR!!!" << endl;
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  return 0;
+}
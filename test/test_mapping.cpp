@@ -19,12 +19,16 @@
 #include <Bpp/Phyl/Mapping/UniformizationSubstitutionCount.h>
 #include <Bpp/Phyl/Mapping/NaiveSubstitutionCount.h>
 #include <Bpp/Phyl/Mapping/SubstitutionMappingTools.h>
+#include <Bpp/Phyl/Mapping/ColumnarMappingFormat.h>
 #include <Bpp/Phyl/Likelihood/ParametrizablePhyloTree.h>
 #include <Bpp/Phyl/Likelihood/SimpleSubstitutionProcess.h>
 #include <Bpp/Phyl/Likelihood/RateAcrossSitesSubstitutionProcess.h>
 #include <Bpp/Phyl/Likelihood/PhyloLikelihoods/SingleProcessPhyloLikelihood.h>
 #include <Bpp/Seq/AlphabetIndex/GranthamAAVolumeIndex.h>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <utility>
 
 using namespace bpp;
 using namespace std;
@@ -176,6 +180,32 @@ int main()
     }
     cout << endl;
 
+    // Check batched counts against one length at a time, without the
+    // cache, so that both are computed:
+    cout << "checking batched counts..." << endl;
+    vector<shared_ptr<AbstractSubstitutionCount>> vsCount = {sCountDecDet, sCountUniDet};
+    for (auto& sCount : vsCount)
+    {
+      size_t cacheSize = sCount->getCache()->getMaxSize();
+      sCount->setCacheSize(0);
+      vector<vector<Eigen::MatrixXd>> mats;
+      sCount->storeAllNumbersOfSubstitutionsForLengths(vd, mats);
+      for (size_t l = 0; l < vd.size(); ++l)
+      {
+        for (size_t t = 0; t < sCount->getNumberOfSubstitutionTypes(); ++t)
+        {
+          Eigen::MatrixXd mat;
+          sCount->storeAllNumbersOfSubstitutions(vd[l], t + 1, mat);
+          if ((mat - mats[l][t]).cwiseAbs().maxCoeff() > 1e-10)
+            throw Exception("Batched substitution counts differ for length " + TextTools::toString(vd[l]) + " and type " + TextTools::toString(t + 1));
+        }
+      }
+      if (sCount->getCache()->getNumberOfEntries() != 0)
+        throw Exception("Substitution counts stored in a disabled cache.");
+      sCount->setCacheSize(cacheSize);
+    }
+    cout << endl;
+
     // Check per branch:
     // 1. Total:
 
@@ -255,6 +285,66 @@ int main()
       // if (abs(totalReal - totalObs) / totalReal > 0.1) return 1;
     }
 
+    // Check binary output:
+    cout << "checking binary output..." << endl;
+    size_t nbTypes = probNEWMapDecDet->getNumberOfSubstitutionTypes();
+    vector<string> typeNames;
+    for (size_t t = 0; t < nbTypes; ++t)
+    {
+      typeNames.push_back("type" + TextTools::toString(t + 1));
+    }
+    vector<int> coordinates(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      coordinates[i] = static_cast<int>(i + 1);
+    }
+    string binPath = "test_mapping.bin";
+    vector<pair<short, short>> formats = {
+      {ColumnarMappingFormat::FLOAT64, ColumnarMappingFormat::NO_COMPRESSION},
+      {ColumnarMappingFormat::FLOAT32, ColumnarMappingFormat::NO_COMPRESSION}
+    };
+    if (ColumnarMappingFormat::hasCompressionSupport())
+    {
+      formats.push_back({ColumnarMappingFormat::FLOAT64, ColumnarMappingFormat::ZLIB_COMPRESSION});
+      formats.push_back({ColumnarMappingFormat::FLOAT32, ColumnarMappingFormat::ZLIB_COMPRESSION});
+    }
+    for (const auto& format : formats)
+    {
+      // Values are rounded to single precision in FLOAT32 files:
+      double tol = (format.first == ColumnarMappingFormat::FLOAT32) ? 1e-6 : 1e-12;
+      ColumnarMappingFormat::write(binPath, *probNEWMapDecDet, ids, typeNames, coordinates, format.first, format.second, 100);
+      {
+        ColumnarMappingReader reader(binPath);
+        if (reader.getNumberOfSites() != n || reader.getNumberOfBranches() != ids.size() || reader.getNumberOfTypes() != nbTypes)
+          throw Exception("Binary mapping output: wrong dimensions.");
+        vector<double> values;
+        for (size_t j = 0; j < ids.size(); ++j)
+        {
+          for (size_t t = 0; t < nbTypes; ++t)
+          {
+            reader.readSiteColumn(reader.getBranchIndex(ids[j]), reader.getTypeIndex(typeNames[t]), 0, n, values);
+            for (size_t i = 0; i < n; ++i)
+            {
+              double count = probNEWMapDecDet->getCount(ids[j], i, t);
+              if (abs(values[i] - count) > tol * max(1., abs(count)))
+                throw Exception("Binary mapping output: wrong value for branch " + TextTools::toString(ids[j]) + ", site " + TextTools::toString(i) + ", type " + TextTools::toString(t) + ", value size " + TextTools::toString(format.first) + ", compression " + TextTools::toString(format.second));
+            }
+          }
+        }
+      }
+      std::remove(binPath.c_str());
+    }
+
+    // Per-site counts must have one value per branch and per type:
+    VVVdouble badCounts(n, VVdouble(ids.size(), Vdouble(nbTypes + 1)));
+    try
+    {
+      ColumnarMappingFormat::write(binPath, badCounts, ids, typeNames, coordinates);
+      std::remove(binPath.c_str());
+      throw Exception("Binary mapping output: counts of wrong dimensions accepted.");
+    }
+    catch (BadSizeException&)
+    {}
 
     // -------------
   }
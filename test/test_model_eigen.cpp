@@ -0,0 +1,392 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include <Bpp/Numeric/Matrix/MatrixTools.h>
+#include <Bpp/Phyl/Likelihood/DataFlow/Model.h>
+#include <Bpp/Phyl/Model/Codon/CodonDistanceSubstitutionModel.h>
+#include <Bpp/Phyl/Model/Codon/MG94.h>
+#include <Bpp/Phyl/Model/Codon/YN98.h>
+#include <Bpp/Phyl/Model/FrequencySet/CodonFrequencySet.h>
+#include <Bpp/Phyl/Model/FrequencySet/ProteinFrequencySet.h>
+#include <Bpp/Phyl/Model/MixtureOfSubstitutionModels.h>
+#include <Bpp/Phyl/Model/Nucleotide/GTR.h>
+#include <Bpp/Phyl/Model/Nucleotide/HKY85.h>
+#include <Bpp/Phyl/Model/Nucleotide/K80.h>
+#include <Bpp/Phyl/Model/Nucleotide/RN95.h>
+#include <Bpp/Phyl/Model/Nucleotide/T92.h>
+#include <Bpp/Phyl/Model/Protein/LG08.h>
+#include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/GeneticCode/StandardGeneticCode.h>
+#include <Bpp/Text/TextTools.h>
+#include <iostream>
+#include <utility>
+
+using namespace bpp;
+using namespace std;
+
+// Transition probabilities by scaling and squaring:
+RowMatrix<double> expm(const Matrix<double>& q, double t)
+{
+  size_t n = q.getNumberOfRows();
+  RowMatrix<double> a(q), term, tmp, p;
+  MatrixTools::scale(a, t / 1024.);
+  MatrixTools::getId(n, p);
+  MatrixTools::getId(n, term);
+  for (unsigned int k = 1; k < 20; ++k)
+  {
+    MatrixTools::mult(term, a, tmp);
+    MatrixTools::scale(tmp, 1. / k);
+    term = tmp;
+    MatrixTools::add(p, term);
+  }
+  for (unsigned int k = 0; k < 10; ++k)
+  {
+    MatrixTools::mult(p, p, tmp);
+    p = tmp;
+  }
+  return p;
+}
+
+bool testModel(SubstitutionModelInterface& model)
+{
+  // Transition probabilities:
+  for (double t : {0.01, 0.3, 2.})
+  {
+    RowMatrix<double> ref = expm(model.generator(), t);
+    const Matrix<double>& pij = model.getPij_t(t);
+    for (size_t i = 0; i < ref.getNumberOfRows(); ++i)
+    {
+      for (size_t j = 0; j < ref.getNumberOfColumns(); ++j)
+      {
+        if (abs(pij(i, j) - ref(i, j)) > 1e-8)
+        {
+          cerr << model.getName() << ": wrong P(" << t << ")[" << i << "," << j << "]: " << pij(i, j) << " <> " << ref(i, j) << endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// The submodels must behave as independently built models, with fewer
+// eigen decompositions than submodels:
+bool testMixture(MixtureOfSubstitutionModels& mixture, const ParameterList& parameters, size_t nbDecompositions, vector<unique_ptr<AbstractSubstitutionModel>>& references)
+{
+  mixture.matchParametersValues(parameters);
+  if (mixture.getNumberOfEigenDecompositions() != nbDecompositions)
+  {
+    cerr << "Mixture: " << mixture.getNumberOfEigenDecompositions() << " eigen decompositions instead of " << nbDecompositions << endl;
+    return false;
+  }
+  if (mixture.getNumberOfEigenDecompositions() >= mixture.getNumberOfModels())
+  {
+    cerr << "Mixture: " << mixture.getNumberOfEigenDecompositions() << " eigen decompositions for " << mixture.getNumberOfModels() << " submodels" << endl;
+    return false;
+  }
+  for (size_t n = 0; n < mixture.getNumberOfModels(); ++n)
+  {
+    const auto& model = dynamic_cast<const SubstitutionModelInterface&>(mixture.nModel(n));
+    RowMatrix<double> ref = expm(model.generator(), 0.3 * model.getRate());
+    const Matrix<double>& pij = model.getPij_t(0.3);
+    for (size_t i = 0; i < ref.getNumberOfRows(); ++i)
+    {
+      for (size_t j = 0; j < ref.getNumberOfColumns(); ++j)
+      {
+        if (abs(pij(i, j) - ref(i, j)) > 1e-8)
+        {
+          cerr << "Mixture: wrong P for submodel " << n << endl;
+          return false;
+        }
+      }
+    }
+
+    references[n]->setRate(model.getRate());
+    const Matrix<double>& refPij = references[n]->getPij_t(0.3);
+    for (size_t i = 0; i < refPij.getNumberOfRows(); ++i)
+    {
+      for (size_t j = 0; j < refPij.getNumberOfColumns(); ++j)
+      {
+        if (abs(pij(i, j) - refPij(i, j)) > 1e-10)
+        {
+          cerr << "Mixture: P for submodel " << n << " differs from the one of an independent model: " << pij(i, j) << " <> " << refPij(i, j) << endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool compareMatrices(const string& name, const Matrix<double>& m1, const Matrix<double>& m2, double tol)
+{
+  for (size_t i = 0; i < m1.getNumberOfRows(); ++i)
+  {
+    for (size_t j = 0; j < m1.getNumberOfColumns(); ++j)
+    {
+      if (abs(m1(i, j) - m2(i, j)) > tol)
+      {
+        cerr << name << ": wrong value [" << i << "," << j << "]: " << m1(i, j) << " <> " << m2(i, j) << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Pade approximants and action of the exponential on a block of vectors:
+bool testExponential(AbstractSubstitutionModel& model)
+{
+  model.setExponentialMethod(AbstractSubstitutionModel::ExponentialMethod::PADE);
+  model.enableEigenDecomposition(false);
+  size_t n = model.getNumberOfStates();
+  double h = 1e-5;
+  for (double t : {0.01, 0.3, 2.})
+  {
+    RowMatrix<double> ref = expm(model.generator(), t * model.getRate());
+    if (!compareMatrices(model.getName() + " Pade P(" + TextTools::toString(t) + ")", model.getPij_t(t), ref, 1e-8))
+      return false;
+
+    RowMatrix<double> pp(model.getPij_t(t + h)), pm(model.getPij_t(t - h)), p(model.getPij_t(t));
+    RowMatrix<double> d1(n, n), d2(n, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      for (size_t j = 0; j < n; ++j)
+      {
+        d1(i, j) = (pp(i, j) - pm(i, j)) / (2 * h);
+        d2(i, j) = (pp(i, j) - 2 * p(i, j) + pm(i, j)) / (h * h);
+      }
+    }
+    if (!compareMatrices(model.getName() + " Pade dP(" + TextTools::toString(t) + ")", model.getdPij_dt(t), d1, 1e-6))
+      return false;
+    if (!compareMatrices(model.getName() + " Pade d2P(" + TextTools::toString(t) + ")", model.getd2Pij_dt2(t), d2, 1e-3))
+      return false;
+
+    Eigen::MatrixXd values = Eigen::MatrixXd::Random(Eigen::Index(n), 50).cwiseAbs();
+    Eigen::MatrixXd result;
+    for (size_t nDeriv = 0; nDeriv < 3; ++nDeriv)
+    {
+      const Matrix<double>& pij = nDeriv == 0 ? model.getPij_t(t) : (nDeriv == 1 ? model.getdPij_dt(t) : model.getd2Pij_dt2(t));
+      Eigen::MatrixXd dense(Eigen::Index(n), Eigen::Index(n));
+      for (size_t i = 0; i < n; ++i)
+      {
+        for (size_t j = 0; j < n; ++j)
+        {
+          dense(Eigen::Index(i), Eigen::Index(j)) = pij(i, j);
+        }
+      }
+      model.applyPij_t(t, values, result, nDeriv);
+      double diff = (result - dense * values).cwiseAbs().maxCoeff();
+      if (diff > 1e-8 * max(1., (dense * values).cwiseAbs().maxCoeff()))
+      {
+        cerr << model.getName() << ": wrong action of the exponential, order " << nDeriv << ", t=" << t << ": " << diff << endl;
+        return false;
+      }
+    }
+  }
+
+  model.enableEigenDecomposition(true);
+  model.setExponentialMethod(AbstractSubstitutionModel::ExponentialMethod::EIGEN);
+  return true;
+}
+
+// Derivatives of the transition matrices with respect to the parameters:
+template<class M>
+bool testParameterDerivatives(const M& model, const vector<string>& names)
+{
+  size_t n = model.getNumberOfStates();
+  double h = 1e-6;
+  for (const auto& name : names)
+  {
+    if (!model.hasGeneratorDerivative(name))
+    {
+      cerr << model.getName() << ": no derivative with respect to " << name << endl;
+      return false;
+    }
+    double x = model.getParameterValue(model.getParameterNameWithoutNamespace(name));
+    unique_ptr<M> mp(model.clone()), mm(model.clone());
+    mp->setParameterValue(model.getParameterNameWithoutNamespace(name), x + h);
+    mm->setParameterValue(model.getParameterNameWithoutNamespace(name), x - h);
+    for (double t : {0.01, 0.3, 2.})
+    {
+      RowMatrix<double> pp(mp->getPij_t(t)), pm(mm->getPij_t(t)), d(n, n);
+      for (size_t i = 0; i < n; ++i)
+      {
+        for (size_t j = 0; j < n; ++j)
+        {
+          d(i, j) = (pp(i, j) - pm(i, j)) / (2 * h);
+        }
+      }
+      if (!compareMatrices(model.getName() + " dP(" + TextTools::toString(t) + ")/d" + name, model.getdPij_dparam(t, name), d, 1e-7))
+        return false;
+    }
+  }
+  return true;
+}
+
+// The sparse generator has the non-zero rates of the dense one:
+bool testSparseGenerator(const SubstitutionModelInterface& model)
+{
+  const auto& sparse = model.sparseGenerator();
+  const auto& dense = model.generator();
+  size_t nbNonZero = 0;
+  for (size_t i = 0; i < dense.getNumberOfRows(); ++i)
+  {
+    for (size_t j = 0; j < dense.getNumberOfColumns(); ++j)
+    {
+      if (dense(i, j) != 0)
+        nbNonZero++;
+      if (sparse.coeff(Eigen::Index(i), Eigen::Index(j)) != dense(i, j))
+      {
+        cerr << model.getName() << ": wrong sparse generator [" << i << "," << j << "]" << endl;
+        return false;
+      }
+    }
+  }
+  return size_t(sparse.nonZeros()) == nbNonZero;
+}
+
+int main()
+{
+  GTR gtr(AlphabetTools::DNA_ALPHABET, 1.2, 0.4, 0.5, 0.9, 1.7, 0.1, 0.2, 0.3, 0.4);
+  if (!testModel(gtr))
+    return 1;
+
+  LG08 lg08(AlphabetTools::PROTEIN_ALPHABET, make_unique<FullProteinFrequencySet>(AlphabetTools::PROTEIN_ALPHABET), true);
+  if (!testModel(lg08))
+    return 1;
+
+  auto gc = make_shared<StandardGeneticCode>(AlphabetTools::DNA_ALPHABET);
+  YN98 yn98(gc, CodonFrequencySetInterface::getFrequencySetForCodons(CodonFrequencySetInterface::F3X4, gc));
+  yn98.setParameterValue("kappa", 2.5);
+  yn98.setParameterValue("omega", 0.3);
+  if (!testModel(yn98))
+    return 1;
+
+  RN95 rn95(AlphabetTools::DNA_ALPHABET, 0.6, 0.1, 0.3, 0.2, 0.8, 0.3, 0.1, 0.5);
+  if (!testExponential(rn95))
+    return 1;
+
+  K80 k80(AlphabetTools::DNA_ALPHABET, 2.5);
+  if (!testParameterDerivatives(k80, {"K80.kappa"}))
+    return 1;
+
+  T92 t92(AlphabetTools::DNA_ALPHABET, 3., 0.3);
+  if (!testParameterDerivatives(t92, {"T92.kappa", "T92.theta"}))
+    return 1;
+  t92.setExponentialMethod(AbstractSubstitutionModel::ExponentialMethod::PADE);
+  t92.enableEigenDecomposition(false);
+  if (!testParameterDerivatives(t92, {"T92.kappa", "T92.theta"}))
+    return 1;
+
+  HKY85 hky85(AlphabetTools::DNA_ALPHABET, 2.5, 0.1, 0.2, 0.3, 0.4);
+  if (!testParameterDerivatives(hky85, {"HKY85.kappa"}))
+    return 1;
+
+  if (!testParameterDerivatives(gtr, {"GTR.a", "GTR.b", "GTR.c", "GTR.d", "GTR.e"}))
+    return 1;
+
+  // Codon models: derivatives with respect to omega, through the model
+  // they are defined with.
+  const auto& yn98Model = dynamic_cast<const CodonDistanceFrequenciesSubstitutionModel&>(yn98.substitutionModel());
+  if (!testParameterDerivatives(yn98Model, {"YN98.beta"}))
+    return 1;
+  MG94 mg94(gc, CodonFrequencySetInterface::getFrequencySetForCodons(CodonFrequencySetInterface::F3X4, gc));
+  mg94.setParameterValue("rho", 0.3);
+  const auto& mg94Model = dynamic_cast<const CodonDistancePhaseFrequenciesSubstitutionModel&>(mg94.substitutionModel());
+  if (!testParameterDerivatives(mg94Model, {"MG94.beta"}))
+    return 1;
+  vector<pair<const BranchModelInterface*, string>> omegas = {{&yn98, "YN98.omega"}, {&mg94, "MG94.rho"}};
+  for (const auto& omega : omegas)
+  {
+    size_t nParam = omega.first->getIndependentParameters().whichParameterHasName(omega.second);
+    if (!TransitionMatrixDerivativeFromModel::isAnalytic(*omega.first, nParam))
+    {
+      cerr << omega.first->getName() << ": no analytic derivative with respect to " << omega.second << endl;
+      return 1;
+    }
+  }
+
+  CodonDistanceSubstitutionModel codon(gc, make_unique<K80>(AlphabetTools::DNA_ALPHABET, 2.), nullptr);
+  codon.setParameterValue("beta", 0.4);
+  if (!testSparseGenerator(codon))
+    return 1;
+  codon.setParameterValue("beta", 0.5);
+  if (!testSparseGenerator(codon))
+    return 1;
+  if (!testExponential(codon))
+    return 1;
+  if (!testParameterDerivatives(codon, {codon.getNamespace() + "beta"}))
+    return 1;
+
+  // Copies of a model with different rates have the same generator:
+  // they share one eigen decomposition, and submodels are updated only
+  // if their parameters change:
+  vector<unique_ptr<TransitionModelInterface>> vModels;
+  vModels.push_back(make_unique<GTR>(AlphabetTools::DNA_ALPHABET, 1.2, 0.4, 0.5, 0.9, 1.7, 0.1, 0.2, 0.3, 0.4));
+  vModels.push_back(make_unique<GTR>(AlphabetTools::DNA_ALPHABET, 1.2, 0.4, 0.5, 0.9, 1.7, 0.1, 0.2, 0.3, 0.4));
+  Vdouble vproba = {0.3, 0.7};
+  Vdouble vrate = {0.5, 1.5};
+  MixtureOfSubstitutionModels mixture(AlphabetTools::DNA_ALPHABET, vModels, vproba, vrate);
+
+  // Independently built submodels, with their own decompositions:
+  vector<unique_ptr<AbstractSubstitutionModel>> references;
+  references.push_back(make_unique<GTR>(AlphabetTools::DNA_ALPHABET, 1.2, 0.4, 0.5, 0.9, 1.7, 0.1, 0.2, 0.3, 0.4));
+  references.push_back(make_unique<GTR>(AlphabetTools::DNA_ALPHABET, 1.2, 0.4, 0.5, 0.9, 1.7, 0.1, 0.2, 0.3, 0.4));
+
+  ParameterList both;
+  both.addParameter(Parameter("Mixture.1_GTR.a", 2.));
+  both.addParameter(Parameter("Mixture.2_GTR.a", 2.));
+  references[0]->setParameterValue("a", 2.);
+  references[1]->setParameterValue("a", 2.);
+  if (!testMixture(mixture, both, 1, references))
+    return 1;
+
+  ParameterList first;
+  first.addParameter(Parameter("Mixture.1_GTR.a", 1.5));
+  references[0]->setParameterValue("a", 1.5);
+  if (!testMixture(mixture, first, 1, references))
+    return 1;
+
+  ParameterList proba;
+  proba.addParameter(Parameter("Mixture.relproba1", 0.5));
+  if (!testMixture(mixture, proba, 0, references))
+    return 1;
+
+  // A model whose generator is not normalized is proportional to the
+  // normalized one: it takes its eigen decomposition, with rescaled
+  // eigen values. GTR normalizes its exchangeabilities itself, hence
+  // a codon model is used.
+  CodonDistanceSubstitutionModel donor(gc, make_unique<K80>(AlphabetTools::DNA_ALPHABET, 2.), nullptr);
+  CodonDistanceSubstitutionModel scaled(gc, make_unique<K80>(AlphabetTools::DNA_ALPHABET, 2.), nullptr);
+  scaled.setScalable(false);
+  scaled.setEigenDecompositionDonors({&donor});
+  donor.setParameterValue("beta", 0.3);
+  size_t nbDecompositions = scaled.getNumberOfEigenDecompositions();
+  scaled.setParameterValue("beta", 0.3);
+  scaled.setEigenDecompositionDonors({});
+  if (scaled.getNumberOfEigenDecompositions() != nbDecompositions)
+  {
+    cerr << "Scaled codon model: eigen decomposition not taken from the donor." << endl;
+    return 1;
+  }
+  double scale = scaled.getScale() / donor.getScale();
+  if (abs(scale - 1.) < 0.01)
+  {
+    cerr << "Scaled codon model: generators should not be equal." << endl;
+    return 1;
+  }
+  for (size_t i = 0; i < donor.getNumberOfStates(); ++i)
+  {
+    if (abs(scaled.getEigenValues()[i] - scale * donor.getEigenValues()[i]) > 1e-10)
+    {
+      cerr << "Scaled codon model: wrong eigen value " << i << ": " << scaled.getEigenValues()[i] << " <> " << scale * donor.getEigenValues()[i] << endl;
+      return 1;
+    }
+  }
+  if (!testModel(scaled))
+    return 1;
+
+  return 0;
+}
@@ -3,10 +3,15 @@
 // SPDX-License-Identifier: CECILL-2.1
 
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Alphabet/CodonAlphabet.h>
+#include <Bpp/Seq/Container/VectorSiteContainer.h>
 #include <Bpp/Seq/Io/Phylip.h>
 #include <Bpp/Phyl/Tree/Tree.h>
 #include <Bpp/Phyl/Io/Newick.h>
+#include <Bpp/Phyl/Legacy/OptimizationTools.h>
+#include <Bpp/Phyl/Parsimony/BitParallelTreeParsimonyScore.h>
 #include <Bpp/Phyl/Parsimony/DRTreeParsimonyScore.h>
+#include <algorithm>
 #include <iostream>
 
 using namespace bpp;
@@ -28,6 +33,97 @@ int main()
 
     if (pars.getScore() != 9)
       return 1;
+
+    BitParallelTreeParsimonyScore bpPars(make_shared<TreeTemplate<Node>>(*tree), sites, true, true);
+
+    cout << "Bit-parallel parsimony score: " << bpPars.getScore() << endl;
+
+    if (bpPars.getScore() != pars.getScore())
+      return 1;
+    if (bpPars.getScorePerSite() != pars.getScorePerSite())
+      return 1;
+
+    // SPR moves must be scored exactly:
+    auto sprTree = make_shared<TreeTemplate<Node>>(*tree);
+    auto sprPars = make_shared<BitParallelTreeParsimonyScore>(sprTree, sites, false, true);
+    vector<int> ids = sprTree->getNodesId();
+    for (auto id : ids)
+    {
+      if (!sprPars->isSPRPossible(id))
+        continue;
+      int targetId;
+      double diff = sprPars->testSPR(id, targetId);
+      unsigned int score = sprPars->getScore();
+      // Testing must leave the arrays unchanged:
+      BitParallelTreeParsimonyScore fresh(make_shared<TreeTemplate<Node>>(*sprTree), sites, false, true);
+      for (auto nniId : ids)
+      {
+        const Node* nniNode = sprTree->getNode(nniId);
+        if (nniNode->hasFather() && nniNode->getFather()->hasFather() && sprPars->testNNI(nniId) != fresh.testNNI(nniId))
+          return 1;
+      }
+      sprPars->doSPR(id, targetId);
+      BitParallelTreeParsimonyScore check(make_shared<TreeTemplate<Node>>(*sprTree), sites, false, true);
+      if (check.getScore() != sprPars->getScore() || (double)sprPars->getScore() != (double)score + diff)
+        return 1;
+    }
+    sprPars = LegacyOptimizationTools::optimizeTreeSPR(sprPars, 1);
+    if (sprPars->getScore() > pars.getScore())
+      return 1;
+
+    // Codon alphabet: with codons made of three identical nucleotides,
+    // scores are the ones of the nucleotide alignment.
+    auto dnaSites = make_shared<VectorSiteContainer>(AlphabetTools::DNA_ALPHABET);
+    auto codonAlphabet = make_shared<CodonAlphabet>(AlphabetTools::DNA_ALPHABET);
+    auto codonSites = make_shared<VectorSiteContainer>(codonAlphabet);
+    for (const auto& name : sites->getSequenceNames())
+    {
+      string dna = sites->sequence(name).toString();
+      replace(dna.begin(), dna.end(), '-', 'A');
+      string codons;
+      for (char c : dna)
+      {
+        codons += string(3, c);
+      }
+      auto dnaSeq = make_unique<Sequence>(name, dna, AlphabetTools::DNA_ALPHABET);
+      dnaSites->addSequence(name, dnaSeq);
+      auto codonSeq = make_unique<Sequence>(name, codons, codonAlphabet);
+      codonSites->addSequence(name, codonSeq);
+    }
+    DRTreeParsimonyScore dnaPars(make_shared<TreeTemplate<Node>>(*tree), dnaSites, false, false);
+    BitParallelTreeParsimonyScore codonPars(make_shared<TreeTemplate<Node>>(*tree), codonSites, false, false);
+    cout << "Codon parsimony score: " << codonPars.getScore() << endl;
+    if (codonPars.getScore() != dnaPars.getScore() || codonPars.getScorePerSite() != dnaPars.getScorePerSite())
+      return 1;
+
+    // More than 64 distinct sites, stored in several words:
+    const string nucleotides = "ACGT";
+    auto longSites = make_shared<VectorSiteContainer>(AlphabetTools::DNA_ALPHABET);
+    unsigned int seed = 1;
+    for (const auto& name : sites->getSequenceNames())
+    {
+      string seq;
+      for (size_t i = 0; i < 300; ++i)
+      {
+        seed = seed * 1103515245 + 12345;
+        seq += nucleotides[(seed >> 16) % 4];
+      }
+      auto longSeq = make_unique<Sequence>(name, seq, AlphabetTools::DNA_ALPHABET);
+      longSites->addSequence(name, longSeq);
+    }
+    DRTreeParsimonyScore longPars(make_shared<TreeTemplate<Node>>(*tree), longSites, false, true);
+    BitParallelTreeParsimonyScore bpLongPars(make_shared<TreeTemplate<Node>>(*tree), longSites, false, true);
+    cout << "Parsimony score on " << bpLongPars.getNumberOfDistinctSites() << " distinct sites: " << bpLongPars.getScore() << endl;
+    if (bpLongPars.getNumberOfDistinctSites() <= 64)
+      return 1;
+    if (bpLongPars.getScore() != longPars.getScore() || bpLongPars.getScorePerSite() != longPars.getScorePerSite())
+      return 1;
+    for (auto id : tree->getNodesId())
+    {
+      const Node* node = tree->getNode(id);
+      if (node->hasFather() && node->getFather()->hasFather() && bpLongPars.testNNI(id) != longPars.testNNI(id))
+        return 1;
+    }
   }
   catch (Exception& ex)
   {
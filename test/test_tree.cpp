@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <fstream>
 
 using namespace bpp;
 using namespace std;
@@ -124,6 +125,37 @@ int main()
   }
   cout << "Newick multiple I/O ok." << endl;
 
+  // Read the same trees one at a time, with a small buffer:
+  ifstream treeStream("tmp_trees.dnd");
+  NewickTreeIterator treeIt(tReader, treeStream, 100);
+  size_t nbTrees = 0;
+  while (treeIt.hasMoreTrees())
+  {
+    auto tree = treeIt.nextTree();
+    if (nbTrees >= trees.size() || !TreeTools::haveSameTopology(*trees[nbTrees], *tree))
+    {
+      cerr << "Tree " << nbTrees << " failed to be read by iterator!" << endl;
+      return 1;
+    }
+    nbTrees++;
+  }
+  if (nbTrees != trees.size())
+    return 1;
+  cout << "Newick iterator ok." << endl;
+
+  // A deep caterpillar tree:
+  string caterpillar(4999, '(');
+  caterpillar += "leaf0";
+  for (size_t i = 1; i < 5000; ++i)
+  {
+    caterpillar += ",leaf" + TextTools::toString(i) + ":0.1)";
+  }
+  caterpillar += ";";
+  auto deep = tReader.parseTreeTemplate(caterpillar.data(), caterpillar.data() + caterpillar.size());
+  if (deep->getNumberOfLeaves() != 5000)
+    return 1;
+  cout << "Caterpillar tree ok." << endl;
+
   for (unsigned int i = 0; i < 100; ++i)
   {
     delete trees[i];